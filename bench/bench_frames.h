@@ -0,0 +1,145 @@
+#pragma once
+
+// Генератор синтетических CRSF-кадров для бенчмарков.
+// Поток имитирует полётный контроллер: RC-каналы, статистика связи, GPS, батарея, положение
+
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <random>
+#include <vector>
+#include "libs/crsf/crc8.h"
+#include "libs/crsf/crsf_protocol.h"
+
+namespace bench {
+
+// Добавить в поток кадр [addr][len][type][payload][crc]
+inline void appendFrame(std::vector<uint8_t>& out, uint8_t type, const uint8_t* payload, uint8_t len)
+{
+    uint8_t buf[CRSF_MAX_PACKET_SIZE];
+    buf[0] = CRSF_ADDRESS_FLIGHT_CONTROLLER;
+    buf[1] = len + 2;
+    buf[2] = type;
+    memcpy(buf + 3, payload, len);
+    buf[len + 3] = crc8_calc(&buf[2], len + 1);
+    out.insert(out.end(), buf, buf + len + 4);
+}
+
+inline void appendChannels(std::vector<uint8_t>& out, unsigned seed)
+{
+    crsf_channels_t ch{};
+    ch.ch0 = CRSF_CHANNEL_VALUE_1000 + (seed * 7) % 1600;
+    ch.ch1 = CRSF_CHANNEL_VALUE_1000 + (seed * 13) % 1600;
+    ch.ch2 = CRSF_CHANNEL_VALUE_MID;
+    ch.ch3 = CRSF_CHANNEL_VALUE_MID;
+    ch.ch4 = CRSF_CHANNEL_VALUE_1000;
+    ch.ch5 = CRSF_CHANNEL_VALUE_2000;
+    appendFrame(out, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, (const uint8_t*)&ch, CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE);
+}
+
+inline void appendLinkStatistics(std::vector<uint8_t>& out, unsigned seed)
+{
+    uint8_t p[CRSF_FRAME_LINK_STATISTICS_PAYLOAD_SIZE] = {
+        uint8_t(60 + seed % 20), 70, 100, 10, 0, 4, 3, 65, 99, 9 };
+    appendFrame(out, CRSF_FRAMETYPE_LINK_STATISTICS, p, sizeof(p));
+}
+
+inline void appendGps(std::vector<uint8_t>& out, unsigned seed)
+{
+    crsf_sensor_gps_t gps{};
+    gps.latitude = htobe32(557558000 + seed);
+    gps.longitude = htobe32(376176000 - seed);
+    gps.groundspeed = htobe16(120);
+    gps.heading = htobe16(18000);
+    gps.altitude = htobe16(1150);
+    gps.satellites = 12;
+    appendFrame(out, CRSF_FRAMETYPE_GPS, (const uint8_t*)&gps, CRSF_FRAME_GPS_PAYLOAD_SIZE);
+}
+
+inline void appendBattery(std::vector<uint8_t>& out, unsigned seed)
+{
+    uint8_t p[CRSF_FRAME_BATTERY_SENSOR_PAYLOAD_SIZE] = {
+        0x04, 0xD8, 0x00, uint8_t(seed & 0xFF), 0x00, 0x01, 0x2C, 87 };
+    appendFrame(out, CRSF_FRAMETYPE_BATTERY_SENSOR, p, sizeof(p));
+}
+
+inline void appendAttitude(std::vector<uint8_t>& out, unsigned seed)
+{
+    int16_t v[3] = { int16_t(htobe16(uint16_t(seed * 3))), int16_t(htobe16(uint16_t(-100))), int16_t(htobe16(9000)) };
+    appendFrame(out, CRSF_FRAMETYPE_ATTITUDE, (const uint8_t*)v, CRSF_FRAME_ATTITUDE_PAYLOAD_SIZE);
+}
+
+// Смешанный поток: половина кадров — RC-каналы, остальные — телеметрия по очереди
+inline std::vector<uint8_t> mixedStream(unsigned frames, unsigned* frameCount = nullptr)
+{
+    std::vector<uint8_t> out;
+    out.reserve(frames * 24);
+    for (unsigned i = 0; i < frames; ++i) {
+        switch (i % 8) {
+        case 1: appendLinkStatistics(out, i); break;
+        case 3: appendGps(out, i); break;
+        case 5: appendBattery(out, i); break;
+        case 7: appendAttitude(out, i); break;
+        default: appendChannels(out, i); break;
+        }
+    }
+    if (frameCount) *frameCount = frames;
+    return out;
+}
+
+// Поток только из RC-кадров
+inline std::vector<uint8_t> channelsStream(unsigned frames)
+{
+    std::vector<uint8_t> out;
+    out.reserve(frames * (CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + 4));
+    for (unsigned i = 0; i < frames; ++i)
+        appendChannels(out, i);
+    return out;
+}
+
+// Кадры максимального размера (64 байта) с произвольной нагрузкой
+inline std::vector<uint8_t> maxFrameStream(unsigned frames)
+{
+    std::vector<uint8_t> out;
+    out.reserve(size_t(frames) * CRSF_MAX_PACKET_SIZE);
+    uint8_t payload[CRSF_MAX_PAYLOAD_LEN];
+    for (unsigned i = 0; i < frames; ++i) {
+        for (unsigned j = 0; j < sizeof(payload); ++j)
+            payload[j] = static_cast<uint8_t>(i * 31 + j * 7);
+        appendFrame(out, CRSF_FRAMETYPE_MSP_RESP, payload, sizeof(payload));
+    }
+    return out;
+}
+
+// Испортить по одному биту в pct процентах кадров (попадает в CRC, длину или байт синхронизации).
+// Разметка кадров берётся из исходного, ещё целого потока
+inline void corrupt(std::vector<uint8_t>& stream, unsigned pct, unsigned seed = 1)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned> pctDist(0, 99);
+    size_t pos = 0;
+    while (pos + 1 < stream.size()) {
+        size_t len = stream[pos + 1] + 2;
+        if (pctDist(rng) < pct)
+            stream[pos + rng() % len] ^= static_cast<uint8_t>(1u << (rng() % 8));
+        pos += len;
+    }
+}
+
+// Длины пачек 1..64 байта, как их отдаёт readv на 420000 бод при цикле ~1 мс
+inline std::vector<uint32_t> randomChunks(size_t total, unsigned seed = 1)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> len(1, 64);
+    std::vector<uint32_t> out;
+    size_t pos = 0;
+    while (pos < total) {
+        uint32_t n = len(rng);
+        if (n > total - pos) n = static_cast<uint32_t>(total - pos);
+        out.push_back(n);
+        pos += n;
+    }
+    return out;
+}
+
+} // namespace bench
@@ -0,0 +1,137 @@
+// Разбор большого захвата UART на нескольких ядрах (libs/crsf/CrsfCaptureAnalyzer): время и ускорение
+// от числа потоков, совпадение счётчиков с разбором одним потоком.
+// Захваты синтетические (как bench/crsf_replay --synth): смешанный поток на 420000 бод, пачки 1..64 байта;
+// clean — без ошибок, noisy — 1% кадров с испорченным битом. Файлы пишутся в /tmp и удаляются в конце.
+//
+// Метрики:
+//   baseline — CrsfParser одним потоком по пачкам захвата, без статистики по типам: ms, mb_per_s
+//   analyze  — CrsfCaptureAnalyzer::analyze(jobs): ms (все стадии), mb_per_s, speedup относительно jobs=1,
+//              parse_ms — стадия разбора; match — frames, crc_errors, resyncs и dropped_bytes
+//              совпадают с baseline, а статистика по типам и серии ошибок CRC — с jobs=1
+// cores — ядер в системе: ускорение выше cores не ожидается
+//
+// Использование:
+//   ./bench/capture_analyze_bench [МБ_захвата=32] [потоков_макс=8]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/crsf/CrsfCapture.h"
+#include "libs/crsf/CrsfCaptureAnalyzer.h"
+#include "libs/crsf/CrsfParser.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct NoTransport {
+    size_t readBulk(uint8_t*, size_t, uint8_t*, size_t) { return 0; }
+};
+
+struct NoClock {
+    static uint32_t millis() { return 0; }
+};
+
+struct CountSink {
+    uint64_t frames = 0;
+    void onFrame(const uint8_t*, uint8_t) { ++frames; }
+    void onSkippedByte(uint8_t) {}
+};
+
+typedef CrsfFrameTypes<CRSF_FRAMETYPE_RC_CHANNELS_PACKED> ChannelsOnly;
+
+bool writeCapture(const std::string& path, size_t mb, unsigned noisePct)
+{
+    // Средний кадр смешанного потока ~24 байта
+    std::vector<uint8_t> stream = bench::mixedStream(static_cast<unsigned>(mb * 1048576 / 24));
+    bench::corrupt(stream, noisePct);
+    CrsfCaptureWriter out;
+    if (!out.open(path.c_str(), CRSF_BAUDRATE)) return false;
+    size_t pos = 0;
+    for (uint32_t len : bench::randomChunks(stream.size())) {
+        pos += len;
+        out.writeAt(pos * 10 * 1000000ull / CRSF_BAUDRATE, &stream[pos - len], len);
+    }
+    out.close();
+    return true;
+}
+
+bool sameTypes(const CrsfCaptureStats& a, const CrsfCaptureStats& b)
+{
+    for (unsigned t = 0; t < 256; ++t) {
+        const CrsfCaptureTypeStats& x = a.types[t];
+        const CrsfCaptureTypeStats& y = b.types[t];
+        if (x.frames != y.frames || x.gaps != y.gaps || x.gapSumUs != y.gapSumUs || x.gapMaxUs != y.gapMaxUs ||
+            x.gapHist != y.gapHist || x.perSecond != y.perSecond)
+            return false;
+    }
+    return a.crcBursts == b.crcBursts && a.crcBurstMax == b.crcBurstMax &&
+           !memcmp(a.crcBurstHist, b.crcBurstHist, sizeof(a.crcBurstHist)) &&
+           !memcmp(a.lqHist, b.lqHist, sizeof(a.lqHist));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t mb = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 32;
+    const unsigned maxJobs = (argc > 2) ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 8;
+    printf("cores=%u\n", std::thread::hardware_concurrency());
+    bool ok = true;
+
+    const struct {
+        const char* name;
+        unsigned noise;
+    } corpora[] = { { "clean", 0 }, { "noisy", 1 } };
+    for (const auto& corpus : corpora) {
+        const std::string path = "/tmp/crsf_analyze_bench." + std::to_string(getpid()) + "." + corpus.name + ".cap";
+        if (!writeCapture(path, mb, corpus.noise)) {
+            fprintf(stderr, "не удалось записать %s\n", path.c_str());
+            return 1;
+        }
+        CrsfCaptureAnalyzer analyzer;
+        if (!analyzer.open(path.c_str())) return 1;
+        const double fileMb = analyzer.reader().size() / 1048576.0;
+
+        // Прогрев страничного кэша и эталон: один парсер по всем пачкам
+        NoTransport transport;
+        CountSink sink;
+        CrsfParser<NoTransport, NoClock, CountSink, ChannelsOnly> parser(transport, sink);
+        CrsfCaptureReader::Position at = analyzer.reader().begin();
+        CrsfCaptureReader::Chunk c;
+        auto t0 = Clock::now();
+        while (analyzer.reader().next(at, c))
+            parser.receive(c.data, c.len);
+        const double baseMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        const CrsfRxStats& ref = parser.stats();
+        printf("corpus=%s mode=baseline file_mb=%.1f frames=%u crc_errors=%u ms=%.1f mb_per_s=%.0f\n", corpus.name,
+               fileMb, ref.frames, ref.crcErrors, baseMs, fileMb / (baseMs / 1000.0));
+
+        CrsfCaptureStats one;
+        double oneMs = 0;
+        for (unsigned jobs = 1; jobs <= maxJobs; jobs *= 2) {
+            t0 = Clock::now();
+            const CrsfCaptureStats st = analyzer.analyze(jobs);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            if (jobs == 1) {
+                one = st;
+                oneMs = ms;
+            }
+            const bool match = st.frames == ref.frames && st.crcErrors == ref.crcErrors &&
+                               st.resyncs == ref.resyncs && st.droppedBytes == ref.droppedBytes && sameTypes(st, one);
+            ok = ok && match;
+            printf("corpus=%s mode=analyze jobs=%u parts=%u ms=%.1f mb_per_s=%.0f speedup=%.2f index_ms=%.1f "
+                   "entry_ms=%.1f parse_ms=%.1f frames=%llu crc_bursts=%llu boundary_partial=%llu match=%s\n",
+                   corpus.name, jobs, st.jobs, ms, fileMb / (ms / 1000.0), oneMs / ms, st.indexUs / 1000.0,
+                   st.entryUs / 1000.0, st.parseUs / 1000.0, (unsigned long long)st.frames,
+                   (unsigned long long)st.crcBursts, (unsigned long long)st.boundaryPartial, match ? "yes" : "NO");
+        }
+        unlink(path.c_str());
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+// Задержка команды управления: от отправки клиентом до CrsfSerial::setChannel() и ответа сервера.
+// Веб-сервер телеметрии (startTelemetryServer, порт 18082) и клиенты в одном процессе, loopback.
+//
+// Транспорты:
+//   http_close     — GET /api/command?cmd=setChannel на новом подключении (как curl в set_all_channels.sh)
+//   http_keepalive — то же на одном keep-alive подключении
+//   ws             — двоичное сообщение уставок в /api/ws, ответ — подтверждение с тем же seq
+//   http_batch     — POST /api/channels (JSON) на keep-alive подключении
+// Обновления:
+//   ch1   — один канал
+//   all16 — все 16 каналов: 16 запросов /api/command против одного сообщения WebSocket или /api/channels
+//
+// Метрики: p50_us / p99_us / max_us — от отправки до ответа (уставка к этому моменту в очереди CrsfSerial),
+// errors — нет ответа или после packetChannelsSend() значение канала не совпало. Поток бенчмарка играет
+// роль тика отправки: вызывает packetChannelsSend() после каждого ответа, вне замера; кадры уходят в pty.
+// Перед замером проверяются рукопожатие (пример ключа из RFC 6455) и отбрасывание устаревших seq.
+//
+// Использование:
+//   ./bench/command_latency_bench [команд=2000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "telemetry_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int PORT = 18082;
+FILE* g_out = stdout;
+SerialPort* g_peer = nullptr;
+
+// Тик отправки: кадр каналов в pty и выборка с другой стороны, чтобы буфер pty не переполнился
+void sendTick(CrsfSerial& crsf)
+{
+    crsf.packetChannelsSend();
+    uint8_t drain[4096];
+    while (g_peer->readBulk(drain, sizeof(drain), nullptr, 0) > 0) {
+    }
+}
+
+int connectTo(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const void* data, size_t len)
+{
+    const char* p = static_cast<const char*>(data);
+    while (len) {
+        const ssize_t r = send(fd, p, len, MSG_NOSIGNAL);
+        if (r <= 0) return false;
+        p += r;
+        len -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Один ответ HTTP по Content-Length; false — ошибка или не 200
+bool readHttpResponse(int fd, std::string& buf)
+{
+    buf.clear();
+    char tmp[4096];
+    for (;;) {
+        const size_t headEnd = buf.find("\r\n\r\n");
+        if (headEnd != std::string::npos) {
+            const size_t cl = buf.find("Content-Length: ");
+            if (cl == std::string::npos || cl > headEnd) return false;
+            if (buf.size() >= headEnd + 4 + strtoul(buf.c_str() + cl + 16, nullptr, 10))
+                return buf.compare(0, 12, "HTTP/1.1 200") == 0;
+        }
+        const ssize_t r = recv(fd, tmp, sizeof(tmp), 0);
+        if (r <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(r));
+    }
+}
+
+class WsClient
+{
+public:
+    ~WsClient() { if (_fd >= 0) close(_fd); }
+
+    // Рукопожатие с ключом из примера RFC 6455: ответ обязан содержать известный Sec-WebSocket-Accept
+    bool open()
+    {
+        _fd = connectTo(PORT);
+        if (_fd < 0) return false;
+        const char* req = "GET /api/ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        if (!sendAll(_fd, req, strlen(req))) return false;
+        char tmp[4096];
+        size_t headEnd;
+        while ((headEnd = _buf.find("\r\n\r\n")) == std::string::npos) {
+            const ssize_t r = recv(_fd, tmp, sizeof(tmp), 0);
+            if (r <= 0) return false;
+            _buf.append(tmp, static_cast<size_t>(r));
+        }
+        const bool ok = _buf.compare(0, 12, "HTTP/1.1 101") == 0 &&
+                        _buf.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") < headEnd;
+        _buf.erase(0, headEnd + 4);
+        return ok;
+    }
+
+    bool sendBinary(const uint8_t* data, size_t len)
+    {
+        uint8_t frame[16 + 64];
+        if (len > 64) return false;
+        const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+        frame[0] = 0x82;
+        frame[1] = static_cast<uint8_t>(0x80 | len);
+        memcpy(frame + 2, mask, 4);
+        for (size_t i = 0; i < len; ++i)
+            frame[6 + i] = data[i] ^ mask[i & 3];
+        return sendAll(_fd, frame, 6 + len);
+    }
+
+    // Следующий двоичный кадр; текстовые (телеметрия) пропускаются
+    bool readBinary(std::string& payload)
+    {
+        char tmp[16384];
+        for (;;) {
+            if (_buf.size() >= 2) {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(_buf.data());
+                uint64_t len = p[1] & 0x7F;
+                size_t pos = 2;
+                if (len == 126 && _buf.size() >= 4) { len = (uint64_t(p[2]) << 8) | p[3]; pos = 4; }
+                else if (len == 127 && _buf.size() >= 10) {
+                    len = 0;
+                    for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+                    pos = 10;
+                }
+                if ((p[1] & 0x7F) < 126 || pos > 2) {
+                    if (_buf.size() >= pos + len) {
+                        const uint8_t opcode = p[0] & 0x0F;
+                        if (opcode == 0x2) payload.assign(_buf, pos, static_cast<size_t>(len));
+                        _buf.erase(0, pos + static_cast<size_t>(len));
+                        if (opcode == 0x2) return true;
+                        if (opcode == 0x8) return false;
+                        continue;
+                    }
+                }
+            }
+            const ssize_t r = recv(_fd, tmp, sizeof(tmp), 0);
+            if (r <= 0) return false;
+            _buf.append(tmp, static_cast<size_t>(r));
+        }
+    }
+
+    // Уставки каналов маски; статус подтверждения или -1
+    int setpoints(uint32_t seq, uint16_t mask, const int* values)
+    {
+        uint8_t msg[7 + 32];
+        msg[0] = TELEMETRY_WS_SETPOINTS;
+        for (int i = 0; i < 4; ++i) msg[1 + i] = static_cast<uint8_t>(seq >> (8 * i));
+        msg[5] = static_cast<uint8_t>(mask & 0xFF);
+        msg[6] = static_cast<uint8_t>(mask >> 8);
+        size_t len = 7;
+        for (unsigned ch = 0, i = 0; ch < 16; ++ch) {
+            if (!(mask & (1u << ch))) continue;
+            msg[len++] = static_cast<uint8_t>(values[i] & 0xFF);
+            msg[len++] = static_cast<uint8_t>(values[i] >> 8);
+            ++i;
+        }
+        std::string ack;
+        if (!sendBinary(msg, len) || !readBinary(ack) || ack.size() != 6) return -1;
+        const uint8_t* a = reinterpret_cast<const uint8_t*>(ack.data());
+        const uint32_t ackSeq = uint32_t(a[1]) | (uint32_t(a[2]) << 8) | (uint32_t(a[3]) << 16) | (uint32_t(a[4]) << 24);
+        if (a[0] != (TELEMETRY_WS_ACK | TELEMETRY_WS_SETPOINTS) || ackSeq != seq) return -1;
+        return a[5];
+    }
+
+private:
+    int _fd = -1;
+    std::string _buf;
+};
+
+struct Result {
+    std::vector<uint32_t> latUs;
+    unsigned errors = 0;
+};
+
+void report(const char* transport, const char* update, Result& r)
+{
+    std::sort(r.latUs.begin(), r.latUs.end());
+    const size_t n = r.latUs.size();
+    fprintf(g_out, "transport=%s update=%s commands=%zu p50_us=%u p99_us=%u max_us=%u errors=%u\n",
+            transport, update, n, n ? r.latUs[n / 2] : 0, n ? r.latUs[n * 99 / 100] : 0, n ? r.latUs[n - 1] : 0, r.errors);
+}
+
+uint32_t sinceUs(Clock::time_point t0)
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count());
+}
+
+// channels — сколько каналов за обновление (1 или 16), по одному запросу на канал
+Result runHttp(CrsfSerial& crsf, bool keepAlive, unsigned channels, unsigned count)
+{
+    Result res;
+    std::string buf;
+    int fd = -1;
+    char req[160];
+    for (unsigned i = 0; i < count; ++i) {
+        const int value = 1000 + static_cast<int>(i % 1001);
+        const auto t0 = Clock::now();
+        bool ok = true;
+        for (unsigned ch = 1; ch <= channels && ok; ++ch) {
+            if (fd < 0) fd = connectTo(PORT);
+            snprintf(req, sizeof(req), "GET /api/command?cmd=setChannel&value=%u=%d HTTP/1.1\r\nHost: localhost\r\n%s\r\n",
+                     ch, value, keepAlive ? "" : "Connection: close\r\n");
+            ok = fd >= 0 && sendAll(fd, req, strlen(req)) && readHttpResponse(fd, buf);
+            if (!ok || !keepAlive) {
+                if (fd >= 0) close(fd);
+                fd = -1;
+            }
+        }
+        const uint32_t us = sinceUs(t0);
+        sendTick(crsf);
+        if (ok && crsf.getChannel(channels) == value) res.latUs.push_back(us);
+        else ++res.errors;
+    }
+    if (fd >= 0) close(fd);
+    return res;
+}
+
+Result runWs(CrsfSerial& crsf, unsigned channels, unsigned count, uint32_t& seq)
+{
+    Result res;
+    WsClient ws;
+    if (!ws.open()) {
+        res.errors = count;
+        return res;
+    }
+    const uint16_t mask = (channels == 16) ? 0xFFFF : 0x0001;
+    int values[16];
+    for (unsigned i = 0; i < count; ++i) {
+        const int value = 1000 + static_cast<int>(i % 1001);
+        for (int& v : values) v = value;
+        const auto t0 = Clock::now();
+        const int status = ws.setpoints(++seq, mask, values);
+        const uint32_t us = sinceUs(t0);
+        sendTick(crsf);
+        if (status == TELEMETRY_WS_OK && crsf.getChannel(channels) == value) res.latUs.push_back(us);
+        else ++res.errors;
+    }
+    return res;
+}
+
+// Все 16 каналов одним POST /api/channels; ответ называет кадр, который понесёт значения
+Result runBatch(CrsfSerial& crsf, unsigned count)
+{
+    Result res;
+    std::string buf;
+    std::string req;
+    const int fd = connectTo(PORT);
+    for (unsigned i = 0; i < count && fd >= 0; ++i) {
+        const int value = 1000 + static_cast<int>(i % 1001);
+        std::string body = "[";
+        for (int ch = 0; ch < 16; ++ch) {
+            if (ch) body += ',';
+            body += std::to_string(value);
+        }
+        body += ']';
+        req = "POST /api/channels HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: " +
+              std::to_string(body.size()) + "\r\n\r\n" + body;
+        const auto t0 = Clock::now();
+        const bool ok = sendAll(fd, req.data(), req.size()) && readHttpResponse(fd, buf);
+        const uint32_t us = sinceUs(t0);
+        const size_t at = buf.find("\"frame\":");
+        const unsigned long frame = (at != std::string::npos) ? strtoul(buf.c_str() + at + 8, nullptr, 10) : 0;
+        sendTick(crsf);
+        bool applied = ok && frame == crsf.channelsFrame();
+        for (unsigned ch = 1; ch <= 16 && applied; ++ch)
+            applied = crsf.getChannel(ch) == value;
+        if (applied) res.latUs.push_back(us);
+        else ++res.errors;
+    }
+    if (fd >= 0) close(fd);
+    else res.errors = count;
+    return res;
+}
+
+// Повтор и откат seq отбрасываются, значения не применяются
+bool checkWs(CrsfSerial& crsf)
+{
+    WsClient ws;
+    if (!ws.open()) {
+        fprintf(stderr, "рукопожатие WebSocket не прошло (Sec-WebSocket-Accept)\n");
+        return false;
+    }
+    int v = 1234;
+    if (ws.setpoints(5, 0x0001, &v) != TELEMETRY_WS_OK) return false;
+    sendTick(crsf);
+    if (crsf.getChannel(1) != 1234) return false;
+    v = 1500;
+    if (ws.setpoints(5, 0x0001, &v) != TELEMETRY_WS_STALE) return false;
+    if (ws.setpoints(4, 0x0001, &v) != TELEMETRY_WS_STALE) return false;
+    v = 2500;
+    if (ws.setpoints(6, 0x0001, &v) != TELEMETRY_WS_INVALID) return false;
+    sendTick(crsf);
+    return crsf.getChannel(1) == 1234;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned count = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000;
+
+    // Сервер печатает каждую HTTP-команду в stdout: результаты — в копию stdout, сам stdout — в /dev/null
+    g_out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!g_out || !freopen("/dev/null", "w", stdout)) return 1;
+    setvbuf(g_out, nullptr, _IOLBF, 0);
+
+    // Номер кадра растёт только за ушедший кадр — нужен настоящий порт (pty), а не закрытый
+    SerialPort port("", CRSF_BAUDRATE);
+    std::string peerPath;
+    if (!port.openPty(peerPath)) { fprintf(stderr, "pty недоступен\n"); return 1; }
+    SerialPort peer(peerPath, CRSF_BAUDRATE);
+    if (!peer.open()) { fprintf(stderr, "не удалось открыть %s\n", peerPath.c_str()); return 1; }
+    g_peer = &peer;
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    startTelemetryServer(&crsf, PORT);
+
+    if (!checkWs(crsf)) {
+        fprintf(stderr, "WebSocket: устаревшие или неверные уставки не отброшены\n");
+        stopTelemetryServer();
+        return 1;
+    }
+
+    uint32_t seq = 0;
+    Result r;
+    r = runHttp(crsf, false, 1, count);
+    report("http_close", "ch1", r);
+    r = runHttp(crsf, true, 1, count);
+    report("http_keepalive", "ch1", r);
+    r = runWs(crsf, 1, count, seq);
+    report("ws", "ch1", r);
+    r = runHttp(crsf, false, 16, count / 16);
+    report("http_close", "all16", r);
+    r = runHttp(crsf, true, 16, count / 16);
+    report("http_keepalive", "all16", r);
+    r = runWs(crsf, 16, count, seq);
+    report("ws", "all16", r);
+    r = runBatch(crsf, count);
+    report("http_batch", "all16", r);
+
+    stopTelemetryServer();
+    setTelemetrySource(nullptr);
+    return 0;
+}
@@ -0,0 +1,568 @@
+// Микробенчмарки разбора и кодирования CRSF: без UART и системных вызовов, только процессор.
+//
+// Стадии:
+//   crc8             — crc8_calc() (slicing-by-8) по каждому кадру потока
+//   crc8_bytewise    — crc8_calc_bytewise(), эталон с поиском в таблице на каждый байт
+//   parse            — CrsfSerial::receive(): разбор кольца, CRC и обработчики кадров,
+//                      пачками 1..64 байта, как их отдаёт readv
+//   parse_client     — то же для rpi/CrsfClientLinux (тот же CrsfParser, обрабатывает только каналы)
+//   parse_dispatch   — parse с четырьмя подписчиками CrsfSerial::subscribe() на каждый тип кадра
+//   pack_channels    — CrsfSerial::packetChannelsSend() на закрытом порту (кодирование + CRC)
+//   channels_decode  — crsf_channels_decode(): 22 байта -> 16 значений в мкс;
+//                      *_legacy — прежние битовые поля crsf_channels_t и деление на каждый канал
+//   channels_encode  — crsf_channels_encode(): 16 значений в мкс -> 22 байта
+//   telemetry_update — новый снимок CrsfSerial (setChannel + packetChannelsSend) и updateTelemetry()
+//   telemetry_update_idle — updateTelemetry() без новых данных: только сравнение номера снимка
+//   telemetry_json_legacy — прежняя сборка JSON через std::stringstream (копия кода для сравнения)
+//   telemetry_json_render — renderTelemetryJson(): JsonWriter и to_chars в буфер, без кэша
+//   telemetry_json   — writeTelemetryJson() для /api/telemetry: тот же снимок, документ из кэша
+//   telemetry_json_fields — то же с fields=channels (меньше байт на ответ)
+//
+// Корпуса: clean (смешанный поток), corrupted (10% кадров с испорченным битом),
+// channels (только RC-кадры, 26 байт), max (кадры по 64 байта; только CRC),
+// capture (файл захвата CRSF_CAPTURE, ключ --capture)
+//
+// Вывод — строка ключ=значение на стадию:
+//   stage corpus frames passes ns_per_frame bytes_per_s cycles_per_frame
+// cycles_per_frame берётся из perf_event_open (PERF_COUNT_HW_CPU_CYCLES); na — счётчик недоступен
+//
+// Использование:
+//   ./bench/crsf_microbench [--frames N=5000] [--ms M=300] [--capture файл]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfCapture.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "libs/crsf/crsf_channels.h"
+#include "rpi/CrsfClientLinux.h"
+#include "telemetry_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Счётчик тактов процессора текущего потока (только пользовательский режим)
+class CycleCounter
+{
+public:
+    CycleCounter()
+    {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~CycleCounter() { if (_fd >= 0) ::close(_fd); }
+
+    bool available() const { return _fd >= 0; }
+    void start()
+    {
+        if (_fd < 0) return;
+        ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop()
+    {
+        if (_fd < 0) return 0;
+        ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t v = 0;
+        if (::read(_fd, &v, sizeof(v)) != sizeof(v)) return 0;
+        return v;
+    }
+
+private:
+    int _fd;
+};
+
+struct Corpus {
+    const char* name;
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> chunks;   // деление на пачки чтения
+    unsigned frames;
+};
+
+CycleCounter g_cycles;
+unsigned g_budgetMs = 300;
+volatile uint32_t g_sink;
+
+unsigned g_decoded = 0;
+void onChannels() { ++g_decoded; }
+void onLink(crsfLinkStatistics_t*) { ++g_decoded; }
+void onGps(crsf_sensor_gps_t*) { ++g_decoded; }
+void onFrame(void* ctx, const crsf_header_t* frame, uint32_t) { *static_cast<uint32_t*>(ctx) += frame->type; }
+
+// Прогнать fn() один раз для прогрева, затем повторять не меньше g_budgetMs
+template <typename Fn>
+void measure(const char* stage, const char* corpus, unsigned framesPerPass, size_t bytesPerPass, Fn fn)
+{
+    fn();
+    unsigned passes = 0;
+    g_cycles.start();
+    const auto t0 = Clock::now();
+    const auto budget = std::chrono::milliseconds(g_budgetMs);
+    do {
+        fn();
+        ++passes;
+    } while (Clock::now() - t0 < budget);
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    const uint64_t cycles = g_cycles.stop();
+
+    const double frames = double(framesPerPass) * passes;
+    char cyclesText[32];
+    if (g_cycles.available()) snprintf(cyclesText, sizeof(cyclesText), "%.1f", cycles / frames);
+    else snprintf(cyclesText, sizeof(cyclesText), "na");
+    printf("stage=%s corpus=%s frames=%u passes=%u ns_per_frame=%.1f bytes_per_s=%.0f cycles_per_frame=%s\n",
+           stage, corpus, framesPerPass, passes, ns / frames,
+           double(bytesPerPass) * passes / (ns / 1e9), cyclesText);
+}
+
+Corpus makeCorpus(const char* name, std::vector<uint8_t> bytes, unsigned frames)
+{
+    Corpus c;
+    c.name = name;
+    c.chunks = bench::randomChunks(bytes.size());
+    c.bytes = std::move(bytes);
+    c.frames = frames;
+    return c;
+}
+
+bool loadCapture(const char* path, Corpus& c)
+{
+    CrsfCaptureReader reader;
+    if (!reader.open(path)) return false;
+    c.name = "capture";
+    CrsfCaptureReader::Chunk chunk;
+    while (reader.next(chunk)) {
+        c.bytes.insert(c.bytes.end(), chunk.data, chunk.data + chunk.len);
+        c.chunks.push_back(static_cast<uint32_t>(chunk.len));
+    }
+    // Число кадров в захвате заранее неизвестно: считаем по одному чистому разбору
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.receive(c.bytes.data(), c.bytes.size());
+    c.frames = crsf.rxStats().frames;
+    return c.frames > 0;
+}
+
+template <uint8_t (*Calc)(const uint8_t*, size_t)>
+void benchCrc(const char* stage, const Corpus& c)
+{
+    // Смещения кадров; CRC считается так же, как в CrsfParser: по type + payload
+    std::vector<uint32_t> offsets;
+    for (size_t pos = 0; pos + 1 < c.bytes.size(); pos += c.bytes[pos + 1] + 2)
+        offsets.push_back(static_cast<uint32_t>(pos));
+    std::vector<uint8_t> bytes = c.bytes;
+    measure(stage, c.name, static_cast<unsigned>(offsets.size()), bytes.size(), [&]() {
+        uint32_t acc = 0;
+        for (uint32_t off : offsets)
+            acc += Calc(&bytes[off + 2], bytes[off + 1] - 1);
+        g_sink = acc;
+    });
+}
+
+void benchParse(const Corpus& c)
+{
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.onPacketChannels = &onChannels;
+    crsf.onPacketLinkStatistics = &onLink;
+    crsf.onPacketGps = &onGps;
+    measure("parse", c.name, c.frames, c.bytes.size(), [&]() {
+        const uint8_t* p = c.bytes.data();
+        for (uint32_t len : c.chunks) {
+            crsf.receive(p, len);
+            p += len;
+        }
+    });
+}
+
+void benchParseDispatch(const Corpus& c)
+{
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.onPacketChannels = &onChannels;
+    crsf.onPacketLinkStatistics = &onLink;
+    crsf.onPacketGps = &onGps;
+    static uint32_t counters[4];
+    const uint8_t types[] = { CRSF_FRAMETYPE_GPS, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, CRSF_FRAMETYPE_LINK_STATISTICS,
+                              CRSF_FRAMETYPE_ATTITUDE, CRSF_FRAMETYPE_FLIGHT_MODE, CRSF_FRAMETYPE_BATTERY_SENSOR };
+    for (uint8_t type : types)
+        for (uint32_t& counter : counters)
+            crsf.subscribe(type, &onFrame, &counter);
+    measure("parse_dispatch", c.name, c.frames, c.bytes.size(), [&]() {
+        const uint8_t* p = c.bytes.data();
+        for (uint32_t len : c.chunks) {
+            crsf.receive(p, len);
+            p += len;
+        }
+    });
+    g_sink = counters[0] + counters[3];
+}
+
+void benchParseClient(const Corpus& c)
+{
+    CrsfClientLinux client;
+    measure("parse_client", c.name, c.frames, c.bytes.size(), [&]() {
+        const uint8_t* p = c.bytes.data();
+        for (uint32_t len : c.chunks) {
+            client.receive(p, len);
+            p += len;
+        }
+    });
+}
+
+// Оба владельца CrsfParser должны находить одни и те же кадры при любом делении потока
+bool checkParsers(const Corpus& c)
+{
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial whole(port, CRSF_BAUDRATE);
+    whole.receive(c.bytes.data(), c.bytes.size());
+    CrsfSerial bytewise(port, CRSF_BAUDRATE);
+    for (uint8_t b : c.bytes)
+        bytewise.receive(&b, 1);
+    CrsfClientLinux client;
+    const uint8_t* p = c.bytes.data();
+    for (uint32_t len : c.chunks) {
+        client.receive(p, len);
+        p += len;
+    }
+    return whole.rxStats().frames == bytewise.rxStats().frames &&
+           whole.rxStats().frames == client.rxStats().frames;
+}
+
+void benchPackChannels(unsigned frames)
+{
+    // Порт не открыт: write() сразу возвращает ошибку, измеряется только кодирование
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    unsigned seed = 0;
+    measure("pack_channels", "synthetic", frames, size_t(frames) * (CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + 4), [&]() {
+        for (unsigned i = 0; i < frames; ++i) {
+            ++seed;
+            crsf.setChannel(1, 1000 + int(seed % 1001));
+            crsf.setChannel(2, 2000 - int(seed % 1001));
+            crsf.packetChannelsSend();
+        }
+    });
+}
+
+// Прежний разбор CrsfSerial::packetChannelsPacked: битовые поля и деление на каждый канал
+void legacyDecode(const uint8_t* payload, int* out)
+{
+    const crsf_channels_t* ch = (const crsf_channels_t*)payload;
+    const int raw[CRSF_NUM_CHANNELS] = { (int)ch->ch0, (int)ch->ch1, (int)ch->ch2, (int)ch->ch3,
+                                         (int)ch->ch4, (int)ch->ch5, (int)ch->ch6, (int)ch->ch7,
+                                         (int)ch->ch8, (int)ch->ch9, (int)ch->ch10, (int)ch->ch11,
+                                         (int)ch->ch12, (int)ch->ch13, (int)ch->ch14, (int)ch->ch15 };
+    const int crsfDelta = (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000);
+    for (unsigned i = 0; i < CRSF_NUM_CHANNELS; ++i) {
+        int code = raw[i];
+        if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
+        if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
+        out[i] = 1000 + ((code - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
+    }
+}
+
+// Прежний CrsfSerial::packetChannelsSend: деления и поправка ±1 на каждый канал, битовые поля
+void legacyEncode(const int* us, uint8_t* payload)
+{
+    int codes[CRSF_NUM_CHANNELS];
+    const int crsfDelta = (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000);
+    for (unsigned i = 0; i < CRSF_NUM_CHANNELS; ++i) {
+        int usTarget = us[i];
+        if (usTarget < 1000) usTarget = 1000;
+        if (usTarget > 2000) usTarget = 2000;
+        int code = CRSF_CHANNEL_VALUE_1000 + ((usTarget - 1000) * crsfDelta + 500) / 1000;
+        if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
+        if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
+        int decodedUs = 1000 + ((code - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
+        if (decodedUs < usTarget && code < CRSF_CHANNEL_VALUE_2000) {
+            int decoded2 = 1000 + ((code + 1 - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
+            if (decoded2 == usTarget) ++code;
+        } else if (decodedUs > usTarget && code > CRSF_CHANNEL_VALUE_1000) {
+            int decoded2 = 1000 + ((code - 1 - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
+            if (decoded2 == usTarget) --code;
+        }
+        codes[i] = code;
+    }
+    crsf_channels_t ch;
+    ch.ch0 = codes[0]; ch.ch1 = codes[1]; ch.ch2 = codes[2]; ch.ch3 = codes[3];
+    ch.ch4 = codes[4]; ch.ch5 = codes[5]; ch.ch6 = codes[6]; ch.ch7 = codes[7];
+    ch.ch8 = codes[8]; ch.ch9 = codes[9]; ch.ch10 = codes[10]; ch.ch11 = codes[11];
+    ch.ch12 = codes[12]; ch.ch13 = codes[13]; ch.ch14 = codes[14]; ch.ch15 = codes[15];
+    memcpy(payload, &ch, CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE);
+}
+
+void benchChannelCodec(const Corpus& c)
+{
+    std::vector<const uint8_t*> payloads;
+    for (size_t pos = 0; pos + 1 < c.bytes.size(); pos += c.bytes[pos + 1] + 2)
+        payloads.push_back(&c.bytes[pos + 3]);
+    const unsigned n = static_cast<unsigned>(payloads.size());
+    const size_t bytes = size_t(n) * CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE;
+    int us[CRSF_NUM_CHANNELS];
+    uint8_t out[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE];
+
+    measure("channels_decode_legacy", c.name, n, bytes, [&]() {
+        uint32_t acc = 0;
+        for (const uint8_t* p : payloads) { legacyDecode(p, us); acc += us[0] + us[15]; }
+        g_sink = acc;
+    });
+    measure("channels_decode", c.name, n, bytes, [&]() {
+        uint32_t acc = 0;
+        for (const uint8_t* p : payloads) { crsf_channels_decode(p, us); acc += us[0] + us[15]; }
+        g_sink = acc;
+    });
+
+    std::vector<int> values(size_t(n) * CRSF_NUM_CHANNELS);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = 1000 + int((i * 37) % 1001);
+    measure("channels_encode_legacy", c.name, n, bytes, [&]() {
+        uint32_t acc = 0;
+        for (unsigned i = 0; i < n; ++i) { legacyEncode(&values[size_t(i) * CRSF_NUM_CHANNELS], out); acc += out[0]; }
+        g_sink = acc;
+    });
+    measure("channels_encode", c.name, n, bytes, [&]() {
+        uint32_t acc = 0;
+        for (unsigned i = 0; i < n; ++i) { crsf_channels_encode(&values[size_t(i) * CRSF_NUM_CHANNELS], out); acc += out[0]; }
+        g_sink = acc;
+    });
+}
+
+// Прежний createTelemetryJson(): stringstream и operator<< на каждый запрос
+std::string legacyTelemetryJson(const CrsfTelemetry& t, const std::string& timestamp, const char* workMode)
+{
+    std::stringstream json;
+    json << "{";
+    json << "\"linkUp\":" << (t.linkUp ? "true" : "false") << ",";
+    json << "\"activePort\":\"" << "UART Active" << "\",";
+    json << "\"lastReceive\":" << t.lastReceive << ",";
+    json << "\"timestamp\":\"" << timestamp << "\",";
+    json << "\"channels\":[";
+    for (int i = 0; i < 16; i++) {
+        if (i > 0) json << ",";
+        json << t.channels[i];
+    }
+    json << "],";
+    json << "\"packetsReceived\":" << (uint32_t)t.linkStatistics.uplink_RSSI_1 << ",";
+    json << "\"packetsSent\":" << (uint32_t)t.linkStatistics.uplink_RSSI_2 << ",";
+    json << "\"packetsLost\":" << (uint32_t)(100 - t.linkStatistics.uplink_Link_quality) << ",";
+    json << "\"gps\":{";
+    json << "\"latitude\":" << t.gps.latitude / 10000000.0 << ",";
+    json << "\"longitude\":" << t.gps.longitude / 10000000.0 << ",";
+    json << "\"altitude\":" << (double)(t.gps.altitude - 1000) << ",";
+    json << "\"speed\":" << t.gps.groundspeed / 10.0;
+    json << "},";
+    json << "\"battery\":{";
+    json << "\"voltage\":" << (double)t.batteryVoltage << ",";
+    json << "\"current\":" << (double)t.batteryCurrent << ",";
+    json << "\"capacity\":" << (double)t.batteryCapacity << ",";
+    json << "\"remaining\":" << (int)t.batteryRemaining;
+    json << "},";
+    json << "\"attitude\":{";
+    json << "\"roll\":" << (double)t.attitudeRoll << ",";
+    json << "\"pitch\":" << (double)t.attitudePitch << ",";
+    json << "\"yaw\":" << (double)t.attitudeYaw;
+    json << "},";
+    json << "\"attitudeRaw\":{";
+    json << "\"roll\":" << t.rawAttitude[0] << ",";
+    json << "\"pitch\":" << t.rawAttitude[1] << ",";
+    json << "\"yaw\":" << t.rawAttitude[2];
+    json << "},";
+    json << "\"workMode\":\"" << workMode << "\"";
+    json << "}";
+    return json.str();
+}
+
+// Новый сериализатор обязан давать тот же документ, что и прежний stringstream
+bool benchTelemetry(const Corpus& c, unsigned ops)
+{
+    // Источник с реальными значениями: прогоняем через него чистый поток
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.receive(c.bytes.data(), c.bytes.size());
+    setTelemetrySource(&crsf);
+
+    // Каждая итерация меняет канал, поэтому публикуется и забирается новый снимок
+    unsigned seed = 0;
+    measure("telemetry_update", "clean", ops, 0, [&]() {
+        unsigned updated = 0;
+        for (unsigned i = 0; i < ops; ++i) {
+            crsf.setChannel(1, 1000 + int(++seed % 1001));
+            crsf.packetChannelsSend();
+            updated += updateTelemetry();
+        }
+        g_sink = updated;
+    });
+    updateTelemetry();
+    measure("telemetry_update_idle", "clean", ops, 0, [&]() {
+        unsigned updated = 0;
+        for (unsigned i = 0; i < ops; ++i)
+            updated += updateTelemetry();
+        g_sink = updated;
+    });
+    const std::string json = createTelemetryJson();
+    const size_t ts = json.find("\"timestamp\":\"") + 13;
+    const std::string legacy = legacyTelemetryJson(crsf.telemetry(), json.substr(ts, json.find('"', ts) - ts), getWorkMode().c_str());
+    if (json != legacy) {
+        fprintf(stderr, "JSON телеметрии не совпадает с прежним:\n%s\n%s\n", json.c_str(), legacy.c_str());
+        setTelemetrySource(nullptr);
+        return false;
+    }
+
+    const CrsfTelemetry snapshot = crsf.telemetry();
+    measure("telemetry_json_legacy", "clean", ops, legacy.size() * ops, [&]() {
+        size_t total = 0;
+        for (unsigned i = 0; i < ops; ++i)
+            total += legacyTelemetryJson(snapshot, "12:34:56.789", "joystick").size();
+        g_sink = static_cast<uint32_t>(total);
+    });
+    char buf[1024];
+    measure("telemetry_json_render", "clean", ops, json.size() * ops, [&]() {
+        size_t total = 0;
+        for (unsigned i = 0; i < ops; ++i)
+            total += renderTelemetryJson(buf, sizeof(buf));
+        g_sink = static_cast<uint32_t>(total);
+    });
+    std::string out;
+    measure("telemetry_json", "clean", ops, json.size() * ops, [&]() {
+        size_t total = 0;
+        for (unsigned i = 0; i < ops; ++i) {
+            writeTelemetryJson(out);
+            total += out.size();
+        }
+        g_sink = static_cast<uint32_t>(total);
+    });
+    const size_t fieldsSize = createTelemetryJson(TELEMETRY_FIELD_CHANNELS).size();
+    measure("telemetry_json_fields", "clean", ops, fieldsSize * ops, [&]() {
+        size_t total = 0;
+        for (unsigned i = 0; i < ops; ++i) {
+            writeTelemetryJson(out, TELEMETRY_FIELD_CHANNELS);
+            total += out.size();
+        }
+        g_sink = static_cast<uint32_t>(total);
+    });
+    setTelemetrySource(nullptr);
+    return true;
+}
+
+// Быстрое ядро обязано совпадать с эталоном на всех длинах
+bool checkCrc()
+{
+    uint8_t buf[CRSF_MAX_PACKET_SIZE];
+    for (unsigned seed = 0; seed < 256; ++seed) {
+        for (unsigned i = 0; i < sizeof(buf); ++i)
+            buf[i] = static_cast<uint8_t>(seed * 131 + i * 29 + (i >> 3));
+        for (size_t len = 0; len <= sizeof(buf); ++len)
+            if (crc8_calc(buf, len) != crc8_calc_bytewise(buf, len)) return false;
+    }
+    return true;
+}
+
+// Новый кодек обязан давать те же байты и те же мкс, что и прежний код CrsfSerial
+bool checkChannelCodec()
+{
+    for (int v = 1000; v <= 2000; ++v)
+        if (crsf_code_to_us(crsf_us_to_code(v)) != v) return false;
+    uint8_t payload[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE];
+    uint8_t legacy[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE];
+    int usNew[CRSF_NUM_CHANNELS], usOld[CRSF_NUM_CHANNELS];
+    uint16_t codes[CRSF_NUM_CHANNELS];
+    for (unsigned seed = 0; seed < 4096; ++seed) {
+        for (unsigned i = 0; i < sizeof(payload); ++i)
+            payload[i] = static_cast<uint8_t>(seed * 151 + i * 73 + (seed >> 4) * i);
+        crsf_channels_decode(payload, usNew);
+        legacyDecode(payload, usOld);
+        if (memcmp(usNew, usOld, sizeof(usNew)) != 0) return false;
+        crsf_channels_unpack(payload, codes);
+        crsf_channels_pack(codes, legacy);
+        if (memcmp(payload, legacy, sizeof(payload)) != 0) return false;
+
+        for (unsigned i = 0; i < CRSF_NUM_CHANNELS; ++i)
+            usNew[i] = 990 + int((seed * 13 + i * 101) % 1021);
+        crsf_channels_encode(usNew, payload);
+        legacyEncode(usNew, legacy);
+        if (memcmp(payload, legacy, sizeof(payload)) != 0) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned frames = 5000;
+    const char* capturePath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--ms") == 0 && i + 1 < argc) g_budgetMs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) capturePath = argv[++i];
+        else {
+            fprintf(stderr, "использование: %s [--frames N] [--ms M] [--capture файл]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Corpus> corpora;
+    corpora.push_back(makeCorpus("clean", bench::mixedStream(frames), frames));
+    std::vector<uint8_t> noisy = bench::mixedStream(frames);
+    bench::corrupt(noisy, 10);
+    corpora.push_back(makeCorpus("corrupted", std::move(noisy), frames));
+    corpora.push_back(makeCorpus("channels", bench::channelsStream(frames), frames));
+    if (capturePath) {
+        Corpus cap;
+        if (!loadCapture(capturePath, cap)) {
+            fprintf(stderr, "не удалось прочитать захват %s\n", capturePath);
+            return 1;
+        }
+        corpora.push_back(std::move(cap));
+    }
+
+    if (!checkCrc()) {
+        fprintf(stderr, "crc8_calc не совпадает с эталоном\n");
+        return 1;
+    }
+
+    if (!checkChannelCodec()) {
+        fprintf(stderr, "crsf_channels не совпадает с прежним кодированием\n");
+        return 1;
+    }
+
+    for (const Corpus& c : corpora) {
+        if (!checkParsers(c)) {
+            fprintf(stderr, "CrsfParser: число кадров зависит от деления потока (%s)\n", c.name);
+            return 1;
+        }
+    }
+
+    const Corpus maxFrames = makeCorpus("max", bench::maxFrameStream(frames), frames);
+    const Corpus* crcCorpora[] = { &corpora[2], &maxFrames, &corpora[0] };
+    for (const Corpus* c : crcCorpora) {
+        benchCrc<crc8_calc_bytewise>("crc8_bytewise", *c);
+        benchCrc<crc8_calc>("crc8", *c);
+    }
+    for (const Corpus& c : corpora) {
+        benchParse(c);
+        benchParseClient(c);
+    }
+    benchParseDispatch(corpora[0]);
+    benchPackChannels(frames);
+    benchChannelCodec(corpora[2]);
+    if (!benchTelemetry(corpora[0], 1000)) return 1;
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Воспроизведение захвата UART через CrsfSerial::loop().
+// Пачки из файла захвата (CRSF_CAPTURE в config.h) пишутся в master-сторону pty с исходными
+// интервалами, ускоренно или без пауз; CrsfSerial читает slave как обычный UART.
+//
+// Метрики:
+//   frames_per_s       — разобранных кадров в секунду реального времени
+//   crc_errors         — кадров с неверной CRC
+//   resyncs            — поисков байта синхронизации после неверной длины или CRC
+//   parse_ns_per_frame — время в CrsfSerial::loop() (чтение + разбор) на один кадр;
+//                        считаются только вызовы, которые забрали данные
+//
+// Использование:
+//   ./bench/crsf_replay <захват> [--speed K] [--max] [--min-frames N]
+//   ./bench/crsf_replay --synth <захват> [кадров=5000] [шум_проц=0]
+//   --speed K      — ускорить в K раз (1 — реальное время, по умолчанию)
+//   --max          — без пауз между пачками
+//   --min-frames N — код возврата 2, если разобрано меньше N кадров (проверка регрессий)
+//   --synth        — записать синтетический захват: смешанный поток на 420000 бод,
+//                    пачки 1..64 байта, шум_проц — доля кадров с испорченным байтом
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/SerialPort.h"
+#include "libs/pty.h"
+#include "libs/crsf/CrsfCapture.h"
+#include "libs/crsf/CrsfSerial.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Сколько ждать, пока pty отдаст записанную пачку
+const auto kChunkTimeout = std::chrono::milliseconds(100);
+
+int writeSynthetic(const char* path, unsigned frames, unsigned noisePct)
+{
+    std::vector<uint8_t> stream = bench::mixedStream(frames);
+    bench::corrupt(stream, noisePct);
+
+    CrsfCaptureWriter out;
+    if (!out.open(path, CRSF_BAUDRATE)) {
+        fprintf(stderr, "не удалось создать %s\n", path);
+        return 1;
+    }
+    // Время пачки — момент прихода её последнего байта на 420000 бод (10 бит на байт)
+    size_t pos = 0;
+    for (uint32_t len : bench::randomChunks(stream.size())) {
+        pos += len;
+        out.writeAt(pos * 10 * 1000000ull / CRSF_BAUDRATE, &stream[pos - len], len);
+    }
+    printf("capture=%s chunks=%llu bytes=%zu noise_pct=%u\n",
+           path, (unsigned long long)out.chunks(), stream.size(), noisePct);
+    return 0;
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t len)
+{
+    size_t off = 0;
+    const auto start = Clock::now();
+    while (off < len) {
+        ssize_t w = ::write(fd, data + off, len - off);
+        if (w > 0) off += w;
+        else if (Clock::now() - start > kChunkTimeout) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > 2 && strcmp(argv[1], "--synth") == 0) {
+        unsigned frames = (argc > 3) ? static_cast<unsigned>(strtoul(argv[3], nullptr, 10)) : 5000;
+        unsigned noise = (argc > 4) ? static_cast<unsigned>(strtoul(argv[4], nullptr, 10)) : 0;
+        return writeSynthetic(argv[2], frames, noise);
+    }
+
+    const char* path = nullptr;
+    double speed = 1.0;
+    bool maxSpeed = false;
+    unsigned minFrames = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max") == 0) maxSpeed = true;
+        else if (strcmp(argv[i], "--min-frames") == 0 && i + 1 < argc) minFrames = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else path = argv[i];
+    }
+    if (!path || speed <= 0) {
+        fprintf(stderr, "использование: %s <захват> [--speed K] [--max] [--min-frames N]\n", argv[0]);
+        return 1;
+    }
+
+    CrsfCaptureReader capture;
+    if (!capture.open(path)) {
+        fprintf(stderr, "не удалось прочитать захват %s\n", path);
+        return 1;
+    }
+
+    int master;
+    std::string slavePath;
+    if (!pty_open(master, slavePath)) { fprintf(stderr, "pty недоступен\n"); return 1; }
+    SerialPort port(slavePath, capture.baud());
+    if (!port.open()) { fprintf(stderr, "не удалось открыть %s\n", slavePath.c_str()); return 1; }
+    CrsfSerial crsf(port, capture.baud());
+
+    uint64_t chunks = 0, sent = 0;
+    std::chrono::nanoseconds loopTime{0};
+    const auto t0 = Clock::now();
+    CrsfCaptureReader::Chunk chunk;
+    while (capture.next(chunk)) {
+        if (!maxSpeed)
+            std::this_thread::sleep_until(t0 + std::chrono::microseconds(uint64_t(chunk.timeUs / speed)));
+        if (!writeAll(master, chunk.data, chunk.len)) {
+            fprintf(stderr, "pty не принимает данные\n");
+            break;
+        }
+        ++chunks;
+        sent += chunk.len;
+        // Вызываем loop(), пока CrsfSerial не заберёт всю пачку
+        const auto written = Clock::now();
+        while (crsf.rxStats().bytes < sent && Clock::now() - written < kChunkTimeout) {
+            const uint64_t before = crsf.rxStats().bytes;
+            const auto l0 = Clock::now();
+            crsf.loop();
+            if (crsf.rxStats().bytes != before)
+                loopTime += Clock::now() - l0;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    const CrsfRxStats& st = crsf.rxStats();
+    char speedText[32];
+    if (maxSpeed) snprintf(speedText, sizeof(speedText), "max");
+    else snprintf(speedText, sizeof(speedText), "%g", speed);
+    printf("capture=%s speed=%s chunks=%llu bytes=%llu frames=%u frames_per_s=%.0f crc_errors=%u resyncs=%u "
+           "dropped_bytes=%u parse_ns_per_frame=%.0f seconds=%.3f\n",
+           path, speedText, (unsigned long long)chunks, (unsigned long long)st.bytes, st.frames,
+           st.frames / seconds, st.crcErrors, st.resyncs, st.droppedBytes,
+           st.frames ? double(loopTime.count()) / st.frames : 0.0, seconds);
+
+    port.close();
+    ::close(master);
+    if (st.bytes != sent) {
+        fprintf(stderr, "внимание: прочитано %llu из %llu байт\n", (unsigned long long)st.bytes, (unsigned long long)sent);
+        return 2;
+    }
+    return (st.frames < minFrames) ? 2 : 0;
+}
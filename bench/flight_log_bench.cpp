@@ -0,0 +1,206 @@
+// Бортовой журнал кадров (libs/crsf/CrsfFrameLog): цена записи для потока приёма и выборка окна времени.
+// Журнал пишется во временный каталог и удаляется в конце.
+//
+// Метрики:
+//   append — ns_per_frame: CrsfFrameLog::append() (поток приёма, на каждый кадр) пачкой в полочереди;
+//            p99_ns и max_ns — по 1000 кадров/с, как на линке 500 Гц с телеметрией, с работающим потоком записи;
+//            dropped — выброшено при полной очереди (должно быть 0)
+//   write  — поток записи: кадров в секунду при записи без пауз, сегментов
+//   query  — журналы на minutes минут (1000 кадров/с, сегменты по 4 МБ), окна window_s в середине:
+//            ms на выборку, rows, scanned — просмотрено записей (окно плюс не больше интервала индекса),
+//            segments — открыто сегментов. full_scan — то же окно без индекса (просмотр с начала журнала)
+//
+// Использование:
+//   ./bench/flight_log_bench [минут_малого_журнала=5] [минут_большого=50]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/crsf/CrsfFrameLog.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint64_t FRAME_NS = 1000000;  // 1000 кадров/с
+
+void removeDir(const std::string& dir)
+{
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d))
+            if (e->d_name[0] != '.') unlink((dir + "/" + e->d_name).c_str());
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+// Смешанный поток: каналы через кадр, остальное — телеметрия по кругу
+struct Frames {
+    std::vector<uint8_t> frame[4];
+
+    Frames()
+    {
+        bench::appendChannels(frame[0], 1);
+        bench::appendLinkStatistics(frame[1], 1);
+        bench::appendAttitude(frame[2], 1);
+        bench::appendGps(frame[3], 1);
+    }
+    const uint8_t* at(uint64_t i) const { return frame[(i & 1) ? 0 : 1 + (i / 2) % 3].data(); }
+};
+
+// Дождаться, пока поток записи заберёт очередь до half кадров
+void waitQueue(const CrsfFrameLog& log, uint64_t half)
+{
+    for (;;) {
+        const CrsfFrameLog::Stats s = log.stats();
+        if (s.frames - s.written - s.dropped <= half) return;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+CrsfFrameLog::Options benchOptions()
+{
+    CrsfFrameLog::Options o = CrsfFrameLog::defaults();
+    o.segmentSize = 4ull * 1024 * 1024;
+    o.maxSegments = 0;
+    o.flushMs = 1;
+    return o;
+}
+
+bool countRow(const CrsfFrameLogReader::Record&, void*) { return true; }
+
+struct Window {
+    int64_t from;
+    int64_t to;
+    uint64_t rows;
+};
+
+// Без индекса: просмотр всего журнала с начала, в окно попадают только подходящие записи
+bool countInWindow(const CrsfFrameLogReader::Record& r, void* ctx)
+{
+    Window* w = static_cast<Window*>(ctx);
+    if (r.timeNs >= w->from && r.timeNs < w->to) ++w->rows;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned smallMin = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 5;
+    const unsigned largeMin = (argc > 2) ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 50;
+    const Frames frames;
+    const std::string base = "/tmp/crsf_flog_bench." + std::to_string(getpid());
+    bool ok = true;
+
+    // append: пачка в полочереди (поток записи не успевает вмешаться) и темп 1000 кадров/с
+    {
+        const std::string dir = base + ".append";
+        CrsfFrameLog log;
+        if (!log.start(dir.c_str(), benchOptions())) {
+            fprintf(stderr, "не удалось открыть журнал в %s\n", dir.c_str());
+            return 1;
+        }
+        const unsigned burst = CrsfFrameLog::defaults().queueFrames / 2;
+        uint64_t t = CrsfFrameLog::monotonicNs();
+        auto t0 = Clock::now();
+        for (unsigned i = 0; i < burst; ++i)
+            log.append(t + i, frames.at(i));
+        const double burstNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / burst;
+        waitQueue(log, 0);
+
+        const unsigned paced = 3000;
+        std::vector<uint32_t> ns(paced);
+        auto next = Clock::now();
+        for (unsigned i = 0; i < paced; ++i) {
+            next += std::chrono::microseconds(1000);
+            std::this_thread::sleep_until(next);
+            const uint64_t now = CrsfFrameLog::monotonicNs();
+            const auto a = Clock::now();
+            log.append(now, frames.at(i));
+            ns[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - a).count());
+        }
+        log.stop();
+        const CrsfFrameLog::Stats s = log.stats();
+        std::sort(ns.begin(), ns.end());
+        ok = ok && s.dropped == 0 && s.written == burst + paced;
+        printf("mode=append ns_per_frame=%.1f p99_ns=%u max_ns=%u frames=%llu written=%llu dropped=%llu\n", burstNs,
+               ns[paced * 99 / 100], ns.back(), (unsigned long long)s.frames, (unsigned long long)s.written,
+               (unsigned long long)s.dropped);
+        removeDir(dir);
+    }
+
+    // Журналы для выборки: метки синтетические, 1000 кадров/с подряд, без пауз
+    struct Log {
+        unsigned minutes;
+        std::string dir;
+    };
+    std::vector<Log> logs = { { smallMin, base + ".small" }, { largeMin, base + ".large" } };
+    for (const Log& l : logs) {
+        CrsfFrameLog log;
+        if (!log.start(l.dir.c_str(), benchOptions())) return 1;
+        const uint64_t n = static_cast<uint64_t>(l.minutes) * 60000;
+        const uint64_t half = CrsfFrameLog::defaults().queueFrames / 2;
+        const uint64_t t0 = CrsfFrameLog::monotonicNs() - n * FRAME_NS;
+        const auto w0 = Clock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            if (i % half == 0) waitQueue(log, half);
+            log.append(t0 + i * FRAME_NS, frames.at(i));
+        }
+        log.stop();
+        const double s = std::chrono::duration<double>(Clock::now() - w0).count();
+        const CrsfFrameLog::Stats st = log.stats();
+        ok = ok && st.dropped == 0 && st.written == n;
+        printf("mode=write minutes=%u frames=%llu frames_per_s=%.0f mb=%.1f segments=%llu dropped=%llu\n", l.minutes,
+               (unsigned long long)st.written, st.written / s, st.bytes / 1048576.0, (unsigned long long)st.segments,
+               (unsigned long long)st.dropped);
+    }
+
+    const double windows[] = { 1, 10, 60 };
+    for (const Log& l : logs) {
+        CrsfFrameLogReader reader;
+        int64_t first = 0, last = 0;
+        if (!reader.open(l.dir.c_str()) || !reader.range(first, last)) return 1;
+        const int64_t mid = first + (last - first) / 2;
+        for (double w : windows) {
+            const int64_t from = mid;
+            const int64_t to = mid + static_cast<int64_t>(w * 1e9);
+            const unsigned reps = 20;
+            CrsfFrameLogReader::QueryStats qs;
+            const auto t0 = Clock::now();
+            for (unsigned i = 0; i < reps; ++i)
+                reader.query(from, to, nullptr, &countRow, nullptr, &qs);
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / reps;
+            const bool rowsOk = qs.matched == static_cast<uint64_t>(w * 1000);
+            ok = ok && rowsOk;
+            printf("mode=query minutes=%u window_s=%.0f ms=%.3f rows=%llu scanned=%llu segments=%u rows_ok=%s\n",
+                   l.minutes, w, ms, (unsigned long long)qs.matched, (unsigned long long)qs.scanned, qs.segments,
+                   rowsOk ? "yes" : "NO");
+        }
+        // Только каналы в окне 10 с
+        std::bitset<256> channels;
+        channels.set(CRSF_FRAMETYPE_RC_CHANNELS_PACKED);
+        CrsfFrameLogReader::QueryStats qs;
+        reader.query(mid, mid + 10000000000ll, &channels, &countRow, nullptr, &qs);
+        ok = ok && qs.matched == 5000;
+        printf("mode=query minutes=%u window_s=10 type=0x16 rows=%llu scanned=%llu rows_ok=%s\n", l.minutes,
+               (unsigned long long)qs.matched, (unsigned long long)qs.scanned, qs.matched == 5000 ? "yes" : "NO");
+
+        Window win{ mid, mid + 10000000000ll, 0 };
+        const auto t0 = Clock::now();
+        reader.query(first, last + 1, nullptr, &countInWindow, &win, &qs);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        printf("mode=full_scan minutes=%u window_s=10 ms=%.3f rows=%llu scanned=%llu\n", l.minutes, ms,
+               (unsigned long long)win.rows, (unsigned long long)qs.scanned);
+        removeDir(l.dir);
+    }
+    return ok ? 0 : 1;
+}
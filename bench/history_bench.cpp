@@ -0,0 +1,213 @@
+// История телеметрии (libs/TelemetryHistory) и /api/history: запись отсчёта, выборка интервала
+// частями (Transfer-Encoding: chunked) и чтение во время записи.
+// Веб-сервер телеметрии (startTelemetryServer, порт 18084) и клиент в одном процессе, loopback.
+//
+// Метрики:
+//   record — ns_per_record: TelemetryHistory::record() (главный цикл, на каждый отсчёт)
+//   query  — полный буфер (по умолчанию 30000 отсчётов по 20 мс — 10 минут) как есть и со свёрткой step:
+//            ms на запрос, bytes ответа, rows, max_chunk — наибольшая часть (столько ответ держит в памяти
+//            сервера за раз), rows_ok — строк столько, сколько отсчётов или интервалов в окне
+//   race   — медленный клиент читает окно, пока писатель пишет 100 отсчётов в мс: overwritten — отсчёты,
+//            затёртые до того, как сервер до них дошёл; monotonic — метки строк не убывают
+//
+// Использование:
+//   ./bench/history_bench [отсчётов=30000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "libs/SerialPort.h"
+#include "libs/TelemetryHistory.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "telemetry_server.h"
+
+namespace {
+
+const int PORT = 18084;
+const uint64_t SAMPLE_NS = 20000000ull;
+
+int connectTo(int port, int rcvbuf)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (rcvbuf) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct Reply {
+    std::string body;
+    size_t maxChunk = 0;
+    size_t rows = 0;
+    uint64_t overwritten = 0;
+    bool monotonic = true;
+};
+
+// Запрос и ответ chunked целиком; slowUs — пауза между recv (медленный клиент)
+bool get(int fd, const std::string& target, Reply& r, unsigned slowUs = 0)
+{
+    const std::string req = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (send(fd, req.data(), req.size(), MSG_NOSIGNAL) <= 0) return false;
+    std::string buf;
+    char tmp[16384];
+    const size_t readSize = slowUs ? 2048 : sizeof(tmp);
+    // Конец ответа chunked — пустая часть; в JSON переводов строк нет
+    while (buf.size() < 5 || buf.compare(buf.size() - 5, 5, "0\r\n\r\n") != 0) {
+        const ssize_t n = recv(fd, tmp, readSize, 0);
+        if (n <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(n));
+        if (slowUs) usleep(slowUs);
+    }
+    if (buf.find("Transfer-Encoding: chunked") == std::string::npos) return false;
+    size_t pos = buf.find("\r\n\r\n") + 4;
+    r.body.clear();
+    r.maxChunk = 0;
+    for (;;) {
+        const size_t len = strtoul(buf.c_str() + pos, nullptr, 16);
+        pos = buf.find("\r\n", pos) + 2;
+        if (!len) break;
+        r.body.append(buf, pos, len);
+        r.maxChunk = std::max(r.maxChunk, len);
+        pos += len + 2;
+    }
+    // Строки — массивы чисел без вложенных массивов: по одной '[' на строку после "rows":[
+    const size_t rows = r.body.find("\"rows\":[");
+    if (rows == std::string::npos || r.body.back() != '}') return false;
+    r.rows = 0;
+    double lastT = -1;
+    for (size_t p = r.body.find('[', rows + 8); p != std::string::npos; p = r.body.find('[', p + 1)) {
+        ++r.rows;
+        const double t = strtod(r.body.c_str() + p + 1, nullptr);
+        if (t < lastT) r.monotonic = false;
+        lastT = t;
+    }
+    const size_t ow = r.body.find("\"overwritten\":");
+    r.overwritten = ow == std::string::npos ? 0 : strtoull(r.body.c_str() + ow + 14, nullptr, 10);
+    return true;
+}
+
+CrsfTelemetry sample(uint64_t i)
+{
+    CrsfTelemetry t{};
+    t.linkUp = true;
+    t.linkStatistics.uplink_Link_quality = static_cast<uint8_t>(90 + i % 10);
+    t.gps.latitude = 557512345 + static_cast<int32_t>(i % 1000);
+    t.gps.longitude = 376184321 - static_cast<int32_t>(i % 1000);
+    t.gps.altitude = 1150;
+    t.batteryVoltage = 16.8 - static_cast<double>(i % 500) / 1000.0;
+    t.batteryRemaining = static_cast<uint8_t>(100 - i % 100);
+    t.attitudeRoll = 30.0 * std::sin(static_cast<double>(i) / 50.0);
+    t.attitudePitch = 10.0 * std::cos(static_cast<double>(i) / 70.0);
+    t.attitudeYaw = static_cast<double>(i % 360);
+    for (int ch = 0; ch < 16; ++ch)
+        t.channels[ch] = 1000 + static_cast<int>((i + static_cast<uint64_t>(ch) * 37) % 1001);
+    return t;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t samples = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 30000;
+
+    // Сервер печатает баннер в stdout: результаты — в копию stdout
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || !freopen("/dev/null", "w", stdout)) return 1;
+
+    // record: время записи отсчёта, два оборота кольца
+    {
+        TelemetryHistory h(samples);
+        const CrsfTelemetry t = sample(1);
+        const uint64_t n = samples * 2;
+        const uint64_t t0 = TelemetryHistory::monotonicNs();
+        for (uint64_t i = 0; i < n; ++i)
+            h.record(t0 + i, t);
+        fprintf(out, "mode=record samples=%zu ns_per_record=%llu\n", samples,
+                (unsigned long long)((TelemetryHistory::monotonicNs() - t0) / n));
+    }
+
+    // Полный буфер: отсчёты раз в 20 мс, последний — сейчас
+    TelemetryHistory history(samples);
+    const uint64_t now = TelemetryHistory::monotonicNs();
+    for (uint64_t i = 0; i < samples; ++i)
+        history.record(now - (samples - 1 - i) * SAMPLE_NS, sample(i));
+
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    setTelemetryHistorySource(&history);
+    startTelemetryServer(&crsf, PORT);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    struct Query {
+        const char* name;
+        const char* target;
+        size_t expectRows;
+    };
+    const size_t windowMs = samples * SAMPLE_NS / 1000000;
+    const Query queries[] = {
+        { "raw_all", "/api/history", samples },
+        { "raw_attitude", "/api/history?fields=attitude", samples },
+        { "step1000_all", "/api/history?step=1000", (windowMs + 999) / 1000 },
+        { "step100_attitude", "/api/history?fields=attitude&step=100", (windowMs + 99) / 100 },
+    };
+    bool ok = true;
+    const int fd = connectTo(PORT, 0);
+    for (const Query& q : queries) {
+        const unsigned reps = 20;
+        Reply r;
+        bool good = fd >= 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < reps && good; ++i)
+            good = get(fd, q.target, r);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / reps;
+        const bool rowsOk = good && r.rows == q.expectRows;
+        ok = ok && rowsOk;
+        fprintf(out, "mode=query query=%s ms=%.2f bytes=%zu rows=%zu max_chunk=%zu rows_ok=%s\n", q.name, ms,
+                r.body.size(), r.rows, r.maxChunk, rowsOk ? "yes" : "NO");
+    }
+    if (fd >= 0) close(fd);
+
+    // race: писатель обгоняет медленного клиента
+    std::atomic<bool> stop{false};
+    std::thread writer([&]() {
+        uint64_t i = samples;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (int k = 0; k < 100; ++k)
+                history.record(TelemetryHistory::monotonicNs(), sample(i++));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    const int slow = connectTo(PORT, 4096);
+    Reply r;
+    const bool good = slow >= 0 && get(slow, "/api/history", r, 1000);
+    stop.store(true);
+    writer.join();
+    if (slow >= 0) close(slow);
+    ok = ok && good && r.monotonic;
+    fprintf(out, "mode=race rows=%zu overwritten=%llu monotonic=%s\n", r.rows, (unsigned long long)r.overwritten,
+            good && r.monotonic ? "yes" : "NO");
+
+    stopTelemetryServer();
+    setTelemetryHistorySource(nullptr);
+    setTelemetrySource(nullptr);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+// Нагрузочный тест веб-сервера телеметрии: запросов/с и задержка GET /api/telemetry.
+//
+// Серверы:
+//   legacy — прежний telemetry_server: поток на каждое подключение, разбор через stringstream,
+//            ответ с Connection: close (копия кода для сравнения)
+//   epoll  — libs/HttpServer: рабочие потоки на epoll, keep-alive, маршруты по таблице
+// Оба отдают один и тот же createTelemetryJson().
+//
+// Клиенты — потоки, каждый шлёт запросы друг за другом:
+//   close     — новое TCP-подключение на каждый запрос (как клиент без keep-alive)
+//   keepalive — одно подключение на всё время замера
+//
+// Метрики: requests_per_s, p50_us / p99_us / max_us, errors,
+// threads_peak — наибольшее число потоков процесса во время замера (/proc/self/status)
+//
+// Доставка снимков (mode=poll / mode=stream): CrsfSerial публикует новый снимок каждые 2 мс (500 Гц),
+// веб-сервер телеметрии (startTelemetryServer, порт 18081) отдаёт их клиентам:
+//   poll   — GET /api/telemetry раз в 20 мс на keep-alive подключении (как crsf_realtime_interface.py)
+//   stream — GET /api/stream?maxRate=N (Server-Sent Events); плюс один клиент, который ничего не читает
+//   samples_per_s — новых снимков у клиента в секунду, dup_pct — ответов без нового снимка,
+//   lat_p50_us / lat_p99_us — от публикации снимка до получения клиентом (только stream)
+//
+// Использование:
+//   ./bench/http_load_bench [клиентов=4] [мс=2000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/HttpServer.h"
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "telemetry_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+unsigned threadCount()
+{
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    unsigned n = 0;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "Threads: %u", &n) == 1) break;
+    fclose(f);
+    return n;
+}
+
+// ---- Прежний сервер (telemetry_server.cpp до перехода на HttpServer) ----
+
+void legacySendHttpResponse(int clientSocket, const std::string& content, const std::string& contentType)
+{
+    std::stringstream response;
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: " << contentType << "\r\n";
+    response << "Content-Length: " << content.length() << "\r\n";
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Connection: close\r\n\r\n";
+    response << content;
+    std::string responseStr = response.str();
+    send(clientSocket, responseStr.c_str(), responseStr.length(), MSG_NOSIGNAL);
+}
+
+void legacyHandleClient(int clientSocket)
+{
+    char buffer[4096];
+    int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+    if (bytesReceived > 0) {
+        buffer[bytesReceived] = '\0';
+        std::string request(buffer);
+        std::stringstream ss(request);
+        std::string method, path, version;
+        ss >> method >> path >> version;
+        if (path == "/api/telemetry") {
+            legacySendHttpResponse(clientSocket, createTelemetryJson(), "application/json");
+        } else {
+            std::string response = "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n\r\n<h1>404 Not Found</h1>";
+            send(clientSocket, response.c_str(), response.length(), MSG_NOSIGNAL);
+        }
+    }
+    close(clientSocket);
+}
+
+class LegacyServer
+{
+public:
+    bool start()
+    {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(_fd, 5) < 0) return false;
+        socklen_t len = sizeof(addr);
+        getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        _port = ntohs(addr.sin_port);
+        _thread = std::thread([this]() {
+            while (!_stop.load()) {
+                int clientSocket = accept(_fd, nullptr, nullptr);
+                if (clientSocket < 0) continue;
+                std::thread clientThread(legacyHandleClient, clientSocket);
+                clientThread.detach();
+            }
+        });
+        return true;
+    }
+    void stop()
+    {
+        _stop = true;
+        shutdown(_fd, SHUT_RDWR);
+        _thread.join();
+        close(_fd);
+        // Отсоединённые потоки подключений дорабатывают сами
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    int port() const { return _port; }
+
+private:
+    int _fd = -1;
+    int _port = 0;
+    std::atomic<bool> _stop{false};
+    std::thread _thread;
+};
+
+// ---- Клиенты ----
+
+int connectTo(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Прочитать один ответ: заголовки и тело по Content-Length (или до закрытия). false — ошибка
+bool readResponse(int fd, std::string& buf)
+{
+    buf.clear();
+    size_t headEnd = std::string::npos;
+    size_t need = 0;
+    char tmp[8192];
+    for (;;) {
+        if (headEnd == std::string::npos) {
+            headEnd = buf.find("\r\n\r\n");
+            if (headEnd != std::string::npos) {
+                const size_t cl = buf.find("Content-Length: ");
+                if (cl == std::string::npos || cl > headEnd) return false;
+                need = headEnd + 4 + strtoul(buf.c_str() + cl + 16, nullptr, 10);
+            }
+        }
+        if (headEnd != std::string::npos && buf.size() >= need)
+            return buf.compare(0, 12, "HTTP/1.1 200") == 0;
+        const ssize_t r = recv(fd, tmp, sizeof(tmp), 0);
+        if (r <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(r));
+    }
+}
+
+struct ClientResult {
+    std::vector<uint32_t> latUs;
+    uint64_t errors = 0;
+};
+
+void client(int port, bool keepAlive, Clock::time_point end, ClientResult& res)
+{
+    const char* req = keepAlive ? "GET /api/telemetry HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                                : "GET /api/telemetry HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    const size_t reqLen = strlen(req);
+    std::string buf;
+    int fd = -1;
+    while (Clock::now() < end) {
+        const auto t0 = Clock::now();
+        if (fd < 0) fd = connectTo(port);
+        bool ok = fd >= 0 && send(fd, req, reqLen, MSG_NOSIGNAL) == static_cast<ssize_t>(reqLen) && readResponse(fd, buf);
+        if (ok) res.latUs.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count()));
+        else ++res.errors;
+        if (!ok || !keepAlive) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) close(fd);
+}
+
+void runLoad(const char* server, int port, bool keepAlive, unsigned clients, unsigned ms)
+{
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    std::atomic<bool> done{false};
+    unsigned peak = threadCount();
+    std::thread sampler([&]() {
+        while (!done.load()) {
+            peak = std::max(peak, threadCount());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    const auto end = Clock::now() + std::chrono::milliseconds(ms);
+    for (unsigned i = 0; i < clients; ++i)
+        threads.emplace_back(client, port, keepAlive, end, std::ref(results[i]));
+    for (auto& t : threads)
+        t.join();
+    done = true;
+    sampler.join();
+
+    std::vector<uint32_t> lat;
+    uint64_t errors = 0;
+    for (auto& r : results) {
+        lat.insert(lat.end(), r.latUs.begin(), r.latUs.end());
+        errors += r.errors;
+    }
+    std::sort(lat.begin(), lat.end());
+    const size_t n = lat.size();
+    printf("server=%s conn=%s clients=%u requests=%zu requests_per_s=%.0f p50_us=%u p99_us=%u max_us=%u errors=%llu threads_peak=%u\n",
+           server, keepAlive ? "keepalive" : "close", clients, n, n * 1000.0 / ms,
+           n ? lat[n / 2] : 0, n ? lat[n * 99 / 100] : 0, n ? lat[n - 1] : 0,
+           (unsigned long long)errors, peak);
+}
+
+void routeTelemetry(const HttpRequest&, HttpResponse& resp)
+{
+    resp.contentType = "application/json";
+    resp.body = createTelemetryJson();
+}
+
+const HttpRoute kRoutes[] = {
+    { "/api/telemetry", false, routeTelemetry },
+};
+
+// ---- Доставка снимков: опрос против потока ----
+
+const int STREAM_PORT = 18081;
+const unsigned PUBLISH_SLOTS = 1u << 16;
+std::atomic<uint64_t> g_publishNs[PUBLISH_SLOTS];
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+struct DeliveryResult {
+    uint64_t responses = 0;
+    uint64_t samples = 0;       // ответов/событий с новым снимком
+    std::vector<uint32_t> latUs;
+};
+
+// Опрос: в первом канале — счётчик снимков, по нему видно новый снимок или повтор
+void pollClient(Clock::time_point end, DeliveryResult& res)
+{
+    const char* req = "GET /api/telemetry?fields=channels HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string buf;
+    int fd = connectTo(STREAM_PORT);
+    int last = -1;
+    while (fd >= 0 && Clock::now() < end) {
+        if (send(fd, req, strlen(req), MSG_NOSIGNAL) < 0 || !readResponse(fd, buf)) break;
+        ++res.responses;
+        const size_t at = buf.find("\"channels\":[");
+        const int ch1 = (at == std::string::npos) ? -1 : atoi(buf.c_str() + at + 12);
+        if (ch1 != last) ++res.samples;
+        last = ch1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    if (fd >= 0) close(fd);
+}
+
+// Поток: события разбираются по строкам id:, задержка — по времени публикации снимка с этим номером
+void streamClient(unsigned hz, bool reader, Clock::time_point end, DeliveryResult& res)
+{
+    int fd = connectTo(STREAM_PORT);
+    if (fd < 0) return;
+    char req[128];
+    snprintf(req, sizeof(req), "GET /api/stream?maxRate=%u HTTP/1.1\r\nHost: localhost\r\n\r\n", hz);
+    send(fd, req, strlen(req), MSG_NOSIGNAL);
+    if (!reader) {
+        // Медленный клиент: подключился и не читает, пока идёт замер
+        std::this_thread::sleep_until(end);
+        close(fd);
+        return;
+    }
+    timeval tv{0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string buf;
+    char tmp[16384];
+    uint64_t lastId = 0;
+    while (Clock::now() < end) {
+        const ssize_t r = recv(fd, tmp, sizeof(tmp), 0);
+        if (r == 0) break;
+        if (r < 0) continue;
+        const uint64_t t = nowNs();
+        buf.append(tmp, static_cast<size_t>(r));
+        size_t pos;
+        while ((pos = buf.find("\n\n")) != std::string::npos) {
+            const size_t id = buf.rfind("id: ", pos);
+            if (id != std::string::npos) {
+                const uint64_t version = strtoull(buf.c_str() + id + 4, nullptr, 10);
+                ++res.responses;
+                if (version != lastId) {
+                    ++res.samples;
+                    const uint64_t pub = g_publishNs[version % PUBLISH_SLOTS].load(std::memory_order_acquire);
+                    if (pub && t > pub) res.latUs.push_back(static_cast<uint32_t>((t - pub) / 1000));
+                }
+                lastId = version;
+            }
+            buf.erase(0, pos + 2);
+        }
+    }
+    close(fd);
+}
+
+void runDelivery(CrsfSerial& crsf, const char* mode, unsigned hz, unsigned clients, unsigned ms)
+{
+    std::vector<DeliveryResult> results(clients);
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop{false};
+    uint64_t published = 0;
+    // Писатель — как поток CRSF: новый снимок каждые 2 мс
+    std::thread producer([&]() {
+        int value = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            const uint32_t next = crsf.telemetryVersion() + 1;
+            value = (value + 1) % 1000;
+            crsf.setChannel(1, 1000 + value);
+            g_publishNs[next % PUBLISH_SLOTS].store(nowNs(), std::memory_order_release);
+            crsf.packetChannelsSend();
+            ++published;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const auto end = Clock::now() + std::chrono::milliseconds(ms);
+    const bool stream = strcmp(mode, "stream") == 0;
+    for (unsigned i = 0; i < clients; ++i) {
+        if (stream) threads.emplace_back(streamClient, hz, true, end, std::ref(results[i]));
+        else threads.emplace_back(pollClient, end, std::ref(results[i]));
+    }
+    DeliveryResult slow;
+    if (stream) threads.emplace_back(streamClient, hz, false, end, std::ref(slow));
+    for (auto& t : threads)
+        t.join();
+    stop = true;
+    producer.join();
+
+    std::vector<uint32_t> lat;
+    uint64_t responses = 0, samples = 0;
+    for (auto& r : results) {
+        lat.insert(lat.end(), r.latUs.begin(), r.latUs.end());
+        responses += r.responses;
+        samples += r.samples;
+    }
+    std::sort(lat.begin(), lat.end());
+    const size_t n = lat.size();
+    const double sec = ms / 1000.0;
+    char latText[64] = "lat_p50_us=na lat_p99_us=na";
+    if (n) snprintf(latText, sizeof(latText), "lat_p50_us=%u lat_p99_us=%u", lat[n / 2], lat[n * 99 / 100]);
+    printf("mode=%s rate_hz=%u clients=%u published_per_s=%.0f samples_per_s=%.1f dup_pct=%.1f %s\n",
+           mode, hz, clients, published / (sec + 0.05), samples / sec / clients,
+           responses ? 100.0 * (responses - samples) / responses : 0.0, latText);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned clients = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 4;
+    const unsigned ms = (argc > 2) ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 2000;
+
+    // Источник телеметрии с реальными значениями
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    const std::vector<uint8_t> stream = bench::mixedStream(1000);
+    crsf.receive(stream.data(), stream.size());
+    setTelemetrySource(&crsf);
+
+    LegacyServer legacy;
+    if (!legacy.start()) { fprintf(stderr, "не удалось запустить прежний сервер\n"); return 1; }
+    runLoad("legacy", legacy.port(), false, clients, ms);
+    legacy.stop();
+
+    HttpServer server(kRoutes, sizeof(kRoutes) / sizeof(kRoutes[0]));
+    if (!server.start(0, 2, 64)) { fprintf(stderr, "не удалось запустить HttpServer\n"); return 1; }
+    runLoad("epoll", server.port(), false, clients, ms);
+    runLoad("epoll", server.port(), true, clients, ms);
+    server.stop();
+
+    startTelemetryServer(&crsf, STREAM_PORT);
+    runDelivery(crsf, "poll", 50, clients, ms);
+    runDelivery(crsf, "stream", 50, clients, ms);
+    runDelivery(crsf, "stream", 1000, clients, ms);
+    stopTelemetryServer();
+    setTelemetrySource(nullptr);
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Гистограммы сквозных задержек (libs/LatencyHistogram.h и CrsfSerial::setLatencyStats).
+//
+// Сценарии:
+//   record   — цена LatencyHistogram::record() и сводки (summary / takeSummary)
+//   accuracy — процентили гистограммы против точных по отсортированной выборке (логнормальные задержки
+//              с хвостом); rel_err — наибольшая относительная ошибка p50/p99/p999, ok — не больше 1/32
+//   reset    — писатель пишет, читатель в это время снимает сводки со сбросом: lost — отсчёты, не попавшие
+//              ни в одну сводку (должно быть 0)
+//   e2e      — CrsfSerial на псевдотерминале: tx — queueChannels() → packetChannelsSend() → write(),
+//              rx — CrsfSenderLinux → pty → CrsfSerial::loop() → обработчик кадра; count — записей в гистограмме
+//
+// Использование:
+//   ./bench/latency_bench [отсчётов=2000000] [кадров=2000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libs/LatencyHistogram.h"
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "rpi/CrsfSenderLinux.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const auto kFrameTimeout = std::chrono::milliseconds(100);
+
+unsigned g_channelsDecoded = 0;
+void onChannels() { ++g_channelsDecoded; }
+
+void printSummary(const char* scenario, const char* path, const LatencyHistogram::Summary& s)
+{
+    printf("scenario=%s path=%s count=%llu p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n", scenario, path,
+           (unsigned long long)s.count, s.p50Ns / 1000.0, s.p99Ns / 1000.0, s.p999Ns / 1000.0, s.maxNs / 1000.0);
+}
+
+void benchRecord(unsigned samples)
+{
+    LatencyHistogram h;
+    std::vector<uint64_t> values(4096);
+    std::mt19937_64 rng(1);
+    for (auto& v : values) v = 20000 + rng() % 2000000;
+    auto t0 = Clock::now();
+    for (unsigned i = 0; i < samples; ++i)
+        h.record(values[i & 4095]);
+    const double recordNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / samples;
+    t0 = Clock::now();
+    const unsigned rounds = 1000;
+    uint64_t sink = 0;
+    for (unsigned i = 0; i < rounds; ++i)
+        sink += h.summary().p99Ns;
+    const double summaryUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / rounds;
+    printf("scenario=record samples=%u ns_per_record=%.2f summary_us=%.2f buckets=%u bytes=%zu check=%llu\n", samples,
+           recordNs, summaryUs, LatencyHistogram::BUCKETS, sizeof(LatencyHistogram), (unsigned long long)(sink & 1));
+}
+
+bool benchAccuracy(unsigned samples)
+{
+    // Основная масса около 200 мкс, 1% — хвост до десятков миллисекунд
+    std::mt19937_64 rng(7);
+    std::lognormal_distribution<double> body(std::log(200000.0), 0.3);
+    std::lognormal_distribution<double> tail(std::log(5000000.0), 1.0);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::vector<uint64_t> values(samples);
+    LatencyHistogram h;
+    for (auto& v : values) {
+        v = static_cast<uint64_t>(coin(rng) < 0.01 ? tail(rng) : body(rng));
+        h.record(v);
+    }
+    std::sort(values.begin(), values.end());
+    auto exact = [&](double q) { return values[static_cast<size_t>(std::ceil(q * values.size())) - 1]; };
+    const LatencyHistogram::Summary s = h.summary();
+    const uint64_t got[3] = { s.p50Ns, s.p99Ns, s.p999Ns };
+    const double qs[3] = { 0.5, 0.99, 0.999 };
+    double relErr = 0;
+    for (unsigned i = 0; i < 3; ++i) {
+        const double e = exact(qs[i]);
+        relErr = std::max(relErr, std::fabs(got[i] - e) / e);
+    }
+    const bool ok = relErr <= 1.0 / 32 && s.maxNs == values.back();
+    printf("scenario=accuracy samples=%u exact_p50_us=%.1f p50_us=%.1f exact_p99_us=%.1f p99_us=%.1f "
+           "exact_p999_us=%.1f p999_us=%.1f rel_err=%.4f ok=%s\n",
+           samples, exact(0.5) / 1000.0, s.p50Ns / 1000.0, exact(0.99) / 1000.0, s.p99Ns / 1000.0,
+           exact(0.999) / 1000.0, s.p999Ns / 1000.0, relErr, ok ? "yes" : "NO");
+    return ok;
+}
+
+bool benchReset(unsigned samples)
+{
+    LatencyHistogram h;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (unsigned i = 0; i < samples; ++i)
+            h.record(1000 + i % 100000);
+        done.store(true, std::memory_order_release);
+    });
+    uint64_t taken = 0;
+    unsigned resets = 0;
+    while (!done.load(std::memory_order_acquire)) {
+        taken += h.takeSummary().count;
+        ++resets;
+        std::this_thread::yield();
+    }
+    writer.join();
+    taken += h.takeSummary().count;
+    const long long lost = static_cast<long long>(samples) - static_cast<long long>(taken);
+    printf("scenario=reset samples=%u resets=%u taken=%llu lost=%lld\n", samples, resets, (unsigned long long)taken, lost);
+    return lost == 0;
+}
+
+bool benchTx(unsigned frames, CrsfLatencyStats& latency)
+{
+    SerialPort port("", CRSF_BAUDRATE);
+    std::string peer;
+    if (!port.openPty(peer)) { fprintf(stderr, "pty недоступен\n"); return false; }
+    SerialPort reader(peer, CRSF_BAUDRATE);
+    if (!reader.open()) { fprintf(stderr, "не удалось открыть %s\n", peer.c_str()); return false; }
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.setLatencyStats(&latency);
+    uint8_t drain[4096];
+    int values[CRSF_NUM_CHANNELS] = {};
+    for (unsigned i = 0; i < frames; ++i) {
+        values[0] = (i & 1) ? 2000 : 1000;
+        crsf.queueChannels(1u, values);
+        crsf.packetChannelsSend();
+        // Выбираем с другой стороны, чтобы буфер pty не переполнился
+        while (reader.readBulk(drain, sizeof(drain), nullptr, 0) > 0) {
+        }
+    }
+    printSummary("e2e", "tx_http", latency.input[CRSF_INPUT_HTTP].takeSummary());
+    reader.close();
+    port.close();
+    return true;
+}
+
+bool benchRx(unsigned frames, CrsfLatencyStats& latency)
+{
+    CrsfSenderLinux tx;
+    std::string peer;
+    if (!tx.beginPty(peer)) { fprintf(stderr, "pty недоступен\n"); return false; }
+    SerialPort port(peer, CRSF_BAUDRATE);
+    if (!port.open()) { fprintf(stderr, "не удалось открыть %s\n", peer.c_str()); return false; }
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.onPacketChannels = &onChannels;
+    crsf.setLatencyStats(&latency);
+    for (unsigned i = 0; i < frames; ++i) {
+        tx.setChannel(1, 1000 + int(i % 1001));
+        const unsigned before = g_channelsDecoded;
+        const auto sent = Clock::now();
+        if (!tx.sendChannels()) continue;
+        while (g_channelsDecoded == before && Clock::now() - sent < kFrameTimeout)
+            crsf.loop();
+    }
+    printSummary("e2e", "rx", latency.rx.takeSummary());
+    port.close();
+    tx.end();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned samples = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000000;
+    const unsigned frames = (argc > 2) ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 2000;
+    benchRecord(samples);
+    bool ok = benchAccuracy(samples);
+    ok = benchReset(samples) && ok;
+    static CrsfLatencyStats latency;
+    if (!benchTx(frames, latency) || !benchRx(frames, latency)) return 1;
+    return ok ? 0 : 1;
+}
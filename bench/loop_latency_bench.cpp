@@ -0,0 +1,146 @@
+// Бенчмарк главного цикла: задержка пробуждения и загрузка CPU для режимов EventLoop.
+// Байты приходят через псевдотерминал (pty) через случайные интервалы 0.5..3 мс;
+// задержка = время от write() в master до вызова обработчика в цикле.
+// Параллельно работает таймер 10 мс, как тик отправки каналов в main.cpp.
+//
+// Использование:
+//   ./bench/loop_latency_bench [событий=2000] [spin_us=200]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "libs/EventLoop.h"
+#include "libs/SerialPort.h"
+#include "libs/pty.h"
+#include "libs/crsf/crsf_protocol.h"
+
+namespace {
+
+uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+uint64_t threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+struct Context {
+    SerialPort* port;
+    std::atomic<uint64_t> sentAt{0};
+    std::vector<double> latenciesUs;
+    unsigned ticks = 0;
+};
+
+void onReadable(void* p)
+{
+    Context* ctx = static_cast<Context*>(p);
+    uint8_t buf[64];
+    int r = ctx->port->readBulk(buf, sizeof(buf));
+    if (r > 0) {
+        uint64_t sent = ctx->sentAt.load(std::memory_order_acquire);
+        ctx->latenciesUs.push_back((nowNs() - sent) / 1000.0);
+    }
+}
+
+void onTick(void* p)
+{
+    ++static_cast<Context*>(p)->ticks;
+}
+
+const char* modeName(EventLoop::Mode m)
+{
+    switch (m) {
+    case EventLoop::Mode::Spin: return "spin";
+    case EventLoop::Mode::Hybrid: return "hybrid";
+    default: return "blocking";
+    }
+}
+
+bool runMode(EventLoop::Mode mode, unsigned events, uint32_t spinUs)
+{
+    int master;
+    std::string slavePath;
+    if (!pty_open(master, slavePath)) {
+        fprintf(stderr, "pty недоступен\n");
+        return false;
+    }
+    SerialPort port(slavePath, 420000);
+    if (!port.open()) {
+        fprintf(stderr, "не удалось открыть slave pty\n");
+        return false;
+    }
+
+    Context ctx;
+    ctx.port = &port;
+    ctx.latenciesUs.reserve(events);
+
+    EventLoop loop(mode, spinUs);
+    loop.open();
+    loop.add(port.fd(), &onReadable, &ctx);
+    loop.addTimer(10000, &onTick, &ctx);
+
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> gapUs(500, 3000);
+        for (unsigned i = 0; i < events; ++i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(gapUs(rng)));
+            uint8_t b = CRSF_SYNC_BYTE;
+            ctx.sentAt.store(nowNs(), std::memory_order_release);
+            if (::write(master, &b, 1) != 1) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        done = true;
+        uint8_t b = 0; // разбудить цикл в блокирующем режиме
+        ctx.sentAt.store(nowNs(), std::memory_order_release);
+        (void)!::write(master, &b, 1);
+    });
+
+    const uint64_t wall0 = nowNs();
+    const uint64_t cpu0 = threadCpuNs();
+    while (!done)
+        loop.runOnce();
+    const double wallSec = (nowNs() - wall0) / 1e9;
+    const double cpuSec = (threadCpuNs() - cpu0) / 1e9;
+    writer.join();
+
+    std::vector<double>& v = ctx.latenciesUs;
+    if (!v.empty()) v.pop_back(); // служебный байт остановки
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double q) { return v.empty() ? 0.0 : v[std::min(v.size() - 1, size_t(q * v.size()))]; };
+    printf("mode=%s spin_us=%u events=%zu ticks=%u cpu_pct=%.1f wake_p50_us=%.1f wake_p99_us=%.1f wake_max_us=%.1f\n",
+           modeName(mode), mode == EventLoop::Mode::Hybrid ? spinUs : 0, v.size(), ctx.ticks,
+           100.0 * cpuSec / wallSec, pct(0.50), pct(0.99), v.empty() ? 0.0 : v.back());
+
+    loop.close();
+    port.close();
+    ::close(master);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned events = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000;
+    uint32_t spinUs = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 200;
+
+    const EventLoop::Mode modes[] = { EventLoop::Mode::Spin, EventLoop::Mode::Hybrid, EventLoop::Mode::Blocking };
+    for (EventLoop::Mode m : modes)
+        if (!runMode(m, events, spinUs)) return 1;
+    return 0;
+}
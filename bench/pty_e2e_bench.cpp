@@ -0,0 +1,138 @@
+// Сквозной бенчмарк RX/TX через псевдотерминалы, без UART.
+//
+// Сценарии:
+//   sender->serial — rpi/CrsfSenderLinux::sendChannels() → pty → CrsfSerial::loop()
+//   serial->client — CrsfSerial::packetChannelsSend()    → pty → rpi/CrsfClientLinux::loop()
+//
+// Кадры идут по одному: отправка, затем приём до разбора кадра. Задержка — от отправки до разбора.
+// Темп: paced — не быстрее 420000 бод (26-байтовый кадр раз в ~619 мкс), max — без пауз.
+//
+// Использование:
+//   ./bench/pty_e2e_bench [кадров=2000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "rpi/CrsfClientLinux.h"
+#include "rpi/CrsfSenderLinux.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Время одного RC-кадра на линии 420000 бод: 26 байт по 10 бит
+const auto kFramePeriod = std::chrono::nanoseconds(26ll * 10 * 1000000000ll / CRSF_BAUDRATE);
+const auto kFrameTimeout = std::chrono::milliseconds(100);
+
+unsigned g_channelsDecoded = 0;
+void onChannels() { ++g_channelsDecoded; }
+
+struct Result {
+    unsigned sent = 0;
+    unsigned received = 0;
+    double seconds = 0;
+    std::vector<double> latencyUs;
+};
+
+void report(const char* scenario, bool paced, Result& r)
+{
+    std::sort(r.latencyUs.begin(), r.latencyUs.end());
+    auto pct = [&](double q) {
+        return r.latencyUs.empty() ? 0.0 : r.latencyUs[std::min(r.latencyUs.size() - 1, size_t(q * r.latencyUs.size()))];
+    };
+    printf("scenario=%s pace=%s sent=%u received=%u frames_per_s=%.0f latency_p50_us=%.1f latency_p99_us=%.1f latency_max_us=%.1f\n",
+           scenario, paced ? "paced" : "max", r.sent, r.received, r.received / r.seconds,
+           pct(0.50), pct(0.99), r.latencyUs.empty() ? 0.0 : r.latencyUs.back());
+}
+
+bool senderToSerial(unsigned frames, bool paced)
+{
+    CrsfSenderLinux tx;
+    std::string peer;
+    if (!tx.beginPty(peer)) { fprintf(stderr, "pty недоступен\n"); return false; }
+    SerialPort port(peer, CRSF_BAUDRATE);
+    if (!port.open()) { fprintf(stderr, "не удалось открыть %s\n", peer.c_str()); return false; }
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    crsf.onPacketChannels = &onChannels;
+
+    Result r;
+    const auto t0 = Clock::now();
+    auto next = t0;
+    for (unsigned i = 0; i < frames; ++i) {
+        if (paced) {
+            std::this_thread::sleep_until(next);
+            next += kFramePeriod;
+        }
+        tx.setChannel(1, 1000 + int(i % 1001));
+        unsigned before = g_channelsDecoded;
+        const auto sent = Clock::now();
+        if (!tx.sendChannels()) continue;
+        ++r.sent;
+        while (g_channelsDecoded == before && Clock::now() - sent < kFrameTimeout)
+            crsf.loop();
+        if (g_channelsDecoded != before) {
+            ++r.received;
+            r.latencyUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+        }
+    }
+    r.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    report("sender->serial", paced, r);
+    port.close();
+    tx.end();
+    return true;
+}
+
+bool serialToClient(unsigned frames, bool paced)
+{
+    SerialPort port("", CRSF_BAUDRATE);
+    std::string peer;
+    if (!port.openPty(peer)) { fprintf(stderr, "pty недоступен\n"); return false; }
+    CrsfClientLinux rx;
+    if (!rx.begin(peer)) { fprintf(stderr, "не удалось открыть %s\n", peer.c_str()); return false; }
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+
+    Result r;
+    const auto t0 = Clock::now();
+    auto next = t0;
+    for (unsigned i = 0; i < frames; ++i) {
+        if (paced) {
+            std::this_thread::sleep_until(next);
+            next += kFramePeriod;
+        }
+        // Чередуем крайние значения: они переводятся в код и обратно без округления
+        const int value = (i & 1) ? 2000 : 1000;
+        crsf.setChannel(1, value);
+        const auto sent = Clock::now();
+        crsf.packetChannelsSend();
+        ++r.sent;
+        while (rx.getChannel(1) != value && Clock::now() - sent < kFrameTimeout)
+            rx.loop();
+        if (rx.getChannel(1) == value) {
+            ++r.received;
+            r.latencyUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+        }
+    }
+    r.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    report("serial->client", paced, r);
+    rx.end();
+    port.close();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned frames = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000;
+    for (bool paced : { true, false }) {
+        if (!senderToSerial(frames, paced)) return 1;
+        if (!serialToClient(frames, paced)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Бенчмарк профилей SerialPort: одинаковый замер для NonBlocking, BoundedBlocking и LowLatency.
+// Имитирует прежний главный цикл: чтение порта + отправка каналов каждые 10 мс в том же потоке.
+// Байты приходят через псевдотерминал (pty) через случайные интервалы 0.5..3 мс, с паузами
+// «тихой линии» по 50 мс.
+//
+// Метрики:
+//   read_p50_us / read_p99_us — от write() в master до возврата данных из чтения
+//   tick_late_max_us          — максимальное опоздание 10-мс тика отправки (сколько цикл ждал в чтении)
+//   cpu_pct                   — загрузка CPU потоком цикла
+//
+// Использование:
+//   ./bench/serial_profile_bench [событий=1000] [deadline_us=1000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "libs/SerialPort.h"
+#include "libs/pty.h"
+#include "libs/crsf/crsf_protocol.h"
+
+namespace {
+
+uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+uint64_t threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+const char* profileName(SerialPort::Profile p)
+{
+    switch (p) {
+    case SerialPort::Profile::BoundedBlocking: return "bounded";
+    case SerialPort::Profile::LowLatency: return "lowlatency";
+    default: return "nonblocking";
+    }
+}
+
+bool runProfile(SerialPort::Profile profile, uint32_t deadlineUs, unsigned events)
+{
+    int master;
+    std::string slavePath;
+    if (!pty_open(master, slavePath)) {
+        fprintf(stderr, "pty недоступен\n");
+        return false;
+    }
+    SerialPort port(slavePath, CRSF_BAUDRATE);
+    port.setProfile(profile, deadlineUs);
+    if (!port.open()) {
+        fprintf(stderr, "не удалось открыть slave pty\n");
+        return false;
+    }
+
+    std::atomic<uint64_t> sentAt{0};
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> gapUs(500, 3000);
+        for (unsigned i = 0; i < events; ++i) {
+            // Каждые 100 событий — «тихая линия» на 50 мс
+            unsigned gap = (i % 100 == 99) ? 50000 : gapUs(rng);
+            std::this_thread::sleep_for(std::chrono::microseconds(gap));
+            uint8_t b = CRSF_SYNC_BYTE;
+            sentAt.store(nowNs(), std::memory_order_release);
+            if (::write(master, &b, 1) != 1) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        done = true;
+    });
+
+    std::vector<double> readUs;
+    readUs.reserve(events);
+    const uint64_t tickNs = 10000000ull;
+    uint64_t nextTick = nowNs() + tickNs;
+    uint64_t tickLateMaxNs = 0;
+    const uint64_t wall0 = nowNs();
+    const uint64_t cpu0 = threadCpuNs();
+    while (!done) {
+        uint8_t buf[64];
+        int r = port.readBulk(buf, sizeof(buf));
+        uint64_t t = nowNs();
+        if (r > 0)
+            readUs.push_back((t - sentAt.load(std::memory_order_acquire)) / 1000.0);
+        if (t >= nextTick) {
+            tickLateMaxNs = std::max(tickLateMaxNs, t - nextTick);
+            nextTick += tickNs;
+            if (nextTick < t) nextTick = t + tickNs;
+        }
+    }
+    const double wallSec = (nowNs() - wall0) / 1e9;
+    const double cpuSec = (threadCpuNs() - cpu0) / 1e9;
+    writer.join();
+
+    std::sort(readUs.begin(), readUs.end());
+    auto pct = [&](double q) { return readUs.empty() ? 0.0 : readUs[std::min(readUs.size() - 1, size_t(q * readUs.size()))]; };
+    printf("profile=%s deadline_us=%u low_latency=%d events=%zu cpu_pct=%.1f read_p50_us=%.1f read_p99_us=%.1f tick_late_max_us=%.1f\n",
+           profileName(profile), profile == SerialPort::Profile::BoundedBlocking ? deadlineUs : 0,
+           port.lowLatencyActive() ? 1 : 0, readUs.size(), 100.0 * cpuSec / wallSec,
+           pct(0.50), pct(0.99), tickLateMaxNs / 1000.0);
+
+    port.close();
+    ::close(master);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned events = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 1000;
+    uint32_t deadlineUs = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 1000;
+
+    if (!runProfile(SerialPort::Profile::NonBlocking, 0, events)) return 1;
+    if (!runProfile(SerialPort::Profile::BoundedBlocking, deadlineUs, events)) return 1;
+    if (!runProfile(SerialPort::Profile::LowLatency, 0, events)) return 1;
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Бенчмарк приёма CRSF: число системных вызовов чтения на кадр.
+// Поток кадров подаётся через псевдотерминал (pty) с темпом 420000 бод, поэтому железо не нужно.
+//
+// Режимы:
+//   bytewise — прежний путь: readByte() по одному байту (до 32 за проход) и rpi_millis() на каждый байт
+//   batched  — CrsfSerial::loop(): один readv в кольцевой буфер, одна метка времени на пачку
+// В обоих режимах порт работает в профиле BoundedBlocking со сроком 100 мс — как прежний VTIME=1,
+// чтобы пустые чтения не искажали сравнение
+//
+// Использование:
+//   ./bench/serial_rx_bench [кадров=5000] [--fast]
+//   --fast — писать поток без пауз (максимальная скорость вместо 420000 бод)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "bench_frames.h"
+#include "libs/SerialPort.h"
+#include "libs/pty.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "libs/rpi_hal.h"
+
+namespace {
+
+// Пишет поток в master-сторону pty покадрово с темпом UART (10 бит на байт)
+void writeStream(int fd, const std::vector<uint8_t>& stream, bool fast)
+{
+    using Clock = std::chrono::steady_clock;
+    const double nsPerByte = 1e9 * 10.0 / CRSF_BAUDRATE;
+    const auto start = Clock::now();
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        size_t len = stream[pos + 1] + 2;
+        if (!fast) {
+            auto due = start + std::chrono::nanoseconds((long long)((pos + len) * nsPerByte));
+            std::this_thread::sleep_until(due);
+        }
+        size_t off = 0;
+        while (off < len) {
+            ssize_t w = ::write(fd, &stream[pos + off], len - off);
+            if (w > 0) off += w;
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        pos += len;
+    }
+}
+
+unsigned g_decoded = 0;
+void onChannels() { ++g_decoded; }
+void onLink(crsfLinkStatistics_t*) { ++g_decoded; }
+void onGps(crsf_sensor_gps_t*) { ++g_decoded; }
+
+void report(const char* mode, unsigned frames, size_t bytes, const SerialPort& port, double sec)
+{
+    const uint64_t calls = port.readCalls();
+    const uint64_t waits = port.waitCalls();
+    printf("mode=%s frames=%u bytes=%zu read_syscalls=%llu syscalls_per_frame=%.2f wait_syscalls=%llu "
+           "total_per_frame=%.2f seconds=%.3f\n",
+           mode, frames, bytes, (unsigned long long)calls, frames ? double(calls) / frames : 0.0,
+           (unsigned long long)waits, frames ? double(calls + waits) / frames : 0.0, sec);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned frames = 5000;
+    bool fast = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--fast") == 0) fast = true;
+        else frames = static_cast<unsigned>(strtoul(argv[i], nullptr, 10));
+    }
+
+    const std::vector<uint8_t> stream = bench::mixedStream(frames);
+    // Обработчики есть у каналов, статистики связи и GPS — это 6 кадров из каждых 8
+    unsigned decodable = 0;
+    for (unsigned i = 0; i < frames; ++i)
+        if (i % 8 != 5 && i % 8 != 7) ++decodable;
+
+    using Clock = std::chrono::steady_clock;
+
+    // --- bytewise: прежний цикл handleSerialIn ---
+    {
+        int master;
+        std::string slavePath;
+        if (!pty_open(master, slavePath)) { fprintf(stderr, "pty недоступен\n"); return 1; }
+        SerialPort port(slavePath, CRSF_BAUDRATE);
+        port.setProfile(SerialPort::Profile::BoundedBlocking, 100000);
+        if (!port.open()) { fprintf(stderr, "не удалось открыть %s\n", slavePath.c_str()); return 1; }
+
+        auto t0 = Clock::now();
+        std::thread writer(writeStream, master, std::cref(stream), fast);
+        size_t got = 0;
+        volatile uint32_t lastReceive = 0;
+        while (got < stream.size()) {
+            for (int i = 0; i < 32; ++i) {
+                uint8_t b;
+                if (port.readByte(b) <= 0) break;
+                lastReceive = rpi_millis();
+                ++got;
+            }
+        }
+        (void)lastReceive;
+        writer.join();
+        double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+        report("bytewise", frames, got, port, sec);
+        port.close();
+        ::close(master);
+    }
+
+    // --- batched: CrsfSerial::loop() с readv в кольцевой буфер ---
+    {
+        int master;
+        std::string slavePath;
+        if (!pty_open(master, slavePath)) { fprintf(stderr, "pty недоступен\n"); return 1; }
+        SerialPort port(slavePath, CRSF_BAUDRATE);
+        port.setProfile(SerialPort::Profile::BoundedBlocking, 100000);
+        if (!port.open()) { fprintf(stderr, "не удалось открыть %s\n", slavePath.c_str()); return 1; }
+
+        static CrsfSerial crsf(port, CRSF_BAUDRATE);
+        crsf.onPacketChannels = &onChannels;
+        crsf.onPacketLinkStatistics = &onLink;
+        crsf.onPacketGps = &onGps;
+
+        auto t0 = Clock::now();
+        std::thread writer(writeStream, master, std::cref(stream), fast);
+        while (g_decoded < decodable &&
+               Clock::now() - t0 < std::chrono::seconds(60)) {
+            crsf.loop();
+        }
+        writer.join();
+        double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+        report("batched", frames, stream.size(), port, sec);
+        if (g_decoded != decodable)
+            fprintf(stderr, "внимание: разобрано %u из %u кадров\n", g_decoded, decodable);
+        port.close();
+        ::close(master);
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+// Разделяемая память (libs/CrsfShm.h) против HTTP JSON для процесса на той же машине.
+// Сервер — этот процесс (CrsfShmServer и веб-сервер телеметрии на порту 18083), клиент — дочерний после fork().
+//
+// Метрики:
+//   read   — ns_per_read: CrsfShmClient::telemetry() против GET /api/telemetry (keep-alive) с разбором
+//            каналов и положения из JSON обратно в числа
+//   wait   — сервер публикует снимок раз в 1 мс, клиент спит в waitTelemetry(): задержка от публикации
+//            до пробуждения клиента (p50/p99), пропущенные снимки
+//   setpoints — клиент пишет уставки раз в 1 мс, сервер ждёт ящик и забирает их pollSetpoints():
+//            задержка от записи до применения (в crsf_io_rpi вместо ожидания — тик отправки);
+//            coalesced — записи, перекрытые следующей до того, как сервер их забрал
+//
+// Использование:
+//   ./bench/shm_bench [снимков=2000]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "libs/CrsfShm.h"
+#include "libs/SerialPort.h"
+#include "libs/crsf/CrsfSerial.h"
+#include "telemetry_server.h"
+
+namespace {
+
+const char* SHM_NAME = "/crsf_shm_bench";
+const int HTTP_PORT = 18083;
+const unsigned SEQ_SLOTS = 1024;
+
+// Управление фазами и метки времени уставок — анонимная разделяемая память между родителем и потомком
+struct Control {
+    std::atomic<int> httpReady;
+    std::atomic<int> waitReady;
+    std::atomic<int> publishDone;
+    std::atomic<int> setpointsDone;
+    std::atomic<uint64_t> postNs[SEQ_SLOTS];
+};
+
+uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+void sleepUntil(uint64_t ns)
+{
+    timespec ts{ time_t(ns / 1000000000ull), long(ns % 1000000000ull) };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+}
+
+void waitFlag(const std::atomic<int>& flag)
+{
+    while (!flag.load(std::memory_order_acquire))
+        usleep(1000);
+}
+
+uint32_t percentile(std::vector<uint32_t>& v, unsigned pct)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, v.size() * pct / 100)];
+}
+
+int connectTo(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Тело ответа по Content-Length; пусто — ошибка
+bool httpGet(int fd, const char* req, std::string& buf, std::string_view& body)
+{
+    if (send(fd, req, strlen(req), MSG_NOSIGNAL) <= 0) return false;
+    buf.clear();
+    char tmp[4096];
+    for (;;) {
+        const size_t headEnd = buf.find("\r\n\r\n");
+        if (headEnd != std::string::npos) {
+            const size_t cl = buf.find("Content-Length: ");
+            if (cl == std::string::npos || cl > headEnd) return false;
+            const size_t len = strtoul(buf.c_str() + cl + 16, nullptr, 10);
+            if (buf.size() >= headEnd + 4 + len) {
+                body = std::string_view(buf).substr(headEnd + 4, len);
+                return true;
+            }
+        }
+        const ssize_t r = recv(fd, tmp, sizeof(tmp), 0);
+        if (r <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(r));
+    }
+}
+
+// То, что делает клиент HTTP: числа обратно из JSON (каналы и положение)
+bool parseTelemetry(std::string_view json, int* channels, double* attitude)
+{
+    const size_t ch = json.find("\"channels\":[");
+    const size_t att = json.find("\"attitude\":{");
+    if (ch == std::string_view::npos || att == std::string_view::npos) return false;
+    const char* p = json.data() + ch + 12;
+    for (int i = 0; i < 16; ++i) {
+        char* end;
+        channels[i] = static_cast<int>(strtol(p, &end, 10));
+        p = end + 1;
+    }
+    static const char* keys[3] = { "\"roll\":", "\"pitch\":", "\"yaw\":" };
+    for (int i = 0; i < 3; ++i) {
+        const size_t k = json.find(keys[i], att);
+        if (k == std::string_view::npos) return false;
+        attitude[i] = strtod(json.data() + k + strlen(keys[i]), nullptr);
+    }
+    return true;
+}
+
+int runClient(Control* ctl, unsigned samples)
+{
+    CrsfShmClient client;
+    if (!client.open(SHM_NAME)) {
+        fprintf(stderr, "клиент: сегмент %s не открылся\n", SHM_NAME);
+        return 1;
+    }
+
+    // read: разделяемая память
+    const unsigned reads = 1000000;
+    int64_t sink = 0;
+    uint64_t t0 = nowNs();
+    for (unsigned i = 0; i < reads; ++i) {
+        const CrsfShmTelemetry t = client.telemetry();
+        sink += t.channels[i & 15] + static_cast<int64_t>(t.roll);
+    }
+    const uint64_t shmNs = (nowNs() - t0) / reads;
+
+    // read: HTTP JSON с разбором
+    waitFlag(ctl->httpReady);
+    const int fd = connectTo(HTTP_PORT);
+    std::string buf;
+    std::string_view body;
+    int channels[16];
+    double attitude[3];
+    const unsigned httpReads = 2000;
+    unsigned httpErrors = 0;
+    t0 = nowNs();
+    for (unsigned i = 0; i < httpReads; ++i) {
+        if (fd < 0 || !httpGet(fd, "GET /api/telemetry HTTP/1.1\r\nHost: localhost\r\n\r\n", buf, body) ||
+            !parseTelemetry(body, channels, attitude))
+            ++httpErrors;
+        sink += channels[i & 15];
+    }
+    const uint64_t httpNs = (nowNs() - t0) / httpReads;
+    if (fd >= 0) close(fd);
+    printf("mode=read transport=shm ns_per_read=%llu\n", (unsigned long long)shmNs);
+    printf("mode=read transport=http_json ns_per_read=%llu errors=%u\n", (unsigned long long)httpNs, httpErrors);
+
+    // wait: пробуждение по каждому снимку
+    std::vector<uint32_t> wakeUs;
+    uint32_t version = client.telemetryVersion();
+    uint32_t firstVersion = version;
+    ctl->waitReady.store(1, std::memory_order_release);
+    while (!ctl->publishDone.load(std::memory_order_acquire) || client.telemetryVersion() != version) {
+        if (!client.waitTelemetry(version, 100)) continue;
+        const uint64_t woke = nowNs();
+        const CrsfShmTelemetry t = client.telemetry();
+        version = client.telemetryVersion();
+        wakeUs.push_back(static_cast<uint32_t>((woke - t.publishNs) / 1000));
+    }
+    const unsigned published = version - firstVersion;
+    printf("mode=wait published=%u woken=%zu missed=%u p50_us=%u p99_us=%u\n", published, wakeUs.size(),
+           published - static_cast<unsigned>(wakeUs.size()), percentile(wakeUs, 50), percentile(wakeUs, 99));
+
+    // setpoints: раз в 1 мс все 16 каналов
+    int values[16];
+    uint64_t next = nowNs();
+    for (unsigned i = 0; i < samples; ++i) {
+        for (int ch = 0; ch < 16; ++ch) values[ch] = 1000 + static_cast<int>((i + ch) % 1001);
+        next += 1000000;
+        sleepUntil(next);
+        // Метка до записи: seq следующей уставки известен заранее (нумерация клиента подряд)
+        ctl->postNs[(i + 1) % SEQ_SLOTS].store(nowNs(), std::memory_order_relaxed);
+        if (!client.setChannels(0xFFFF, values)) {
+            fprintf(stderr, "клиент: ящик уставок занят\n");
+            return 1;
+        }
+    }
+    ctl->setpointsDone.store(1, std::memory_order_release);
+    return sink == 42 ? 2 : 0;
+}
+
+struct Applied {
+    CrsfSerial* crsf;
+};
+
+void applySetpoints(uint16_t mask, const int* values, void* p)
+{
+    CrsfSerial* crsf = static_cast<Applied*>(p)->crsf;
+    for (unsigned ch = 1; ch <= 16; ++ch)
+        if (mask & (1u << (ch - 1))) crsf->setChannel(ch, values[ch - 1]);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned samples = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2000;
+
+    CrsfShmServer server;
+    if (!server.create(SHM_NAME)) {
+        fprintf(stderr, "не удалось создать %s\n", SHM_NAME);
+        return 1;
+    }
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    CrsfShmTelemetry t{};
+    crsfShmFill(t, crsf.telemetry(), crsf.channelsFrame());
+    server.publish(t);
+
+    void* mem = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return 1;
+    Control* ctl = new (mem) Control();
+
+    fflush(stdout);
+    const pid_t child = fork();
+    if (child == 0) {
+        const int rc = runClient(ctl, samples);
+        fflush(stdout);
+        _exit(rc);
+    }
+
+    // Потоки веб-сервера — только у родителя, после fork()
+    startTelemetryServer(&crsf, HTTP_PORT);
+    ctl->httpReady.store(1, std::memory_order_release);
+
+    waitFlag(ctl->waitReady);
+    uint64_t next = nowNs();
+    for (unsigned i = 0; i < samples; ++i) {
+        next += 1000000;
+        sleepUntil(next);
+        crsfShmFill(t, crsf.telemetry(), crsf.channelsFrame());
+        t.channels[0] = 1000 + static_cast<int>(i % 1001);
+        server.publish(t);
+    }
+    ctl->publishDone.store(1, std::memory_order_release);
+
+    // Сторона crsf_io_rpi: ждём ящик, забираем уставки, «отправляем кадр»
+    std::vector<uint32_t> applyUs;
+    Applied applied{ &crsf };
+    uint32_t frame = 0;
+    uint32_t version = server.layout()->setpoints.version();
+    while (!ctl->setpointsDone.load(std::memory_order_acquire) || server.layout()->setpoints.version() != version) {
+        if (!server.layout()->setpoints.waitChange(version, 100)) continue;
+        version = server.layout()->setpoints.version();
+        if (!server.pollSetpoints(&applySetpoints, &applied)) continue;
+        const uint64_t now = nowNs();
+        server.channelsSent(++frame);
+        const uint32_t seq = server.layout()->appliedSeq.load(std::memory_order_acquire);
+        applyUs.push_back(static_cast<uint32_t>((now - ctl->postNs[seq % SEQ_SLOTS].load(std::memory_order_relaxed)) / 1000));
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    // Две записи до пробуждения сервера — в ящике только последняя (coalesced), так и задумано
+    printf("mode=setpoints posted=%u applied=%zu coalesced=%zu p50_us=%u p99_us=%u last_ch1=%d\n", samples,
+           applyUs.size(), samples - applyUs.size(), percentile(applyUs, 50), percentile(applyUs, 99), crsf.getChannel(1));
+    stopTelemetryServer();
+    setTelemetrySource(nullptr);
+    server.destroy();
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Снимок телеметрии между потоками: Seqlock<CrsfTelemetry> против копии под std::mutex.
+// Писатель публикует снимки так часто, как может (как CrsfSerial на каждую пачку байт),
+// читатели непрерывно копируют снимок (как веб-сервер и будущие потоки записи).
+//
+// Метрики на режим:
+//   write_p99_ns / write_max_ns — время одной публикации у писателя (поток приёма CRSF)
+//   reads_per_s                 — копий снимка у всех читателей вместе
+//   retries_per_read            — повторов seqlock из-за совпадения с записью
+//   torn                        — копий, где поля из разных записей (должно быть 0)
+//
+// Режим wait: писатель публикует раз в 1 мс, читатель спит в Seqlock::waitChange() (как потоковые
+// клиенты веб-сервера) и просыпается только на новые снимки:
+//   wakeups / missed    — пробуждений и пропущенных снимков (читатель не успел)
+//   wake_p50_us / wake_p99_us — от публикации до копии снимка у читателя
+//
+// Использование:
+//   ./bench/snapshot_bench [читателей=2] [мс=1000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "libs/Seqlock.h"
+#include "libs/crsf/CrsfSerial.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Все поля снимка из записи k равны k: по любому расхождению видно порванную копию
+void fill(CrsfTelemetry& t, uint32_t k)
+{
+    t.lastReceive = k;
+    for (int& ch : t.channels)
+        ch = static_cast<int>(k);
+    t.gps.latitude = static_cast<int32_t>(k);
+    t.batteryVoltage = k;
+    t.attitudeYaw = k;
+    t.rxStats.frames = k;
+}
+
+bool coherent(const CrsfTelemetry& t)
+{
+    const uint32_t k = t.lastReceive;
+    for (int ch : t.channels)
+        if (ch != static_cast<int>(k)) return false;
+    return t.gps.latitude == static_cast<int32_t>(k) && t.batteryVoltage == k &&
+           t.attitudeYaw == k && t.rxStats.frames == k;
+}
+
+struct Result {
+    std::vector<uint32_t> writeNs;
+    uint64_t reads = 0;
+    uint64_t retries = 0;
+    uint64_t torn = 0;
+};
+
+// Store — Seqlock<CrsfTelemetry> или MutexStore с тем же write()/read()
+template <typename Store>
+Result run(unsigned readers, unsigned ms)
+{
+    Store store;
+    Result res;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0}, retries{0}, torn{0};
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i) {
+        threads.emplace_back([&]() {
+            uint64_t n = 0, bad = 0;
+            uint32_t retry = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const CrsfTelemetry t = store.read(&retry);
+                if (!coherent(t)) ++bad;
+                ++n;
+            }
+            reads += n;
+            retries += retry;
+            torn += bad;
+        });
+    }
+
+    CrsfTelemetry t{};
+    const auto end = Clock::now() + std::chrono::milliseconds(ms);
+    for (uint32_t k = 1; Clock::now() < end; ++k) {
+        fill(t, k);
+        const auto w0 = Clock::now();
+        store.write(t);
+        res.writeNs.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - w0).count()));
+    }
+    stop = true;
+    for (auto& th : threads)
+        th.join();
+    res.reads = reads;
+    res.retries = retries;
+    res.torn = torn;
+    return res;
+}
+
+class MutexStore
+{
+public:
+    void write(const CrsfTelemetry& t)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _value = t;
+    }
+    CrsfTelemetry read(uint32_t*) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _value;
+    }
+
+private:
+    mutable std::mutex _mutex;
+    CrsfTelemetry _value{};
+};
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+void runWait(unsigned ms)
+{
+    Seqlock<CrsfTelemetry> store;
+    std::atomic<bool> stop{false};
+    std::vector<double> wakeUs;
+    uint64_t wakeups = 0, empty = 0;
+    std::thread reader([&]() {
+        uint32_t version = store.version();
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!store.waitChange(version, 100)) {
+                ++empty;
+                continue;
+            }
+            const CrsfTelemetry t = store.read();
+            const uint64_t now = nowNs();
+            version = store.version();
+            ++wakeups;
+            wakeUs.push_back((now - t.rxStats.bytes) / 1000.0);
+        }
+    });
+
+    CrsfTelemetry t{};
+    unsigned writes = 0;
+    const auto end = Clock::now() + std::chrono::milliseconds(ms);
+    while (Clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        t.rxStats.bytes = nowNs();
+        store.write(t);
+        ++writes;
+    }
+    stop = true;
+    store.write(t);
+    reader.join();
+
+    std::sort(wakeUs.begin(), wakeUs.end());
+    const size_t n = wakeUs.size();
+    printf("mode=wait writes=%u wakeups=%llu missed=%llu empty_wakeups=%llu wake_p50_us=%.1f wake_p99_us=%.1f\n",
+           writes, (unsigned long long)wakeups, (unsigned long long)(writes > wakeups ? writes - wakeups : 0),
+           (unsigned long long)empty, n ? wakeUs[n / 2] : 0.0, n ? wakeUs[n * 99 / 100] : 0.0);
+}
+
+void report(const char* mode, unsigned readers, unsigned ms, Result& r)
+{
+    std::sort(r.writeNs.begin(), r.writeNs.end());
+    const size_t n = r.writeNs.size();
+    printf("mode=%s readers=%u writes_per_s=%.0f write_p50_ns=%u write_p99_ns=%u write_max_ns=%u "
+           "reads_per_s=%.0f retries_per_read=%.4f torn=%llu\n",
+           mode, readers, n * 1000.0 / ms, r.writeNs[n / 2], r.writeNs[n * 99 / 100], r.writeNs[n - 1],
+           r.reads * 1000.0 / ms, r.reads ? double(r.retries) / r.reads : 0.0, (unsigned long long)r.torn);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const unsigned readers = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : 2;
+    const unsigned ms = (argc > 2) ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : 1000;
+
+    Result seq = run<Seqlock<CrsfTelemetry>>(readers, ms);
+    report("seqlock", readers, ms, seq);
+    Result mtx = run<MutexStore>(readers, ms);
+    report("mutex", readers, ms, mtx);
+    runWait(ms);
+    return seq.torn ? 2 : 0;
+}
@@ -0,0 +1,228 @@
+// Приём уставок по UDP (libs/UdpSetpoints) в цикле событий, как в main.cpp: сокет и тик отправки 10 мс
+// в одном EventLoop, принятые значения пишутся прямо в каналы CrsfSerial, тик вызывает packetChannelsSend().
+//
+// Отправители — отдельные потоки, каждый со своего сокета (свой источник) с частотой rate_hz.
+// Кроме обычных пакетов каждый шлёт повторы, переставленные, просроченные и неверные — счётчики
+// источника обязаны совпасть с числом посланных пакетов каждого вида.
+//
+// Метрики:
+//   ingest_p50_us / ingest_p99_us — от sendto() до записи значений в каналы
+//   uart_avg_us / uart_max_us     — от приёма до отправки кадра каналов (счётчики UdpSetpoints)
+//   cpu_ns_per_packet             — процессорное время потока цикла на датаграмму
+//
+// Использование:
+//   ./bench/udp_setpoints_bench [источников=3] [rate_hz=250] [секунд=2]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "libs/EventLoop.h"
+#include "libs/SerialPort.h"
+#include "libs/UdpSetpoints.h"
+#include "libs/crsf/CrsfSerial.h"
+
+namespace {
+
+const uint16_t PORT = 19001;
+const int MAX_SOURCES = UdpSetpoints::MAX_SOURCES;
+const unsigned SEQ_SLOTS = 1024;
+
+uint64_t threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+// Время sendto() по (источник, seq): канал 16 несёт номер источника, канал 15 — seq % SEQ_SLOTS
+std::atomic<uint64_t> g_sentNs[MAX_SOURCES][SEQ_SLOTS];
+
+struct Expected {
+    unsigned sent = 0;
+    unsigned valid = 0;
+    unsigned dropped = 0;
+    unsigned late = 0;
+};
+
+struct Loop {
+    CrsfSerial* crsf;
+    UdpSetpoints* udp;
+    std::vector<uint32_t> ingestUs;
+    uint64_t packets = 0;
+};
+
+void putU16(uint8_t* p, uint16_t v) { p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+void putU32(uint8_t* p, uint32_t v) { putU16(p, uint16_t(v)); putU16(p + 2, uint16_t(v >> 16)); }
+void putU64(uint8_t* p, uint64_t v) { putU32(p, uint32_t(v)); putU32(p + 4, uint32_t(v >> 32)); }
+
+void buildDatagram(uint8_t* d, uint32_t seq, uint64_t timestampUs, int source)
+{
+    putU32(d, UDP_SETPOINT_MAGIC);
+    putU32(d + 4, seq);
+    putU64(d + 8, timestampUs);
+    putU16(d + 16, 0xFFFF);
+    for (int ch = 0; ch < 14; ++ch)
+        putU16(d + 18 + 2 * ch, uint16_t(1000 + (seq + ch) % 1001));
+    putU16(d + 18 + 2 * 14, uint16_t(1000 + seq % SEQ_SLOTS));
+    putU16(d + 18 + 2 * 15, uint16_t(1000 + source));
+}
+
+void sender(int source, unsigned rateHz, unsigned seconds, Expected* expected)
+{
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(PORT);
+    auto send = [&](const uint8_t* d, size_t len) {
+        sendto(fd, d, len, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+        ++expected->sent;
+    };
+
+    const uint64_t periodNs = 1000000000ull / rateHz;
+    uint64_t next = UdpSetpoints::monotonicNs();
+    uint8_t d[UDP_SETPOINT_SIZE], prev[UDP_SETPOINT_SIZE];
+    const unsigned total = rateHz * seconds;
+    for (uint32_t seq = 1; seq <= total; ++seq) {
+        next += periodNs;
+        timespec ts{ time_t(next / 1000000000ull), long(next % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+
+        const uint64_t now = UdpSetpoints::monotonicNs();
+        if (seq % 50 == 0) {
+            // Просроченный: метка на 200 мс в прошлом
+            buildDatagram(d, seq, now / 1000 - 200000, source);
+            send(d, sizeof(d));
+            ++expected->late;
+            continue;
+        }
+        buildDatagram(d, seq, now / 1000, source);
+        g_sentNs[source][seq % SEQ_SLOTS].store(now, std::memory_order_relaxed);
+        send(d, sizeof(d));
+        ++expected->valid;
+        if (seq % 25 == 0) {
+            // Повтор и запоздавший предыдущий: оба отбрасываются по seq
+            send(d, sizeof(d));
+            send(prev, sizeof(prev));
+            expected->dropped += 2;
+        }
+        if (seq % 40 == 0) {
+            // Неверный: короткая датаграмма
+            send(d, 20);
+            ++expected->dropped;
+        }
+        memcpy(prev, d, sizeof(d));
+    }
+    close(fd);
+}
+
+void applySetpoints(uint16_t mask, const int* values, void* p)
+{
+    Loop* loop = static_cast<Loop*>(p);
+    for (unsigned ch = 1; ch <= 16; ++ch)
+        if (mask & (1u << (ch - 1))) loop->crsf->setChannel(ch, values[ch - 1]);
+    const int source = values[15] - 1000;
+    const unsigned slot = unsigned(values[14] - 1000);
+    if (source >= 0 && source < MAX_SOURCES && slot < SEQ_SLOTS) {
+        const uint64_t sent = g_sentNs[source][slot].load(std::memory_order_relaxed);
+        loop->ingestUs.push_back(uint32_t((UdpSetpoints::monotonicNs() - sent) / 1000));
+    }
+}
+
+void onUdpReadable(void* p)
+{
+    Loop* loop = static_cast<Loop*>(p);
+    loop->udp->poll(&applySetpoints, loop);
+}
+
+void onSendTick(void* p)
+{
+    Loop* loop = static_cast<Loop*>(p);
+    loop->crsf->packetChannelsSend();
+    loop->udp->channelsSent(UdpSetpoints::monotonicNs());
+}
+
+uint32_t percentile(std::vector<uint32_t>& v, unsigned pct)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, v.size() * pct / 100)];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int sources = std::min(MAX_SOURCES, (argc > 1) ? atoi(argv[1]) : 3);
+    const unsigned rateHz = (argc > 2) ? unsigned(atoi(argv[2])) : 250;
+    const unsigned seconds = (argc > 3) ? unsigned(atoi(argv[3])) : 2;
+
+    SerialPort port("", CRSF_BAUDRATE);
+    CrsfSerial crsf(port, CRSF_BAUDRATE);
+    UdpSetpoints udp(50);
+    if (!udp.open(PORT, "127.0.0.1")) {
+        fprintf(stderr, "UDP порт %u недоступен\n", PORT);
+        return 1;
+    }
+    EventLoop loop(EventLoop::Mode::Blocking);
+    Loop ctx{ &crsf, &udp, {}, 0 };
+    if (!loop.open() || !loop.add(udp.fd(), &onUdpReadable, &ctx) || !loop.addTimer(10000, &onSendTick, &ctx)) {
+        fprintf(stderr, "не удалось создать цикл событий\n");
+        return 1;
+    }
+
+    std::vector<Expected> expected(sources);
+    std::vector<std::thread> senders;
+    std::atomic<int> running{sources};
+    for (int s = 0; s < sources; ++s)
+        senders.emplace_back([&, s]() {
+            sender(s, rateHz, seconds, &expected[s]);
+            running.fetch_sub(1);
+        });
+
+    const uint64_t cpu0 = threadCpuNs();
+    while (running.load() > 0)
+        loop.runOnce();
+    // Хвост: датаграммы в сокете и последний кадр
+    const uint64_t tail = UdpSetpoints::monotonicNs() + 30000000ull;
+    while (UdpSetpoints::monotonicNs() < tail)
+        loop.runOnce();
+    const uint64_t cpuNs = threadCpuNs() - cpu0;
+    for (std::thread& t : senders) t.join();
+
+    uint64_t packets = 0;
+    bool ok = udp.sourceCount() == sources;
+    uint64_t framesTotal = 0, latencySum = 0;
+    uint32_t latencyMax = 0;
+    UdpSetpointStats st;
+    for (int i = 0; udp.stats(i, st); ++i) {
+        // Источник по номеру в канале 16 неизвестен заранее: сверяем по числу посланных
+        const Expected* e = nullptr;
+        for (const Expected& x : expected)
+            if (x.sent == st.received) e = &x;
+        const bool match = e && st.accepted == e->valid && st.dropped == e->dropped && st.late == e->late;
+        ok = ok && match;
+        packets += st.received;
+        framesTotal += st.frames;
+        latencySum += st.latencySumUs;
+        latencyMax = std::max(latencyMax, st.latencyMaxUs);
+        printf("source=%d received=%llu accepted=%llu dropped=%llu late=%llu frames=%llu counters=%s\n", i,
+               (unsigned long long)st.received, (unsigned long long)st.accepted, (unsigned long long)st.dropped,
+               (unsigned long long)st.late, (unsigned long long)st.frames, match ? "ok" : "MISMATCH");
+    }
+    printf("sources=%d rate_hz=%u packets=%llu applied=%zu ingest_p50_us=%u ingest_p99_us=%u uart_avg_us=%llu "
+           "uart_max_us=%u cpu_ns_per_packet=%llu\n",
+           sources, rateHz, (unsigned long long)packets, ctx.ingestUs.size(), percentile(ctx.ingestUs, 50),
+           percentile(ctx.ingestUs, 99), (unsigned long long)(framesTotal ? latencySum / framesTotal : 0), latencyMax,
+           (unsigned long long)(packets ? cpuNs / packets : 0));
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,12 @@
 #define USE_CRSF_SEND true   // включить отправку телеметрии CRSF
 #define USE_LOG false    // включить журналы для отладки yaw
 
+// Главный цикл на epoll: false — блокировка до следующего события (минимальная загрузка CPU),
+// true — гибрид (опрос MAIN_LOOP_SPIN_US мкс после события, затем сон). Гибрид по замерам не быстрее
+// блокировки по p99 пробуждения и тратит ~13% CPU — включать только после замера на целевой плате
+#define MAIN_LOOP_HYBRID false
+#define MAIN_LOOP_SPIN_US 200
+
 #define DEVICE_1 false  // режим: 1 — Н-мост с ШИМ и направлением; 2 — сервоприводы 50 Гц
 #define DEVICE_2 false
 #define PIN_INIT false  // инициализация доп. пинов (реле/камера)
@@ -28,6 +34,54 @@
 
 #define SERIAL_BAUD 115200   // обычная отладочная скорость, если нужна
 #define CRSF_BAUD 420000     // скорость CRSF
+// Профиль UART: false — NonBlocking, true — LowLatency (NonBlocking + ASYNC_LOW_LATENCY драйвера, если поддерживается)
+#define CRSF_SERIAL_LOW_LATENCY false
+// Захват сырого потока UART (пачки байт с метками времени) для воспроизведения в bench/crsf_replay
+#define CRSF_CAPTURE false
+#define CRSF_CAPTURE_PATH "/tmp/crsf_capture.bin"
+// Бортовой журнал разобранных кадров (тип, метка приёма, нагрузка) в сегментах по CRSF_FRAME_LOG_SEGMENT_MB
+// в каталоге CRSF_FRAME_LOG_DIR; разбор после полёта — утилита crsf_flog. Формат — libs/crsf/CrsfFrameLog.h.
+// Точка индекса по времени — не чаще раза в CRSF_FRAME_LOG_INDEX_MS; хранятся последние
+// CRSF_FRAME_LOG_MAX_SEGMENTS сегментов (0 — все). Поток приёма только кладёт кадр в очередь
+// на CRSF_FRAME_LOG_QUEUE кадров, в файл пишет отдельный поток
+#define CRSF_FRAME_LOG true
+#define CRSF_FRAME_LOG_DIR "/var/log/crsf_io"
+#define CRSF_FRAME_LOG_SEGMENT_MB 16
+#define CRSF_FRAME_LOG_INDEX_MS 100
+#define CRSF_FRAME_LOG_MAX_SEGMENTS 32
+#define CRSF_FRAME_LOG_QUEUE 4096
+// Гистограммы сквозных задержек (/api/latency, /metrics): от ввода уставки (джойстик, HTTP, UDP, разделяемая
+// память) до write() кадра каналов, который первым её понёс, и от чтения байт UART до конца обработки кадра.
+// Цена — два чтения CLOCK_MONOTONIC на кадр и несколько relaxed-атомиков
+#define CRSF_LATENCY_STATS true
+
+// Веб-сервер телеметрии (epoll, keep-alive): число рабочих потоков и подключений на поток.
+// Потоки создаются один раз при старте; подключения сверх пула сразу закрываются
+#define TELEMETRY_HTTP_WORKERS 2
+#define TELEMETRY_HTTP_MAX_CONNECTIONS 32
+// Поток /api/stream (Server-Sent Events): частота по умолчанию для клиента (?maxRate= меняет её)
+// и сколько событий ждёт отправки у медленного клиента, прежде чем старые начнут выбрасываться
+#define TELEMETRY_STREAM_MAX_HZ 50
+#define TELEMETRY_STREAM_QUEUE 4
+
+// Приём уставок каналов по UDP от внешних процессов (автопилот, компаньон): формат в libs/UdpSetpoints.h.
+// Пакеты старше UDP_SETPOINTS_MAX_AGE_MS (по метке отправителя) отбрасываются; счётчики — /api/udp
+#define UDP_SETPOINTS_ENABLE true
+#define UDP_SETPOINTS_BIND "127.0.0.1"
+#define UDP_SETPOINTS_PORT 9001
+#define UDP_SETPOINTS_MAX_AGE_MS 50
+
+// Разделяемая память POSIX (/dev/shm) для процессов на той же машине: снимок телеметрии и ящик уставок
+// без сериализации и системных вызовов. Раскладка и клиент — libs/CrsfShm.h
+#define CRSF_SHM_ENABLE true
+#define CRSF_SHM_NAME "/crsf_io"
+
+// История снимков телеметрии в памяти для /api/history: кольцо на TELEMETRY_HISTORY_CAPACITY отсчётов
+// (~130 байт каждый, заводится при старте), не чаще одного отсчёта в TELEMETRY_HISTORY_INTERVAL_MS.
+// 30000 отсчётов по 20 мс — последние 10 минут, ~4 МБ
+#define TELEMETRY_HISTORY_ENABLE true
+#define TELEMETRY_HISTORY_CAPACITY 30000
+#define TELEMETRY_HISTORY_INTERVAL_MS 20
 
 // Пути к последовательным портам Raspberry Pi для CRSF
 // Обычно: "/dev/ttyAMA0" (PL011) и "/dev/ttyS0" (miniUART)
@@ -11,6 +11,15 @@ static SerialPort crsfPort2(CRSF_PORT_SECONDARY, CRSF_BAUD);
 static CrsfSerial crsf_1(crsfPort1, CRSF_BAUD);
 static CrsfSerial crsf_2(crsfPort2, CRSF_BAUD);
 static CrsfSerial *crsf = &crsf_1;
+#if CRSF_CAPTURE == true
+static CrsfCaptureWriter crsfCapture;
+#endif
+#if CRSF_FRAME_LOG == true
+static CrsfFrameLog crsfFrameLog;
+#endif
+#if CRSF_LATENCY_STATS == true
+static CrsfLatencyStats crsfLatency;
+#endif
 // static uint32_t lastPortSwitchTime = 0; // Время последнего переключения порта - отключено
 
 #if PIN_INIT == true
@@ -134,9 +143,9 @@ void crsfSetChannel(unsigned int ch, int value)
   crsf->setChannel(ch, value); // Используем указатель на активный порт
 }
 
-void crsfSendChannels()
+bool crsfSendChannels()
 {
-  crsf->packetChannelsSend(); // Используем указатель на активный порт
+  return crsf->packetChannelsSend(); // Используем указатель на активный порт
 }
 
 void* crsfGetActive()
@@ -144,6 +153,44 @@ void* crsfGetActive()
   return (void*)crsf; // Возвращаем указатель на активный CRSF объект
 }
 
+int crsfGetRxFd()
+{
+  return (crsf == &crsf_1) ? crsfPort1.fd() : crsfPort2.fd();
+}
+
+void* crsfGetPort(unsigned index)
+{
+  return index == 0 ? (void*)&crsf_1 : index == 1 ? (void*)&crsf_2 : nullptr;
+}
+
+const char* crsfGetPortName(unsigned index)
+{
+  return index == 0 ? CRSF_PORT_PRIMARY : index == 1 ? CRSF_PORT_SECONDARY : nullptr;
+}
+
+const CrsfFrameLog* crsfGetFrameLog()
+{
+#if CRSF_FRAME_LOG == true
+  return crsfFrameLog.isRunning() ? &crsfFrameLog : nullptr;
+#else
+  return nullptr;
+#endif
+}
+
+CrsfLatencyStats* crsfGetLatency()
+{
+#if CRSF_LATENCY_STATS == true
+  return &crsfLatency;
+#else
+  return nullptr;
+#endif
+}
+
+void crsfMarkInput(unsigned source, uint64_t inputNs)
+{
+  crsf->markInput(source, inputNs); // Кадр понесёт активный порт
+}
+
 void loop_ch()
 {
   static uint32_t newTime;
@@ -245,6 +292,11 @@ void pinInit()
 void crsfInitRecv()
 {
   // Открываем последовательные порты для CRSF
+  // Порты неблокирующие (профиль по умолчанию): ожиданием данных занимается цикл событий в main.cpp
+#if CRSF_SERIAL_LOW_LATENCY == true
+  crsfPort1.setProfile(SerialPort::Profile::LowLatency);
+  crsfPort2.setProfile(SerialPort::Profile::LowLatency);
+#endif
   crsfPort1.open();
   crsfPort2.open();
   crsf_2.onPacketChannels = &packetChannels;
@@ -258,12 +310,44 @@ void crsfInitRecv()
   if (!crsfPort1.isOpen() && crsfPort2.isOpen()) {
     crsf = &crsf_2;
   }
+#if CRSF_LATENCY_STATS == true
+  crsf_1.setLatencyStats(&crsfLatency);
+  crsf_2.setLatencyStats(&crsfLatency);
+#endif
+#if CRSF_CAPTURE == true
+  // Читается только активный порт, поэтому в файл попадает один поток
+  if (crsfCapture.open(CRSF_CAPTURE_PATH, CRSF_BAUD)) {
+    crsf_1.setCapture(&crsfCapture);
+    crsf_2.setCapture(&crsfCapture);
+    log_info(std::string("Захват UART в ") + CRSF_CAPTURE_PATH);
+  } else {
+    log_warn(std::string("Не удалось открыть файл захвата ") + CRSF_CAPTURE_PATH);
+  }
+#endif
+#if CRSF_FRAME_LOG == true
+  CrsfFrameLog::Options flog = CrsfFrameLog::defaults();
+  flog.segmentSize = CRSF_FRAME_LOG_SEGMENT_MB * 1024ull * 1024ull;
+  flog.indexIntervalMs = CRSF_FRAME_LOG_INDEX_MS;
+  flog.maxSegments = CRSF_FRAME_LOG_MAX_SEGMENTS;
+  flog.queueFrames = CRSF_FRAME_LOG_QUEUE;
+  // Оба порта пишут из главного цикла — в журнале один поток кадров, как у захвата
+  if (crsfFrameLog.start(CRSF_FRAME_LOG_DIR, flog)) {
+    crsf_1.setFrameLog(&crsfFrameLog);
+    crsf_2.setFrameLog(&crsfFrameLog);
+    log_info(std::string("Журнал кадров в ") + CRSF_FRAME_LOG_DIR);
+  } else {
+    log_warn(std::string("Не удалось открыть журнал кадров в ") + CRSF_FRAME_LOG_DIR);
+  }
+#endif
 }
 
 void crsfInitSend()
 {
   // Для Raspberry Pi используем первичный порт
   crsfPort1.open();
+#if CRSF_LATENCY_STATS == true
+  crsf_1.setLatencyStats(&crsfLatency);
+#endif
 }
 
 struct packet_CRSF_FRAMETYPE_BATTERY_SENSOR
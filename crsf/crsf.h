@@ -10,10 +10,24 @@ void crsfInitRecv();
 void crsfInitSend();
 void loop_ch();
 void crsfSetChannel(unsigned int ch, int value);
-void crsfSendChannels();
+// Кадр каналов в активный порт; false — кадр не ушёл в UART целиком (см. CrsfSerial::packetChannelsSend)
+bool crsfSendChannels();
 void crsfTelemetrySend();
 // Получить указатель на активный CRSF объект
 void* crsfGetActive();
+// Дескриптор UART активного порта (для epoll), -1 если порт не открыт
+int crsfGetRxFd();
+// CRSF объект порта index (0 — основной, 1 — резервный) и имя его устройства; nullptr — нет такого порта
+void* crsfGetPort(unsigned index);
+const char* crsfGetPortName(unsigned index);
+class CrsfFrameLog;
+// Бортовой журнал кадров; nullptr — не ведётся (CRSF_FRAME_LOG) или не открылся
+const CrsfFrameLog* crsfGetFrameLog();
+struct CrsfLatencyStats;
+// Гистограммы сквозных задержек обоих портов; nullptr — не ведутся (CRSF_LATENCY_STATS)
+CrsfLatencyStats* crsfGetLatency();
+// Ввод уставок источника source (CrsfInputSource) в момент inputNs, CLOCK_MONOTONIC: см. CrsfSerial::markInput
+void crsfMarkInput(unsigned source, uint64_t inputNs);
 // Инициализация GPIO/PWM под Raspberry Pi
 void PWMinit();       // настройка PWM (50 Гц для сервоприводов)
 void analogInit();    // начальная инициализация ШИМ/цифровых пинов
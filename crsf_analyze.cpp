@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "libs/crsf/CrsfCaptureAnalyzer.h"
+#include "libs/crsf/crsf_protocol.h"
+
+// Разбор захвата UART (CRSF_CAPTURE в config.h, bench/crsf_replay --synth) на всех ядрах:
+// сводка по типам кадров, сериям ошибок CRC и качеству линка. Части захвата разбираются
+// параллельно тем же CrsfParser, что и при приёме (libs/crsf/CrsfCaptureAnalyzer).
+//
+// Использование:
+//   ./crsf_analyze <захват> [--jobs N]
+//   --jobs N — потоков (по умолчанию по числу ядер)
+//
+// Вывод key=value, по строке на раздел:
+//   capture    — размер, длительность, счётчики разбора (как CrsfRxStats), время стадий и МБ/с
+//   type       — по каждому встреченному типу: кадров, средняя частота; rate_min/p50/max — кадров
+//                за целую секунду (без первой и последней); gap_* — интервалы между кадрами типа,
+//                процентили — верхняя граница корзины 100 мкс; gap_max_at_s — где был самый длинный
+//   crc_bursts — серии ошибок CRC подряд по длине (1, 2, 3-4, 5-8, 9+), самая длинная и где она была
+//   link       — LINK_STATISTICS: качество линка (%) и RSSI1 (-дБм), процентили
+
+namespace {
+
+unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+
+void printType(unsigned type, const CrsfCaptureTypeStats& t)
+{
+    std::vector<uint32_t> rate;
+    const size_t first = static_cast<size_t>(t.firstUs / 1000000) + 1;
+    const size_t last = static_cast<size_t>(t.lastUs / 1000000);
+    for (size_t s = first; s < last && s < t.perSecond.size(); ++s)
+        rate.push_back(t.perSecond[s]);
+    std::sort(rate.begin(), rate.end());
+    const double span = (t.lastUs - t.firstUs) / 1e6;
+
+    printf("type=0x%02X frames=%llu rate_hz=%.1f", type, ull(t.frames), span > 0 ? (t.frames - 1) / span : 0.0);
+    if (!rate.empty())
+        printf(" rate_min=%u rate_p50=%u rate_max=%u", rate.front(), rate[rate.size() / 2], rate.back());
+    if (t.gaps) {
+        const size_t n = t.gapHist.size();
+        const uint32_t w = CrsfCaptureTypeStats::GAP_BUCKET_US;
+        printf(" gap_avg_us=%.0f gap_p50_us=%llu gap_p99_us=%llu gap_max_us=%llu gap_max_at_s=%.3f",
+               static_cast<double>(t.gapSumUs) / t.gaps,
+               ull((crsf_histogram_percentile(t.gapHist.data(), n, 50) + 1) * w),
+               ull((crsf_histogram_percentile(t.gapHist.data(), n, 99) + 1) * w), ull(t.gapMaxUs), t.gapMaxAtUs / 1e6);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = nullptr;
+    unsigned jobs = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--jobs") && i + 1 < argc) jobs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else path = nullptr, i = argc;
+    }
+    if (!path) {
+        fprintf(stderr, "Использование: crsf_analyze <захват> [--jobs N]\n");
+        return 1;
+    }
+
+    CrsfCaptureAnalyzer analyzer;
+    if (!analyzer.open(path)) {
+        fprintf(stderr, "Не удалось открыть захват %s\n", path);
+        return 1;
+    }
+    const CrsfCaptureStats st = analyzer.analyze(jobs);
+
+    const double ms = (st.indexUs + st.entryUs + st.parseUs) / 1000.0;
+    printf("capture=%s baud=%u jobs=%u file_mb=%.1f chunks=%llu duration_s=%.3f bytes=%llu frames=%llu "
+           "crc_errors=%llu resyncs=%llu dropped_bytes=%llu boundary_partial=%llu "
+           "index_ms=%.1f entry_ms=%.1f parse_ms=%.1f mb_per_s=%.0f\n",
+           path, analyzer.reader().baud(), st.jobs, st.fileBytes / 1048576.0, ull(st.chunks), st.durationUs / 1e6,
+           ull(st.bytes), ull(st.frames), ull(st.crcErrors), ull(st.resyncs), ull(st.droppedBytes),
+           ull(st.boundaryPartial), st.indexUs / 1000.0, st.entryUs / 1000.0, st.parseUs / 1000.0,
+           ms > 0 ? st.fileBytes / 1048576.0 / (ms / 1000.0) : 0.0);
+
+    for (unsigned t = 0; t < 256; ++t)
+        if (st.types[t].frames) printType(t, st.types[t]);
+
+    printf("crc_bursts=%llu len_1=%llu len_2=%llu len_3_4=%llu len_5_8=%llu len_9_plus=%llu max=%llu max_at_s=%.3f\n",
+           ull(st.crcBursts), ull(st.crcBurstHist[0]), ull(st.crcBurstHist[1]), ull(st.crcBurstHist[2]),
+           ull(st.crcBurstHist[3]), ull(st.crcBurstHist[4]), ull(st.crcBurstMax), st.crcBurstMaxAtUs / 1e6);
+
+    if (st.linkStats) {
+        // Хуже качество — меньше LQ и больше RSSI (-дБм): нижние процентили LQ и верхние RSSI
+        printf("link frames=%llu lq_p1=%zu lq_p5=%zu lq_p50=%zu rssi_p50=%zu rssi_p95=%zu rssi_p99=%zu\n",
+               ull(st.linkStats), crsf_histogram_percentile(st.lqHist, 101, 1),
+               crsf_histogram_percentile(st.lqHist, 101, 5), crsf_histogram_percentile(st.lqHist, 101, 50),
+               crsf_histogram_percentile(st.rssiHist, 256, 50), crsf_histogram_percentile(st.rssiHist, 256, 95),
+               crsf_histogram_percentile(st.rssiHist, 256, 99));
+    }
+    return 0;
+}
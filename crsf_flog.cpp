@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include "config.h"
+#include "libs/crsf/CrsfFrameLog.h"
+
+// Разбор бортового журнала кадров (CRSF_FRAME_LOG в config.h): выборка окна времени в CSV.
+// Начало окна ищется по разреженному индексу сегмента, поэтому время выборки зависит от длины окна,
+// а не от размера журнала; сегменты вне окна не открываются.
+//
+// Использование:
+//   ./crsf_flog [--dir каталог] [--from время] [--to время] [--type T[,T...]] [--stats]
+//   ./crsf_flog [--dir каталог] --info
+//   --dir   — каталог журнала (по умолчанию CRSF_FRAME_LOG_DIR)
+//   --from, --to — границы окна [from, to): секунды UTC (1760700000.25), +секунды от начала журнала
+//            или -секунды до его конца; по умолчанию весь журнал
+//   --type  — только кадры этих типов (0x16, 30, ...)
+//   --stats — в stderr: сегментов открыто, записей просмотрено и выбрано, время выборки
+//   --info  — список сегментов вместо выборки
+//
+// CSV в stdout: time (секунды UTC, мкс), type, addr, len, payload (hex)
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+            "Использование: crsf_flog [--dir каталог] [--from время] [--to время] [--type T[,T...]] [--stats]\n"
+            "               crsf_flog [--dir каталог] --info\n"
+            "время: секунды UTC, +секунды от начала журнала, -секунды до конца\n");
+}
+
+// Время окна в нс UTC; false — не число
+bool parseTime(const char* s, int64_t first, int64_t last, int64_t& out)
+{
+    char* end;
+    const double v = strtod(s, &end);
+    if (end == s || *end) return false;
+    const int64_t ns = static_cast<int64_t>(v * 1e9);
+    if (s[0] == '+') out = first + ns;
+    else if (s[0] == '-') out = last + ns;
+    else out = ns;
+    return true;
+}
+
+bool parseTypes(const char* s, std::bitset<256>& types)
+{
+    while (*s) {
+        char* end;
+        const unsigned long t = strtoul(s, &end, 0);
+        if (end == s || t > 255) return false;
+        types.set(t);
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return true;
+}
+
+void printTime(FILE* f, int64_t ns)
+{
+    const int64_t us = ns / 1000;
+    fprintf(f, "%lld.%06lld", static_cast<long long>(us / 1000000), static_cast<long long>(us % 1000000));
+}
+
+bool writeRow(const CrsfFrameLogReader::Record& r, void* ctx)
+{
+    FILE* out = static_cast<FILE*>(ctx);
+    static const char hex[] = "0123456789abcdef";
+    char payload[CRSF_MAX_PAYLOAD_LEN * 2 + 1];
+    for (unsigned i = 0; i < r.len && i < CRSF_MAX_PAYLOAD_LEN; ++i) {
+        payload[i * 2] = hex[r.payload[i] >> 4];
+        payload[i * 2 + 1] = hex[r.payload[i] & 15];
+    }
+    payload[(r.len < CRSF_MAX_PAYLOAD_LEN ? r.len : CRSF_MAX_PAYLOAD_LEN) * 2] = '\0';
+    printTime(out, r.timeNs);
+    fprintf(out, ",0x%02X,0x%02X,%u,%s\n", r.type, r.addr, r.len, payload);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* dir = CRSF_FRAME_LOG_DIR;
+    const char* from = nullptr;
+    const char* to = nullptr;
+    std::bitset<256> types;
+    bool filter = false;
+    bool info = false;
+    bool stats = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--dir") && hasValue) dir = argv[++i];
+        else if (!strcmp(argv[i], "--from") && hasValue) from = argv[++i];
+        else if (!strcmp(argv[i], "--to") && hasValue) to = argv[++i];
+        else if (!strcmp(argv[i], "--type") && hasValue) {
+            if (!parseTypes(argv[++i], types)) {
+                fprintf(stderr, "Неверный список типов: %s\n", argv[i]);
+                return 1;
+            }
+            filter = true;
+        } else if (!strcmp(argv[i], "--info")) info = true;
+        else if (!strcmp(argv[i], "--stats")) stats = true;
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    CrsfFrameLogReader reader;
+    if (!reader.open(dir)) {
+        fprintf(stderr, "Не удалось открыть каталог журнала %s\n", dir);
+        return 1;
+    }
+
+    if (info) {
+        printf("sequence,records,first,last,closed,path\n");
+        for (const CrsfFrameLogReader::Segment& s : reader.segments()) {
+            printf("%llu,%llu,", static_cast<unsigned long long>(s.sequence), static_cast<unsigned long long>(s.records));
+            printTime(stdout, s.firstNs);
+            putchar(',');
+            printTime(stdout, s.lastNs);
+            printf(",%d,%s\n", s.closed ? 1 : 0, s.path.c_str());
+        }
+        return 0;
+    }
+
+    int64_t first = 0, last = 0;
+    if (!reader.range(first, last)) {
+        fprintf(stderr, "Журнал %s пуст\n", dir);
+        return 0;
+    }
+    int64_t fromNs = first;
+    int64_t toNs = last + 1;
+    if ((from && !parseTime(from, first, last, fromNs)) || (to && !parseTime(to, first, last, toNs))) {
+        usage();
+        return 1;
+    }
+
+    // Строки CSV копятся в большом буфере stdio: системный вызов записи — раз на 1 МБ
+    static char buf[1 << 20];
+    setvbuf(stdout, buf, _IOFBF, sizeof(buf));
+    printf("time,type,addr,len,payload\n");
+    CrsfFrameLogReader::QueryStats qs;
+    const auto t0 = std::chrono::steady_clock::now();
+    reader.query(fromNs, toNs, filter ? &types : nullptr, &writeRow, stdout, &qs);
+    fflush(stdout);
+    if (stats) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        fprintf(stderr, "segments=%u scanned=%llu matched=%llu bytes=%llu ms=%.2f\n", qs.segments,
+                static_cast<unsigned long long>(qs.scanned), static_cast<unsigned long long>(qs.matched),
+                static_cast<unsigned long long>(qs.bytes), ms);
+    }
+    return 0;
+}
@@ -23,6 +23,7 @@ class CRSFRealtimeInterface:
         # Настройки
         self.api_url = "http://localhost:8081"  # Исправляем порт
         self.update_interval = 20  # Уменьшаем до 20мс для реалтайма
+        self.use_stream = True  # Телеметрия потоком /api/stream, опрос — только если сервер его не умеет
         self.is_running = False
         self.data_queue = queue.Queue()
         
@@ -502,17 +503,23 @@ class CRSFRealtimeInterface:
             scale.set(2000.0)
     
     def apply_all_channels(self):
-        """Применить все каналы"""
+        """Применить все каналы одним запросом: сервер отправит их в одном кадре"""
+        values = []
         for ch_num in range(16):
             var = self.manual_channel_vars[ch_num]
             try:
                 value = int(var.get())
-                if 1000 <= value <= 2000:
-                    self.send_channel_command(ch_num + 1, value)
-                    time.sleep(0.01)  # Небольшая задержка между командами
             except ValueError:
                 messagebox.showerror("Ошибка", f"Неверное значение для канала {ch_num + 1}")
                 return
+            # Значения вне диапазона не отправляются, канал остаётся как есть
+            values.append(value if 1000 <= value <= 2000 else None)
+        try:
+            response = requests.post(f"{self.api_url}/api/channels", json=values, timeout=2)
+            if response.status_code != 200:
+                messagebox.showerror("Ошибка", f"Не удалось установить каналы: {response.status_code}")
+        except Exception as e:
+            messagebox.showerror("Ошибка", f"Ошибка отправки команды: {e}")
     
     def send_channel_command(self, ch_num, value):
         """Отправить команду установки канала через API"""
@@ -567,8 +574,10 @@ class CRSFRealtimeInterface:
             messagebox.showerror("Ошибка", f"Ошибка подключения: {e}")
     
     def data_update_worker(self):
-        """Поток обновления данных"""
+        """Поток обновления данных: поток событий /api/stream, при ошибке — опрос /api/telemetry"""
         while self.is_running:
+            if self.use_stream and self.stream_worker():
+                continue
             try:
                 response = requests.get(f"{self.api_url}/api/telemetry", timeout=2)
                 if response.status_code == 200:
@@ -582,6 +591,28 @@ class CRSFRealtimeInterface:
             
             time.sleep(self.update_interval / 1000.0)
     
+    def stream_worker(self):
+        """Приём телеметрии из /api/stream (Server-Sent Events). Сервер сам присылает каждый новый
+        снимок, но не чаще maxRate в секунду. False — поток недоступен, нужен опрос"""
+        max_rate = max(1, min(1000, int(1000 / max(1, self.update_interval))))
+        try:
+            with requests.get(f"{self.api_url}/api/stream?maxRate={max_rate}", stream=True, timeout=(2, 10)) as response:
+                if response.status_code != 200:
+                    # Старый сервер без /api/stream: дальше только опрос
+                    self.use_stream = False
+                    return False
+                for line in response.iter_lines(decode_unicode=True):
+                    if not self.is_running:
+                        return True
+                    if line and line.startswith("data: "):
+                        self.data_queue.put(json.loads(line[6:]))
+        except Exception as e:
+            print(f"Поток телеметрии недоступен: {e}")
+            self.data_queue.put(None)
+            time.sleep(self.update_interval / 1000.0)
+            return False
+        return True
+    
     def start_data_update(self):
         """Запуск обновления интерфейса"""
         self.update_interface()
@@ -0,0 +1,122 @@
+#include "CrsfShm.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "crsf/CrsfSerial.h"
+
+void crsfShmFill(CrsfShmTelemetry& out, const CrsfTelemetry& t, uint32_t channelsFrame)
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    out.publishNs = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    out.lastReceive = t.lastReceive;
+    out.channelsFrame = channelsFrame;
+    out.linkUp = t.linkUp ? 1 : 0;
+    out.batteryRemaining = t.batteryRemaining;
+    for (int i = 0; i < 3; ++i)
+        out.rawAttitude[i] = t.rawAttitude[i];
+    for (int i = 0; i < 16; ++i)
+        out.channels[i] = t.channels[i];
+    // Статистика связи, GPS и батарея — как в updateTelemetry() (telemetry_server.cpp)
+    out.packetsReceived = t.linkStatistics.uplink_RSSI_1;
+    out.packetsSent = t.linkStatistics.uplink_RSSI_2;
+    out.packetsLost = 100 - t.linkStatistics.uplink_Link_quality;
+    out.reserved = 0;
+    out.latitude = t.gps.latitude / 10000000.0;
+    out.longitude = t.gps.longitude / 10000000.0;
+    out.altitude = t.gps.altitude - 1000;
+    out.speed = t.gps.groundspeed / 10.0;
+    out.voltage = t.batteryVoltage;
+    out.current = t.batteryCurrent;
+    out.capacity = t.batteryCapacity;
+    out.roll = t.attitudeRoll;
+    out.pitch = t.attitudePitch;
+    out.yaw = t.attitudeYaw;
+}
+
+CrsfShmServer::CrsfShmServer() : _layout(nullptr), _name{}, _setpointsVersion(0), _pendingSeq(0), _pending(false) {}
+
+CrsfShmServer::~CrsfShmServer() { destroy(); }
+
+bool CrsfShmServer::create(const char* name)
+{
+    destroy();
+    // Сегмент прежнего экземпляра (аварийная остановка) не переиспользуем: его клиенты держат старое
+    // отображение и увидят magic == 0 только у нового объекта, поэтому создаём сегмент заново
+    shm_unlink(name);
+    const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0) return false;
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, sizeof(CrsfShmLayout)) == 0)
+        p = mmap(nullptr, sizeof(CrsfShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+    _layout = new (p) CrsfShmLayout();
+    _layout->version = CRSF_SHM_VERSION;
+    _layout->size = sizeof(CrsfShmLayout);
+    _layout->serverPid = static_cast<int32_t>(getpid());
+    _layout->setpointsOwner.store(0, std::memory_order_relaxed);
+    _layout->appliedSeq.store(0, std::memory_order_relaxed);
+    _layout->appliedFrame.store(0, std::memory_order_relaxed);
+    _layout->rejectedSetpoints.store(0, std::memory_order_relaxed);
+    snprintf(_name, sizeof(_name), "%s", name);
+    _setpointsVersion = _layout->setpoints.version();
+    _pending = false;
+    // Последним: клиент, увидевший magic, видит и остальную раскладку
+    _layout->magic.store(CRSF_SHM_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void CrsfShmServer::destroy()
+{
+    if (!_layout) return;
+    _layout->magic.store(0, std::memory_order_release);
+    _layout->~CrsfShmLayout();
+    munmap(_layout, sizeof(CrsfShmLayout));
+    shm_unlink(_name);
+    _layout = nullptr;
+}
+
+void CrsfShmServer::publish(const CrsfShmTelemetry& t)
+{
+    if (_layout) _layout->telemetry.write(t);
+}
+
+bool CrsfShmServer::pollSetpoints(ApplyFn apply, void* ctx)
+{
+    // Без новых уставок — одно чтение номера версии
+    if (!_layout || _layout->setpoints.version() == _setpointsVersion) return false;
+    // Писатель — другой процесс: он может замереть или умереть посреди записи. Не ждём его —
+    // версия не запоминается, и следующий тик отправки попробует снова
+    CrsfShmSetpoints s;
+    if (!_layout->setpoints.tryRead(s, &_setpointsVersion)) return false;
+    // Пустая mask и значение вне 1000..2000 — неверные уставки, ничего не применяется
+    int values[16] = {};
+    bool valid = s.mask != 0;
+    for (unsigned ch = 0; ch < 16 && valid; ++ch) {
+        if (!(s.mask & (1u << ch))) continue;
+        values[ch] = s.channels[ch];
+        valid = values[ch] >= 1000 && values[ch] <= 2000;
+    }
+    if (!valid) {
+        _layout->rejectedSetpoints.store(_layout->rejectedSetpoints.load(std::memory_order_relaxed) + 1,
+                                        std::memory_order_relaxed);
+        return false;
+    }
+    if (apply) apply(s.mask, values, ctx);
+    _pendingSeq = s.seq;
+    _pending = true;
+    return true;
+}
+
+void CrsfShmServer::channelsSent(uint32_t frame)
+{
+    if (!_layout || !_pending) return;
+    _pending = false;
+    _layout->appliedFrame.store(frame, std::memory_order_relaxed);
+    _layout->appliedSeq.store(_pendingSeq, std::memory_order_release);
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+// Телеметрия и уставки каналов через разделяемую память POSIX для процессов на той же машине.
+//
+// crsf_io_rpi создаёт сегмент CRSF_SHM_NAME (CrsfShmServer) и публикует в нём снимок телеметрии
+// при каждом изменении — Seqlock, как у CrsfSerial::telemetry(). Клиент (CrsfShmClient — только этот
+// заголовок и Seqlock.h) читает снимок готовыми числами: без системных вызовов и без JSON.
+// Ждать нового снимка можно через futex (waitTelemetry); писатель будит только ждущих.
+//
+// Уставки — почтовый ящик на том же Seqlock: пишет один процесс-владелец (первый, кто записал;
+// ящик умершего владельца забирает следующий). Главный цикл забирает уставки на каждом тике отправки
+// и пишет их в каналы, номер унёсшего их кадра виден клиенту (appliedSeq/appliedFrame).
+//
+// Раскладка версионируется: клиент сверяет magic, CRSF_SHM_VERSION и размер. При остановке
+// сервера magic обнуляется — клиенту пора переоткрыть сегмент (alive() == false)
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Seqlock.h"
+
+static const uint32_t CRSF_SHM_MAGIC = 0x4D485343;  // "CSHM"
+static const uint32_t CRSF_SHM_VERSION = 1;
+#define CRSF_SHM_DEFAULT_NAME "/crsf_io"
+
+// Снимок телеметрии: поля и единицы как в /api/telemetry (TelemetryData в telemetry_server.cpp)
+struct CrsfShmTelemetry {
+    uint64_t publishNs;             // CLOCK_MONOTONIC публикации
+    uint32_t lastReceive;           // rpi_millis() последней пачки байт
+    uint32_t channelsFrame;         // номер последнего отправленного кадра каналов
+    uint8_t linkUp;
+    uint8_t batteryRemaining;       // %
+    int16_t rawAttitude[3];         // [0]=roll, [1]=pitch, [2]=yaw
+    int32_t channels[16];           // мкс
+    uint32_t packetsReceived;
+    uint32_t packetsSent;
+    uint32_t packetsLost;
+    uint32_t reserved;
+    double latitude;                // градусы
+    double longitude;
+    double altitude;                // м
+    double speed;                   // км/ч
+    double voltage;                 // В
+    double current;                 // А
+    double capacity;                // мА·ч
+    double roll;                    // градусы
+    double pitch;
+    double yaw;
+};
+
+// Уставки клиента: channels[ch - 1] (мкс 1000..2000) для каналов из mask (бит 0 — канал 1)
+struct CrsfShmSetpoints {
+    uint32_t seq;
+    uint16_t mask;
+    uint16_t channels[16];
+};
+
+struct CrsfShmLayout {
+    std::atomic<uint32_t> magic;            // CRSF_SHM_MAGIC, пока сервер жив
+    uint32_t version;                       // CRSF_SHM_VERSION
+    uint32_t size;                          // sizeof(CrsfShmLayout)
+    int32_t serverPid;
+    alignas(64) Seqlock<CrsfShmTelemetry, true> telemetry;
+    // Ящик уставок на отдельных строках кэша: запись клиента не мешает читателям телеметрии
+    alignas(64) std::atomic<int32_t> setpointsOwner;  // pid пишущего процесса, 0 — свободен
+    Seqlock<CrsfShmSetpoints, true> setpoints;
+    alignas(64) std::atomic<uint32_t> appliedSeq;     // seq уставок, ушедших в кадр
+    std::atomic<uint32_t> appliedFrame;               // номер этого кадра
+    std::atomic<uint32_t> rejectedSetpoints;          // неверные уставки (значение вне 1000..2000, пустая mask)
+};
+
+class CrsfShmClient
+{
+public:
+    CrsfShmClient() : _layout(nullptr), _seq(0), _owner(false) {}
+    ~CrsfShmClient() { close(); }
+
+    bool open(const char* name = CRSF_SHM_DEFAULT_NAME)
+    {
+        close();
+        const int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(CrsfShmLayout))
+            p = mmap(nullptr, sizeof(CrsfShmLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        _layout = static_cast<CrsfShmLayout*>(p);
+        if (!alive() || _layout->version != CRSF_SHM_VERSION || _layout->size != sizeof(CrsfShmLayout)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (_layout) munmap(_layout, sizeof(CrsfShmLayout));
+        _layout = nullptr;
+        _owner = false;
+    }
+
+    bool isOpen() const { return _layout != nullptr; }
+    // false — сервер остановлен, сегмент нужно открыть заново
+    bool alive() const { return _layout && _layout->magic.load(std::memory_order_acquire) == CRSF_SHM_MAGIC; }
+    // После аварийной остановки magic остаётся: процесс сервера проверяется системным вызовом, не на каждом чтении
+    bool serverRunning() const { return alive() && !(kill(_layout->serverPid, 0) != 0 && errno == ESRCH); }
+
+    CrsfShmTelemetry telemetry(uint32_t* retries = nullptr) const { return _layout->telemetry.read(retries); }
+    uint32_t telemetryVersion() const { return _layout->telemetry.version(); }
+    // Спать до снимка новее version, не дольше timeoutMs; true — есть новый снимок
+    bool waitTelemetry(uint32_t version, uint32_t timeoutMs) const { return _layout->telemetry.waitChange(version, timeoutMs); }
+
+    // Уставки каналов: values[ch - 1] для каналов из mask. Уйдут в ближайшем кадре каналов.
+    // Возвращает seq уставок (см. appliedSeq) или 0, если ящиком владеет другой живой процесс
+    uint32_t setChannels(uint16_t mask, const int* values)
+    {
+        if (!_owner && !claim()) return 0;
+        CrsfShmSetpoints s{};
+        s.seq = ++_seq;
+        s.mask = mask;
+        for (unsigned ch = 0; ch < 16; ++ch)
+            if (mask & (1u << ch)) s.channels[ch] = static_cast<uint16_t>(values[ch]);
+        _layout->setpoints.write(s);
+        return s.seq;
+    }
+
+    uint32_t appliedSeq() const { return _layout->appliedSeq.load(std::memory_order_acquire); }
+    uint32_t appliedFrame() const { return _layout->appliedFrame.load(std::memory_order_acquire); }
+
+private:
+    static const unsigned CLAIM_READ_TRIES = 1000;
+
+    CrsfShmLayout* _layout;
+    uint32_t _seq;
+    bool _owner;
+
+    // Владение ящиком: свободный или владелец умер. Системный вызов — только здесь, один раз
+    bool claim()
+    {
+        const int32_t self = static_cast<int32_t>(getpid());
+        int32_t owner = _layout->setpointsOwner.load(std::memory_order_acquire);
+        while (owner != self) {
+            if (owner != 0 && !(kill(owner, 0) != 0 && errno == ESRCH)) return false;
+            if (_layout->setpointsOwner.compare_exchange_weak(owner, self, std::memory_order_acq_rel)) break;
+        }
+        // Продолжаем нумерацию прежнего владельца: сервер принимает только новые версии ящика.
+        // Прежний владелец мог умереть посреди записи (версия нечётная навсегда) — попытки ограничены,
+        // тогда нумерация идёт от последних принятых сервером уставок, а первая запись завершит порванную
+        CrsfShmSetpoints last;
+        bool got = false;
+        for (unsigned i = 0; i < CLAIM_READ_TRIES && !got; ++i)
+            got = _layout->setpoints.tryRead(last);
+        _seq = got ? last.seq : _layout->appliedSeq.load(std::memory_order_acquire);
+        _owner = true;
+        return true;
+    }
+};
+
+struct CrsfTelemetry;
+// Снимок CrsfSerial в раскладку сегмента (те же преобразования, что у /api/telemetry)
+void crsfShmFill(CrsfShmTelemetry& out, const CrsfTelemetry& t, uint32_t channelsFrame);
+
+// Сторона crsf_io_rpi: создаёт сегмент, публикует телеметрию и забирает уставки. Только главный поток
+class CrsfShmServer
+{
+public:
+    typedef void (*ApplyFn)(uint16_t mask, const int* values, void* ctx);
+
+    CrsfShmServer();
+    ~CrsfShmServer();
+
+    bool create(const char* name = CRSF_SHM_DEFAULT_NAME);
+    void destroy();
+    bool isOpen() const { return _layout != nullptr; }
+
+    void publish(const CrsfShmTelemetry& t);
+    // Новые уставки из ящика — в apply; true — были
+    bool pollSetpoints(ApplyFn apply, void* ctx);
+    // Кадр каналов ушёл: отметить принятые уставки его номером
+    void channelsSent(uint32_t frame);
+
+    const CrsfShmLayout* layout() const { return _layout; }
+
+private:
+    CrsfShmLayout* _layout;
+    char _name[64];
+    uint32_t _setpointsVersion;
+    uint32_t _pendingSeq;
+    bool _pending;
+};
@@ -0,0 +1,155 @@
+#include "EventLoop.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <ctime>
+#include <cerrno>
+
+// Реализация цикла событий на epoll + timerfd
+
+static uint64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+EventLoop::EventLoop(Mode mode, uint32_t spinUs)
+    : _mode(mode), _spinUs(spinUs), _epfd(-1), _lastEventNs(0)
+{
+    for (int i = 0; i < MAX_SOURCES; ++i)
+        _sources[i] = Source{-1, nullptr, nullptr, nullptr, false};
+}
+
+EventLoop::~EventLoop() { close(); }
+
+bool EventLoop::open()
+{
+    if (_epfd >= 0) return true;
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    return _epfd >= 0;
+}
+
+void EventLoop::close()
+{
+    for (int i = 0; i < MAX_SOURCES; ++i) {
+        // Таймеры созданы циклом — закрываем их сами; остальные fd принадлежат вызывающему
+        if (_sources[i].fd >= 0 && _sources[i].timer)
+            ::close(_sources[i].fd);
+        _sources[i] = Source{-1, nullptr, nullptr, nullptr, false};
+    }
+    if (_epfd >= 0) {
+        ::close(_epfd);
+        _epfd = -1;
+    }
+}
+
+EventLoop::Source* EventLoop::findFree()
+{
+    for (int i = 0; i < MAX_SOURCES; ++i)
+        if (_sources[i].fd < 0) return &_sources[i];
+    return nullptr;
+}
+
+bool EventLoop::add(int fd, Handler handler, void* ctx, Handler onError)
+{
+    if (_epfd < 0 || fd < 0 || !handler) return false;
+    Source* src = findFree();
+    if (!src) return false;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = src;
+    if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) != 0) return false;
+    *src = Source{fd, handler, onError, ctx, false};
+    return true;
+}
+
+bool EventLoop::remove(int fd)
+{
+    if (_epfd < 0 || fd < 0) return false;
+    for (int i = 0; i < MAX_SOURCES; ++i) {
+        if (_sources[i].fd != fd) continue;
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, nullptr);
+        if (_sources[i].timer) ::close(fd);
+        _sources[i] = Source{-1, nullptr, nullptr, nullptr, false};
+        return true;
+    }
+    return false;
+}
+
+int EventLoop::addTimer(uint32_t periodUs, Handler handler, void* ctx)
+{
+    if (_epfd < 0 || periodUs == 0 || !handler) return -1;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) return -1;
+
+    itimerspec spec{};
+    spec.it_interval.tv_sec = periodUs / 1000000;
+    spec.it_interval.tv_nsec = static_cast<long>(periodUs % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(tfd, 0, &spec, nullptr) != 0 || !add(tfd, handler, ctx)) {
+        ::close(tfd);
+        return -1;
+    }
+    for (int i = 0; i < MAX_SOURCES; ++i)
+        if (_sources[i].fd == tfd) _sources[i].timer = true;
+    return tfd;
+}
+
+int EventLoop::dispatch(int timeoutMs)
+{
+    epoll_event events[MAX_SOURCES];
+    int n = epoll_wait(_epfd, events, MAX_SOURCES, timeoutMs);
+    if (n <= 0) return 0; // таймаут или EINTR
+
+    for (int i = 0; i < n; ++i) {
+        Source* src = static_cast<Source*>(events[i].data.ptr);
+        if (src->fd < 0) continue; // источник удалён обработчиком выше
+        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+            // Уровневый HUP/ERR не сбросить чтением: без снятия fd epoll_wait возвращался бы сразу, цикл крутился
+            const Handler onError = src->onError;
+            void* ctx = src->ctx;
+            remove(src->fd);
+            if (onError) onError(ctx);
+            continue;
+        }
+        if (src->timer) {
+            // Сбрасываем счётчик срабатываний, иначе fd останется готовым
+            uint64_t expirations;
+            if (::read(src->fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN)
+                continue;
+        }
+        src->handler(src->ctx);
+    }
+    return n;
+}
+
+int EventLoop::runOnce()
+{
+    if (_epfd < 0) return 0;
+
+    switch (_mode) {
+    case Mode::Spin:
+        return dispatch(0);
+    case Mode::Blocking:
+        return dispatch(-1);
+    case Mode::Hybrid:
+    default:
+        break;
+    }
+
+    // Гибрид: пока с последнего события прошло меньше spinUs — опрашиваем без сна
+    const uint64_t spinNs = static_cast<uint64_t>(_spinUs) * 1000ull;
+    while (monotonicNs() - _lastEventNs < spinNs) {
+        int n = dispatch(0);
+        if (n > 0) {
+            _lastEventNs = monotonicNs();
+            return n;
+        }
+    }
+    int n = dispatch(-1);
+    _lastEventNs = monotonicNs();
+    return n;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Цикл событий на epoll для главного потока: UART, джойстик, периодические таймеры (timerfd).
+// Процесс спит между событиями вместо постоянного опроса.
+//
+// Режимы ожидания:
+//   Blocking — сразу блокируемся в epoll_wait до следующего события (минимум CPU; по умолчанию)
+//   Hybrid   — после события spinUs мкс опрашиваем без блокировки, затем блокируемся. Выигрывает, только если
+//              следующее событие приходит внутри окна опроса; на редких байтах p99 не лучше Blocking
+//              (bench/loop_latency_bench)
+//   Spin     — только опрос без блокировки (поведение прежнего for(;;), для сравнения в бенчмарках)
+
+#include <cstdint>
+
+class EventLoop {
+public:
+    enum class Mode { Blocking, Hybrid, Spin };
+
+    // Обработчик события: ctx передаётся без изменений
+    typedef void (*Handler)(void* ctx);
+
+    explicit EventLoop(Mode mode = Mode::Blocking, uint32_t spinUs = 200);
+    ~EventLoop();
+
+    bool open();
+    void close();
+
+    // Подписаться на готовность fd к чтению (уровень, EPOLLIN).
+    // EPOLLHUP/EPOLLERR (джойстик отключён, UART повис) держатся на fd постоянно: такой fd цикл снимает сам
+    // и вызывает onError(ctx) — закрыть устройство или переключиться; без onError fd просто снимается
+    bool add(int fd, Handler handler, void* ctx, Handler onError = nullptr);
+    bool remove(int fd);
+
+    // Периодический таймер на timerfd. Возвращает fd таймера или -1
+    int addTimer(uint32_t periodUs, Handler handler, void* ctx);
+
+    // Дождаться событий (с учётом режима) и вызвать обработчики.
+    // Возвращает число обработанных событий
+    int runOnce();
+
+    Mode mode() const { return _mode; }
+
+private:
+    static const int MAX_SOURCES = 8;
+
+    struct Source {
+        int fd;
+        Handler handler;
+        Handler onError;
+        void* ctx;
+        bool timer;
+    };
+
+    Mode _mode;
+    uint32_t _spinUs;
+    int _epfd;
+    uint64_t _lastEventNs;
+    Source _sources[MAX_SOURCES];
+
+    Source* findFree();
+    int dispatch(int timeoutMs);
+};
@@ -0,0 +1,959 @@
+#include "HttpServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Метки epoll_event.data.u64 помимо номеров подключений
+static const uint64_t TOKEN_LISTEN = ~0ull;
+static const uint64_t TOKEN_STOP = ~0ull - 1;
+static const uint64_t TOKEN_NOTIFY = ~0ull - 2;
+static const int MAX_EVENTS = 64;
+static const int LISTEN_BACKLOG = 128;
+
+static uint64_t monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint64_t monotonicMs() { return monotonicNs() / 1000000; }
+
+static bool iequals(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+
+static std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+static const char* statusText(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+// ---- WebSocket: ключ рукопожатия (SHA-1 + base64) и заголовки кадров ----
+
+static void sha1(const uint8_t* data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    auto rol = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    const uint64_t bits = static_cast<uint64_t>(len) * 8;
+    // Ключ рукопожатия короткий: сообщение с дополнением умещается в два блока
+    uint8_t buf[128] = {};
+    if (len > sizeof(buf) - 9) return;
+    memcpy(buf, data, len);
+    buf[len] = 0x80;
+    const size_t total = (len + 9 <= 64) ? 64 : 128;
+    for (int i = 0; i < 8; ++i)
+        buf[total - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    for (size_t block = 0; block < total; block += 64) {
+        uint32_t wv[80];
+        for (int i = 0; i < 16; ++i)
+            wv[i] = (uint32_t(buf[block + 4 * i]) << 24) | (uint32_t(buf[block + 4 * i + 1]) << 16) |
+                    (uint32_t(buf[block + 4 * i + 2]) << 8) | buf[block + 4 * i + 3];
+        for (int i = 16; i < 80; ++i)
+            wv[i] = rol(wv[i - 3] ^ wv[i - 8] ^ wv[i - 14] ^ wv[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            const uint32_t t = rol(a, 5) + f + e + k + wv[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 4; ++j)
+            out[4 * i + j] = static_cast<uint8_t>(h[i] >> (24 - 8 * j));
+}
+
+static void appendBase64(std::string& out, const uint8_t* data, size_t len)
+{
+    static const char abc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t v = (uint32_t(data[i]) << 16) | (i + 1 < len ? uint32_t(data[i + 1]) << 8 : 0) |
+                           (i + 2 < len ? data[i + 2] : 0);
+        out.push_back(abc[(v >> 18) & 63]);
+        out.push_back(abc[(v >> 12) & 63]);
+        out.push_back(i + 1 < len ? abc[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? abc[v & 63] : '=');
+    }
+}
+
+// Sec-WebSocket-Accept = base64(SHA-1(ключ клиента + GUID протокола))
+static void appendWsAccept(std::string& out, std::string_view key)
+{
+    static const char GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t buf[96];
+    if (key.size() + sizeof(GUID) - 1 > sizeof(buf)) return;
+    memcpy(buf, key.data(), key.size());
+    memcpy(buf + key.size(), GUID, sizeof(GUID) - 1);
+    uint8_t digest[20];
+    sha1(buf, key.size() + sizeof(GUID) - 1, digest);
+    appendBase64(out, digest, sizeof(digest));
+}
+
+enum : uint8_t { WS_TEXT = 0x1, WS_BINARY = 0x2, WS_CLOSE = 0x8, WS_PING = 0x9, WS_PONG = 0xA };
+
+// Заголовок кадра сервера (FIN, без маски)
+static void appendWsHeader(std::string& out, uint8_t opcode, size_t len)
+{
+    out.push_back(static_cast<char>(0x80 | opcode));
+    if (len < 126) {
+        out.push_back(static_cast<char>(len));
+    } else if (len <= 0xFFFF) {
+        out.push_back(126);
+        out.push_back(static_cast<char>(len >> 8));
+        out.push_back(static_cast<char>(len & 0xFF));
+    } else {
+        out.push_back(127);
+        for (int i = 7; i >= 0; --i)
+            out.push_back(static_cast<char>((static_cast<uint64_t>(len) >> (8 * i)) & 0xFF));
+    }
+}
+
+// Кадр закрытия с кодом причины
+static void appendWsClose(std::string& out, uint16_t code)
+{
+    appendWsHeader(out, WS_CLOSE, 2);
+    out.push_back(static_cast<char>(code >> 8));
+    out.push_back(static_cast<char>(code & 0xFF));
+}
+
+// Часть ответа chunked: размер в hex, данные; пустую не пишем — она означала бы конец ответа
+static void appendChunk(std::string& out, const std::string& part, bool framed)
+{
+    if (part.empty()) return;
+    if (!framed) {
+        out.append(part);
+        return;
+    }
+    char num[16];
+    out.append(num, std::to_chars(num, num + sizeof(num), part.size(), 16).ptr);
+    out.append("\r\n");
+    out.append(part);
+    out.append("\r\n");
+}
+
+std::string_view HttpRequest::param(std::string_view name) const
+{
+    std::string_view rest = query;
+    while (!rest.empty()) {
+        const size_t amp = rest.find('&');
+        const std::string_view pair = rest.substr(0, amp);
+        const size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == name)
+            return (eq == std::string_view::npos) ? std::string_view() : pair.substr(eq + 1);
+        if (amp == std::string_view::npos) break;
+        rest.remove_prefix(amp + 1);
+    }
+    return std::string_view();
+}
+
+std::string_view HttpRequest::header(std::string_view name) const
+{
+    std::string_view rest = headers;
+    while (!rest.empty()) {
+        const size_t eol = rest.find("\r\n");
+        const std::string_view line = rest.substr(0, eol);
+        const size_t colon = line.find(':');
+        if (colon != std::string_view::npos && iequals(trim(line.substr(0, colon)), name))
+            return trim(line.substr(colon + 1));
+        if (eol == std::string_view::npos) break;
+        rest.remove_prefix(eol + 2);
+    }
+    return std::string_view();
+}
+
+struct HttpServer::Connection {
+    int fd = -1;
+    size_t inLen = 0;
+    std::string out;            // ответы, ещё не отданные сокету
+    size_t outOff = 0;
+    bool closeAfter = false;    // закрыть, как только out уйдёт целиком
+    bool wantWrite = false;     // сокет переполнен: ждём EPOLLOUT и не читаем новые запросы
+    uint64_t lastActiveMs = 0;  // последний принятый запрос или, кроме WebSocket, продвижение отправки
+    int sendQueued = 0;         // байт в очереди сокета (SIOCOUTQ) на прошлом обходе простоя
+    // Потоковое подключение: тема, ограничение частоты и кольцо событий, ждущих отправки
+    unsigned stream = 0;
+    uint32_t streamIntervalMs = 0;
+    uint64_t streamSeq = 0;     // seq последнего события темы, поставленного в очередь
+    uint64_t nextSendMs = 0;
+    std::vector<std::shared_ptr<const std::string>> queue;
+    size_t queueHead = 0;
+    size_t queueLen = 0;
+    // WebSocket после рукопожатия: обработчик сообщений и слово состояния для него
+    HttpWsHandler ws = nullptr;
+    uint64_t wsSession = 0;
+    bool pingSent = false;      // ждём ответа на ping от сервера
+    // Ответ частями: генератор и его курсор; chunkFramed — кадры chunked (HTTP/1.1), иначе до закрытия
+    HttpChunkFn chunk = nullptr;
+    uint64_t chunkState[HTTP_CHUNK_STATE_WORDS] = {};
+    bool chunkFramed = false;
+    bool chunkKeepAlive = false;
+    char in[REQUEST_BUFFER_SIZE];
+};
+
+struct HttpServer::Worker {
+    int listenFd = -1;
+    int epfd = -1;
+    int stopFd = -1;
+    int notifyFd = -1;          // publish(): есть новые события тем
+    unsigned streams = 0;       // потоковых подключений у этого потока
+    std::thread thread;
+    std::vector<Connection> conns;
+    std::vector<uint32_t> freeList;
+    HttpResponse resp{200, "text/html", std::string(), 0, 0, nullptr, nullptr, {}};
+    std::string wsReply;
+    std::string chunkPart;      // часть ответа генератора до заголовка chunked
+};
+
+// Счётчики маршрута: рабочие потоки прибавляют без блокировок (fetch_add relaxed)
+struct HttpServer::RouteCounters {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> durationUs{0};
+    std::atomic<uint64_t> buckets[HttpRouteStats::BUCKETS] = {};
+};
+
+constexpr uint32_t HttpRouteStats::BUCKET_US[];
+
+HttpServer::HttpServer(const HttpRoute* routes, size_t routeCount)
+    : _routes(routes), _routeCount(routeCount), _port(0), _idleTimeoutMs(10000), _streamQueue(4),
+      _requests(0), _connections(0), _rejected(0), _streamDropped(0), _wsMessages(0), _responses{},
+      _routeCounters(new RouteCounters[routeCount + 1])
+{
+}
+
+bool HttpServer::routeStats(size_t index, HttpRouteStats& out) const
+{
+    if (index > _routeCount) return false;
+    const RouteCounters& c = _routeCounters[index];
+    out.requests = c.requests.load(std::memory_order_relaxed);
+    out.durationUs = c.durationUs.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < HttpRouteStats::BUCKETS; ++i)
+        out.buckets[i] = c.buckets[i].load(std::memory_order_relaxed);
+    return true;
+}
+
+void HttpServer::count(size_t route, int status, uint64_t durationNs)
+{
+    RouteCounters& c = _routeCounters[route];
+    const uint64_t us = durationNs / 1000;
+    unsigned b = 0;
+    while (b < HttpRouteStats::BUCKETS - 1 && us > HttpRouteStats::BUCKET_US[b]) ++b;
+    c.requests.fetch_add(1, std::memory_order_relaxed);
+    c.durationUs.fetch_add(us, std::memory_order_relaxed);
+    c.buckets[b].fetch_add(1, std::memory_order_relaxed);
+    const unsigned cls = static_cast<unsigned>(status) / 100;
+    if (cls < 6) _responses[cls].fetch_add(1, std::memory_order_relaxed);
+}
+
+HttpServer::~HttpServer() { stop(); }
+
+static int openListener(int port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    // Один слушающий сокет на рабочий поток: ядро распределяет подключения между ними
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, LISTEN_BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool HttpServer::start(int port, unsigned workers, unsigned maxConnectionsPerWorker, uint32_t idleTimeoutMs,
+                       unsigned streamQueue)
+{
+    stop();
+    if (workers == 0 || maxConnectionsPerWorker == 0 || streamQueue == 0) return false;
+    _idleTimeoutMs = idleTimeoutMs;
+    _streamQueue = streamQueue;
+    _port = port;
+
+    for (unsigned i = 0; i < workers; ++i) {
+        Worker* w = new Worker();
+        _workers.push_back(w);
+        w->listenFd = openListener(_port);
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        w->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        w->notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->listenFd < 0 || w->epfd < 0 || w->stopFd < 0 || w->notifyFd < 0) {
+            stop();
+            return false;
+        }
+        if (_port == 0) {
+            // Порт выбран ядром: остальные потоки слушают тот же
+            sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+            getsockname(w->listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+            _port = ntohs(addr.sin_port);
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = TOKEN_LISTEN;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->listenFd, &ev);
+        ev.data.u64 = TOKEN_STOP;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->stopFd, &ev);
+        ev.data.u64 = TOKEN_NOTIFY;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->notifyFd, &ev);
+
+        // Пул подключений с буферами заводится один раз
+        w->conns = std::vector<Connection>(maxConnectionsPerWorker);
+        for (Connection& c : w->conns)
+            c.queue.resize(_streamQueue);
+        for (unsigned j = maxConnectionsPerWorker; j > 0; --j)
+            w->freeList.push_back(j - 1);
+    }
+    for (Worker* w : _workers)
+        w->thread = std::thread(&HttpServer::run, this, w);
+    return true;
+}
+
+void HttpServer::stop()
+{
+    for (Worker* w : _workers) {
+        if (w->thread.joinable()) {
+            const uint64_t one = 1;
+            const ssize_t r = write(w->stopFd, &one, sizeof(one));
+            (void)r;
+            w->thread.join();
+        }
+        for (Connection& c : w->conns)
+            if (c.fd >= 0) close(c.fd);
+        if (w->listenFd >= 0) close(w->listenFd);
+        if (w->epfd >= 0) close(w->epfd);
+        if (w->stopFd >= 0) close(w->stopFd);
+        if (w->notifyFd >= 0) close(w->notifyFd);
+        delete w;
+    }
+    _workers.clear();
+    for (Topic& t : _topics) {
+        std::lock_guard<std::mutex> lock(t.mutex);
+        t.event.reset();
+        t.subscribers.store(0, std::memory_order_relaxed);
+    }
+}
+
+void HttpServer::publish(unsigned topic, const char* data, size_t len)
+{
+    if (topic == 0 || topic > MAX_STREAM_TOPICS) return;
+    // Одна копия на событие: подключения держат ссылки на неё, пока не отдадут сокету
+    std::shared_ptr<const std::string> event = std::make_shared<const std::string>(data, len);
+    {
+        std::lock_guard<std::mutex> lock(_topics[topic].mutex);
+        _topics[topic].event = std::move(event);
+        ++_topics[topic].seq;
+    }
+    const uint64_t one = 1;
+    for (Worker* w : _workers) {
+        const ssize_t r = write(w->notifyFd, &one, sizeof(one));
+        (void)r;
+    }
+}
+
+unsigned HttpServer::subscribers(unsigned topic) const
+{
+    if (topic == 0 || topic > MAX_STREAM_TOPICS) return 0;
+    return _topics[topic].subscribers.load(std::memory_order_relaxed);
+}
+
+void HttpServer::run(Worker* w)
+{
+    epoll_event events[MAX_EVENTS];
+    uint64_t lastSweepMs = monotonicMs();
+    int timeoutMs = 1000;
+    for (;;) {
+        const int n = epoll_wait(w->epfd, events, MAX_EVENTS, timeoutMs);
+        for (int i = 0; i < n; ++i) {
+            const uint64_t token = events[i].data.u64;
+            if (token == TOKEN_STOP) return;
+            if (token == TOKEN_LISTEN) {
+                acceptAll(w);
+                continue;
+            }
+            if (token == TOKEN_NOTIFY) {
+                uint64_t count;
+                const ssize_t r = read(w->notifyFd, &count, sizeof(count));
+                (void)r;
+                collectEvents(w);
+                continue;
+            }
+            Connection* c = &w->conns[token];
+            if (c->fd < 0) continue;
+            if (events[i].events & EPOLLOUT) {
+                // Ответ ушёл целиком — разбираем запросы, накопленные за время ожидания
+                // (потоковому подключению — отдаём накопившиеся события)
+                if (flush(w, c) && !c->wantWrite) {
+                    if (c->stream) pump(w, c, monotonicMs());
+                    else if (c->chunk) pumpChunks(w, c);
+                    else onReadable(w, c);
+                }
+                continue;
+            }
+            onReadable(w, c);
+        }
+
+        const uint64_t now = monotonicMs();
+        timeoutMs = w->streams ? pumpStreams(w, now) : 1000;
+
+        // Простаивающие keep-alive подключения закрываем, чтобы не держать слоты пула.
+        // Ответ, который клиент ещё забирает (chunked, медленное чтение), простоем не считается: срок продлевают
+        // продвижение flush() и убывание очереди сокета — EPOLLOUT при большом буфере приходит реже, чем раз в срок.
+        // Потоковые не трогаем: их молчание — отсутствие событий
+        if (now - lastSweepMs >= 1000) {
+            lastSweepMs = now;
+            for (Connection& c : w->conns) {
+                if (c.fd < 0) continue;
+                if (c.ws) {
+                    // WebSocket: молчит дольше половины срока — ping; не ответил до конца срока — закрываем
+                    if (now - c.lastActiveMs > _idleTimeoutMs) {
+                        closeConnection(w, &c);
+                    } else if (now - c.lastActiveMs > _idleTimeoutMs / 2 && !c.pingSent && !c.wantWrite) {
+                        appendWsHeader(c.out, WS_PING, 0);
+                        c.pingSent = true;
+                        flush(w, &c);
+                    }
+                } else if (!c.stream) {
+                    if (c.chunk || c.wantWrite) {
+                        int queued = 0;
+                        if (ioctl(c.fd, SIOCOUTQ, &queued) == 0) {
+                            if (queued < c.sendQueued) c.lastActiveMs = now;
+                            c.sendQueued = queued;
+                        }
+                    }
+                    if (c.lastActiveMs + _idleTimeoutMs < now) closeConnection(w, &c);
+                }
+            }
+        }
+    }
+}
+
+void HttpServer::collectEvents(Worker* w)
+{
+    if (!w->streams) return;
+    for (unsigned t = 1; t <= MAX_STREAM_TOPICS; ++t) {
+        if (!_topics[t].subscribers.load(std::memory_order_relaxed)) continue;
+        std::shared_ptr<const std::string> event;
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(_topics[t].mutex);
+            event = _topics[t].event;
+            seq = _topics[t].seq;
+        }
+        if (!event) continue;
+        for (Connection& c : w->conns) {
+            if (c.fd < 0 || c.stream != t || c.streamSeq >= seq) continue;
+            c.streamSeq = seq;
+            if (c.queueLen == c.queue.size()) {
+                // Очередь полна: самое старое событие устарело — выбрасываем его
+                c.queue[c.queueHead].reset();
+                c.queueHead = (c.queueHead + 1) % c.queue.size();
+                --c.queueLen;
+                _streamDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            c.queue[(c.queueHead + c.queueLen) % c.queue.size()] = event;
+            ++c.queueLen;
+        }
+    }
+}
+
+int HttpServer::pumpStreams(Worker* w, uint64_t now)
+{
+    uint64_t wait = 1000;
+    for (Connection& c : w->conns) {
+        if (c.fd < 0 || !c.stream || !c.queueLen) continue;
+        pump(w, &c, now);
+        // Событие придержано ограничением частоты — проснуться к сроку
+        if (c.fd >= 0 && c.queueLen && !c.wantWrite && c.nextSendMs > now)
+            wait = std::min<uint64_t>(wait, c.nextSendMs - now);
+    }
+    return static_cast<int>(wait);
+}
+
+void HttpServer::pump(Worker* w, Connection* c, uint64_t now)
+{
+    // Сокет ещё не забрал прошлое: события копятся в очереди (EPOLLOUT вызовет pump снова)
+    if (c->wantWrite || !c->queueLen) return;
+    if (c->streamIntervalMs) {
+        if (now < c->nextSendMs) return;
+        // С ограничением частоты отдаём только самое свежее, остальное устарело
+        while (c->queueLen > 1) {
+            c->queue[c->queueHead].reset();
+            c->queueHead = (c->queueHead + 1) % c->queue.size();
+            --c->queueLen;
+            _streamDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        c->nextSendMs = now + c->streamIntervalMs;
+    }
+    while (c->queueLen) {
+        if (c->ws) appendWsHeader(c->out, WS_TEXT, c->queue[c->queueHead]->size());
+        c->out.append(*c->queue[c->queueHead]);
+        c->queue[c->queueHead].reset();
+        c->queueHead = (c->queueHead + 1) % c->queue.size();
+        --c->queueLen;
+    }
+    flush(w, c);
+}
+
+void HttpServer::acceptAll(Worker* w)
+{
+    for (;;) {
+        const int fd = accept4(w->listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (w->freeList.empty()) {
+            // Пул занят: не создаём ничего сверх заданного при старте
+            close(fd);
+            _rejected.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const uint32_t idx = w->freeList.back();
+        w->freeList.pop_back();
+        Connection* c = &w->conns[idx];
+        c->fd = fd;
+        c->inLen = 0;
+        c->out.clear();
+        c->outOff = 0;
+        c->closeAfter = false;
+        c->wantWrite = false;
+        c->lastActiveMs = monotonicMs();
+        c->stream = 0;
+        c->queueHead = 0;
+        c->queueLen = 0;
+        c->ws = nullptr;
+        c->pingSent = false;
+        c->chunk = nullptr;
+        c->sendQueued = 0;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = idx;
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev);
+        _connections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void HttpServer::closeConnection(Worker* w, Connection* c)
+{
+    if (c->stream) {
+        _topics[c->stream].subscribers.fetch_sub(1, std::memory_order_relaxed);
+        --w->streams;
+        c->stream = 0;
+        for (; c->queueLen; --c->queueLen) {
+            c->queue[c->queueHead].reset();
+            c->queueHead = (c->queueHead + 1) % c->queue.size();
+        }
+    }
+    c->ws = nullptr;
+    c->chunk = nullptr;
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+    close(c->fd);
+    c->fd = -1;
+    w->freeList.push_back(static_cast<uint32_t>(c - w->conns.data()));
+}
+
+void HttpServer::onReadable(Worker* w, Connection* c)
+{
+    bool peerClosed = false;
+    while (c->inLen < sizeof(c->in)) {
+        const ssize_t r = recv(c->fd, c->in + c->inLen, sizeof(c->in) - c->inLen, 0);
+        if (r > 0) {
+            c->inLen += static_cast<size_t>(r);
+        } else if (r == 0) {
+            peerClosed = true;
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeConnection(w, c);
+                return;
+            }
+            break;
+        }
+    }
+    c->lastActiveMs = monotonicMs();
+    c->pingSent = false;
+
+    if (c->ws) {
+        processWsFrames(w, c);
+        if (peerClosed) c->closeAfter = true;
+        flush(w, c);
+        return;
+    }
+
+    if (c->stream) {
+        // Потоковому подключению клиент ничего не шлёт; читаем только чтобы заметить закрытие
+        c->inLen = 0;
+        if (peerClosed) closeConnection(w, c);
+        return;
+    }
+
+    if (!processRequests(w, c)) {
+        // Неразборчивый или слишком большой запрос: ответ и закрытие
+        c->out.append("HTTP/1.1 400 Bad Request\r\nContent-Type: text/html\r\nContent-Length: 24\r\n"
+                      "Connection: close\r\n\r\n<h1>400 Bad Request</h1>");
+        c->inLen = 0;
+        c->closeAfter = true;
+    }
+    if (c->chunk) {
+        // Клиент закрыл свою сторону: ответ всё равно доводим до конца, потом закрываем
+        if (peerClosed) c->chunkKeepAlive = false;
+        pumpChunks(w, c);
+        return;
+    }
+    if (peerClosed)
+        c->closeAfter = true;
+    flush(w, c);
+}
+
+void HttpServer::pumpChunks(Worker* w, Connection* c)
+{
+    std::string& part = w->chunkPart;
+    while (c->chunk) {
+        part.clear();
+        const bool more = c->chunk(c->chunkState, part);
+        appendChunk(c->out, part, c->chunkFramed);
+        if (!more) {
+            c->chunk = nullptr;
+            if (c->chunkFramed) c->out.append("0\r\n\r\n");
+            if (!c->chunkKeepAlive) {
+                c->closeAfter = true;
+                c->inLen = 0;
+            }
+        }
+        // Сокет не забрал часть целиком — следующую готовим по EPOLLOUT
+        if (!flush(w, c) || c->wantWrite) return;
+    }
+    // Запросы, пришедшие конвейером за время ответа
+    if (c->inLen) onReadable(w, c);
+}
+
+bool HttpServer::processRequests(Worker* w, Connection* c)
+{
+    while (c->inLen > 0 && !c->closeAfter) {
+        const std::string_view buf(c->in, c->inLen);
+        const size_t headEnd = buf.find("\r\n\r\n");
+        if (headEnd == std::string_view::npos)
+            return c->inLen < sizeof(c->in); // ждём остаток; буфер полон — запрос слишком велик
+
+        HttpRequest req;
+        const size_t lineEnd = buf.find("\r\n");
+        const std::string_view line = buf.substr(0, lineEnd);
+        const size_t sp1 = line.find(' ');
+        const size_t sp2 = (sp1 == std::string_view::npos) ? sp1 : line.find(' ', sp1 + 1);
+        if (sp2 == std::string_view::npos) return false;
+        req.method = line.substr(0, sp1);
+        const std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        const std::string_view version = line.substr(sp2 + 1);
+        if (req.method.empty() || target.empty() || version.substr(0, 7) != "HTTP/1.") return false;
+        const size_t q = target.find('?');
+        req.path = target.substr(0, q);
+        req.query = (q == std::string_view::npos) ? std::string_view() : target.substr(q + 1);
+        req.headers = (lineEnd < headEnd) ? buf.substr(lineEnd + 2, headEnd - lineEnd - 2) : std::string_view();
+
+        // HTTP/1.1 — keep-alive по умолчанию, HTTP/1.0 — только по явной просьбе
+        const std::string_view conn = req.header("Connection");
+        req.keepAlive = (version == "HTTP/1.1") ? !iequals(conn, "close") : iequals(conn, "keep-alive");
+
+        // Длина тела — только цифры целиком (header() уже снял пробелы): "12abc" или "5, 7" разошлись бы
+        // с клиентом в границах запросов на keep-alive подключении
+        size_t bodyLen = 0;
+        const std::string_view cl = req.header("Content-Length");
+        if (!cl.empty()) {
+            const std::from_chars_result r = std::from_chars(cl.data(), cl.data() + cl.size(), bodyLen);
+            if (r.ec != std::errc() || r.ptr != cl.data() + cl.size()) return false;
+        }
+        const size_t total = headEnd + 4 + bodyLen;
+        if (total > sizeof(c->in)) return false;
+        if (c->inLen < total) return true; // тело ещё не пришло целиком
+        req.body = buf.substr(headEnd + 4, bodyLen);
+
+        HttpResponse& resp = w->resp;
+        const uint64_t startNs = monotonicNs();
+        const size_t route = handle(req, resp);
+        _requests.fetch_add(1, std::memory_order_relaxed);
+        count(route, resp.status, monotonicNs() - startNs);
+
+        if (resp.websocket && resp.status == 200) {
+            const std::string_view key = req.header("Sec-WebSocket-Key");
+            if (iequals(req.header("Upgrade"), "websocket") && req.header("Sec-WebSocket-Version") == "13" &&
+                !key.empty() && key.size() <= 64) {
+                // Рукопожатие; кадры, пришедшие следом за запросом, разбираются сразу
+                c->out.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: ");
+                appendWsAccept(c->out, key);
+                c->out.append("\r\n\r\n");
+                if (!resp.body.empty()) {
+                    appendWsHeader(c->out, WS_TEXT, resp.body.size());
+                    c->out.append(resp.body);
+                }
+                c->ws = resp.websocket;
+                c->wsSession = 0;
+                if (resp.stream > 0 && resp.stream <= MAX_STREAM_TOPICS)
+                    subscribe(w, c, resp);
+                memmove(c->in, c->in + total, c->inLen - total);
+                c->inLen -= total;
+                processWsFrames(w, c);
+                break;
+            }
+            resp.status = 400;
+            resp.body = "<h1>400 Bad Request</h1>";
+            resp.stream = 0;
+        }
+
+        if (resp.chunked && resp.status == 200) {
+            // Ответ частями: HTTP/1.0 не знает chunked — тело до закрытия подключения
+            c->chunkFramed = (version == "HTTP/1.1");
+            c->chunkKeepAlive = req.keepAlive && c->chunkFramed;
+            c->out.append("HTTP/1.1 200 OK\r\nContent-Type: ");
+            c->out.append(resp.contentType);
+            c->out.append(c->chunkFramed ? "\r\nTransfer-Encoding: chunked" : "");
+            c->out.append(c->chunkKeepAlive ? "\r\nAccess-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\n"
+                                            : "\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n");
+            appendChunk(c->out, resp.body, c->chunkFramed);
+            c->chunk = resp.chunked;
+            memcpy(c->chunkState, resp.chunkState, sizeof(c->chunkState));
+            // Следующий запрос конвейера ждёт конца ответа
+            memmove(c->in, c->in + total, c->inLen - total);
+            c->inLen -= total;
+            break;
+        }
+
+        if (resp.stream > 0 && resp.stream <= MAX_STREAM_TOPICS && resp.status == 200) {
+            // Потоковый ответ: без Content-Length, подключение дальше только получает события темы
+            c->out.append("HTTP/1.1 200 OK\r\nContent-Type: ");
+            c->out.append(resp.contentType);
+            c->out.append("\r\nCache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\n");
+            c->out.append(resp.body);
+            subscribe(w, c, resp);
+            c->inLen = 0;
+            break;
+        }
+
+        char num[16];
+        c->out.append("HTTP/1.1 ");
+        c->out.append(num, std::to_chars(num, num + sizeof(num), resp.status).ptr);
+        c->out.push_back(' ');
+        c->out.append(statusText(resp.status));
+        c->out.append("\r\nContent-Type: ");
+        c->out.append(resp.contentType);
+        c->out.append("\r\nContent-Length: ");
+        c->out.append(num, std::to_chars(num, num + sizeof(num), resp.body.size()).ptr);
+        c->out.append(req.keepAlive ? "\r\nAccess-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\n"
+                                    : "\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n");
+        c->out.append(resp.body);
+
+        if (!req.keepAlive) {
+            c->closeAfter = true;
+            c->inLen = 0;
+            break;
+        }
+        // Следующий запрос (конвейер) сдвигаем в начало буфера
+        memmove(c->in, c->in + total, c->inLen - total);
+        c->inLen -= total;
+    }
+    return true;
+}
+
+void HttpServer::subscribe(Worker* w, Connection* c, const HttpResponse& resp)
+{
+    Topic& topic = _topics[resp.stream];
+    {
+        // Событие, опубликованное до подписки, уже учтено в body
+        std::lock_guard<std::mutex> lock(topic.mutex);
+        c->streamSeq = topic.seq;
+    }
+    topic.subscribers.fetch_add(1, std::memory_order_relaxed);
+    ++w->streams;
+    c->stream = resp.stream;
+    c->streamIntervalMs = resp.streamIntervalMs;
+    c->nextSendMs = monotonicMs() + resp.streamIntervalMs;
+}
+
+void HttpServer::processWsFrames(Worker* w, Connection* c)
+{
+    while (c->inLen >= 2 && !c->closeAfter) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(c->in);
+        const bool fin = p[0] & 0x80;
+        const uint8_t opcode = p[0] & 0x0F;
+        uint64_t len = p[1] & 0x7F;
+        size_t pos = 2;
+        if (len == 126) {
+            if (c->inLen < 4) return;
+            len = (uint64_t(p[2]) << 8) | p[3];
+            pos = 4;
+        } else if (len == 127) {
+            if (c->inLen < 10) return;
+            len = 0;
+            for (int i = 0; i < 8; ++i)
+                len = (len << 8) | p[2 + i];
+            pos = 10;
+        }
+        // Кадры клиента обязаны быть с маской; расширения (RSV) и фрагментация не поддерживаются
+        const bool control = opcode & 0x8;
+        if (!(p[1] & 0x80) || (p[0] & 0x70) || !fin || (control && len > 125) || len > sizeof(c->in) - pos - 4) {
+            appendWsClose(c->out, 1002);
+            c->closeAfter = true;
+            c->inLen = 0;
+            return;
+        }
+        const size_t total = pos + 4 + static_cast<size_t>(len);
+        if (c->inLen < total) return; // кадр ещё не пришёл целиком
+        uint8_t mask[4];
+        memcpy(mask, p + pos, 4);
+        char* payload = c->in + pos + 4;
+        for (size_t i = 0; i < len; ++i)
+            payload[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+
+        switch (opcode) {
+        case WS_TEXT:
+        case WS_BINARY: {
+            std::string& reply = w->wsReply;
+            reply.clear();
+            HttpWsMessage msg{ std::string_view(payload, static_cast<size_t>(len)), opcode == WS_BINARY, &c->wsSession, &reply };
+            c->ws(msg);
+            _wsMessages.fetch_add(1, std::memory_order_relaxed);
+            if (!reply.empty()) {
+                appendWsHeader(c->out, WS_BINARY, reply.size());
+                c->out.append(reply);
+            }
+            break;
+        }
+        case WS_PING:
+            appendWsHeader(c->out, WS_PONG, static_cast<size_t>(len));
+            c->out.append(payload, static_cast<size_t>(len));
+            break;
+        case WS_PONG:
+            break;
+        case WS_CLOSE:
+            // Отвечаем тем же кодом и закрываем после отправки
+            appendWsHeader(c->out, WS_CLOSE, len >= 2 ? 2 : 0);
+            if (len >= 2) c->out.append(payload, 2);
+            c->closeAfter = true;
+            c->inLen = 0;
+            return;
+        default:
+            appendWsClose(c->out, 1003);
+            c->closeAfter = true;
+            c->inLen = 0;
+            return;
+        }
+        memmove(c->in, c->in + total, c->inLen - total);
+        c->inLen -= total;
+    }
+}
+
+size_t HttpServer::handle(const HttpRequest& req, HttpResponse& resp) const
+{
+    resp.status = 200;
+    resp.contentType = "text/html";
+    resp.body.clear();
+    resp.stream = 0;
+    resp.streamIntervalMs = 0;
+    resp.websocket = nullptr;
+    resp.chunked = nullptr;
+    for (size_t i = 0; i < _routeCount; ++i) {
+        const HttpRoute& r = _routes[i];
+        const std::string_view path(r.path);
+        const bool match = r.prefix ? req.path.substr(0, path.size()) == path : req.path == path;
+        if (match) {
+            r.handler(req, resp);
+            return i;
+        }
+    }
+    resp.status = 404;
+    resp.body = "<h1>404 Not Found</h1>";
+    return _routeCount;
+}
+
+bool HttpServer::flush(Worker* w, Connection* c)
+{
+    // Клиент забирает ответ (большой chunked, медленное чтение) — подключение не простаивает.
+    // У WebSocket срок — живость клиента (ping/pong), наша отправка его не продлевает
+    const size_t startOff = c->outOff;
+    while (c->outOff < c->out.size()) {
+        const ssize_t r = send(c->fd, c->out.data() + c->outOff, c->out.size() - c->outOff, MSG_NOSIGNAL);
+        if (r > 0) {
+            // Одна метка времени на вызов, по первому продвижению; клиент, не читающий вовсе, закроется по сроку
+            if (c->outOff == startOff && !c->ws)
+                c->lastActiveMs = monotonicMs();
+            c->outOff += static_cast<size_t>(r);
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c->wantWrite) {
+                // Клиент не успевает читать: пока ответ не уйдёт, новые запросы не принимаем
+                c->wantWrite = true;
+                epoll_event ev{};
+                ev.events = EPOLLOUT;
+                ev.data.u64 = static_cast<uint64_t>(c - w->conns.data());
+                epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+            }
+            return true;
+        }
+        closeConnection(w, c);
+        return false;
+    }
+    c->out.clear();
+    c->outOff = 0;
+    if (c->closeAfter) {
+        closeConnection(w, c);
+        return false;
+    }
+    if (c->wantWrite) {
+        c->wantWrite = false;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = static_cast<uint64_t>(c - w->conns.data());
+        epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+    return true;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+// HTTP/1.1 сервер на epoll с keep-alive и фиксированным числом рабочих потоков.
+//
+// Каждый рабочий поток — свой epoll и свой слушающий сокет на общем порту (SO_REUSEPORT):
+// ядро само распределяет подключения, потоки ничего не делят и не создаются на подключение.
+// Подключения берутся из пула, заведённого при старте (буферы приёма и ответа переиспользуются);
+// если пул потока занят, новое подключение сразу закрывается.
+//
+// Разбор запроса — string_view по буферу подключения без копирования. Маршруты — статическая
+// таблица HttpRoute: точное совпадение пути или префикс. Обработчик заполняет HttpResponse
+// и вызывается в рабочем потоке, поэтому должен быть потокобезопасным и не блокироваться надолго
+//
+// Потоковые ответы (Server-Sent Events и т.п.): обработчик задаёт HttpResponse::stream — номер темы,
+// и подключение остаётся открытым. Издатель из любого потока вызывает publish(): событие копируется
+// один раз и раздаётся всем подключениям темы по ссылке. У каждого подключения своя ограниченная
+// очередь: медленный клиент теряет самые старые события, а не задерживает остальных и издателя
+//
+// WebSocket (RFC 6455): обработчик задаёт HttpResponse::websocket, и на запрос с Upgrade: websocket
+// сервер отвечает 101. Входящие сообщения (целые, без фрагментации) идут в HttpWsHandler, события
+// темы stream уходят клиенту текстовыми кадрами. Ping/pong и закрытие сервер ведёт сам
+//
+// Большие ответы частями (Transfer-Encoding: chunked): обработчик задаёт HttpResponse::chunked — генератор
+// частей. Следующая часть готовится, только когда сокет забрал предыдущую: ответ любого размера занимает
+// в памяти одну часть, а не целую строку
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;      // без строки запроса
+    std::string_view query;     // после '?', без него
+    std::string_view headers;   // строки заголовков как пришли, без стартовой строки
+    std::string_view body;
+    bool keepAlive;
+
+    // Значение параметра строки запроса как есть (без декодирования %XX); пусто, если параметра нет
+    std::string_view param(std::string_view name) const;
+    // Значение заголовка (имя без учёта регистра); пусто, если заголовка нет
+    std::string_view header(std::string_view name) const;
+};
+
+// Сообщение WebSocket от клиента; обработчик вызывается в рабочем потоке подключения
+struct HttpWsMessage {
+    std::string_view data;
+    bool binary;
+    uint64_t* session;          // слово состояния подключения: 0 после рукопожатия, дальше — как задаст обработчик
+    std::string* reply;         // ответ этому клиенту одним бинарным кадром; пусто — без ответа
+};
+
+typedef void (*HttpWsHandler)(HttpWsMessage& msg);
+
+// Генератор ответа частями: дописывает в out очередную часть (может ничего не дописать) и возвращает false,
+// если она последняя. state — курсор генератора: слова, заданные обработчиком в HttpResponse::chunkState.
+// Вызывается в рабочем потоке подключения
+static const unsigned HTTP_CHUNK_STATE_WORDS = 8;
+typedef bool (*HttpChunkFn)(uint64_t* state, std::string& out);
+
+struct HttpResponse {
+    int status;
+    const char* contentType;
+    std::string body;           // буфер рабочего потока: ёмкость сохраняется между запросами
+    // Потоковый ответ: тема 1..HttpServer::MAX_STREAM_TOPICS, 0 — обычный ответ. Заголовки уходят
+    // без Content-Length, body — первое событие, дальше подключение получает события темы
+    unsigned stream;
+    uint32_t streamIntervalMs;  // не чаще одного события за столько мс (отдаётся самое свежее); 0 — без ограничения
+    // WebSocket: обработчик входящих сообщений. Запрос без Upgrade: websocket получает 400;
+    // body (если не пуст) уходит первым текстовым кадром
+    HttpWsHandler websocket;
+    // Ответ частями: body — первая часть, дальше — генератор. Только для status 200
+    HttpChunkFn chunked;
+    uint64_t chunkState[HTTP_CHUNK_STATE_WORDS];
+};
+
+typedef void (*HttpHandler)(const HttpRequest& req, HttpResponse& resp);
+
+// Запросы одного маршрута: число и время обработчика (без приёма запроса и отправки ответа)
+struct HttpRouteStats {
+    // Корзины времени: верхние границы в мкс, последняя корзина — всё, что дольше
+    static const unsigned BUCKETS = 8;
+    static constexpr uint32_t BUCKET_US[BUCKETS - 1] = { 100, 500, 1000, 5000, 10000, 50000, 100000 };
+
+    uint64_t requests;
+    uint64_t durationUs;        // сумма
+    uint64_t buckets[BUCKETS];  // не накопленные: запрос попадает в одну корзину
+};
+
+struct HttpRoute {
+    const char* path;
+    bool prefix;                // true — path задаёт начало пути ("/api/command" и "/api/command/...")
+    HttpHandler handler;
+};
+
+class HttpServer
+{
+public:
+    // Размер буфера приёма подключения: запрос целиком (стартовая строка, заголовки, тело) должен в него уместиться
+    static const size_t REQUEST_BUFFER_SIZE = 8192;
+
+    HttpServer(const HttpRoute* routes, size_t routeCount);
+    ~HttpServer();
+
+    static const unsigned MAX_STREAM_TOPICS = 4;
+
+    // port = 0 — любой свободный порт (см. port()). Возвращает false, если порт занят.
+    // streamQueue — сколько событий ждёт отправки у одного потокового подключения
+    bool start(int port, unsigned workers = 2, unsigned maxConnectionsPerWorker = 64,
+               uint32_t idleTimeoutMs = 10000, unsigned streamQueue = 4);
+    void stop();
+
+    // Разослать событие подключениям темы. Из любого потока, но не одновременно со start()/stop()
+    void publish(unsigned topic, const char* data, size_t len);
+    // Потоковых подключений темы: без подписчиков издателю незачем готовить события
+    unsigned subscribers(unsigned topic) const;
+
+    int port() const { return _port; }
+
+    // Счётчики всех рабочих потоков
+    uint64_t requests() const { return _requests.load(std::memory_order_relaxed); }
+    uint64_t connections() const { return _connections.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return _rejected.load(std::memory_order_relaxed); }
+    // Событий, выброшенных у потоковых подключений (очередь полна или вытеснены более свежим)
+    uint64_t streamDropped() const { return _streamDropped.load(std::memory_order_relaxed); }
+    uint64_t wsMessages() const { return _wsMessages.load(std::memory_order_relaxed); }
+    // Маршрут index (как в таблице); index == routeCount() — запросы без маршрута (404). false — нет такого
+    bool routeStats(size_t index, HttpRouteStats& out) const;
+    size_t routeCount() const { return _routeCount; }
+    const HttpRoute& route(size_t index) const { return _routes[index]; }
+    // Ответов с кодом статуса класса 1..5 (2 — 2xx и т.д.)
+    uint64_t responses(unsigned statusClass) const
+    {
+        return statusClass < 6 ? _responses[statusClass].load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    struct Connection;
+    struct Worker;
+    struct RouteCounters;
+
+    // Последнее событие темы; seq растёт с каждым publish()
+    struct Topic {
+        std::mutex mutex;
+        std::shared_ptr<const std::string> event;
+        uint64_t seq = 0;
+        std::atomic<unsigned> subscribers{0};
+    };
+
+    const HttpRoute* _routes;
+    size_t _routeCount;
+    int _port;
+    uint32_t _idleTimeoutMs;
+    unsigned _streamQueue;
+    Topic _topics[MAX_STREAM_TOPICS + 1];
+    std::vector<Worker*> _workers;
+    std::atomic<uint64_t> _requests;
+    std::atomic<uint64_t> _connections;
+    std::atomic<uint64_t> _rejected;
+    std::atomic<uint64_t> _streamDropped;
+    std::atomic<uint64_t> _wsMessages;
+    std::atomic<uint64_t> _responses[6];
+    std::unique_ptr<RouteCounters[]> _routeCounters;    // _routeCount + 1
+
+    void run(Worker* w);
+    void acceptAll(Worker* w);
+    void onReadable(Worker* w, Connection* c);
+    bool flush(Worker* w, Connection* c);
+    void closeConnection(Worker* w, Connection* c);
+    // Разобрать все полные запросы из буфера c и дописать ответы; false — запрос неверный или слишком большой
+    bool processRequests(Worker* w, Connection* c);
+    // Возвращает номер маршрута (_routeCount — не найден)
+    size_t handle(const HttpRequest& req, HttpResponse& resp) const;
+    void count(size_t route, int status, uint64_t durationNs);
+    // Новые события тем — в очереди потоковых подключений
+    void collectEvents(Worker* w);
+    // Отдать очереди потоковых подключений сокетам; возвращает мс до ближайшей отложенной отправки
+    int pumpStreams(Worker* w, uint64_t now);
+    void pump(Worker* w, Connection* c, uint64_t now);
+    // Части ответа генератора, пока сокет их принимает; после последней — конвейерные запросы
+    void pumpChunks(Worker* w, Connection* c);
+    // Подписать подключение на тему resp.stream (после заголовков ответа)
+    void subscribe(Worker* w, Connection* c, const HttpResponse& resp);
+    // Разобрать все полные кадры WebSocket из буфера c; при ошибке протокола — кадр закрытия
+    void processWsFrames(Worker* w, Connection* c);
+};
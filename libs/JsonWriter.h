@@ -0,0 +1,145 @@
+#pragma once
+
+// Запись JSON в буфер вызывающего без выделения памяти и без локали.
+//
+// Числа — std::to_chars: целые как есть, double в формате %g с 6 значащими цифрами
+// (как operator<< по умолчанию), NaN и бесконечность — null. Запятые между элементами
+// ставятся сами. Если буфер кончился, запись прекращается и overflow() возвращает true.
+// to_chars для double есть в libstdc++ с GCC 11; на старых компиляторах (__cpp_lib_to_chars
+// не определён) double пишется через snprintf("%.6g") — то же, пока локаль процесса "C"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+class JsonWriter
+{
+public:
+    JsonWriter(char* buf, size_t size) : _buf(buf), _end(buf + size), _pos(buf), _comma(false), _overflow(false) {}
+
+    void beginObject() { separator(); put('{'); _comma = false; }
+    void endObject() { put('}'); _comma = true; }
+    void beginArray() { separator(); put('['); _comma = false; }
+    void endArray() { put(']'); _comma = true; }
+
+    // Имя поля в объекте; следом — значение или begin*
+    void key(const char* name)
+    {
+        separator();
+        string(name);
+        put(':');
+        _comma = false;
+    }
+
+    void value(bool v)
+    {
+        separator();
+        raw(v ? "true" : "false");
+        _comma = true;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    void value(T v)
+    {
+        separator();
+        // uint8_t/int8_t — числа, а не символы
+        number(static_cast<typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>(v));
+        _comma = true;
+    }
+
+    void value(double v)
+    {
+        separator();
+        if (std::isfinite(v))
+            real(v);
+        else
+            raw("null");
+        _comma = true;
+    }
+
+    void value(const char* s)
+    {
+        separator();
+        string(s);
+        _comma = true;
+    }
+
+    const char* data() const { return _buf; }
+    size_t size() const { return static_cast<size_t>(_pos - _buf); }
+    bool overflow() const { return _overflow; }
+
+private:
+    char* _buf;
+    char* _end;
+    char* _pos;
+    bool _comma;
+    bool _overflow;
+
+    void separator()
+    {
+        if (_comma) put(',');
+    }
+
+    void put(char c)
+    {
+        if (_pos < _end) *_pos++ = c;
+        else _overflow = true;
+    }
+
+    void raw(const char* s)
+    {
+        const size_t n = strlen(s);
+        if (static_cast<size_t>(_end - _pos) < n) { _overflow = true; _pos = _end; return; }
+        memcpy(_pos, s, n);
+        _pos += n;
+    }
+
+    template <typename... Args>
+    void number(Args... args)
+    {
+        const std::to_chars_result r = std::to_chars(_pos, _end, args...);
+        if (r.ec != std::errc()) { _overflow = true; _pos = _end; return; }
+        _pos = r.ptr;
+    }
+
+#if defined(__cpp_lib_to_chars)
+    void real(double v) { number(v, std::chars_format::general, 6); }
+#else
+    void real(double v)
+    {
+        char tmp[32];
+        const int n = snprintf(tmp, sizeof(tmp), "%.6g", v);
+        if (n < 0 || static_cast<size_t>(_end - _pos) < static_cast<size_t>(n)) {
+            _overflow = true;
+            _pos = _end;
+            return;
+        }
+        memcpy(_pos, tmp, static_cast<size_t>(n));
+        _pos += n;
+    }
+#endif
+
+    // Строка в кавычках: экранируются кавычка, обратная косая черта и управляющие символы
+    void string(const char* s)
+    {
+        put('"');
+        for (; *s; ++s) {
+            const unsigned char c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(static_cast<char>(c));
+            } else if (c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                raw("\\u00");
+                put(hex[c >> 4]);
+                put(hex[c & 0xF]);
+            } else {
+                put(static_cast<char>(c));
+            }
+        }
+        put('"');
+    }
+};
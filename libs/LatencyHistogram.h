@@ -0,0 +1,133 @@
+#pragma once
+
+// Гистограмма задержек в стиле HDR: ячейки лог-линейные, относительная ошибка значения не больше 1/32.
+//
+// Значения (нс) до 64 хранятся точно; дальше каждая степень двойки делится на SUB_BUCKETS равных ячеек.
+// Всё больше 2^MAX_BITS нс (~68 с) попадает в последнюю ячейку, max при этом точный.
+// Запись — несколько relaxed-атомиков без блокировок и без выделения памяти, можно из любого числа потоков.
+// Читатель (веб-сервер) снимает сводку, не мешая писателям; сброс с чтением забирает ячейки exchange(0),
+// поэтому отсчёт, пришедший во время сброса, попадает либо в снятую сводку, либо в следующую
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+
+class LatencyHistogram
+{
+public:
+    static const unsigned SUB_BITS = 5;
+    static const unsigned SUB_BUCKETS = 1u << SUB_BITS;
+    static const unsigned MAX_BITS = 36;
+    static const unsigned BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    // Сводка, все значения в нс; процентиль — верхняя граница ячейки (не больше max)
+    struct Summary {
+        uint64_t count;
+        uint64_t sumNs;
+        uint64_t meanNs;
+        uint64_t p50Ns;
+        uint64_t p99Ns;
+        uint64_t p999Ns;
+        uint64_t maxNs;
+    };
+
+    LatencyHistogram() : _count(0), _sumNs(0), _maxNs(0)
+    {
+        for (auto& b : _buckets)
+            b.store(0, std::memory_order_relaxed);
+    }
+
+    void record(uint64_t ns)
+    {
+        _buckets[index(ns)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = _maxNs.load(std::memory_order_relaxed);
+        while (ns > m && !_maxNs.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+
+    // Сводка за время с прошлого сброса
+    Summary summary() const
+    {
+        uint64_t counts[BUCKETS];
+        for (unsigned i = 0; i < BUCKETS; ++i)
+            counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        return summarize(counts, _count.load(std::memory_order_relaxed), _sumNs.load(std::memory_order_relaxed),
+                         _maxNs.load(std::memory_order_relaxed));
+    }
+    // То же со сбросом: ячейки забираются exchange(0), отсчёты писателей не теряются (см. выше)
+    Summary takeSummary()
+    {
+        uint64_t counts[BUCKETS];
+        for (unsigned i = 0; i < BUCKETS; ++i)
+            counts[i] = _buckets[i].exchange(0, std::memory_order_relaxed);
+        return summarize(counts, _count.exchange(0, std::memory_order_relaxed),
+                         _sumNs.exchange(0, std::memory_order_relaxed), _maxNs.exchange(0, std::memory_order_relaxed));
+    }
+
+    // Ячейка значения и наибольшее значение, попадающее в ячейку
+    static unsigned index(uint64_t ns)
+    {
+        if (ns < 2 * SUB_BUCKETS) return static_cast<unsigned>(ns);
+        unsigned e = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+        if (e >= MAX_BITS) return BUCKETS - 1;
+        return (e - SUB_BITS + 1) * SUB_BUCKETS + static_cast<unsigned>(ns >> (e - SUB_BITS)) - SUB_BUCKETS;
+    }
+    static uint64_t highestValue(unsigned index)
+    {
+        if (index < 2 * SUB_BUCKETS) return index;
+        const unsigned shift = index / SUB_BUCKETS - 1;
+        const uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return low + (1ull << shift) - 1;
+    }
+
+    static uint64_t monotonicNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+private:
+    std::atomic<uint64_t> _buckets[BUCKETS];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sumNs;
+    std::atomic<uint64_t> _maxNs;
+
+    static Summary summarize(const uint64_t* counts, uint64_t count, uint64_t sumNs, uint64_t maxNs)
+    {
+        Summary s;
+        s.count = count;
+        s.sumNs = sumNs;
+        s.meanNs = count ? sumNs / count : 0;
+        s.maxNs = maxNs;
+        uint64_t total = 0;
+        for (unsigned i = 0; i < BUCKETS; ++i)
+            total += counts[i];
+        // Три процентиля за один проход: ранг — первый отсчёт, на котором накопленная доля не меньше q
+        const double qs[3] = { 0.5, 0.99, 0.999 };
+        uint64_t* out[3] = { &s.p50Ns, &s.p99Ns, &s.p999Ns };
+        unsigned q = 0;
+        uint64_t seen = 0;
+        for (unsigned i = 0; i < BUCKETS && q < 3; ++i) {
+            seen += counts[i];
+            while (q < 3 && counts[i] && seen >= rank(total, qs[q])) {
+                const uint64_t v = highestValue(i);
+                *out[q++] = v < maxNs ? v : maxNs;
+            }
+        }
+        for (; q < 3; ++q)
+            *out[q] = 0;
+        return s;
+    }
+
+    static uint64_t rank(uint64_t total, double q)
+    {
+        const uint64_t r = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+        return r ? r : 1;
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+// Seqlock: один писатель публикует значение, читатели из других потоков забирают согласованную копию.
+//
+// Писатель не ждёт никогда (wait-free): нечётный номер версии — запись идёт, чётный — значение целое.
+// Читатель копирует значение и повторяет, если версия изменилась за время копирования.
+// Данные хранятся 64-битными словами в std::atomic с relaxed-доступом, поэтому одновременные
+// чтение и запись не являются гонкой данных; порядок задают барьеры вокруг номера версии.
+// T — тривиально копируемая структура без указателей на изменяемые данные писателя.
+//
+// Читатели могут спать до следующей записи (waitChange, futex на номере версии). Писатель будит их
+// системным вызовом только если кто-то ждёт: без ожидающих запись стоит один барьер и одно чтение
+//
+// Shared = true — объект лежит в разделяемой памяти и читатели в других процессах (futex без _PRIVATE).
+// Тогда он создаётся размещающим new в отображённом сегменте; атомарные слова без блокировок от адреса не зависят
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <type_traits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+template <typename T, bool Shared = false>
+class Seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock: T должен быть тривиально копируемым");
+
+public:
+    Seqlock() : _seq(0), _waiters(0)
+    {
+        for (auto& w : _words)
+            w.store(0, std::memory_order_relaxed);
+    }
+
+    // Только из одного потока-писателя. Нечётная версия на входе — прежний писатель (другой процесс при Shared)
+    // умер посреди записи: эта запись её завершает, читатели порванную копию так и не увидят
+    void write(const T& value)
+    {
+        uint64_t buf[WORDS] = {};
+        memcpy(buf, &value, sizeof(T));
+        const uint32_t seq = _seq.load(std::memory_order_relaxed) | 1;
+        _seq.store(seq, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (unsigned i = 0; i < WORDS; ++i)
+            _words[i].store(buf[i], std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_release);
+        // Новая версия видна раньше, чем проверяется счётчик ожидающих (пара к fetch_add в waitChange)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_relaxed) > 0)
+            syscall(SYS_futex, futexWord(), WAKE_OP, INT32_MAX, nullptr, nullptr, 0);
+    }
+
+    // Одна попытка: false — копия могла порваться (писатель работал), нужно повторить.
+    // version — номер записи (как version()), копия которой прочитана
+    bool tryRead(T& out, uint32_t* version = nullptr) const
+    {
+        const uint32_t seq0 = _seq.load(std::memory_order_acquire);
+        if (seq0 & 1) return false;
+        uint64_t buf[WORDS];
+        for (unsigned i = 0; i < WORDS; ++i)
+            buf[i] = _words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_seq.load(std::memory_order_relaxed) != seq0) return false;
+        memcpy(&out, buf, sizeof(T));
+        if (version) *version = seq0 >> 1;
+        return true;
+    }
+
+    // Повторять, пока копия не окажется целой. retries — сколько попыток пришлось повторить.
+    // Писатель в том же процессе; если он в другом и может умереть посреди записи — только tryRead
+    T read(uint32_t* retries = nullptr) const
+    {
+        T out;
+        uint32_t n = 0;
+        while (!tryRead(out))
+            ++n;
+        if (retries) *retries += n;
+        return out;
+    }
+
+    // Число завершённых записей
+    uint32_t version() const { return _seq.load(std::memory_order_acquire) >> 1; }
+
+    // Ждать записи новее version не дольше timeoutMs. true — версия уже другая.
+    // Возможны ложные пробуждения: вызывающий проверяет результат и при необходимости ждёт снова
+    bool waitChange(uint32_t version, uint32_t timeoutMs) const
+    {
+        const uint32_t seq = _seq.load(std::memory_order_acquire);
+        if ((seq >> 1) != version) return true;
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (_seq.load(std::memory_order_seq_cst) == seq) {
+            timespec ts;
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+            // Ядро само сравнит слово с seq: запись между проверкой и сном не теряется
+            syscall(SYS_futex, futexWord(), WAIT_OP, seq, &ts, nullptr, 0);
+        }
+        _waiters.fetch_sub(1, std::memory_order_relaxed);
+        return this->version() != version;
+    }
+
+private:
+    static constexpr unsigned WORDS = (sizeof(T) + 7) / 8;
+    static constexpr int WAIT_OP = Shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    static constexpr int WAKE_OP = Shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Seqlock: слова данных без блокировок");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+                  "Seqlock: futex требует atomic<uint32_t> без блокировки");
+
+    std::atomic<uint32_t> _seq;
+    mutable std::atomic<uint32_t> _waiters;
+    std::atomic<uint64_t> _words[WORDS];
+
+    uint32_t* futexWord() const { return reinterpret_cast<uint32_t*>(const_cast<std::atomic<uint32_t>*>(&_seq)); }
+};
@@ -1,8 +1,11 @@
 #include "SerialPort.h"
+#include "pty.h"
 
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <linux/serial.h>
 #include <asm/termbits.h>
 #include <cerrno>
@@ -10,23 +13,45 @@
 
 // Реализация SerialPort для Linux с termios2
 
+// Пустое чтение: при VMIN=0/VTIME=0 tty возвращает 0, с O_NONBLOCK — EAGAIN
+static inline bool noData(ssize_t r) {
+    return r == 0 || (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+}
+
 SerialPort::SerialPort(const std::string &path, uint32_t baud)
-    : _path(path), _baud(baud), _fd(-1) {}
+    : _path(path), _baud(baud), _fd(-1), _readCalls(0), _waitCalls(0), _drained(false),
+      _profile(Profile::NonBlocking), _deadlineUs(0), _lowLatencyActive(false) {}
 
 SerialPort::~SerialPort() { close(); }
 
 bool SerialPort::open() {
     if (_fd >= 0) return true;
+    _readCalls = 0;
+    _waitCalls = 0;
+    _drained = false;
     _fd = ::open(_path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
     if (_fd < 0) {
         return false; // не удалось открыть устройство
     }
 
-    // Сбрасываем флаг O_NONBLOCK после открытия
-    int flags = fcntl(_fd, F_GETFL, 0);
-    if (flags >= 0) fcntl(_fd, F_SETFL, flags & ~O_NONBLOCK);
+    return configure();
+}
 
-    if (!configureTermios2(_baud)) {
+bool SerialPort::openPty(std::string &peerPath) {
+    if (_fd >= 0) return false;
+    _readCalls = 0;
+    _waitCalls = 0;
+    _drained = false;
+    if (!pty_open(_fd, peerPath)) {
+        _fd = -1;
+        return false;
+    }
+    // termios-запросы к master применяются к slave: вторая сторона сразу получает сырой режим
+    return configure();
+}
+
+bool SerialPort::configure() {
+    if (!configureTermios2(_baud) || !applyProfile()) {
         close();
         return false;
     }
@@ -54,9 +79,10 @@ bool SerialPort::configureTermios2(uint32_t baud) {
     tio2.c_ispeed = baud;
     tio2.c_ospeed = baud;
 
-    // Минимум один байт, таймаут ~10мс
+    // Никаких ожиданий на уровне termios: VTIME квантуется по 100 мс и блокировал бы цикл
+    // на тихой линии. Ограниченное ожидание, если нужно, делает профиль BoundedBlocking
     tio2.c_cc[VMIN] = 0;
-    tio2.c_cc[VTIME] = 1;
+    tio2.c_cc[VTIME] = 0;
 
     if (ioctl(_fd, TCSETS2, &tio2) < 0) return false;
 
@@ -66,21 +92,51 @@ bool SerialPort::configureTermios2(uint32_t baud) {
 }
 
 int SerialPort::readByte(uint8_t &b) {
-    uint8_t tmp;
-    int r = ::read(_fd, &tmp, 1);
-    if (r == 1) { b = tmp; return 1; }
-    return r;
+    return read(&b, 1);
 }
 
 int SerialPort::read(uint8_t *buf, size_t len) {
-    return ::read(_fd, buf, len);
+    ++_readCalls;
+    ssize_t r = ::read(_fd, buf, len);
+    if (noData(r)) {
+        if (!waitReadable()) return 0;
+        ++_readCalls;
+        r = ::read(_fd, buf, len);
+        if (noData(r)) return 0;
+    }
+    return static_cast<int>(r);
+}
+
+int SerialPort::readBulk(uint8_t *first, size_t firstLen, uint8_t *second, size_t secondLen) {
+    struct iovec iov[2];
+    int cnt = 0;
+    if (firstLen > 0) { iov[cnt].iov_base = first; iov[cnt].iov_len = firstLen; ++cnt; }
+    if (secondLen > 0) { iov[cnt].iov_base = second; iov[cnt].iov_len = secondLen; ++cnt; }
+    if (cnt == 0) return 0;
+
+    // Прошлое чтение забрало у драйвера всё: новое сразу почти наверняка пустое, поэтому с ожиданием
+    // (BoundedBlocking) сначала ждём данных — на кадр один ppoll и один readv вместо лишнего пустого readv
+    if (_drained && waits() && !waitReadable()) return 0;
+    ++_readCalls;
+    ssize_t r = ::readv(_fd, iov, cnt);
+    if (noData(r)) {
+        _drained = true;
+        if (!waitReadable()) return 0;
+        ++_readCalls;
+        r = ::readv(_fd, iov, cnt);
+        if (noData(r)) return 0;
+    }
+    _drained = r > 0 && static_cast<size_t>(r) < firstLen + secondLen;
+    return static_cast<int>(r);
 }
 
 int SerialPort::write(const uint8_t *buf, size_t len) {
+    if (_fd < 0) return -1;
     return ::write(_fd, buf, len);
 }
 
 int SerialPort::writeByte(uint8_t b) {
+    if (_fd < 0) return -1;
     return ::write(_fd, &b, 1);
 }
 
@@ -89,4 +145,43 @@ void SerialPort::flush() {
     ioctl(_fd, TCFLSH, TCIOFLUSH);
 }
 
+bool SerialPort::setProfile(Profile profile, uint32_t deadlineUs) {
+    _profile = profile;
+    _deadlineUs = deadlineUs;
+    return _fd < 0 || applyProfile();
+}
+
+bool SerialPort::applyProfile() {
+    // Во всех профилях дескриптор неблокирующий: ожидание (если есть) делает ppoll с точным сроком
+    int flags = fcntl(_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(_fd, F_SETFL, flags | O_NONBLOCK) != 0) return false;
+    // Флаг драйвера только включаем: в других профилях его могли выставить снаружи (udev, setserial)
+    _lowLatencyActive = false;
+    if (_profile == Profile::LowLatency) enableLowLatency();
+    return true;
+}
+
+bool SerialPort::enableLowLatency() {
+    // ASYNC_LOW_LATENCY: драйвер отдаёт байты сразу, без отложенной передачи в line discipline.
+    // Поддерживается не всеми драйверами (pty, часть USB-UART) — тогда тихо работаем без него
+    struct serial_struct ss;
+    if (ioctl(_fd, TIOCGSERIAL, &ss) != 0) return false;
+    ss.flags |= ASYNC_LOW_LATENCY;
+    _lowLatencyActive = ioctl(_fd, TIOCSSERIAL, &ss) == 0;
+    return _lowLatencyActive;
+}
+
+bool SerialPort::waitReadable() {
+    // Ждём данных только в профиле BoundedBlocking и не дольше _deadlineUs
+    if (!waits()) return false;
+    ++_waitCalls;
+    struct pollfd pfd;
+    pfd.fd = _fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    struct timespec ts;
+    ts.tv_sec = _deadlineUs / 1000000;
+    ts.tv_nsec = static_cast<long>(_deadlineUs % 1000000) * 1000;
+    return ppoll(&pfd, 1, &ts, nullptr) > 0;
+}
 
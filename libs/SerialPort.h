@@ -9,27 +9,67 @@
 
 class SerialPort {
 public:
+    // Профили ввода-вывода.
+    //   NonBlocking     — O_NONBLOCK, VMIN=0/VTIME=0: чтение никогда не ждёт (по умолчанию; ожидание — в epoll)
+    //   BoundedBlocking — чтение ждёт данных не дольше заданного срока в мкс (ppoll), затем возвращает 0
+    //   LowLatency      — как NonBlocking плюс ASYNC_LOW_LATENCY драйвера (TIOCSSERIAL), если драйвер поддерживает.
+    //                     Другие профили флаг драйвера не трогают: выставленный снаружи (udev, setserial) остаётся
+    enum class Profile { NonBlocking, BoundedBlocking, LowLatency };
+
     // Конструктор: path — например "/dev/ttyAMA0" или "/dev/ttyS0"
     SerialPort(const std::string &path, uint32_t baud);
     ~SerialPort();
 
     bool isOpen() const { return _fd >= 0; }
+    // Дескриптор порта (для epoll), -1 если порт закрыт
+    int fd() const { return _fd; }
     bool open();
+    // Открыть master-сторону нового псевдотерминала вместо UART (тесты и бенчмарки без железа).
+    // peerPath — путь slave-стороны (/dev/pts/N): его открывает вторая сторона как обычный UART
+    bool openPty(std::string &peerPath);
     void close();
 
-    // Неблокирующее чтение/запись (по умолчанию блокирующее с таймаутами через termios)
+    // Чтение/запись. Ожидание чтения определяется профилем; 0 — данных нет, -1 — ошибка
     int readByte(uint8_t &b);
     int read(uint8_t *buf, size_t len);
     int write(const uint8_t *buf, size_t len);
     int writeByte(uint8_t b);
 
+    // Пакетное чтение: одним системным вызовом (readv) забирает всё, что накопил драйвер,
+    // в два непрерывных участка (хвост и начало кольцевого буфера).
+    // Возвращает число прочитанных байт, 0 — данных нет, -1 — ошибка
+    int readBulk(uint8_t *first, size_t firstLen, uint8_t *second = nullptr, size_t secondLen = 0);
+
+    // Количество системных вызовов read/readv и ожиданий ppoll (BoundedBlocking) с момента открытия (для бенчмарков)
+    uint64_t readCalls() const { return _readCalls; }
+    uint64_t waitCalls() const { return _waitCalls; }
+
     void flush();
 
+    // Выбрать профиль ввода-вывода. deadlineUs — срок ожидания для BoundedBlocking.
+    // Можно вызывать до open(): профиль применится при открытии.
+    // Для LowLatency возвращает true, даже если драйвер не поддерживает флаг — см. lowLatencyActive()
+    bool setProfile(Profile profile, uint32_t deadlineUs = 0);
+    Profile profile() const { return _profile; }
+    // Удалось ли включить ASYNC_LOW_LATENCY в драйвере профилем LowLatency
+    bool lowLatencyActive() const { return _lowLatencyActive; }
+
 private:
     std::string _path;
     uint32_t _baud;
     int _fd;
+    uint64_t _readCalls;
+    uint64_t _waitCalls;
+    bool _drained;          // прошлое readBulk() забрало у драйвера всё
+    Profile _profile;
+    uint32_t _deadlineUs;
+    bool _lowLatencyActive;
     bool configureTermios2(uint32_t baud);
+    bool configure();
+    bool applyProfile();
+    bool enableLowLatency();
+    bool waitReadable();
+    bool waits() const { return _profile == Profile::BoundedBlocking && _deadlineUs != 0; }
 };
 
 
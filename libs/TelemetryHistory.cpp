@@ -0,0 +1,189 @@
+#include "TelemetryHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include "crsf/CrsfSerial.h"
+
+static_assert(TelemetryHistory::COLUMNS <= 32, "маска колонок — uint32_t");
+
+const TelemetryHistory::ColumnInfo TelemetryHistory::columns[COLUMNS] = {
+    { "linkUp", "linkUp", 0 },
+    { "packetsReceived", "packetsReceived", 0 },
+    { "packetsSent", "packetsSent", 0 },
+    { "packetsLost", "packetsLost", 0 },
+    { "latitude", "gps", 7 },
+    { "longitude", "gps", 7 },
+    { "altitude", "gps", 0 },
+    { "speed", "gps", 1 },
+    { "voltage", "battery", 2 },
+    { "current", "battery", 0 },
+    { "capacity", "battery", 0 },
+    { "remaining", "battery", 0 },
+    { "roll", "attitude", 3 },
+    { "pitch", "attitude", 3 },
+    { "yaw", "attitude", 3 },
+    { "ch1", "channels", 0 }, { "ch2", "channels", 0 }, { "ch3", "channels", 0 }, { "ch4", "channels", 0 },
+    { "ch5", "channels", 0 }, { "ch6", "channels", 0 }, { "ch7", "channels", 0 }, { "ch8", "channels", 0 },
+    { "ch9", "channels", 0 }, { "ch10", "channels", 0 }, { "ch11", "channels", 0 }, { "ch12", "channels", 0 },
+    { "ch13", "channels", 0 }, { "ch14", "channels", 0 }, { "ch15", "channels", 0 }, { "ch16", "channels", 0 },
+};
+
+static int32_t fixed(double v, double scale)
+{
+    return static_cast<int32_t>(std::lround(v * scale));
+}
+
+uint64_t TelemetryHistory::monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+TelemetryHistory::TelemetryHistory(size_t capacity)
+    : _capacity(std::max<size_t>(capacity, 1)),
+      _time(new std::atomic<uint64_t>[_capacity]()),
+      _values(new std::atomic<int32_t>[_capacity * COLUMNS]()),
+      _begin(0), _count(0)
+{
+}
+
+void TelemetryHistory::record(uint64_t timeNs, const CrsfTelemetry& t)
+{
+    int32_t v[COLUMNS];
+    // Те же величины, что у /api/telemetry (updateTelemetry в telemetry_server.cpp), в фиксированной точке
+    v[LINK_UP] = t.linkUp ? 1 : 0;
+    v[PACKETS_RECEIVED] = t.linkStatistics.uplink_RSSI_1;
+    v[PACKETS_SENT] = t.linkStatistics.uplink_RSSI_2;
+    v[PACKETS_LOST] = 100 - t.linkStatistics.uplink_Link_quality;
+    v[LATITUDE] = t.gps.latitude;
+    v[LONGITUDE] = t.gps.longitude;
+    v[ALTITUDE] = static_cast<int32_t>(t.gps.altitude) - 1000;
+    v[SPEED] = t.gps.groundspeed;
+    v[VOLTAGE] = fixed(t.batteryVoltage, 100.0);
+    v[CURRENT] = fixed(t.batteryCurrent, 1.0);
+    v[CAPACITY] = fixed(t.batteryCapacity, 1.0);
+    v[REMAINING] = t.batteryRemaining;
+    v[ROLL] = fixed(t.attitudeRoll, 1000.0);
+    v[PITCH] = fixed(t.attitudePitch, 1000.0);
+    v[YAW] = fixed(t.attitudeYaw, 1000.0);
+    for (unsigned ch = 0; ch < 16; ++ch)
+        v[CHANNEL_1 + ch] = t.channels[ch];
+
+    const uint64_t n = _count.load(std::memory_order_relaxed);
+    // Сначала объявляем слот занятым: читатель, заставший запись, сверит begin и выбросит копию
+    _begin.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const size_t slot = static_cast<size_t>(n % _capacity);
+    _time[slot].store(timeNs, std::memory_order_relaxed);
+    for (unsigned c = 0; c < COLUMNS; ++c)
+        _values[c * _capacity + slot].store(v[c], std::memory_order_relaxed);
+    _count.store(n + 1, std::memory_order_release);
+}
+
+uint64_t TelemetryHistory::oldest() const
+{
+    // Слот, который писатель сейчас переписывает, уже не в счёт
+    return std::min(safeFrom(_begin.load(std::memory_order_acquire)), count());
+}
+
+uint64_t TelemetryHistory::timeAt(uint64_t index) const
+{
+    if (index >= count()) return 0;
+    const uint64_t t = _time[index % _capacity].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return index >= safeFrom(_begin.load(std::memory_order_relaxed)) ? t : 0;
+}
+
+uint64_t TelemetryHistory::lowerBound(uint64_t timeNs) const
+{
+    // Метки не убывают: двоичный поиск. Отсчёт, затёртый во время поиска, считается сколь угодно старым —
+    // граница сдвигается к новым, read() всё равно проверит копии
+    uint64_t lo = oldest();
+    uint64_t hi = count();
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (timeAt(mid) < timeNs) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t TelemetryHistory::read(uint64_t& index, uint64_t endIndex, uint64_t endNs, uint32_t mask, Sample* out,
+                              size_t max, uint64_t& overwritten) const
+{
+    unsigned cols[COLUMNS];
+    unsigned ncols = 0;
+    for (unsigned c = 0; c < COLUMNS; ++c)
+        if (mask & (1u << c)) cols[ncols++] = c;
+
+    for (;;) {
+        const uint64_t count = std::min(_count.load(std::memory_order_acquire), endIndex);
+        const uint64_t from = std::min(safeFrom(_begin.load(std::memory_order_relaxed)), endIndex);
+        if (index < from) {
+            overwritten += from - index;
+            index = from;
+        }
+        size_t n = 0;
+        uint64_t i = index;
+        for (; i < count && n < max; ++i, ++n) {
+            const size_t slot = static_cast<size_t>(i % _capacity);
+            const uint64_t t = _time[slot].load(std::memory_order_relaxed);
+            if (t >= endNs) break;
+            out[n].timeNs = t;
+            for (unsigned k = 0; k < ncols; ++k)
+                out[n].values[cols[k]] = _values[cols[k] * _capacity + slot].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t safe = std::min(safeFrom(_begin.load(std::memory_order_relaxed)), endIndex);
+        if (safe <= index) {
+            index = i;
+            return n;
+        }
+        // Писатель обогнал читателя: копии до safe недостоверны (и решение остановиться по метке — тоже)
+        if (safe >= i) {
+            overwritten += safe - index;
+            index = safe;
+            continue;
+        }
+        const size_t lost = static_cast<size_t>(safe - index);
+        memmove(out, out + lost, (n - lost) * sizeof(Sample));
+        overwritten += lost;
+        index = i;
+        return n - lost;
+    }
+}
+
+bool TelemetryHistory::aggregate(uint64_t& index, uint64_t endIndex, uint64_t endNs, uint32_t mask, Bucket& out,
+                                 uint64_t& overwritten) const
+{
+    unsigned cols[COLUMNS];
+    unsigned ncols = 0;
+    for (unsigned c = 0; c < COLUMNS; ++c)
+        if (mask & (1u << c)) cols[ncols++] = c;
+
+    // Пачками по стеку: интервал любой длины сворачивается без выделения памяти
+    Sample batch[64];
+    out.count = 0;
+    size_t n;
+    while ((n = read(index, endIndex, endNs, mask, batch, sizeof(batch) / sizeof(batch[0]), overwritten)) > 0) {
+        size_t i = 0;
+        if (out.count == 0) {
+            out.firstNs = batch[0].timeNs;
+            for (unsigned k = 0; k < ncols; ++k)
+                out.min[cols[k]] = out.max[cols[k]] = batch[0].values[cols[k]];
+            i = 1;
+        }
+        for (; i < n; ++i)
+            for (unsigned k = 0; k < ncols; ++k) {
+                const int32_t v = batch[i].values[cols[k]];
+                out.min[cols[k]] = std::min(out.min[cols[k]], v);
+                out.max[cols[k]] = std::max(out.max[cols[k]], v);
+            }
+        out.count += static_cast<uint32_t>(n);
+        out.lastNs = batch[n - 1].timeNs;
+    }
+    return out.count > 0;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// История снимков телеметрии: кольцо фиксированной ёмкости, заведённое при старте, по колонкам.
+//
+// Отсчёт — метка CLOCK_MONOTONIC (нс) и значения колонок целыми в фиксированной точке
+// (число знаков после запятой — TelemetryHistory::columns[i].decimals): координаты, напряжение и углы
+// хранятся без потерь точности источника, а чтение одной колонки не тянет в кэш остальные.
+//
+// Пишет один поток (главный цикл), читают любые (веб-сервер) без блокировок. Писатель помечает слот
+// занятым до записи (begin) и публикует отсчёт после (count); читатель, сверив begin после копии,
+// выбрасывает отсчёты, которые писатель успел затереть, и считает их (overwritten)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct CrsfTelemetry;
+
+class TelemetryHistory
+{
+public:
+    enum Column : unsigned {
+        LINK_UP,
+        PACKETS_RECEIVED,
+        PACKETS_SENT,
+        PACKETS_LOST,
+        LATITUDE,
+        LONGITUDE,
+        ALTITUDE,
+        SPEED,
+        VOLTAGE,
+        CURRENT,
+        CAPACITY,
+        REMAINING,
+        ROLL,
+        PITCH,
+        YAW,
+        CHANNEL_1,
+        COLUMNS = CHANNEL_1 + 16,
+    };
+
+    struct ColumnInfo {
+        const char* name;       // как в JSON /api/history
+        const char* field;      // поле /api/telemetry, к которому относится колонка (для fields=)
+        uint8_t decimals;       // значение = целое / 10^decimals
+    };
+    static const ColumnInfo columns[COLUMNS];
+
+    // Отсчёт из read(): заполнены только колонки из mask
+    struct Sample {
+        uint64_t timeNs;
+        int32_t values[COLUMNS];
+    };
+
+    // Сводка отсчётов из aggregate(): min и max по колонкам из mask
+    struct Bucket {
+        uint32_t count;
+        uint64_t firstNs;
+        uint64_t lastNs;
+        int32_t min[COLUMNS];
+        int32_t max[COLUMNS];
+    };
+
+    explicit TelemetryHistory(size_t capacity);
+
+    // Только из одного потока; timeNs не убывает от отсчёта к отсчёту
+    void record(uint64_t timeNs, const CrsfTelemetry& t);
+
+    size_t capacity() const { return _capacity; }
+    // Номер следующего отсчёта (всего записано)
+    uint64_t count() const { return _count.load(std::memory_order_acquire); }
+    // Номер самого старого отсчёта, который ещё не затирается
+    uint64_t oldest() const;
+    // Номер первого отсчёта не раньше timeNs (count(), если таких нет)
+    uint64_t lowerBound(uint64_t timeNs) const;
+    // Метка отсчёта index; 0 — отсчёт затёрт или ещё не записан
+    uint64_t timeAt(uint64_t index) const;
+
+    // Скопировать до max отсчётов из [index, endIndex) с меткой раньше endNs; index сдвигается за последний.
+    // Затёртые писателем отсчёты пропускаются и добавляются к overwritten. 0 — больше таких отсчётов нет
+    size_t read(uint64_t& index, uint64_t endIndex, uint64_t endNs, uint32_t mask, Sample* out, size_t max,
+                uint64_t& overwritten) const;
+    // Свернуть все такие отсчёты в out (min/max по колонкам mask); false — ни одного отсчёта
+    bool aggregate(uint64_t& index, uint64_t endIndex, uint64_t endNs, uint32_t mask, Bucket& out,
+                   uint64_t& overwritten) const;
+
+    // CLOCK_MONOTONIC, нс
+    static uint64_t monotonicNs();
+
+private:
+    size_t _capacity;
+    std::unique_ptr<std::atomic<uint64_t>[]> _time;
+    // Колонки подряд: колонка c — [c * capacity, (c + 1) * capacity)
+    std::unique_ptr<std::atomic<int32_t>[]> _values;
+    std::atomic<uint64_t> _begin;   // номер отсчёта, запись которого начата (+1)
+    std::atomic<uint64_t> _count;   // номер отсчёта, запись которого закончена (+1)
+
+    // Первый отсчёт, который писатель ещё не начал затирать, при данном begin
+    uint64_t safeFrom(uint64_t begin) const { return begin > _capacity ? begin - _capacity : 0; }
+};
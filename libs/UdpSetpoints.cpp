@@ -0,0 +1,212 @@
+#include "UdpSetpoints.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+// Счётчики пишет один поток: чтение-запись без блокирующей шины, читатели видят целые значения
+template <typename T>
+static void bump(std::atomic<T>& counter, T by = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+static uint16_t readU16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static uint32_t readU32(const uint8_t* p) { return uint32_t(readU16(p)) | (uint32_t(readU16(p + 2)) << 16); }
+static uint64_t readU64(const uint8_t* p) { return uint64_t(readU32(p)) | (uint64_t(readU32(p + 4)) << 32); }
+
+uint64_t UdpSetpoints::monotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+UdpSetpoints::UdpSetpoints(uint32_t maxAgeMs)
+    : _fd(-1), _maxAgeNs(static_cast<uint64_t>(maxAgeMs) * 1000000ull), _sourceCount(0), _rejected(0)
+{
+    for (Source& s : _sources) {
+        s.address = 0;
+        s.port = 0;
+        s.received = 0;
+        s.accepted = 0;
+        s.dropped = 0;
+        s.late = 0;
+        s.lastSeq = 0;
+        s.frames = 0;
+        s.latencySumUs = 0;
+        s.latencyMaxUs = 0;
+        s.latencyLastUs = 0;
+        s.lastSeenNs = 0;
+        s.pendingNs = 0;
+        s.haveSeq = false;
+    }
+}
+
+UdpSetpoints::~UdpSetpoints() { close(); }
+
+bool UdpSetpoints::open(uint16_t port, const char* bindAddress)
+{
+    close();
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bindAddress, &addr.sin_addr) != 1) return false;
+
+    _fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_fd < 0) return false;
+    if (bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSetpoints::close()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+int UdpSetpoints::poll(ApplyFn apply, void* ctx)
+{
+    if (_fd < 0) return 0;
+    // Пачка за один системный вызов: при 250 Гц от нескольких источников между тиками копится несколько датаграмм
+    static const int BATCH = 16;
+    uint8_t bufs[BATCH][UDP_SETPOINT_SIZE + 1];
+    sockaddr_in from[BATCH];
+    iovec iov[BATCH];
+    mmsghdr msgs[BATCH];
+    int accepted = 0;
+    for (;;) {
+        for (int i = 0; i < BATCH; ++i) {
+            iov[i].iov_base = bufs[i];
+            iov[i].iov_len = sizeof(bufs[i]);
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        }
+        const int n = recvmmsg(_fd, msgs, BATCH, MSG_DONTWAIT, nullptr);
+        if (n <= 0) break;
+        const uint64_t nowNs = monotonicNs();
+        for (int i = 0; i < n; ++i) {
+            // Обрезанная датаграмма (MSG_TRUNC) длиннее формата — неверная
+            const size_t len = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? sizeof(bufs[i]) : msgs[i].msg_len;
+            if (ingest(bufs[i], len, from[i].sin_addr.s_addr, ntohs(from[i].sin_port), nowNs, apply, ctx))
+                ++accepted;
+        }
+        if (n < BATCH) break;
+    }
+    return accepted;
+}
+
+UdpSetpoints::Source* UdpSetpoints::findSource(uint32_t address, uint16_t port, uint64_t nowNs)
+{
+    const int count = _sourceCount.load(std::memory_order_relaxed);
+    Source* idle = nullptr;
+    for (int i = 0; i < count; ++i) {
+        Source& s = _sources[i];
+        if (s.address.load(std::memory_order_relaxed) == address && s.port.load(std::memory_order_relaxed) == port)
+            return &s;
+        if (nowNs - s.lastSeenNs > SOURCE_RESET_MS * 1000000ull && (!idle || s.lastSeenNs < idle->lastSeenNs))
+            idle = &s;
+    }
+    Source* s = nullptr;
+    if (count < MAX_SOURCES) {
+        s = &_sources[count];
+    } else if (idle) {
+        // Таблица занята: место отдаём самому давно молчащему источнику (перезапущенный отправитель — новый порт)
+        s = idle;
+    } else {
+        bump(_rejected, uint64_t(1));
+        return nullptr;
+    }
+    s->address.store(address, std::memory_order_relaxed);
+    s->port.store(port, std::memory_order_relaxed);
+    s->received.store(0, std::memory_order_relaxed);
+    s->accepted.store(0, std::memory_order_relaxed);
+    s->dropped.store(0, std::memory_order_relaxed);
+    s->late.store(0, std::memory_order_relaxed);
+    s->lastSeq.store(0, std::memory_order_relaxed);
+    s->frames.store(0, std::memory_order_relaxed);
+    s->latencySumUs.store(0, std::memory_order_relaxed);
+    s->latencyMaxUs.store(0, std::memory_order_relaxed);
+    s->latencyLastUs.store(0, std::memory_order_relaxed);
+    s->pendingNs = 0;
+    s->haveSeq = false;
+    if (count < MAX_SOURCES)
+        _sourceCount.store(count + 1, std::memory_order_release);
+    return s;
+}
+
+bool UdpSetpoints::ingest(const uint8_t* data, size_t len, uint32_t address, uint16_t port, uint64_t nowNs,
+                          ApplyFn apply, void* ctx)
+{
+    Source* s = findSource(address, port, nowNs);
+    if (!s) return false;
+    bump(s->received, uint64_t(1));
+    const uint64_t silentNs = nowNs - s->lastSeenNs;
+    s->lastSeenNs = nowNs;
+
+    // Сначала вся датаграмма, потом применение: либо все каналы из mask, либо ни одного
+    if (len != UDP_SETPOINT_SIZE || readU32(data) != UDP_SETPOINT_MAGIC) {
+        bump(s->dropped, uint64_t(1));
+        return false;
+    }
+    const uint32_t seq = readU32(data + 4);
+    const uint64_t timestampUs = readU64(data + 8);
+    const uint16_t mask = readU16(data + 16);
+    int values[16];
+    for (unsigned ch = 0; ch < 16; ++ch) {
+        values[ch] = readU16(data + 18 + 2 * ch);
+        if ((mask & (1u << ch)) && (values[ch] < 1000 || values[ch] > 2000)) {
+            bump(s->dropped, uint64_t(1));
+            return false;
+        }
+    }
+    if (mask == 0) {
+        bump(s->dropped, uint64_t(1));
+        return false;
+    }
+    // Метка из будущего — часы отправителя не наши; возраст проверить нельзя
+    if (timestampUs && nowNs / 1000 > timestampUs && (nowNs / 1000 - timestampUs) * 1000 > _maxAgeNs) {
+        bump(s->late, uint64_t(1));
+        return false;
+    }
+    if (s->haveSeq && silentNs <= SOURCE_RESET_MS * 1000000ull &&
+        static_cast<int32_t>(seq - s->lastSeq.load(std::memory_order_relaxed)) <= 0) {
+        bump(s->dropped, uint64_t(1));
+        return false;
+    }
+
+    s->haveSeq = true;
+    s->lastSeq.store(seq, std::memory_order_relaxed);
+    bump(s->accepted, uint64_t(1));
+    s->pendingNs = nowNs;
+    if (apply) apply(mask, values, ctx);
+    return true;
+}
+
+void UdpSetpoints::channelsSent(uint64_t nowNs)
+{
+    const int count = _sourceCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        Source& s = _sources[i];
+        if (!s.pendingNs) continue;
+        const uint32_t us = static_cast<uint32_t>((nowNs - s.pendingNs) / 1000);
+        s.pendingNs = 0;
+        bump(s.frames, uint64_t(1));
+        bump(s.latencySumUs, uint64_t(us));
+        s.latencyLastUs.store(us, std::memory_order_relaxed);
+        if (us > s.latencyMaxUs.load(std::memory_order_relaxed))
+            s.latencyMaxUs.store(us, std::memory_order_relaxed);
+    }
+}
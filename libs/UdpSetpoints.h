@@ -0,0 +1,112 @@
+#pragma once
+
+// Приём уставок каналов по UDP от внешних процессов (автопилот, компаньон) в главном потоке.
+//
+// Датаграмма фиксированного формата, UDP_SETPOINT_SIZE байт, little-endian:
+//   magic:u32 (UDP_SETPOINT_MAGIC, "CSP1")  seq:u32  timestampUs:u64  mask:u16  channels:u16[16]
+// timestampUs — CLOCK_MONOTONIC отправителя в мкс (процесс на той же машине); 0 — без проверки возраста.
+// channels[ch - 1] — мкс 1000..2000, берутся только каналы из mask (бит 0 — канал 1).
+//
+// Источник — адрес отправителя (IP и порт). Пакет с seq не новее последнего принятого от источника
+// отбрасывается (переупорядочен или повтор), старше maxAgeMs — опоздал. Источник, молчавший
+// SOURCE_RESET_MS, начинает с любого seq (перезапуск отправителя). Принятые значения сразу уходят
+// обработчику: в главном потоке это прямая запись в каналы, которые читает crsfSendChannels().
+//
+// Счётчики источников пишет только главный поток, читать их можно из любого (веб-сервер)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+static const uint32_t UDP_SETPOINT_MAGIC = 0x31505343;  // "CSP1"
+static const size_t UDP_SETPOINT_SIZE = 50;
+
+// Снимок счётчиков источника (см. UdpSetpoints::stats)
+struct UdpSetpointStats {
+    uint32_t address;           // IPv4, порядок байт сети
+    uint16_t port;              // порядок байт хоста
+    uint64_t received;          // все датаграммы источника
+    uint64_t accepted;
+    uint64_t dropped;           // переупорядоченные, повторы и неверные
+    uint64_t late;              // старше maxAgeMs
+    uint32_t lastSeq;
+    uint64_t frames;            // кадров каналов, унёсших принятые значения
+    uint64_t latencySumUs;      // от приёма до отправки кадра каналов
+    uint32_t latencyMaxUs;
+    uint32_t latencyLastUs;
+};
+
+class UdpSetpoints
+{
+public:
+    static const int MAX_SOURCES = 8;
+    static const uint32_t SOURCE_RESET_MS = 1000;
+
+    // Принятые уставки: values[ch - 1] для каналов из mask
+    typedef void (*ApplyFn)(uint16_t mask, const int* values, void* ctx);
+
+    explicit UdpSetpoints(uint32_t maxAgeMs = 50);
+    ~UdpSetpoints();
+
+    bool open(uint16_t port, const char* bindAddress = "0.0.0.0");
+    void close();
+    int fd() const { return _fd; }
+
+    // Прочитать все ожидающие датаграммы без блокировки (пачками recvmmsg). Возвращает число принятых
+    int poll(ApplyFn apply, void* ctx);
+    // Разобрать одну датаграмму от address:port, принятую в nowNs (CLOCK_MONOTONIC); true — принята
+    bool ingest(const uint8_t* data, size_t len, uint32_t address, uint16_t port, uint64_t nowNs,
+                ApplyFn apply, void* ctx);
+    // Кадр каналов ушёл в UART: задержка от приёма последних принятых значений каждого источника
+    void channelsSent(uint64_t nowNs);
+
+    int sourceCount() const { return _sourceCount.load(std::memory_order_acquire); }
+    bool stats(int index, UdpSetpointStats& out) const
+    {
+        if (index < 0 || index >= sourceCount()) return false;
+        const Source& s = _sources[index];
+        out.address = s.address.load(std::memory_order_relaxed);
+        out.port = s.port.load(std::memory_order_relaxed);
+        out.received = s.received.load(std::memory_order_relaxed);
+        out.accepted = s.accepted.load(std::memory_order_relaxed);
+        out.dropped = s.dropped.load(std::memory_order_relaxed);
+        out.late = s.late.load(std::memory_order_relaxed);
+        out.lastSeq = s.lastSeq.load(std::memory_order_relaxed);
+        out.frames = s.frames.load(std::memory_order_relaxed);
+        out.latencySumUs = s.latencySumUs.load(std::memory_order_relaxed);
+        out.latencyMaxUs = s.latencyMaxUs.load(std::memory_order_relaxed);
+        out.latencyLastUs = s.latencyLastUs.load(std::memory_order_relaxed);
+        return true;
+    }
+    // Датаграммы от новых источников, когда таблица из MAX_SOURCES уже занята
+    uint64_t rejected() const { return _rejected.load(std::memory_order_relaxed); }
+
+    static uint64_t monotonicNs();
+
+private:
+    struct Source {
+        std::atomic<uint32_t> address;
+        std::atomic<uint16_t> port;
+        std::atomic<uint64_t> received;
+        std::atomic<uint64_t> accepted;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> late;
+        std::atomic<uint32_t> lastSeq;
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> latencySumUs;
+        std::atomic<uint32_t> latencyMaxUs;
+        std::atomic<uint32_t> latencyLastUs;
+        // Только главный поток
+        uint64_t lastSeenNs;
+        uint64_t pendingNs;     // приём значений, ещё не ушедших в кадр; 0 — нет
+        bool haveSeq;
+    };
+
+    int _fd;
+    uint64_t _maxAgeNs;
+    Source _sources[MAX_SOURCES];
+    std::atomic<int> _sourceCount;
+    std::atomic<uint64_t> _rejected;
+
+    Source* findSource(uint32_t address, uint16_t port, uint64_t nowNs);
+};
@@ -0,0 +1,173 @@
+#include "CrsfCapture.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CAPTURE_MAGIC[7] = { 'C', 'R', 'S', 'F', 'C', 'A', 'P' };
+static const uint8_t CAPTURE_VERSION = 1;
+static const size_t CAPTURE_HEADER_SIZE = 16;
+// Сбрасывать буфер stdio на диск не реже раза в секунду: при аварийном завершении теряется не больше
+static const uint64_t CAPTURE_FLUSH_US = 1000000;
+
+static uint64_t monotonicUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ull + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+static void putLe32(uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static size_t putVarint(uint8_t* p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = static_cast<uint8_t>(v) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = static_cast<uint8_t>(v);
+    return n;
+}
+
+CrsfCaptureWriter::CrsfCaptureWriter()
+    : _file(nullptr), _lastUs(0), _lastFlushUs(0), _chunks(0), _first(true)
+{
+}
+
+CrsfCaptureWriter::~CrsfCaptureWriter() { close(); }
+
+bool CrsfCaptureWriter::open(const char* path, uint32_t baud)
+{
+    close();
+    _file = fopen(path, "wb");
+    if (!_file) return false;
+    // Буфер побольше: на 420000 бод это ~1.5 с потока между системными вызовами записи
+    setvbuf(_file, nullptr, _IOFBF, 64 * 1024);
+
+    uint8_t header[CAPTURE_HEADER_SIZE] = {};
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header[7] = CAPTURE_VERSION;
+    putLe32(&header[8], baud);
+    if (fwrite(header, 1, sizeof(header), _file) != sizeof(header)) {
+        close();
+        return false;
+    }
+    _first = true;
+    _chunks = 0;
+    _lastFlushUs = monotonicUs();
+    return true;
+}
+
+void CrsfCaptureWriter::close()
+{
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+void CrsfCaptureWriter::write(const uint8_t* first, size_t firstLen, const uint8_t* second, size_t secondLen)
+{
+    writeAt(monotonicUs(), first, firstLen, second, secondLen);
+}
+
+void CrsfCaptureWriter::writeAt(uint64_t timeUs, const uint8_t* first, size_t firstLen,
+                                const uint8_t* second, size_t secondLen)
+{
+    if (!_file || firstLen + secondLen == 0) return;
+
+    // Первая запись начинается с нуля: в файле хранятся только интервалы
+    const uint64_t delta = (_first || timeUs < _lastUs) ? 0 : timeUs - _lastUs;
+    _first = false;
+    _lastUs = timeUs;
+
+    uint8_t rec[20];
+    size_t n = putVarint(rec, delta);
+    n += putVarint(&rec[n], firstLen + secondLen);
+    fwrite(rec, 1, n, _file);
+    fwrite(first, 1, firstLen, _file);
+    if (secondLen)
+        fwrite(second, 1, secondLen, _file);
+    ++_chunks;
+
+    if (timeUs - _lastFlushUs >= CAPTURE_FLUSH_US) {
+        fflush(_file);
+        _lastFlushUs = timeUs;
+    }
+}
+
+CrsfCaptureReader::~CrsfCaptureReader() { close(); }
+
+bool CrsfCaptureReader::open(const char* path)
+{
+    close();
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= CAPTURE_HEADER_SIZE)
+        p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    _data = static_cast<const uint8_t*>(p);
+    _size = static_cast<size_t>(st.st_size);
+    // Захват читается от начала к концу: ядро подкачивает страницы с опережением
+    madvise(p, _size, MADV_SEQUENTIAL);
+
+    if (memcmp(_data, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 || _data[7] != CAPTURE_VERSION) {
+        close();
+        return false;
+    }
+    _baud = static_cast<uint32_t>(_data[8]) | (static_cast<uint32_t>(_data[9]) << 8) |
+            (static_cast<uint32_t>(_data[10]) << 16) | (static_cast<uint32_t>(_data[11]) << 24);
+    rewind();
+    return true;
+}
+
+void CrsfCaptureReader::close()
+{
+    if (_data) munmap(const_cast<uint8_t*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+    _at = Position{ 0, 0 };
+}
+
+CrsfCaptureReader::Position CrsfCaptureReader::begin() const
+{
+    return Position{ _data ? CAPTURE_HEADER_SIZE : 0, 0 };
+}
+
+bool CrsfCaptureReader::readVarint(size_t& pos, uint64_t& value) const
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < _size; shift += 7) {
+        uint8_t b = _data[pos++];
+        value |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool CrsfCaptureReader::next(Position& at, Chunk& chunk) const
+{
+    size_t pos = at.pos;
+    uint64_t delta, len;
+    if (!readVarint(pos, delta) || !readVarint(pos, len)) return false;
+    if (len > _size - pos) return false;
+    at.timeUs += delta;
+    chunk.timeUs = at.timeUs;
+    chunk.data = &_data[pos];
+    chunk.len = static_cast<size_t>(len);
+    at.pos = pos + static_cast<size_t>(len);
+    return true;
+}
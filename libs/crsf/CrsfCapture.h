@@ -0,0 +1,87 @@
+#pragma once
+
+// Запись сырого потока UART в файл захвата и его чтение для воспроизведения.
+//
+// Формат файла (всё little-endian):
+//   заголовок 16 байт: "CRSFCAP" + версия (1 байт), скорость порта (uint32), резерв (uint32)
+//   записи подряд:     varint интервал от предыдущей пачки в мкс, varint длина, байты пачки
+// Одна запись — одна пачка, прочитанная CrsfSerial::loop() за один readv,
+// поэтому при воспроизведении сохраняется исходное деление потока на чтения
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+class CrsfCaptureWriter
+{
+public:
+    CrsfCaptureWriter();
+    ~CrsfCaptureWriter();
+
+    bool open(const char* path, uint32_t baud);
+    void close();
+    bool isOpen() const { return _file != nullptr; }
+
+    // Записать пачку из одного или двух участков (как их заполнил readv) с текущей меткой времени
+    void write(const uint8_t* first, size_t firstLen, const uint8_t* second = nullptr, size_t secondLen = 0);
+    // То же с явной меткой CLOCK_MONOTONIC в мкс (синтетические захваты)
+    void writeAt(uint64_t timeUs, const uint8_t* first, size_t firstLen,
+                 const uint8_t* second = nullptr, size_t secondLen = 0);
+
+    uint64_t chunks() const { return _chunks; }
+
+private:
+    FILE* _file;
+    uint64_t _lastUs;
+    uint64_t _lastFlushUs;
+    uint64_t _chunks;
+    bool _first;
+};
+
+class CrsfCaptureReader
+{
+public:
+    struct Chunk {
+        uint64_t timeUs;      // от начала захвата
+        const uint8_t* data;
+        size_t len;
+    };
+
+    // Место в файле: смещение следующей записи и метка предыдущей пачки (интервалы в файле относительные)
+    struct Position {
+        size_t pos;
+        uint64_t timeUs;
+    };
+
+    CrsfCaptureReader() = default;
+    ~CrsfCaptureReader();
+    CrsfCaptureReader(const CrsfCaptureReader&) = delete;
+    CrsfCaptureReader& operator=(const CrsfCaptureReader&) = delete;
+
+    // Отобразить файл в память (mmap) — захват на сотни МБ не копируется.
+    // false — файла нет или неверный заголовок
+    bool open(const char* path);
+    void close();
+    uint32_t baud() const { return _baud; }
+    // Размер файла в байтах (с заголовком)
+    size_t size() const { return _size; }
+
+    // Следующая пачка; false — конец файла или обрезанная запись
+    bool next(Chunk& chunk) { return next(_at, chunk); }
+    void rewind() { _at = begin(); }
+
+    // То же с позицией вызывающего: один открытый захват читают несколько потоков, каждый со своей позицией.
+    // Пачка не читается, пока к chunk.data не обратились — проход только по заголовкам записей дёшев
+    bool next(Position& at, Chunk& chunk) const;
+    Position begin() const;
+    Position tell() const { return _at; }
+    void seek(const Position& at) { _at = at; }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    Position _at{ 0, 0 };
+    uint32_t _baud = 0;
+
+    bool readVarint(size_t& pos, uint64_t& value) const;
+};
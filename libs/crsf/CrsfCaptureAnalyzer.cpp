@@ -0,0 +1,371 @@
+#include "CrsfCaptureAnalyzer.h"
+
+#include <chrono>
+#include <thread>
+#include <utility>
+#include "CrsfParser.h"
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+uint64_t elapsedUs(SteadyClock::time_point since)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - since).count());
+}
+
+// Разбор без порта и без времени: байты подаются через receive(), таймаут пакета не нужен
+struct NoTransport {
+    size_t readBulk(uint8_t*, size_t, uint8_t*, size_t) { return 0; }
+};
+
+struct NoClock {
+    static uint32_t millis() { return 0; }
+};
+
+// Все типы, которые умеет различать CrsfFrameTypes (0..253): 0xFE и 0xFF в протоколе не используются
+template <size_t... I>
+CrsfFrameTypes<static_cast<uint8_t>(I)...> allTypes(std::index_sequence<I...>);
+typedef decltype(allTypes(std::make_index_sequence<254>())) AllFrameTypes;
+
+// Место в потоке: запись с пачкой, смещение внутри пачки и смещение от начала потока
+struct Cut {
+    CrsfCaptureReader::Position record;
+    size_t skip;
+    uint64_t offset;
+};
+
+// Кадр в начале p: верная длина и CRC; 0 — нет (или байт не хватает)
+size_t frameAt(const uint8_t* p, size_t avail)
+{
+    if (avail < 2) return 0;
+    const uint8_t len = p[1];
+    if (len < 3 || len > CRSF_MAX_PAYLOAD_LEN + 2 || avail < len + 2u) return 0;
+    return crc8_calc(&p[2], len - 1) == p[len + 1] ? len + 2u : 0;
+}
+
+// Итог одной части; всё, что зависит от соседних частей, откладывается до сложения
+struct Part {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t crcErrors = 0;
+    uint64_t resyncs = 0;
+    uint64_t droppedBytes = 0;
+    uint64_t boundaryPartial = 0;
+
+    // Серии ошибок CRC: до первого целого кадра части (продолжают серию предыдущей части),
+    // законченные внутри части и оставшиеся в конце (продолжаются в следующей)
+    bool hasFrame = false;
+    uint64_t firstFrameUs = 0;
+    uint64_t leadingErrors = 0;
+    uint64_t trailingErrors = 0;
+    uint64_t crcBursts = 0;
+    uint64_t crcBurstMax = 0;
+    uint64_t crcBurstMaxAtUs = 0;
+    uint64_t crcBurstHist[CrsfCaptureStats::BURST_BUCKETS] = {};
+
+    uint64_t linkStats = 0;
+    uint64_t lqHist[101] = {};
+    uint64_t rssiHist[256] = {};
+
+    CrsfCaptureTypeStats types[256];
+};
+
+unsigned burstBucket(uint64_t n)
+{
+    if (n <= 2) return static_cast<unsigned>(n - 1);
+    if (n <= 4) return 2;
+    if (n <= 8) return 3;
+    return 4;
+}
+
+template <typename T>
+void addBurst(T& s, uint64_t n, uint64_t atUs)
+{
+    ++s.crcBursts;
+    ++s.crcBurstHist[burstBucket(n)];
+    if (n > s.crcBurstMax) {
+        s.crcBurstMax = n;
+        s.crcBurstMaxAtUs = atUs;
+    }
+}
+
+// Владелец парсера для одной части (Sink для CrsfParser)
+class Worker
+{
+public:
+    Worker(Part& part, size_t seconds) : _part(part), _seconds(seconds), _parser(_transport, *this) {}
+
+    void feed(uint64_t timeUs, const uint8_t* data, size_t len)
+    {
+        _timeUs = timeUs;
+        _parser.receive(data, len);
+    }
+
+    void finish()
+    {
+        // Кадр, начатый до конца части, в ней не закончится: следующая часть начинает с целого кадра
+        _tail = 0;
+        _draining = true;
+        _parser.drain();
+        if (_tail) ++_part.boundaryPartial;
+
+        const CrsfRxStats& s = _parser.stats();
+        _part.bytes = s.bytes;
+        _part.frames = s.frames;
+        _part.crcErrors = s.crcErrors;
+        _part.resyncs = s.resyncs;
+        _part.droppedBytes = s.droppedBytes + _tail;
+        _part.trailingErrors = s.crcErrors - _errors;
+    }
+
+    void onFrame(const uint8_t* frame, uint8_t len)
+    {
+        const uint32_t errors = _parser.stats().crcErrors;
+        if (!_part.hasFrame) {
+            _part.hasFrame = true;
+            _part.firstFrameUs = _timeUs;
+            _part.leadingErrors = errors;
+        } else if (errors != _errors) {
+            addBurst(_part, errors - _errors, _timeUs);
+        }
+        _errors = errors;
+
+        CrsfCaptureTypeStats& t = _part.types[frame[2]];
+        if (t.frames) t.addGap(_timeUs - t.lastUs, _timeUs);
+        else {
+            t.firstUs = _timeUs;
+            t.perSecond.assign(_seconds, 0);
+        }
+        ++t.frames;
+        t.lastUs = _timeUs;
+        const size_t second = static_cast<size_t>(_timeUs / 1000000);
+        if (second < t.perSecond.size()) ++t.perSecond[second];
+
+        if (frame[2] == CRSF_FRAMETYPE_LINK_STATISTICS && len >= 3 + 3) {
+            const crsfLinkStatistics_t* ls = reinterpret_cast<const crsfLinkStatistics_t*>(&frame[3]);
+            ++_part.linkStats;
+            ++_part.lqHist[ls->uplink_Link_quality > 100 ? 100 : ls->uplink_Link_quality];
+            ++_part.rssiHist[ls->uplink_RSSI_1];
+        }
+    }
+
+    void onSkippedByte(uint8_t)
+    {
+        if (_draining) ++_tail;
+    }
+
+private:
+    Part& _part;
+    const size_t _seconds;
+    NoTransport _transport;
+    CrsfParser<NoTransport, NoClock, Worker, AllFrameTypes> _parser;
+    uint64_t _timeUs = 0;
+    uint32_t _errors = 0;       // ошибок CRC на момент последнего целого кадра
+    uint64_t _tail = 0;
+    bool _draining = false;
+};
+
+// Разобрать поток от from до to.offset тем же CrsfParser, что и при приёме
+void parsePart(const CrsfCaptureReader& reader, const Cut& from, uint64_t to, size_t seconds, Part& part)
+{
+    Worker w(part, seconds);
+    CrsfCaptureReader::Position at = from.record;
+    CrsfCaptureReader::Chunk c;
+    uint64_t offset = from.offset - from.skip;
+    size_t skip = from.skip;
+    while (offset + skip < to && reader.next(at, c)) {
+        size_t len = c.len;
+        if (offset + len > to) len = static_cast<size_t>(to - offset);
+        if (len > skip) w.feed(c.timeUs, c.data + skip, len - skip);
+        offset += c.len;
+        skip = 0;
+    }
+    w.finish();
+}
+
+// Первая точка входа не раньше from и раньше limit: байт адреса (CRSF_ADDRESSES), кадр с верной CRC
+// и сразу за ним ещё один такой же. Байты пачек собираются в окно, кадр может пересекать пачки
+bool findEntry(const CrsfCaptureReader& reader, const Cut& from, uint64_t limit, Cut& entry)
+{
+    struct Loaded {
+        CrsfCaptureReader::Position record;
+        uint64_t offset;
+    };
+    std::vector<Loaded> loaded;
+    std::vector<uint8_t> win;
+    uint64_t winOffset = from.offset;       // смещение win[0] в потоке
+    CrsfCaptureReader::Position at = from.record;
+    CrsfCaptureReader::Chunk c;
+    bool more = true;
+    size_t i = 0;
+    const size_t need = 2 * CRSF_MAX_PACKET_SIZE;
+
+    auto load = [&]() {
+        const CrsfCaptureReader::Position record = at;
+        if (!reader.next(at, c)) return false;
+        const uint64_t offset = winOffset + win.size() - (loaded.empty() ? from.skip : 0);
+        loaded.push_back(Loaded{ record, offset });
+        const size_t skip = loaded.size() == 1 ? from.skip : 0;
+        if (c.len > skip) win.insert(win.end(), c.data + skip, c.data + c.len);
+        return true;
+    };
+
+    while (winOffset + i < limit) {
+        while (more && win.size() - i < need)
+            more = load();
+        if (i >= win.size()) return false;
+        const uint8_t* p = &win[i];
+        const size_t avail = win.size() - i;
+        size_t first;
+        if (CRSF_ADDRESSES.is[p[0]] && (first = frameAt(p, avail)) && frameAt(p + first, avail - first)) {
+            // Пачка, в которой начинается кадр: последняя загруженная с началом не дальше него
+            const uint64_t offset = winOffset + i;
+            size_t b = loaded.size() - 1;
+            while (loaded[b].offset > offset) --b;
+            entry.record = loaded[b].record;
+            entry.offset = offset;
+            entry.skip = static_cast<size_t>(offset - loaded[b].offset);
+            return true;
+        }
+        // Просмотренное начало окна больше не нужно (длинный участок шума)
+        if (++i >= (1u << 20)) {
+            win.erase(win.begin(), win.begin() + static_cast<std::ptrdiff_t>(i));
+            winOffset += i;
+            i = 0;
+        }
+    }
+    return false;
+}
+
+template <typename F>
+void runJobs(unsigned n, F fn)
+{
+    std::vector<std::thread> threads;
+    for (unsigned k = 1; k < n; ++k)
+        threads.emplace_back(fn, k);
+    fn(0u);
+    for (std::thread& t : threads)
+        t.join();
+}
+
+void mergeType(CrsfCaptureTypeStats& into, const CrsfCaptureTypeStats& part)
+{
+    if (!part.frames) return;
+    if (into.frames) into.addGap(part.firstUs - into.lastUs, part.firstUs);
+    else into.firstUs = part.firstUs;
+    if (into.gapHist.empty()) into.gapHist.assign(CrsfCaptureTypeStats::GAP_BUCKETS, 0);
+    into.frames += part.frames;
+    into.lastUs = part.lastUs;
+    into.gaps += part.gaps;
+    into.gapSumUs += part.gapSumUs;
+    if (part.gapMaxUs > into.gapMaxUs) {
+        into.gapMaxUs = part.gapMaxUs;
+        into.gapMaxAtUs = part.gapMaxAtUs;
+    }
+    for (size_t i = 0; i < part.gapHist.size(); ++i)
+        into.gapHist[i] += part.gapHist[i];
+    if (into.perSecond.size() < part.perSecond.size()) into.perSecond.resize(part.perSecond.size(), 0);
+    for (size_t i = 0; i < part.perSecond.size(); ++i)
+        into.perSecond[i] += part.perSecond[i];
+}
+
+} // namespace
+
+void CrsfCaptureTypeStats::addGap(uint64_t gapUs, uint64_t atUs)
+{
+    if (gapHist.empty()) gapHist.assign(GAP_BUCKETS, 0);
+    const uint64_t bucket = gapUs / GAP_BUCKET_US;
+    ++gapHist[bucket < GAP_BUCKETS - 1 ? bucket : GAP_BUCKETS - 1];
+    ++gaps;
+    gapSumUs += gapUs;
+    if (gapUs > gapMaxUs) {
+        gapMaxUs = gapUs;
+        gapMaxAtUs = atUs;
+    }
+}
+
+CrsfCaptureStats CrsfCaptureAnalyzer::analyze(unsigned jobs) const
+{
+    CrsfCaptureStats st;
+    if (!jobs) jobs = std::thread::hardware_concurrency();
+    if (!jobs) jobs = 1;
+    st.fileBytes = _reader.size();
+
+    // 1. Проход по заголовкам: начало каждой части — первая запись не раньше k * size / jobs
+    auto t0 = SteadyClock::now();
+    std::vector<Cut> cuts;
+    CrsfCaptureReader::Position at = _reader.begin();
+    CrsfCaptureReader::Chunk c;
+    uint64_t offset = 0;
+    for (;;) {
+        const CrsfCaptureReader::Position record = at;
+        if (!_reader.next(at, c)) break;
+        if (record.pos >= cuts.size() * st.fileBytes / jobs) cuts.push_back(Cut{ record, 0, offset });
+        offset += c.len;
+        ++st.chunks;
+        st.durationUs = c.timeUs;
+    }
+    st.indexUs = elapsedUs(t0);
+    if (cuts.empty()) return st;
+    const uint64_t total = offset;
+    const size_t seconds = static_cast<size_t>(st.durationUs / 1000000) + 1;
+
+    // 2. Точки входа частей; часть без точки входа достаётся предыдущей
+    t0 = SteadyClock::now();
+    const size_t n = cuts.size();
+    std::vector<Cut> entries(n);
+    std::vector<char> found(n, 0);
+    entries[0] = cuts[0];
+    found[0] = 1;
+    runJobs(static_cast<unsigned>(n), [&](unsigned k) {
+        if (k) found[k] = findEntry(_reader, cuts[k], k + 1 < n ? cuts[k + 1].offset : total, entries[k]);
+    });
+    std::vector<Cut> starts;
+    for (size_t k = 0; k < n; ++k)
+        if (found[k]) starts.push_back(entries[k]);
+    st.entryUs = elapsedUs(t0);
+    st.jobs = static_cast<unsigned>(starts.size());
+
+    // 3. Разбор частей от точки входа до точки входа следующей
+    t0 = SteadyClock::now();
+    std::vector<Part> parts(starts.size());
+    runJobs(st.jobs, [&](unsigned k) {
+        parsePart(_reader, starts[k], k + 1 < starts.size() ? starts[k + 1].offset : total, seconds, parts[k]);
+    });
+    st.parseUs = elapsedUs(t0);
+
+    // 4. Сложение по порядку частей
+    uint64_t carry = 0;         // ошибки CRC без целого кадра после них
+    for (const Part& p : parts) {
+        st.bytes += p.bytes;
+        st.frames += p.frames;
+        st.crcErrors += p.crcErrors;
+        st.resyncs += p.resyncs;
+        st.droppedBytes += p.droppedBytes;
+        st.boundaryPartial += p.boundaryPartial;
+        if (p.hasFrame) {
+            if (carry + p.leadingErrors) addBurst(st, carry + p.leadingErrors, p.firstFrameUs);
+            carry = p.trailingErrors;
+        } else {
+            carry += p.trailingErrors;
+        }
+        st.crcBursts += p.crcBursts;
+        for (unsigned i = 0; i < CrsfCaptureStats::BURST_BUCKETS; ++i)
+            st.crcBurstHist[i] += p.crcBurstHist[i];
+        if (p.crcBurstMax > st.crcBurstMax) {
+            st.crcBurstMax = p.crcBurstMax;
+            st.crcBurstMaxAtUs = p.crcBurstMaxAtUs;
+        }
+        st.linkStats += p.linkStats;
+        for (unsigned i = 0; i <= 100; ++i)
+            st.lqHist[i] += p.lqHist[i];
+        for (unsigned i = 0; i < 256; ++i)
+            st.rssiHist[i] += p.rssiHist[i];
+        for (unsigned t = 0; t < 256; ++t)
+            mergeType(st.types[t], p.types[t]);
+    }
+    if (carry) addBurst(st, carry, st.durationUs);
+    return st;
+}
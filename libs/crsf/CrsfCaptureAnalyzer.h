@@ -0,0 +1,105 @@
+#pragma once
+
+// Разбор захвата UART (CrsfCapture) на всех ядрах со сводной статистикой по типам кадров.
+//
+// Захват делится на части по размеру файла. Проход по заголовкам записей (без чтения байт пачек)
+// даёт позиции частей; затем параллельно:
+//   1. каждая часть, кроме первой, ищет точку входа — байт адреса (любой из crsf_addr_e), за которым
+//      кадр с верной длиной и CRC8 и ещё один такой же кадр сразу следом (случайное совпадение
+//      внутри нагрузки не принимается за начало кадра)
+//   2. каждая часть разбирается тем же CrsfParser, что и в CrsfSerial, от своей точки входа до точки
+//      входа следующей: границы частей совпадают с границами кадров, ни один кадр не разбирается дважды
+// Сводка частей складывается по порядку: интервалы между кадрами и серии ошибок CRC, переходящие
+// через границу частей, считаются так же, как при разборе одним потоком. На целом потоке результат
+// совпадает с разбором одним потоком; кадр, разрезанный границей в зашумлённом месте, считается
+// в boundaryPartial и его байты — в droppedBytes.
+//
+// Метка кадра — метка пачки, в которой пришёл его последний байт (как у CrsfParser)
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CrsfCapture.h"
+
+// Сводка по одному типу кадров
+struct CrsfCaptureTypeStats {
+    // Интервалы между соседними кадрами типа: корзины по GAP_BUCKET_US, последняя — всё, что длиннее
+    static const uint32_t GAP_BUCKET_US = 100;
+    static const uint32_t GAP_BUCKETS = 1001;
+
+    uint64_t frames = 0;
+    uint64_t firstUs = 0;
+    uint64_t lastUs = 0;
+    uint64_t gaps = 0;
+    uint64_t gapSumUs = 0;
+    uint64_t gapMaxUs = 0;
+    uint64_t gapMaxAtUs = 0;                // метка кадра после самого длинного интервала
+    std::vector<uint64_t> gapHist;          // GAP_BUCKETS корзин (пусто, если кадров не было)
+    std::vector<uint32_t> perSecond;        // кадров за каждую секунду захвата
+
+    void addGap(uint64_t gapUs, uint64_t atUs);
+};
+
+struct CrsfCaptureStats {
+    // Серии ошибок CRC подряд (без целого кадра между ними): 1, 2, 3-4, 5-8, 9 и больше
+    static const unsigned BURST_BUCKETS = 5;
+
+    unsigned jobs = 0;                      // частей (потоков) фактически
+    uint64_t fileBytes = 0;
+    uint64_t chunks = 0;                    // пачек в захвате
+    uint64_t durationUs = 0;                // метка последней пачки
+
+    // Как CrsfRxStats, за весь захват
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t crcErrors = 0;
+    uint64_t resyncs = 0;
+    uint64_t droppedBytes = 0;
+    uint64_t boundaryPartial = 0;           // части, закончившиеся недоразобранным кадром
+
+    uint64_t crcBursts = 0;
+    uint64_t crcBurstMax = 0;
+    uint64_t crcBurstMaxAtUs = 0;           // метка первого целого кадра после самой длинной серии
+    uint64_t crcBurstHist[BURST_BUCKETS] = {};
+
+    // LINK_STATISTICS: распределения качества линка (uplink_Link_quality, %) и uplink_RSSI_1 (-дБм)
+    uint64_t linkStats = 0;
+    uint64_t lqHist[101] = {};
+    uint64_t rssiHist[256] = {};
+
+    CrsfCaptureTypeStats types[256];
+
+    // Время стадий: проход по заголовкам (один поток), поиск точек входа и разбор (параллельно)
+    uint64_t indexUs = 0;
+    uint64_t entryUs = 0;
+    uint64_t parseUs = 0;
+};
+
+// Процентиль по гистограмме: номер корзины, до которой набирается pct процентов отсчётов
+template <typename T>
+size_t crsf_histogram_percentile(const T* hist, size_t n, double pct)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; ++i) total += hist[i];
+    if (!total) return 0;
+    const double need = total * pct / 100.0;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += hist[i];
+        if (sum >= need && sum > 0) return i;
+    }
+    return n - 1;
+}
+
+class CrsfCaptureAnalyzer
+{
+public:
+    bool open(const char* path) { return _reader.open(path); }
+    const CrsfCaptureReader& reader() const { return _reader; }
+
+    // Разобрать захват в jobs потоках (0 — по числу ядер)
+    CrsfCaptureStats analyze(unsigned jobs = 0) const;
+
+private:
+    CrsfCaptureReader _reader;
+};
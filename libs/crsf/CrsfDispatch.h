@@ -0,0 +1,90 @@
+#pragma once
+
+// Рассылка принятых кадров CRSF подписчикам по типу кадра.
+//
+// Таблица строится при компиляции из набора CrsfFrameTypes: на каждый тип — фиксированный
+// массив из MaxSubscribers подписчиков, номер ячейки берётся из CrsfFrameTypes::slot().
+// Подписчик — указатель на функцию и контекст, без std::function и выделения памяти;
+// для метода класса есть шаблон-переходник crsf_member_handler.
+//
+// Кадр передаётся как есть (заголовок, данные, CRC) вместе с меткой времени приёма пачки.
+// Указатель действителен только на время вызова: кадр лежит в кольце приёма или в буфере
+// сборки парсера. Подписка и рассылка — из одного потока (того, что вызывает loop())
+
+#include <cstddef>
+#include <cstdint>
+#include "crsf_protocol.h"
+
+// frame — кадр целиком (frame->frame_size — длина после байта длины), timeMs — время приёма, мс
+typedef void (*CrsfFrameFn)(void* ctx, const crsf_header_t* frame, uint32_t timeMs);
+
+// Переходник к методу: &crsf_member_handler<Recorder, &Recorder::onFrame> с ctx = объект
+template <typename T, void (T::*Method)(const crsf_header_t*, uint32_t)>
+void crsf_member_handler(void* ctx, const crsf_header_t* frame, uint32_t timeMs)
+{
+    (static_cast<T*>(ctx)->*Method)(frame, timeMs);
+}
+
+template <typename Types, unsigned MaxSubscribers = 4>
+class CrsfDispatch
+{
+public:
+    // false — тип не входит в набор, подписчиков уже MaxSubscribers или такой уже есть
+    bool subscribe(uint8_t type, CrsfFrameFn fn, void* ctx)
+    {
+        const uint8_t slot = Types::slot(type);
+        if (slot == Types::NONE || !fn) return false;
+        Slot& s = _slots[slot];
+        if (s.count >= MaxSubscribers || find(s, fn, ctx) >= 0) return false;
+        s.subs[s.count].fn = fn;
+        s.subs[s.count].ctx = ctx;
+        ++s.count;
+        return true;
+    }
+
+    bool unsubscribe(uint8_t type, CrsfFrameFn fn, void* ctx)
+    {
+        const uint8_t slot = Types::slot(type);
+        if (slot == Types::NONE) return false;
+        Slot& s = _slots[slot];
+        const int i = find(s, fn, ctx);
+        if (i < 0) return false;
+        // Порядок вызова оставшихся подписчиков сохраняется
+        for (unsigned j = static_cast<unsigned>(i) + 1; j < s.count; ++j)
+            s.subs[j - 1] = s.subs[j];
+        --s.count;
+        return true;
+    }
+
+    unsigned subscribers(uint8_t type) const
+    {
+        const uint8_t slot = Types::slot(type);
+        return (slot == Types::NONE) ? 0 : _slots[slot].count;
+    }
+
+    // slot — Types::slot(frame->type), уже посчитанный вызывающим
+    void dispatch(uint8_t slot, const crsf_header_t* frame, uint32_t timeMs) const
+    {
+        const Slot& s = _slots[slot];
+        for (unsigned i = 0; i < s.count; ++i)
+            s.subs[i].fn(s.subs[i].ctx, frame, timeMs);
+    }
+
+private:
+    struct Subscriber {
+        CrsfFrameFn fn;
+        void* ctx;
+    };
+    struct Slot {
+        Subscriber subs[MaxSubscribers];
+        unsigned count;
+    };
+    Slot _slots[Types::COUNT] = {};
+
+    static int find(const Slot& s, CrsfFrameFn fn, void* ctx)
+    {
+        for (unsigned i = 0; i < s.count; ++i)
+            if (s.subs[i].fn == fn && s.subs[i].ctx == ctx) return static_cast<int>(i);
+        return -1;
+    }
+};
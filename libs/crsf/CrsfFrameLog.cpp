@@ -0,0 +1,424 @@
+#include "CrsfFrameLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <new>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(CrsfFrameLogIndexEntry) == 16, "запись индекса");
+
+// Имя сегмента: crsf-<номер>.flog
+static bool parseSegmentName(const char* name, uint64_t& sequence)
+{
+    unsigned long long seq;
+    int end = 0;
+    if (sscanf(name, "crsf-%llu.flog%n", &seq, &end) != 1 || name[end] != '\0') return false;
+    sequence = seq;
+    return true;
+}
+
+static std::vector<uint64_t> listSequences(const std::string& dir)
+{
+    std::vector<uint64_t> out;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return out;
+    while (dirent* e = readdir(d)) {
+        uint64_t seq;
+        if (parseSegmentName(e->d_name, seq)) out.push_back(seq);
+    }
+    closedir(d);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+static std::string segmentPath(const std::string& dir, uint64_t sequence)
+{
+    char name[40];
+    snprintf(name, sizeof(name), "/crsf-%08llu.flog", static_cast<unsigned long long>(sequence));
+    return dir + name;
+}
+
+static int64_t realtimeNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+}
+
+CrsfFrameLog::Options CrsfFrameLog::defaults()
+{
+    Options o;
+    o.segmentSize = 16ull * 1024 * 1024;
+    o.indexIntervalMs = 100;
+    o.indexCapacity = 16384;
+    o.maxSegments = 32;
+    o.queueFrames = 4096;
+    o.flushMs = 10;
+    return o;
+}
+
+CrsfFrameLog::CrsfFrameLog()
+    : _tail(0), _headCache(0), _dropped(0), _head(0), _written(0), _failed(0), _bytes(0), _segments(0),
+      _sequence(0), _stop(false), _mask(0), _options(defaults()), _fd(-1), _map(nullptr), _header(nullptr),
+      _index(nullptr), _dataEnd(0), _records(0), _indexCount(0), _lastIndexNs(0), _lastNs(0), _retryNs(0)
+{
+}
+
+CrsfFrameLog::~CrsfFrameLog() { stop(); }
+
+bool CrsfFrameLog::start(const char* dir, const Options& options)
+{
+    if (isRunning()) return false;
+    _options = options;
+    if (_options.indexCapacity == 0) _options.indexCapacity = 1;
+    const uint64_t minSize = CRSF_FRAME_LOG_HEADER_SIZE + _options.indexCapacity * sizeof(CrsfFrameLogIndexEntry) +
+                             64 * (CRSF_FRAME_LOG_RECORD_HEADER + CRSF_MAX_PAYLOAD_LEN);
+    if (_options.segmentSize < minSize) _options.segmentSize = minSize;
+    uint32_t queue = 64;
+    while (queue < _options.queueFrames) queue <<= 1;
+    _options.queueFrames = queue;
+
+    _dir = dir;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return false;
+    _segments.store(0);
+    _lastNs = 0;
+    const std::vector<uint64_t> existing = listSequences(_dir);
+    if (!openSegment(existing.empty() ? 1 : existing.back() + 1)) return false;
+
+    // Обнулением страницы очереди заводятся сразу, а не первым кадром в каждой на потоке приёма
+    _queue.reset(new Slot[queue]());
+    _mask = queue - 1;
+    _tail.store(0);
+    _head.store(0);
+    _headCache = 0;
+    _dropped.store(0);
+    _written.store(0);
+    _failed.store(0);
+    _bytes.store(0);
+    _stop.store(false);
+    _thread = std::thread(&CrsfFrameLog::run, this);
+    return true;
+}
+
+void CrsfFrameLog::stop()
+{
+    if (!isRunning()) return;
+    _stop.store(true, std::memory_order_release);
+    _thread.join();
+    closeSegment();
+}
+
+CrsfFrameLog::Stats CrsfFrameLog::stats() const
+{
+    Stats s;
+    s.dropped = _dropped.load(std::memory_order_relaxed) + _failed.load(std::memory_order_relaxed);
+    s.frames = _tail.load(std::memory_order_relaxed);
+    s.written = _written.load(std::memory_order_relaxed);
+    s.bytes = _bytes.load(std::memory_order_relaxed);
+    s.segments = _segments.load(std::memory_order_relaxed);
+    s.sequence = _sequence.load(std::memory_order_relaxed);
+    return s;
+}
+
+void CrsfFrameLog::run()
+{
+    for (;;) {
+        if (drain()) continue;
+        // Флаг проверяется только при пустой очереди: всё принятое до stop() будет записано
+        if (_stop.load(std::memory_order_acquire) && !drain()) break;
+        timespec ts{ 0, static_cast<long>(_options.flushMs) * 1000000l };
+        nanosleep(&ts, nullptr);
+    }
+}
+
+bool CrsfFrameLog::drain()
+{
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    const uint64_t tail = _tail.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    while (head != tail) {
+        write(_queue[head & _mask]);
+        ++head;
+        // Слоты возвращаются приёму порциями, не дожидаясь конца большой пачки
+        if ((head & 255) == 0) _head.store(head, std::memory_order_release);
+    }
+    publish();
+    _head.store(head, std::memory_order_release);
+    return true;
+}
+
+void CrsfFrameLog::write(const Slot& s)
+{
+    if (!_map) {
+        // Прошлый сегмент не открылся: пробуем снова не чаще раза в секунду, кадры до тех пор теряются
+        const uint64_t now = monotonicNs();
+        if (now < _retryNs || !openSegment(_sequence.load(std::memory_order_relaxed) + 1)) {
+            if (now >= _retryNs) _retryNs = now + 1000000000ull;
+            _failed.store(_failed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    const uint8_t* f = s.frame;
+    const uint8_t len = static_cast<uint8_t>(f[1] - 2);
+    const uint64_t need = CRSF_FRAME_LOG_RECORD_HEADER + len;
+    // Две пачки двух портов идут одна за другой, но метки индекса обязаны не убывать
+    const uint64_t timeNs = std::max(s.timeNs, _lastNs);
+    bool indexed = _records == 0 || timeNs >= _lastIndexNs + _options.indexIntervalMs * 1000000ull;
+    if (_dataEnd + need > _header->dataCapacity || (indexed && _indexCount == _header->indexCapacity)) {
+        const uint64_t next = _header->sequence + 1;
+        closeSegment();
+        if (!openSegment(next)) {
+            _retryNs = monotonicNs() + 1000000000ull;
+            _failed.store(_failed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        indexed = true;
+    }
+    if (indexed) {
+        _index[_indexCount].timeNs = timeNs;
+        _index[_indexCount].offset = _dataEnd;
+        ++_indexCount;
+        _lastIndexNs = timeNs;
+    }
+
+    uint8_t* p = _map + _header->dataOffset + _dataEnd;
+    memcpy(p, &timeNs, sizeof(timeNs));
+    p[8] = f[0];
+    p[9] = f[2];
+    p[10] = len;
+    memcpy(p + CRSF_FRAME_LOG_RECORD_HEADER, f + 3, len);
+    if (_records == 0) _header->firstNs.store(timeNs, std::memory_order_relaxed);
+    _dataEnd += need;
+    ++_records;
+    _lastNs = timeNs;
+    _written.store(_written.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _bytes.store(_bytes.load(std::memory_order_relaxed) + need, std::memory_order_relaxed);
+}
+
+void CrsfFrameLog::publish()
+{
+    if (!_header) return;
+    _header->indexCount.store(_indexCount, std::memory_order_release);
+    _header->records.store(_records, std::memory_order_relaxed);
+    _header->lastNs.store(_lastNs, std::memory_order_relaxed);
+    _header->dataEnd.store(_dataEnd, std::memory_order_release);
+}
+
+bool CrsfFrameLog::openSegment(uint64_t sequence)
+{
+    const std::string path = segmentPath(_dir, sequence);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    const off_t size = static_cast<off_t>(_options.segmentSize);
+    void* map = MAP_FAILED;
+    if (posix_fallocate(fd, 0, size) == 0)
+        map = mmap(nullptr, _options.segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        unlink(path.c_str());
+        return false;
+    }
+
+    _fd = fd;
+    _map = static_cast<uint8_t*>(map);
+    // Файл только что заведён и заполнен нулями: атомики заголовка создаются на месте
+    _header = new (_map) CrsfFrameLogHeader();
+    _header->version = CRSF_FRAME_LOG_VERSION;
+    _header->headerSize = CRSF_FRAME_LOG_HEADER_SIZE;
+    _header->sequence = sequence;
+    _header->indexCapacity = _options.indexCapacity;
+    _header->indexIntervalMs = _options.indexIntervalMs;
+    _header->dataOffset = CRSF_FRAME_LOG_HEADER_SIZE + _options.indexCapacity * sizeof(CrsfFrameLogIndexEntry);
+    _header->dataCapacity = _options.segmentSize - _header->dataOffset;
+    _header->monotonicNs = monotonicNs();
+    _header->realtimeNs = realtimeNs();
+    // magic — последним: читатель не примет сегмент с недописанным заголовком
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(_header->magic, CRSF_FRAME_LOG_MAGIC, sizeof(CRSF_FRAME_LOG_MAGIC));
+    _index = reinterpret_cast<CrsfFrameLogIndexEntry*>(_map + CRSF_FRAME_LOG_HEADER_SIZE);
+    _dataEnd = 0;
+    _records = 0;
+    _indexCount = 0;
+    _lastIndexNs = 0;
+    _segments.store(_segments.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _sequence.store(sequence, std::memory_order_relaxed);
+
+    if (_options.maxSegments && sequence >= _options.maxSegments) {
+        for (uint64_t old : listSequences(_dir)) {
+            if (old > sequence - _options.maxSegments) break;
+            unlink(segmentPath(_dir, old).c_str());
+        }
+    }
+    return true;
+}
+
+void CrsfFrameLog::closeSegment()
+{
+    if (!_map) return;
+    publish();
+    const uint64_t used = _header->dataOffset + _dataEnd;
+    _header->closed.store(1, std::memory_order_release);
+    munmap(_map, _options.segmentSize);
+    // Зарезервированный хвост сегмента больше не нужен
+    if (ftruncate(_fd, static_cast<off_t>(used)) != 0) {
+        // Сегмент остаётся полного размера; читатель всё равно не заходит за dataEnd
+    }
+    close(_fd);
+    _fd = -1;
+    _map = nullptr;
+    _header = nullptr;
+    _index = nullptr;
+}
+
+// Сегмент, отображённый только для чтения; без заголовка CRSF_FRAME_LOG_MAGIC — пустой
+namespace {
+struct MappedSegment {
+    const uint8_t* map = nullptr;
+    size_t size = 0;
+
+    bool open(const char* path, size_t limit)
+    {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= CRSF_FRAME_LOG_HEADER_SIZE) {
+            size = limit ? std::min(limit, static_cast<size_t>(st.st_size)) : static_cast<size_t>(st.st_size);
+            p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        map = static_cast<const uint8_t*>(p);
+        const CrsfFrameLogHeader* h = header();
+        if (memcmp(h->magic, CRSF_FRAME_LOG_MAGIC, sizeof(CRSF_FRAME_LOG_MAGIC)) != 0 ||
+            h->version != CRSF_FRAME_LOG_VERSION || h->headerSize != CRSF_FRAME_LOG_HEADER_SIZE) {
+            close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    void close()
+    {
+        if (map) munmap(const_cast<uint8_t*>(map), size);
+        map = nullptr;
+    }
+
+    ~MappedSegment() { close(); }
+
+    const CrsfFrameLogHeader* header() const { return reinterpret_cast<const CrsfFrameLogHeader*>(map); }
+    // Монотонная метка сегмента в UTC
+    int64_t utc(uint64_t t) const
+    {
+        return header()->realtimeNs + (static_cast<int64_t>(t) - static_cast<int64_t>(header()->monotonicNs));
+    }
+};
+} // namespace
+
+bool CrsfFrameLogReader::open(const char* dir)
+{
+    _segments.clear();
+    DIR* d = opendir(dir);
+    if (!d) return false;
+    std::vector<uint64_t> sequences;
+    while (dirent* e = readdir(d)) {
+        uint64_t seq;
+        if (parseSegmentName(e->d_name, seq)) sequences.push_back(seq);
+    }
+    closedir(d);
+    std::sort(sequences.begin(), sequences.end());
+
+    for (uint64_t seq : sequences) {
+        Segment s;
+        s.path = segmentPath(dir, seq);
+        MappedSegment m;
+        if (!m.open(s.path.c_str(), CRSF_FRAME_LOG_HEADER_SIZE)) continue;
+        const CrsfFrameLogHeader* h = m.header();
+        s.sequence = h->sequence;
+        s.records = h->records.load(std::memory_order_acquire);
+        s.closed = h->closed.load(std::memory_order_acquire) != 0;
+        s.firstNs = s.records ? m.utc(h->firstNs.load(std::memory_order_relaxed)) : 0;
+        s.lastNs = s.records ? m.utc(h->lastNs.load(std::memory_order_relaxed)) : 0;
+        _segments.push_back(s);
+    }
+    return true;
+}
+
+bool CrsfFrameLogReader::range(int64_t& firstNs, int64_t& lastNs) const
+{
+    bool any = false;
+    for (const Segment& s : _segments) {
+        if (!s.records) continue;
+        if (!any) firstNs = s.firstNs;
+        lastNs = s.lastNs;
+        any = true;
+    }
+    return any;
+}
+
+bool CrsfFrameLogReader::query(int64_t fromNs, int64_t toNs, const std::bitset<256>* types, RecordFn fn, void* ctx,
+                               QueryStats* stats) const
+{
+    QueryStats local{};
+    QueryStats& st = stats ? *stats : local;
+    st = QueryStats{};
+    for (const Segment& seg : _segments) {
+        // Открытый сегмент ещё растёт: его конец (и даже наличие записей) из open() мог устареть
+        if (seg.closed && (seg.records == 0 || seg.lastNs < fromNs)) continue;
+        if (seg.records && seg.firstNs >= toNs) continue;
+        MappedSegment m;
+        if (!m.open(seg.path.c_str(), 0)) continue;
+        const CrsfFrameLogHeader* h = m.header();
+        if (h->dataOffset > m.size) continue;
+        ++st.segments;
+        const uint64_t dataEnd = std::min<uint64_t>(h->dataEnd.load(std::memory_order_acquire), m.size - h->dataOffset);
+        const uint32_t indexCount = std::min(h->indexCount.load(std::memory_order_acquire), h->indexCapacity);
+        const CrsfFrameLogIndexEntry* index =
+            reinterpret_cast<const CrsfFrameLogIndexEntry*>(m.map + CRSF_FRAME_LOG_HEADER_SIZE);
+        const uint8_t* data = m.map + h->dataOffset;
+
+        // Окно в монотонных метках сегмента
+        const int64_t base = static_cast<int64_t>(h->monotonicNs) - h->realtimeNs;
+        const uint64_t from = fromNs + base < 0 ? 0 : static_cast<uint64_t>(fromNs + base);
+        const uint64_t to = toNs + base < 0 ? 0 : static_cast<uint64_t>(toNs + base);
+
+        // Последняя точка индекса не позже начала окна: дальше — не больше indexIntervalMs лишних записей
+        const CrsfFrameLogIndexEntry* it = std::upper_bound(index, index + indexCount, from,
+            [](uint64_t t, const CrsfFrameLogIndexEntry& e) { return t < e.timeNs; });
+        uint64_t off = it == index ? 0 : (it - 1)->offset;
+        const uint64_t startOff = off;
+
+        while (off + CRSF_FRAME_LOG_RECORD_HEADER <= dataEnd) {
+            const uint8_t* p = data + off;
+            uint64_t t;
+            memcpy(&t, p, sizeof(t));
+            if (t >= to) break;
+            const uint8_t len = p[10];
+            if (off + CRSF_FRAME_LOG_RECORD_HEADER + len > dataEnd) break;
+            off += CRSF_FRAME_LOG_RECORD_HEADER + len;
+            ++st.scanned;
+            if (t < from || (types && !types->test(p[9]))) continue;
+            ++st.matched;
+            Record r;
+            r.timeNs = m.utc(t);
+            r.monotonicNs = t;
+            r.addr = p[8];
+            r.type = p[9];
+            r.len = len;
+            r.payload = p + CRSF_FRAME_LOG_RECORD_HEADER;
+            if (!fn(r, ctx)) {
+                st.bytes += off - startOff;
+                return true;
+            }
+        }
+        st.bytes += off - startOff;
+    }
+    return true;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+// Бортовой журнал разобранных кадров CRSF: сегментированные файлы, отображённые в память (mmap),
+// только дописываются. Чтение — CrsfFrameLogReader (утилита crsf_flog и разбор после полёта).
+//
+// Запись разделена на две стороны:
+//   append() — поток приёма (CrsfParser, на каждый кадр с верной CRC): копия кадра в очередь SPSC
+//              в памяти и одна атомарная запись; без системных вызовов, блокировок и обращений к файлу.
+//              Очередь полна — кадр выбрасывается и считается (dropped), приём не ждёт диска
+//   поток записи — забирает кадры из очереди, дописывает их в отображённый сегмент, ведёт
+//              разреженный индекс по времени и открывает следующий сегмент (ftruncate, mmap)
+//
+// Формат сегмента dir/crsf-<номер>.flog (всё little-endian, как в памяти Raspberry Pi):
+//   заголовок  4096 байт: CrsfFrameLogHeader
+//   индекс     indexCapacity записей { метка, смещение записи в данных }: запись добавляется,
+//              когда с предыдущей прошло не меньше indexIntervalMs
+//   данные     записи подряд: метка CLOCK_MONOTONIC (uint64, нс), адрес, тип, длина нагрузки (по байту),
+//              нагрузка (без CRC — она проверена при приёме)
+// Метки монотонные; для перевода в время UTC в заголовке пара realtimeNs/monotonicNs, снятая при
+// открытии сегмента. Место под сегмент резервируется сразу (posix_fallocate): запись в отображение
+// не упадёт SIGBUS на заполненном диске. Закрытый сегмент укорачивается до записанного.
+// Сегменты сверх maxSegments удаляются, начиная со старых
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crsf_protocol.h"
+
+static const char CRSF_FRAME_LOG_MAGIC[8] = { 'C', 'R', 'S', 'F', 'F', 'L', 'O', 'G' };
+static const uint32_t CRSF_FRAME_LOG_VERSION = 1;
+static const uint32_t CRSF_FRAME_LOG_HEADER_SIZE = 4096;
+// Метка, адрес, тип, длина нагрузки
+static const uint32_t CRSF_FRAME_LOG_RECORD_HEADER = 11;
+
+struct CrsfFrameLogHeader {
+    char magic[8];                          // CRSF_FRAME_LOG_MAGIC
+    uint32_t version;                       // CRSF_FRAME_LOG_VERSION
+    uint32_t headerSize;                    // CRSF_FRAME_LOG_HEADER_SIZE
+    uint64_t sequence;                      // номер сегмента (растёт и между запусками)
+    uint64_t dataOffset;                    // начало данных (после индекса)
+    uint64_t dataCapacity;                  // место под данные
+    uint32_t indexCapacity;
+    uint32_t indexIntervalMs;
+    int64_t realtimeNs;                     // CLOCK_REALTIME и CLOCK_MONOTONIC при открытии сегмента
+    uint64_t monotonicNs;
+    // Публикуются писателем после каждой пачки: всё до dataEnd и indexCount уже записано
+    std::atomic<uint64_t> dataEnd;
+    std::atomic<uint64_t> records;
+    std::atomic<uint64_t> firstNs;          // метки первой и последней записи (0 — записей нет)
+    std::atomic<uint64_t> lastNs;
+    std::atomic<uint32_t> indexCount;
+    std::atomic<uint32_t> closed;           // 1 — сегмент закрыт, файл укорочен до dataOffset + dataEnd
+};
+
+struct CrsfFrameLogIndexEntry {
+    uint64_t timeNs;
+    uint64_t offset;                        // от начала данных
+};
+
+static_assert(sizeof(CrsfFrameLogHeader) <= CRSF_FRAME_LOG_HEADER_SIZE, "заголовок сегмента");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "атомики в файле без блокировок");
+
+class CrsfFrameLog
+{
+public:
+    struct Options {
+        uint64_t segmentSize;               // байт на сегмент (заголовок, индекс и данные)
+        uint32_t indexIntervalMs;
+        uint32_t indexCapacity;             // индекс полон — следующий сегмент
+        uint32_t maxSegments;               // 0 — не удалять старые
+        uint32_t queueFrames;               // степень двойки
+        uint32_t flushMs;                   // пауза потока записи, когда очередь пуста
+    };
+    static Options defaults();
+
+    // Счётчики; из любого потока
+    struct Stats {
+        uint64_t frames;                    // принято в очередь
+        uint64_t dropped;                   // выброшено: очередь полна или сегмент не открылся
+        uint64_t written;                   // дописано в сегменты
+        uint64_t bytes;
+        uint64_t segments;                  // открыто сегментов с запуска
+        uint64_t sequence;                  // номер текущего сегмента
+    };
+
+    CrsfFrameLog();
+    ~CrsfFrameLog();
+
+    // Создать каталог (если нет), открыть сегмент со следующим номером и запустить поток записи
+    bool start(const char* dir, const Options& options = defaults());
+    // Дописать очередь, закрыть сегмент и остановить поток записи
+    void stop();
+    bool isRunning() const { return _thread.joinable(); }
+
+    // Кадр с верной CRC: frame[0] — адрес, frame[1] — длина (тип + нагрузка + CRC), frame[2] — тип.
+    // Только из одного потока (приём); timeNs — CLOCK_MONOTONIC пачки, в которой пришёл кадр
+    void append(uint64_t timeNs, const uint8_t* frame)
+    {
+        const uint64_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _headCache > _mask) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail - _headCache > _mask) {
+                _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        Slot& s = _queue[tail & _mask];
+        s.timeNs = timeNs;
+        memcpy(s.frame, frame, frame[1] + 2u);
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+
+    Stats stats() const;
+
+    static uint64_t monotonicNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+private:
+    struct Slot {
+        uint64_t timeNs;
+        uint8_t frame[CRSF_MAX_PACKET_SIZE];
+    };
+
+    // Сторона приёма и сторона записи — на разных строках кэша
+    alignas(64) std::atomic<uint64_t> _tail;
+    uint64_t _headCache;
+    std::atomic<uint64_t> _dropped;
+    alignas(64) std::atomic<uint64_t> _head;
+    std::atomic<uint64_t> _written;
+    std::atomic<uint64_t> _failed;          // кадры, которые некуда было записать (сегмент не открылся)
+    std::atomic<uint64_t> _bytes;
+    std::atomic<uint64_t> _segments;
+    std::atomic<uint64_t> _sequence;
+    std::atomic<bool> _stop;
+
+    std::unique_ptr<Slot[]> _queue;
+    uint64_t _mask;
+    Options _options;
+    std::string _dir;
+    std::thread _thread;
+
+    // Текущий сегмент (только поток записи, кроме start()/stop())
+    int _fd;
+    uint8_t* _map;
+    CrsfFrameLogHeader* _header;
+    CrsfFrameLogIndexEntry* _index;
+    uint64_t _dataEnd;
+    uint64_t _records;
+    uint32_t _indexCount;
+    uint64_t _lastIndexNs;
+    uint64_t _lastNs;
+    uint64_t _retryNs;                      // когда снова пробовать открыть сегмент после неудачи
+
+    void run();
+    // Дописать кадры из очереди; false — очередь была пуста
+    bool drain();
+    void write(const Slot& s);
+    bool openSegment(uint64_t sequence);
+    void closeSegment();
+    void publish();
+};
+
+// Чтение журнала: список сегментов и выборка окна времени. Время запросов и записей — UTC, нс
+class CrsfFrameLogReader
+{
+public:
+    struct Record {
+        int64_t timeNs;                     // UTC (по паре меток сегмента)
+        uint64_t monotonicNs;               // как записано
+        uint8_t addr;
+        uint8_t type;
+        uint8_t len;                        // длина нагрузки
+        const uint8_t* payload;
+    };
+    // false — прекратить выборку
+    typedef bool (*RecordFn)(const Record& r, void* ctx);
+
+    struct Segment {
+        std::string path;
+        uint64_t sequence;
+        uint64_t records;
+        int64_t firstNs;                    // UTC; оба 0 — сегмент пуст
+        int64_t lastNs;
+        bool closed;
+    };
+
+    // Сколько работы стоила выборка: просмотрено записей и байт данных (с учётом разреженности индекса)
+    struct QueryStats {
+        uint32_t segments;
+        uint64_t scanned;
+        uint64_t matched;
+        uint64_t bytes;
+    };
+
+    // Прочитать заголовки сегментов каталога (только первая страница каждого файла)
+    bool open(const char* dir);
+    const std::vector<Segment>& segments() const { return _segments; }
+    // Первая и последняя записи журнала, UTC; false — журнал пуст
+    bool range(int64_t& firstNs, int64_t& lastNs) const;
+
+    // Записи с меткой в [fromNs, toNs) и типом из types (nullptr — любые), по возрастанию меток.
+    // Сегмент отображается, только если окно его задевает; начало окна ищется по индексу
+    bool query(int64_t fromNs, int64_t toNs, const std::bitset<256>* types, RecordFn fn, void* ctx,
+               QueryStats* stats = nullptr) const;
+
+private:
+    std::vector<Segment> _segments;
+};
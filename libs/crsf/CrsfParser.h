@@ -0,0 +1,256 @@
+#pragma once
+
+// Разбор потока CRSF — общий для CrsfSerial и rpi/CrsfClientLinux.
+//
+// Параметры шаблона задаются при компиляции, поэтому горячий путь встраивается целиком:
+//   Transport — источник байт с readBulk(first, firstLen, second, secondLen) (SerialPort, SerialLinux)
+//   Clock     — тип со статической функцией millis() (метка времени пачки)
+//   Sink      — владелец парсера: onFrame(frame, len) для кадров с верной CRC
+//               и onSkippedByte(b) для байт, отброшенных при ресинхронизации или по таймауту
+//   Handled   — CrsfFrameTypes<...> с обрабатываемыми типами кадров; остальные кадры
+//               проверяются по CRC и пропускаются без вызова Sink
+//
+// Правила разбора:
+//   - неверная длина или неверная CRC — ресинхронизация: пропуск до следующего байта адреса
+//     (любой из crsf_addr_e, таблица CRSF_ADDRESSES) после текущего, а не отбрасывание всего заявленного кадра;
+//     испорченный байт длины не уносит с собой следующие целые кадры, в том числе кадры с адресами
+//     передатчика и приёмника (0xEA, 0xEC, 0xEE), а не только 0xC8;
+//     ошибка и ресинхронизация считаются один раз до следующего целого кадра: ложные кандидаты
+//     (байт адреса внутри нагрузки) идут только в отброшенные байты;
+//     если байта адреса в кольце нет, поиск продолжается в следующей пачке —
+//     результат разбора не зависит от того, как поток поделён на чтения
+//   - на каждую пачку одна метка времени Clock::millis() (и CLOCK_MONOTONIC для журнала кадров, если он задан)
+//   - журнал кадров (setFrameLog) получает каждый кадр с верной CRC, в том числе не входящий в Handled
+//   - счётчики (stats(), typeFrames()) — атомики с relaxed-доступом: пишет только поток разбора
+//     (обычные load/store, без lock-префикса), читать можно из любого потока (/metrics)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "crc8.h"
+#include "crsf_protocol.h"
+#include "CrsfRxRing.h"
+#include "CrsfCapture.h"
+#include "CrsfFrameLog.h"
+
+// Счётчики приёмника: сколько принято, разобрано и отброшено
+struct CrsfRxStats {
+    uint64_t bytes;         // байт прочитано из порта
+    uint32_t frames;        // кадров с верной CRC
+    uint32_t crcErrors;     // кадров с неверной CRC (кроме ложных кандидатов во время ресинхронизации)
+    uint32_t resyncs;       // ресинхронизаций после неверной длины или CRC
+    uint32_t droppedBytes;  // байт пропущено при ресинхронизации и по таймауту пакета
+    uint32_t timeouts;      // незавершённых кадров выброшено по таймауту пакета
+};
+
+// Номера типов кадров в наборе: таблица на все 256 значений байта типа
+struct CrsfFrameSlots {
+    uint8_t slot[256];
+};
+
+template <uint8_t... Types>
+constexpr CrsfFrameSlots crsf_make_frame_slots()
+{
+    CrsfFrameSlots s{};
+    for (unsigned i = 0; i < 256; ++i)
+        s.slot[i] = 0xFF;
+    const uint8_t types[] = { Types... };
+    for (unsigned i = 0; i < sizeof...(Types); ++i)
+        s.slot[types[i]] = static_cast<uint8_t>(i);
+    return s;
+}
+
+// Набор обрабатываемых типов кадров
+template <uint8_t... Types>
+struct CrsfFrameTypes
+{
+    static constexpr unsigned COUNT = sizeof...(Types);
+    static constexpr uint8_t NONE = 0xFF;
+    static_assert(COUNT > 0 && COUNT < NONE, "CrsfFrameTypes: от 1 до 254 типов");
+
+    // Номер типа в наборе (порядок аргументов шаблона); NONE — тип не обрабатывается
+    static constexpr uint8_t slot(uint8_t type) { return SLOTS.slot[type]; }
+    static constexpr bool contains(uint8_t type) { return slot(type) != NONE; }
+
+private:
+    static constexpr CrsfFrameSlots SLOTS = crsf_make_frame_slots<Types...>();
+};
+
+template <typename Transport, typename Clock, typename Sink, typename Handled>
+class CrsfParser
+{
+public:
+    CrsfParser(Transport& transport, Sink& sink)
+        : _transport(transport), _sink(sink), _bytes(0), _frames(0), _crcErrors(0), _resyncs(0), _droppedBytes(0),
+          _timeouts(0), _capture(nullptr), _frameLog(nullptr), _frameLogNs(0), _lastReceive(0), _hunting(false),
+          _resyncing(false)
+    {
+        for (std::atomic<uint32_t>& n : _typeFrames)
+            n.store(0, std::memory_order_relaxed);
+    }
+
+    // Забрать всё, что накопил драйвер, одним readv в свободную часть кольца (без разбора).
+    // Возвращает число прочитанных байт
+    int read()
+    {
+        uint8_t* first;
+        uint8_t* second;
+        size_t firstLen, secondLen;
+        _rx.freeSpans(first, firstLen, second, secondLen);
+        const int r = static_cast<int>(_transport.readBulk(first, firstLen, second, secondLen));
+        if (r <= 0) return 0;
+        _rx.commit(static_cast<uint32_t>(r));
+        bump(_bytes, static_cast<uint64_t>(r));
+        _lastReceive = Clock::millis();
+        if (_frameLog) _frameLogNs = CrsfFrameLog::monotonicNs();
+        if (_capture) {
+            const size_t firstPart = (static_cast<size_t>(r) < firstLen) ? static_cast<size_t>(r) : firstLen;
+            _capture->write(first, firstPart, second, static_cast<size_t>(r) - firstPart);
+        }
+        return r;
+    }
+
+    // Байты из источника без Transport (бенчмарки, воспроизведение): копируются в кольцо и разбираются
+    void receive(const uint8_t* data, size_t len)
+    {
+        // После разбора в кольце остаётся меньше одного кадра, поэтому каждая порция продвигается
+        while (len > 0) {
+            const uint32_t n = _rx.push(data, len > CrsfRxRing::SIZE ? CrsfRxRing::SIZE : static_cast<uint32_t>(len));
+            bump(_bytes, static_cast<uint64_t>(n));
+            data += n;
+            len -= n;
+            _lastReceive = Clock::millis();
+            if (_frameLog) _frameLogNs = CrsfFrameLog::monotonicNs();
+            parse();
+        }
+    }
+
+    // Разобрать накопленные кадры прямо в кольце, перемещая только индексы
+    void parse()
+    {
+        if (_hunting) {
+            skip(_rx.find(CRSF_ADDRESSES, 0));
+            if (_rx.empty()) return;
+            _hunting = false;
+        }
+        while (_rx.size() > 1) {
+            const uint8_t len = _rx.peek(1);
+            // Длина считает type + payload + crc; кадров без нагрузки в протоколе нет
+            if (len < 3 || len > (CRSF_MAX_PAYLOAD_LEN + 2)) {
+                resync(false);
+                continue;
+            }
+            if (_rx.size() < static_cast<uint32_t>(len + 2))
+                break; // ждём остаток кадра
+
+            const uint8_t* frame = _rx.view(len + 2, _frameBuf);
+            if (crc8_calc(&frame[2], len - 1) != frame[len + 1]) {
+                resync(true);
+                continue;
+            }
+            _resyncing = false;
+            bump(_frames);
+            bump(_typeFrames[frame[2]]);
+            if (_frameLog) _frameLog->append(_frameLogNs, frame);
+            if (Handled::contains(frame[2]))
+                _sink.onFrame(frame, len);
+            _rx.drop(len + 2);
+        }
+    }
+
+    // Отдать все байты кольца как есть (режим passthrough)
+    void drain()
+    {
+        _hunting = false;
+        _resyncing = false;
+        while (!_rx.empty()) {
+            _sink.onSkippedByte(_rx.peek(0));
+            _rx.drop(1);
+        }
+    }
+
+    // Если новых байт не было дольше timeoutMs — незавершённый кадр уже не придёт
+    void checkTimeout(uint32_t timeoutMs)
+    {
+        if (_rx.empty() || Clock::millis() - _lastReceive <= timeoutMs) return;
+        bump(_droppedBytes, _rx.size());
+        bump(_timeouts);
+        drain();
+    }
+
+    void clear()
+    {
+        _rx.clear();
+        _hunting = false;
+        _resyncing = false;
+    }
+
+    uint32_t lastReceive() const { return _lastReceive; }
+    // Снимок счётчиков; из любого потока (поля между собой не согласованы)
+    CrsfRxStats stats() const
+    {
+        CrsfRxStats s;
+        s.bytes = _bytes.load(std::memory_order_relaxed);
+        s.frames = _frames.load(std::memory_order_relaxed);
+        s.crcErrors = _crcErrors.load(std::memory_order_relaxed);
+        s.resyncs = _resyncs.load(std::memory_order_relaxed);
+        s.droppedBytes = _droppedBytes.load(std::memory_order_relaxed);
+        s.timeouts = _timeouts.load(std::memory_order_relaxed);
+        return s;
+    }
+    // Кадров с верной CRC по типу, в том числе не входящих в Handled; из любого потока
+    uint32_t typeFrames(uint8_t type) const { return _typeFrames[type].load(std::memory_order_relaxed); }
+    void setCapture(CrsfCaptureWriter* capture) { _capture = capture; }
+    void setFrameLog(CrsfFrameLog* log) { _frameLog = log; }
+
+private:
+    Transport& _transport;
+    Sink& _sink;
+    // Кольцевой буфер приёма: заполняется одним readv, разбирается на месте
+    CrsfRxRing _rx;
+    // Сборка кадра, переходящего через конец кольца (единственный случай копирования)
+    uint8_t _frameBuf[CRSF_MAX_PACKET_SIZE];
+    // Счётчики CrsfRxStats и кадры по типам
+    std::atomic<uint64_t> _bytes;
+    std::atomic<uint32_t> _frames;
+    std::atomic<uint32_t> _crcErrors;
+    std::atomic<uint32_t> _resyncs;
+    std::atomic<uint32_t> _droppedBytes;
+    std::atomic<uint32_t> _timeouts;
+    std::atomic<uint32_t> _typeFrames[256];
+    CrsfCaptureWriter* _capture;
+    CrsfFrameLog* _frameLog;
+    uint64_t _frameLogNs;       // CLOCK_MONOTONIC последней пачки (только при заданном журнале)
+    uint32_t _lastReceive;
+    // Байт адреса ещё не найден: начало кольца не считается началом кадра
+    bool _hunting;
+    // С последней ошибки не было целого кадра: следующие кандидаты не считаются новыми ошибками
+    bool _resyncing;
+
+    // Единственный писатель: сложение без атомарной операции чтения-записи
+    template <typename T>
+    static void bump(std::atomic<T>& counter, T n = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void resync(bool crcError)
+    {
+        // Текущий байт не начинает целый кадр: пропускаем всё до следующего байта адреса
+        if (!_resyncing) {
+            if (crcError) bump(_crcErrors);
+            bump(_resyncs);
+            _resyncing = true;
+        }
+        skip(_rx.find(CRSF_ADDRESSES, 1));
+        _hunting = _rx.empty();
+    }
+
+    void skip(uint32_t count)
+    {
+        bump(_droppedBytes, count);
+        for (uint32_t i = 0; i < count; ++i)
+            _sink.onSkippedByte(_rx.peek(i));
+        _rx.drop(count);
+    }
+};
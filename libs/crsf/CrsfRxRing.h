@@ -0,0 +1,93 @@
+#pragma once
+
+// Кольцевой буфер приёма CRSF.
+// Кадры разбираются перемещением индексов, байты никогда не сдвигаются.
+// Общий для CrsfSerial и rpi/CrsfClientLinux
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "crsf_protocol.h"
+
+class CrsfRxRing
+{
+public:
+    // Размер кольца (степень двойки): ~12 мс потока на 420000 бод
+    static const uint32_t SIZE = 512;
+
+    uint32_t size() const { return _tail - _head; }
+    uint32_t space() const { return SIZE - size(); }
+    bool empty() const { return _tail == _head; }
+
+    // Свободное место в виде двух непрерывных участков (для readv).
+    // Второй участок ненулевой, если свободная область переходит через конец буфера
+    void freeSpans(uint8_t*& first, size_t& firstLen, uint8_t*& second, size_t& secondLen)
+    {
+        const uint32_t free = space();
+        const uint32_t tailIdx = _tail & MASK;
+        firstLen = (free < SIZE - tailIdx) ? free : SIZE - tailIdx;
+        first = &_buf[tailIdx];
+        second = _buf;
+        secondLen = free - firstLen;
+    }
+
+    // Подтвердить n байт, записанных в участки из freeSpans()
+    void commit(uint32_t n) { _tail += n; }
+
+    // Скопировать данные в кольцо (для источников без readv). Возвращает число принятых байт
+    uint32_t push(const uint8_t* data, uint32_t len)
+    {
+        if (len > space()) len = space();
+        const uint32_t tailIdx = _tail & MASK;
+        const uint32_t first = (len < SIZE - tailIdx) ? len : SIZE - tailIdx;
+        memcpy(&_buf[tailIdx], data, first);
+        memcpy(_buf, data + first, len - first);
+        _tail += len;
+        return len;
+    }
+
+    // Байт со смещением off от начала непрочитанных данных
+    uint8_t peek(uint32_t off) const { return _buf[(_head + off) & MASK]; }
+
+    // Отбросить n байт с начала
+    void drop(uint32_t n) { _head += n; }
+    void clear() { _head = _tail; }
+
+    // Непрерывное представление первых n байт (n <= CRSF_MAX_PACKET_SIZE).
+    // Если кадр не переходит через конец кольца — указатель прямо в буфер,
+    // иначе кадр собирается в scratch (единственный случай копирования)
+    const uint8_t* view(uint32_t n, uint8_t* scratch) const
+    {
+        const uint32_t headIdx = _head & MASK;
+        if (headIdx + n <= SIZE)
+            return &_buf[headIdx];
+        const uint32_t first = SIZE - headIdx;
+        memcpy(scratch, &_buf[headIdx], first);
+        memcpy(scratch + first, _buf, n - first);
+        return scratch;
+    }
+
+    // Смещение первого байта из set, начиная с from; size(), если не найден.
+    // Проход по одному-двум непрерывным участкам с поиском в таблице на каждый байт
+    uint32_t find(const CrsfAddressSet& set, uint32_t from) const
+    {
+        const uint32_t n = size();
+        for (uint32_t i = from; i < n;) {
+            const uint32_t idx = (_head + i) & MASK;
+            const uint32_t span = (n - i < SIZE - idx) ? n - i : SIZE - idx;
+            for (uint32_t k = 0; k < span; ++k)
+                if (set.is[_buf[idx + k]]) return i + k;
+            i += span;
+        }
+        return n;
+    }
+
+private:
+    static const uint32_t MASK = SIZE - 1;
+    static_assert((SIZE & MASK) == 0, "размер кольца должен быть степенью двойки");
+    static_assert(SIZE >= 2 * CRSF_MAX_PACKET_SIZE, "кольцо должно вмещать хотя бы два кадра");
+
+    uint8_t _buf[SIZE]{};
+    uint32_t _head{0}; // позиция чтения (свободно бегущий индекс)
+    uint32_t _tail{0}; // позиция записи (свободно бегущий индекс)
+};
@@ -1,4 +1,5 @@
 #include "CrsfSerial.h"
+#include "crsf_channels.h"
 #include <cstring>
 #include "../log.h"
 #include "../../telemetry_server.h"
@@ -37,14 +38,21 @@
 
 // Конструктор под Raspberry Pi: SerialPort уже открыт с нужной скоростью
 CrsfSerial::CrsfSerial(SerialPort& port, uint32_t baud) :
-    _port(port), _crc(0xd5), _baud(baud),
-    _lastReceive(0), _lastChannelsPacket(0), _linkIsUp(false),
-    _passthroughMode(false),
+    _lastReceive(0),
+    onLinkUp(nullptr), onLinkDown(nullptr), onPacketChannels(nullptr),
+    onShiftyByte(nullptr), onPacketLinkStatistics(nullptr), onPacketGps(nullptr),
+    _port(port), _parser(port, *this), _telemetryDirty(false),
+    _linkStatistics{}, _gpsSensor{},
     _batteryVoltage(0.0), _batteryCurrent(0.0), _batteryCapacity(0.0), _batteryRemaining(0),
     _attitudeRoll(0.0), _attitudePitch(0.0), _attitudeYaw(0.0),
-    _rawAttitudeBytes{0, 0, 0}
+    _rawAttitudeBytes{0, 0, 0},
+    _baud(baud), _lastChannelsPacket(0), _linkIsUp(false),
+    _passthroughMode(false), _channels{},
+    _pendingMask(0), _pendingChannels{}, _channelsFrame(0), _inputNs{}, _latency(nullptr), _rxBatchNs(0),
+    _txFrames(0), _txBytes(0), _txErrors(0), _txShortWrites(0)
 {
-    // Ничего дополнительно не делаем: открытие и настройка порта снаружи
+    // Открытие и настройка порта снаружи; здесь только начальный снимок для читателей
+    publishTelemetry();
 }
 
 // Call from main loop to update
@@ -55,71 +63,59 @@ void CrsfSerial::loop()
 
 void CrsfSerial::handleSerialIn()
 {
-    // Читаем не более 32 байт за раз, чтобы не блокировать основной цикл
-    for (int i = 0; i < 32; ++i) { 
-        uint8_t b;
-        int r = _port.readByte(b);
-        if (r <= 0) {
-            break; // Прерываем, если в порту больше нет данных
-        }
-
-        _lastReceive = rpi_millis();
-
-        if (_passthroughMode) {
-            if (onShiftyByte)
-                onShiftyByte(b);
-            continue;
-        }
-
-        _rxBuf[_rxBufPos++] = b;
-        handleByteReceived();
-
-        if (_rxBufPos == CRSF_MAX_PACKET_SIZE) {
-            _rxBufPos = 0;
-        }
+    // Метка до read(): байты уже лежат в драйвере, задержка приёма считается от их выборки
+    if (_latency)
+        _rxBatchNs = LatencyHistogram::monotonicNs();
+    // Забираем всё, что накопил драйвер, одним системным вызовом в свободную часть кольца
+    if (_parser.read() > 0) {
+        // Одна метка времени на всю пачку байт
+        _lastReceive = _parser.lastReceive();
+        if (_passthroughMode)
+            _parser.drain();
+        else
+            _parser.parse();
     }
 
-    checkPacketTimeout();
+    // If we haven't received data in a long time, flush the buffer a byte at a time (to trigger shiftyByte)
+    _parser.checkTimeout(CRSF_PACKET_TIMEOUT_MS);
     checkLinkDown();
+
+    // Один снимок на пачку, а не на кадр
+    if (_telemetryDirty)
+        publishTelemetry();
 }
 
-void CrsfSerial::handleByteReceived()
+void CrsfSerial::receive(const uint8_t* data, size_t len)
 {
-    bool reprocess;
-    do {
-        reprocess = false;
-        if (_rxBufPos > 1) {
-            uint8_t len = _rxBuf[1];
-            // Sanity check the declared length isn't outside Type + X{1,CRSF_MAX_PAYLOAD_LEN} + CRC
-            // assumes there never will be a CRSF message that just has a type and no data (X)
-            if (len < 3 || len >(CRSF_MAX_PAYLOAD_LEN + 2)) {
-                shiftRxBuffer(1);
-                reprocess = true;
-            }
-
-            else if (_rxBufPos >= (len + 2)) {
-                uint8_t inCrc = _rxBuf[2 + len - 1];
-                uint8_t crc = _crc.calc(&_rxBuf[2], len - 1);
-                if (crc == inCrc) {
-                    processPacketIn(len);
-                    shiftRxBuffer(len + 2);
-                    reprocess = true;
-                } else {
-                    // Отбрасываем ВЕСЬ битый пакет, а не один байт
-                    shiftRxBuffer(len + 2);
-                    reprocess = true;
-                }
-            }  // if complete packet
-        } // if pos > 1
-    } while (reprocess);
+    if (_latency)
+        _rxBatchNs = LatencyHistogram::monotonicNs();
+    _parser.receive(data, len);
+    _lastReceive = _parser.lastReceive();
+    if (_telemetryDirty)
+        publishTelemetry();
 }
 
-void CrsfSerial::checkPacketTimeout()
+void CrsfSerial::publishTelemetry()
 {
-    // If we haven't received data in a long time, flush the buffer a byte at a time (to trigger shiftyByte)
-    if (_rxBufPos > 0 && rpi_millis() - _lastReceive > CRSF_PACKET_TIMEOUT_MS)
-        while (_rxBufPos)
-            shiftRxBuffer(1);
+    CrsfTelemetry t;
+    t.lastReceive = _lastReceive;
+    t.linkUp = _linkIsUp;
+    memcpy(t.channels, _channels, sizeof(t.channels));
+    t.linkStatistics = _linkStatistics;
+    t.gps = _gpsSensor;
+    t.batteryVoltage = _batteryVoltage;
+    t.batteryCurrent = _batteryCurrent;
+    t.batteryCapacity = _batteryCapacity;
+    t.batteryRemaining = _batteryRemaining;
+    t.attitudeRoll = _attitudeRoll;
+    t.attitudePitch = _attitudePitch;
+    t.attitudeYaw = _attitudeYaw;
+    t.rawAttitude[0] = getRawAttitudeRoll();
+    t.rawAttitude[1] = getRawAttitudePitch();
+    t.rawAttitude[2] = getRawAttitudeYaw();
+    t.rxStats = _parser.stats();
+    _telemetry.write(t);
+    _telemetryDirty = false;
 }
 
 void CrsfSerial::checkLinkDown()
@@ -129,95 +125,51 @@ void CrsfSerial::checkLinkDown()
         if (onLinkDown)
             onLinkDown();
         _linkIsUp = false;
+        _telemetryDirty = true;
     }
 }
 
-void CrsfSerial::processPacketIn(uint8_t len)
+const CrsfSerial::PacketHandler CrsfSerial::PACKET_HANDLERS[CrsfSerialFrames::COUNT] = {
+    &CrsfSerial::packetGps,
+    &CrsfSerial::packetChannelsPacked,
+    &CrsfSerial::packetLinkStatistics,
+    &CrsfSerial::packetAttitude,
+    &CrsfSerial::packetFlightMode,
+    &CrsfSerial::packetBatterySensor,
+};
+static_assert(CrsfSerialFrames::COUNT == 6 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_GPS) == 0 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_RC_CHANNELS_PACKED) == 1 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_LINK_STATISTICS) == 2 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_ATTITUDE) == 3 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_FLIGHT_MODE) == 4 &&
+              CrsfSerialFrames::slot(CRSF_FRAMETYPE_BATTERY_SENSOR) == 5,
+              "PACKET_HANDLERS не совпадает с порядком CrsfSerialFrames");
+
+void CrsfSerial::onFrame(const uint8_t* frame, uint8_t len)
 {
-    const crsf_header_t* hdr = (crsf_header_t*)_rxBuf;
+    (void)len;
+    const crsf_header_t* hdr = (const crsf_header_t*)frame;
+    // Парсер передаёт только типы из CrsfSerialFrames, поэтому номер ячейки всегда есть
+    const uint8_t slot = CrsfSerialFrames::slot(hdr->type);
     if (hdr->device_addr == CRSF_ADDRESS_FLIGHT_CONTROLLER) {
-        switch (hdr->type) {
-        case CRSF_FRAMETYPE_GPS:
-            packetGps(hdr);
-            break;
-        case CRSF_FRAMETYPE_RC_CHANNELS_PACKED:
-            // softSerial.println("CRSF_FRAMETYPE_RC_CHANNELS_PACKED");
-            packetChannelsPacked(hdr);
-            break;
-        case CRSF_FRAMETYPE_LINK_STATISTICS:
-            packetLinkStatistics(hdr);
-            break;
-        case CRSF_FRAMETYPE_ATTITUDE:
-            packetAttitude(hdr);
-            break;
-        case CRSF_FRAMETYPE_FLIGHT_MODE:
-            packetFlightMode(hdr);
-            break;
-        case CRSF_FRAMETYPE_BATTERY_SENSOR:
-            packetBatterySensor(hdr);
-            break;
-        default:
-        // Неизвестный тип пакета
-        break;
-        }
-    } // CRSF_ADDRESS_FLIGHT_CONTROLLER
-}
-
-// Shift the bytes in the RxBuf down by cnt bytes
-void CrsfSerial::shiftRxBuffer(uint8_t cnt)
-{
-    // If removing the whole thing, just set pos to 0
-    if (cnt >= _rxBufPos) {
-        _rxBufPos = 0;
-        return;
+        (this->*PACKET_HANDLERS[slot])(hdr);
+        _telemetryDirty = true;
     }
-
-    if (cnt == 1 && onShiftyByte)
-        onShiftyByte(_rxBuf[0]);
-
-    // Otherwise do the slow shift down
-    uint8_t* src = &_rxBuf[cnt];
-    uint8_t* dst = &_rxBuf[0];
-    _rxBufPos -= cnt;
-    uint8_t left = _rxBufPos;
-    while (left--)
-        *dst++ = *src++;
+    _dispatch.dispatch(slot, hdr, _parser.lastReceive());
+    if (_latency)
+        _latency->rx.record(LatencyHistogram::monotonicNs() - _rxBatchNs);
 }
 
 void CrsfSerial::packetChannelsPacked(const crsf_header_t* p)
 {
-    crsf_channels_t* ch = (crsf_channels_t*)&p->data;
-    _channels[0] = ch->ch0;
-    _channels[1] = ch->ch1;
-    _channels[2] = ch->ch2;
-    _channels[3] = ch->ch3;
-    _channels[4] = ch->ch4;
-    _channels[5] = ch->ch5;
-    _channels[6] = ch->ch6;
-    _channels[7] = ch->ch7;
-    _channels[8] = ch->ch8;
-    _channels[9] = ch->ch9;
-    _channels[10] = ch->ch10;
-    _channels[11] = ch->ch11;
-    _channels[12] = ch->ch12;
-    _channels[13] = ch->ch13;
-    _channels[14] = ch->ch14;
-    _channels[15] = ch->ch15;
-
-    // Преобразование CRSF-кода в микросекунды (1000..2000) с точным округлением
-    const int crsfDelta = (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000);
-    for (unsigned int i = 0; i < CRSF_NUM_CHANNELS; ++i) {
-        int code = _channels[i];
-        if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
-        if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
-        int num = (code - CRSF_CHANNEL_VALUE_1000) * 1000;
-        _channels[i] = 1000 + (num + crsfDelta / 2) / crsfDelta; // округление к ближайшему
-    }
+    // Распаковка 16x11 бит и перевод в мкс (1000..2000) по таблице с округлением к ближайшему
+    crsf_channels_decode(p->data, _channels);
 
     if (!_linkIsUp && onLinkUp)
         onLinkUp();
     _linkIsUp = true;
-    _lastChannelsPacket = rpi_millis();
+    _lastChannelsPacket = _parser.lastReceive();
 
     if (onPacketChannels)
         onPacketChannels();
@@ -256,14 +208,14 @@ void CrsfSerial::write(const uint8_t* buf, size_t len)
     _port.write(buf, len);
 }
 
-void CrsfSerial::queuePacket(uint8_t addr, uint8_t type, const void* payload, uint8_t len)
+bool CrsfSerial::queuePacket(uint8_t addr, uint8_t type, const void* payload, uint8_t len)
 {
     if (!_linkIsUp)
-        return;
+        return false;
     if (_passthroughMode)
-        return;
+        return false;
     if (len > CRSF_MAX_PAYLOAD_LEN)
-        return;
+        return false;
 
     // uint8_t* t = (uint8_t*)payload;
     // for (int i = 0; i < 22; i++) {
@@ -275,7 +227,7 @@ void CrsfSerial::queuePacket(uint8_t addr, uint8_t type, const void* payload, ui
     buf[1] = len + 2; // type + payload + crc
     buf[2] = type;
     memcpy(buf + 3, payload, len);
-    buf[len + 3] = _crc.calc(&buf[2], len + 1);
+    buf[len + 3] = crc8_calc(&buf[2], len + 1);
     // buf[len + 4] = 0x45;
     // buf[3] = 0x03;
     // Busywait until the serial port seems free
@@ -289,8 +241,30 @@ void CrsfSerial::queuePacket(uint8_t addr, uint8_t type, const void* payload, ui
     //         Serial.print(0, BYTE);
     //     }
     // }
-    write(buf, len + 4);
+    // Неблокирующий порт: при переполненном буфере передатчика кадр не ждёт, а считается потерянным
+    const int written = _port.write(buf, len + 4);
+    if (written < 0) {
+        _txErrors.store(_txErrors.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    _txBytes.store(_txBytes.load(std::memory_order_relaxed) + static_cast<uint64_t>(written), std::memory_order_relaxed);
+    if (written < len + 4) {
+        _txShortWrites.store(_txShortWrites.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    _txFrames.store(_txFrames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     // log_info("CRSF: отправлен пакет типа " + std::to_string(type));
+    return true;
+}
+
+CrsfTxStats CrsfSerial::txStats() const
+{
+    CrsfTxStats s;
+    s.frames = _txFrames.load(std::memory_order_relaxed);
+    s.bytes = _txBytes.load(std::memory_order_relaxed);
+    s.errors = _txErrors.load(std::memory_order_relaxed);
+    s.shortWrites = _txShortWrites.load(std::memory_order_relaxed);
+    return s;
 }
 
 void CrsfSerial::setPassthroughMode(bool val, unsigned int baud)
@@ -298,62 +272,78 @@ void CrsfSerial::setPassthroughMode(bool val, unsigned int baud)
     _passthroughMode = val;
     // На Raspberry Pi не перенастраиваем порт здесь; просто очищаем буфер
     _port.flush();
+    _parser.clear();
 }
 
-void CrsfSerial::packetChannelsSend()
+uint32_t CrsfSerial::queueChannels(uint16_t mask, const int* values, unsigned source)
 {
+    const uint64_t inputNs = _latency ? LatencyHistogram::monotonicNs() : 0;
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+    if (inputNs && source < CRSF_INPUT_SOURCES && (!_inputNs[source] || inputNs < _inputNs[source]))
+        _inputNs[source] = inputNs;
+    for (unsigned ch = 0; ch < CRSF_NUM_CHANNELS; ++ch)
+        if (mask & (1u << ch))
+            _pendingChannels[ch] = values[ch];
+    _pendingMask |= mask;
+    // packetChannelsSend() забирает очередь, пишет кадр и увеличивает номер под этим же мьютексом:
+    // между ними очередь не бывает забрана без результата записи. Номер растёт только за ушедший кадр,
+    // а неушедшие значения остаются в _channels — их понесёт ближайший ушедший кадр, он и следующий по номеру
+    return _channelsFrame.load(std::memory_order_relaxed) + 1;
+}
 
-    static int channels[CRSF_NUM_CHANNELS];
-    const int crsfDelta = (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000);
-    for (unsigned int i = 0; i < CRSF_NUM_CHANNELS; ++i) {
-        int usTarget = _channels[i];
-        if (usTarget < 1000) usTarget = 1000;
-        if (usTarget > 2000) usTarget = 2000;
-
-        // Первичное кодирование (округление к ближайшему)
-        int num = (usTarget - 1000) * crsfDelta;
-        int code = CRSF_CHANNEL_VALUE_1000 + (num + 500) / 1000;
-        if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
-        if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
-
-        // Проверка: декодирование должно дать ровно usTarget
-        int decodedUs = 1000 + ((code - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
-        if (decodedUs < usTarget && code < CRSF_CHANNEL_VALUE_2000) {
-            // Подправим вверх до точного совпадения, шаг обычно <= 1
-            int code2 = code + 1;
-            int decoded2 = 1000 + ((code2 - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
-            if (decoded2 == usTarget) code = code2;
-        } else if (decodedUs > usTarget && code > CRSF_CHANNEL_VALUE_1000) {
-            int code2 = code - 1;
-            int decoded2 = 1000 + ((code2 - CRSF_CHANNEL_VALUE_1000) * 1000 + crsfDelta / 2) / crsfDelta;
-            if (decoded2 == usTarget) code = code2;
+void CrsfSerial::markInput(unsigned source, uint64_t inputNs)
+{
+    if (!_latency || source >= CRSF_INPUT_SOURCES || !inputNs)
+        return;
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+    if (!_inputNs[source] || inputNs < _inputNs[source])
+        _inputNs[source] = inputNs;
+}
+
+bool CrsfSerial::packetChannelsSend()
+{
+    // Вводы, которые понесёт этот кадр: забираются вместе с очередью уставок
+    uint64_t inputNs[CRSF_INPUT_SOURCES] = {};
+    bool sent;
+    {
+        // Мьютекс держится до результата записи (неблокирующий write(), единицы микросекунд), чтобы номер кадра
+        // из queueChannels() был номером кадра, который действительно понесёт значения
+        std::lock_guard<std::mutex> lock(_pendingMutex);
+        if (_pendingMask) {
+            for (unsigned ch = 0; ch < CRSF_NUM_CHANNELS; ++ch)
+                if (_pendingMask & (1u << ch))
+                    setChannel(ch + 1, _pendingChannels[ch]);
+            _pendingMask = 0;
         }
 
-        channels[i] = code;
+        // Кодирование по таблице: decode(encode(us)) == us для любого значения 1000..2000
+        uint8_t payload[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE];
+        crsf_channels_encode(_channels, payload);
+
+        if (!_linkIsUp)
+            _telemetryDirty = true;
+        _linkIsUp = true;
+        _passthroughMode = false;
+        sent = queuePacket(CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, payload, sizeof(payload));
+        // Номер растёт только за ушедший кадр; неушедшие значения уже в _channels и уйдут со следующим
+        if (sent)
+            _channelsFrame.store(_channelsFrame.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        // Вводы забираются только за ушедший кадр, иначе отсчёт задержки остаётся до следующего
+        if (_latency && sent) {
+            memcpy(inputNs, _inputNs, sizeof(inputNs));
+            memset(_inputNs, 0, sizeof(_inputNs));
+        }
     }
-
-    crsf_channels_t ch;
-    ch.ch0 = channels[0];
-    ch.ch1 = channels[1];
-    ch.ch2 = channels[2];
-    ch.ch3 = channels[3];
-    ch.ch4 = channels[4];
-    ch.ch5 = channels[5];
-    ch.ch6 = channels[6];
-    ch.ch7 = channels[7];
-    ch.ch8 = channels[8];
-    ch.ch9 = channels[9];
-    ch.ch10 = channels[10];
-    ch.ch11 = channels[11];
-    ch.ch12 = channels[12];
-    ch.ch13 = channels[13];
-    ch.ch14 = channels[14];
-    ch.ch15 = channels[15];
-
-
-    _linkIsUp = true;
-    _passthroughMode = false;
-    queuePacket(CRSF_ADDRESS_FLIGHT_CONTROLLER, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, (void*)&ch, 22);
+    if (_latency && sent) {
+        const uint64_t nowNs = LatencyHistogram::monotonicNs();
+        for (unsigned i = 0; i < CRSF_INPUT_SOURCES; ++i)
+            if (inputNs[i])
+                _latency->input[i].record(nowNs > inputNs[i] ? nowNs - inputNs[i] : 0);
+    }
+    // Каналы не менялись с прошлой отправки — читателям нечего будить
+    if (_telemetryDirty)
+        publishTelemetry();
+    return sent;
 }
 
 void CrsfSerial::packetAttitude(const crsf_header_t* p)
@@ -1,14 +1,84 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <mutex>
 #include "crc8.h"
 #include "crsf_protocol.h"
+#include "CrsfParser.h"
+#include "CrsfDispatch.h"
+#include "../LatencyHistogram.h"
 #include "../SerialPort.h"
+#include "../Seqlock.h"
 #include "../rpi_hal.h"
 
 enum eFailsafeAction { fsaNoPulses, fsaHold };
 
+// Согласованный снимок состояния CrsfSerial для других потоков (веб-сервер, запись): см. CrsfSerial::telemetry()
+struct CrsfTelemetry {
+    uint32_t lastReceive;                  // rpi_millis() последней пачки байт
+    bool linkUp;
+    int channels[CRSF_NUM_CHANNELS];       // мкс
+    crsfLinkStatistics_t linkStatistics;
+    crsf_sensor_gps_t gps;                 // уже в порядке байт хоста
+    double batteryVoltage;
+    double batteryCurrent;
+    double batteryCapacity;
+    uint8_t batteryRemaining;
+    double attitudeRoll;
+    double attitudePitch;
+    double attitudeYaw;
+    int16_t rawAttitude[3];                // [0]=roll, [1]=pitch, [2]=yaw
+    CrsfRxStats rxStats;
+};
+
+// Счётчики передачи queuePacket(); пишет только поток отправки, читать можно из любого потока
+struct CrsfTxStats {
+    uint64_t frames;        // кадров записано целиком
+    uint64_t bytes;         // байт принято write()
+    uint64_t errors;        // write() вернул ошибку (порт закрыт, EAGAIN, EIO)
+    uint64_t shortWrites;   // write() принял часть кадра: остаток потерян
+};
+
+// Источники уставок каналов для гистограмм задержки
+enum CrsfInputSource : unsigned {
+    CRSF_INPUT_JOYSTICK,
+    CRSF_INPUT_HTTP,        // /api/command, /api/channels, /api/ws
+    CRSF_INPUT_UDP,
+    CRSF_INPUT_SHM,
+    CRSF_INPUT_SOURCES
+};
+// Имя источника для API и /metrics
+inline const char* crsf_input_name(unsigned source)
+{
+    static const char* const NAMES[CRSF_INPUT_SOURCES] = { "joystick", "http", "udp", "shm" };
+    return source < CRSF_INPUT_SOURCES ? NAMES[source] : "unknown";
+}
+
+// Сквозные задержки (нс, CLOCK_MONOTONIC); пишет главный поток, читает и сбрасывает веб-сервер.
+// Один объект на все порты: задержку несёт тот порт, что сейчас активен
+struct CrsfLatencyStats {
+    // От ввода (см. CrsfSerial::markInput) до возврата write() первого кадра каналов, который понёс значение
+    LatencyHistogram input[CRSF_INPUT_SOURCES];
+    // От чтения пачки байт из UART до конца обработчиков и подписчиков кадра, завершённого этой пачкой
+    LatencyHistogram rx;
+};
+
+// Часы для CrsfParser: rpi_millis()
+struct RpiClock
+{
+    static uint32_t millis() { return rpi_millis(); }
+};
+
+class CrsfSerial;
+// Типы кадров, которые разбирает CrsfSerial; остальные пропускаются после проверки CRC
+typedef CrsfFrameTypes<CRSF_FRAMETYPE_GPS, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, CRSF_FRAMETYPE_LINK_STATISTICS,
+                       CRSF_FRAMETYPE_ATTITUDE, CRSF_FRAMETYPE_FLIGHT_MODE, CRSF_FRAMETYPE_BATTERY_SENSOR>
+    CrsfSerialFrames;
+typedef CrsfParser<SerialPort, RpiClock, CrsfSerial, CrsfSerialFrames> CrsfSerialParser;
+typedef CrsfDispatch<CrsfSerialFrames> CrsfSerialDispatch;
+
 // Реализация CRSF поверх SerialPort (Raspberry Pi)
 class CrsfSerial
 {
@@ -21,9 +91,12 @@ uint32_t _lastReceive; // время последнего приёма (мс), r
 // Конструктор: принимает ссылку на SerialPort и скорость
 CrsfSerial(SerialPort& port, uint32_t baud = CRSF_BAUDRATE);
 void loop();
+// Разобрать байты из источника без UART (бенчмарки, воспроизведение) так же, как прочитанные в loop()
+void receive(const uint8_t* data, size_t len);
 void write(uint8_t b);
 void write(const uint8_t* buf, size_t len);
-void queuePacket(uint8_t addr, uint8_t type, const void* payload, uint8_t len);
+// true — кадр записан в порт целиком
+bool queuePacket(uint8_t addr, uint8_t type, const void* payload, uint8_t len);
 
 // Return current channel value (1-based) in us
 int getChannel(unsigned int ch) const
@@ -33,9 +106,24 @@ int getChannel(unsigned int ch) const
 
 void setChannel(unsigned int ch, int value)
 {
-    _channels[ch - 1] = value;
+    if (_channels[ch - 1] != value) {
+        _channels[ch - 1] = value;
+        _telemetryDirty = true;
+    }
     }
 
+    // Уставки каналов из других потоков (веб-сервер). Применяются все сразу в ближайшем packetChannelsSend(),
+    // поэтому один кадр не несёт половину набора. mask: бит 0 — канал 1; values[ch - 1] — мкс для каналов из mask.
+    // Возвращает номер кадра каналов, который их понесёт (см. channelsFrame()).
+    // Момент вызова — ввод источника source для гистограмм задержки (см. markInput())
+    uint32_t queueChannels(uint16_t mask, const int* values, unsigned source = CRSF_INPUT_HTTP);
+    // Ввод источника source в момент inputNs (CLOCK_MONOTONIC): задержка до write() ближайшего кадра каналов
+    // попадёт в гистограмму источника. Из любого потока; до отправки кадра учитывается самый ранний ввод.
+    // Без setLatencyStats() ничего не делает
+    void markInput(unsigned source, uint64_t inputNs);
+    // Номер последнего отправленного кадра каналов: растёт на 1 в каждом успешном packetChannelsSend()
+    uint32_t channelsFrame() const { return _channelsFrame.load(std::memory_order_acquire); }
+
     const crsfLinkStatistics_t* getLinkStatistics() const { return &_linkStatistics; }
     const crsf_sensor_gps_t* getGpsSensor() const { return &_gpsSensor; }
     
@@ -60,6 +148,31 @@ void setChannel(unsigned int ch, int value)
     bool getPassthroughMode() const { return _passthroughMode; }
     void setPassthroughMode(bool val, unsigned int baud = 0);
 
+    CrsfRxStats rxStats() const { return _parser.stats(); }
+    // Кадров с верной CRC по типу (все типы, не только CrsfSerialFrames)
+    uint32_t rxTypeFrames(uint8_t type) const { return _parser.typeFrames(type); }
+    CrsfTxStats txStats() const;
+    // Писать каждую прочитанную пачку байт в файл захвата (nullptr — выключить)
+    void setCapture(CrsfCaptureWriter* capture) { _parser.setCapture(capture); }
+    // Дописывать каждый кадр с верной CRC в бортовой журнал (nullptr — выключить)
+    void setFrameLog(CrsfFrameLog* log) { _parser.setFrameLog(log); }
+    // Гистограммы сквозных задержек (nullptr — не вести). Задаётся до запуска цикла и веб-сервера
+    void setLatencyStats(CrsfLatencyStats* latency) { _latency = latency; }
+
+    // Подписка на принятые кадры типа из CrsfSerialFrames (до 4 подписчиков на тип, с любого адреса).
+    // Подписчики вызываются после встроенного обработчика, в порядке подписки
+    bool subscribe(uint8_t type, CrsfFrameFn fn, void* ctx) { return _dispatch.subscribe(type, fn, ctx); }
+    bool unsubscribe(uint8_t type, CrsfFrameFn fn, void* ctx) { return _dispatch.unsubscribe(type, fn, ctx); }
+
+    // Последний опубликованный снимок; из любого потока, не блокирует loop().
+    // Снимок публикуется только при изменениях: в конце loop()/receive(), если пришли кадры
+    // или сменилось состояние линка, и при отправке каналов, если они изменились
+    CrsfTelemetry telemetry(uint32_t* retries = nullptr) const { return _telemetry.read(retries); }
+    // Номер снимка: растёт при каждой публикации
+    uint32_t telemetryVersion() const { return _telemetry.version(); }
+    // Спать до снимка новее version, не дольше timeoutMs; true — есть новый снимок
+    bool waitTelemetry(uint32_t version, uint32_t timeoutMs) const { return _telemetry.waitChange(version, timeoutMs); }
+
     // Event Handlers
     void (*onLinkUp)();
     void (*onLinkDown)();
@@ -68,15 +181,20 @@ void setChannel(unsigned int ch, int value)
     void (*onPacketLinkStatistics)(crsfLinkStatistics_t* ls);
     void (*onPacketGps)(crsf_sensor_gps_t* gpsSensor);
 
-    void packetChannelsSend();
+    // Кадр каналов с уставками из очереди. false — кадр не ушёл целиком (порт закрыт, буфер передатчика полон,
+    // режим passthrough); номер кадра тогда не растёт, а значения понесёт следующий вызов
+    bool packetChannelsSend();
     void packetAttitude(const crsf_header_t* p);
     void packetFlightMode(const crsf_header_t* p);
     void packetBatterySensor(const crsf_header_t* p);
 private:
+    friend CrsfSerialParser;
+
     SerialPort& _port;
-    uint8_t _rxBuf[CRSF_MAX_PACKET_SIZE];
-    uint8_t _rxBufPos;
-    Crc8 _crc;
+    CrsfSerialParser _parser;
+    CrsfSerialDispatch _dispatch;
+    Seqlock<CrsfTelemetry> _telemetry;
+    bool _telemetryDirty;
     crsfLinkStatistics_t _linkStatistics;
     crsf_sensor_gps_t _gpsSensor;
     
@@ -100,14 +218,39 @@ private:
     bool _passthroughMode;
     int _channels[CRSF_NUM_CHANNELS];
 
+    // Очередь queueChannels(): под _pendingMutex, забирается в packetChannelsSend()
+    std::mutex _pendingMutex;
+    uint16_t _pendingMask;
+    int _pendingChannels[CRSF_NUM_CHANNELS];
+    std::atomic<uint32_t> _channelsFrame;
+    // Самый ранний неотправленный ввод по источникам (0 — нет); под _pendingMutex
+    uint64_t _inputNs[CRSF_INPUT_SOURCES];
+
+    CrsfLatencyStats* _latency;
+    uint64_t _rxBatchNs;    // метка чтения текущей пачки байт, только при _latency
+
+    // Счётчики CrsfTxStats
+    std::atomic<uint64_t> _txFrames;
+    std::atomic<uint64_t> _txBytes;
+    std::atomic<uint64_t> _txErrors;
+    std::atomic<uint64_t> _txShortWrites;
+
     void handleSerialIn();
-    void handleByteReceived();
-    void shiftRxBuffer(uint8_t cnt);
-    void processPacketIn(uint8_t len);
-    void checkPacketTimeout();
     void checkLinkDown();
+    void publishTelemetry();
+
+    // Обработчики CrsfParser
+    void onFrame(const uint8_t* frame, uint8_t len);
+    void onSkippedByte(uint8_t b)
+    {
+        if (onShiftyByte)
+            onShiftyByte(b);
+    }
 
     // Packet Handlers
+    // Встроенные обработчики кадров для адреса полётного контроллера, в порядке CrsfSerialFrames
+    typedef void (CrsfSerial::*PacketHandler)(const crsf_header_t* p);
+    static const PacketHandler PACKET_HANDLERS[CrsfSerialFrames::COUNT];
     void packetChannelsPacked(const crsf_header_t* p);
     void packetLinkStatistics(const crsf_header_t* p);
     void packetGps(const crsf_header_t* p);
@@ -1,29 +1,59 @@
 #include "crc8.h"
 
-Crc8::Crc8(uint8_t poly)
+// Таблица T[k][i] — CRC байта i, за которым следуют k нулевых байт.
+// CRC линейна по XOR, поэтому восемь байт b0..b7 дают
+//   crc' = T[7][crc ^ b0] ^ T[6][b1] ^ ... ^ T[0][b7]
+// и восемь независимых поисков вместо цепочки из восьми зависимых
+struct Crc8Tables
 {
-    init(poly);
-}
+    uint8_t t[8][256];
+};
 
-void Crc8::init(uint8_t poly)
+static constexpr Crc8Tables makeTables(uint8_t poly)
 {
-    for (int idx=0; idx<256; ++idx)
-    {
-        uint8_t crc = idx;
-        for (int shift=0; shift<8; ++shift)
-        {
-            crc = (crc << 1) ^ ((crc & 0x80) ? poly : 0);
-        }
-        _lut[idx] = crc & 0xff;
+    Crc8Tables tables{};
+    for (int idx = 0; idx < 256; ++idx) {
+        uint8_t crc = static_cast<uint8_t>(idx);
+        for (int shift = 0; shift < 8; ++shift)
+            crc = static_cast<uint8_t>((crc << 1) ^ ((crc & 0x80) ? poly : 0));
+        tables.t[0][idx] = crc;
     }
+    for (int k = 1; k < 8; ++k)
+        for (int idx = 0; idx < 256; ++idx)
+            tables.t[k][idx] = tables.t[0][tables.t[k - 1][idx]];
+    return tables;
 }
 
-uint8_t Crc8::calc(uint8_t *data, uint8_t len)
+static constexpr Crc8Tables CRC8_TABLES = makeTables(0xD5);
+
+static constexpr uint8_t bytewise(const uint8_t *data, size_t len)
 {
     uint8_t crc = 0;
     while (len--)
-    {
-        crc = _lut[crc ^ *data++];
+        crc = CRC8_TABLES.t[0][crc ^ *data++];
+    return crc;
+}
+
+// Контрольное значение CRC-8/DVB-S2 для "123456789"
+static constexpr uint8_t CHECK_INPUT[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+static_assert(bytewise(CHECK_INPUT, sizeof(CHECK_INPUT)) == 0xBC, "CRC-8/DVB-S2");
+
+uint8_t crc8_calc_bytewise(const uint8_t *data, size_t len)
+{
+    return bytewise(data, len);
+}
+
+uint8_t crc8_calc(const uint8_t *data, size_t len)
+{
+    const uint8_t (*t)[256] = CRC8_TABLES.t;
+    uint8_t crc = 0;
+    while (len >= 8) {
+        crc = t[7][crc ^ data[0]] ^ t[6][data[1]] ^ t[5][data[2]] ^ t[4][data[3]] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        len -= 8;
     }
+    while (len--)
+        crc = t[0][crc ^ *data++];
     return crc;
 }
@@ -1,14 +1,12 @@
 #pragma once
 
-#include <stdint.h>
+// CRC-8/DVB-S2 (полином 0xD5, начальное значение 0) — контрольная сумма кадров CRSF.
+// Таблицы строятся при компиляции и общие для всех пользователей
 
-class Crc8
-{
-public:
-    Crc8(uint8_t poly);
-    uint8_t calc(uint8_t *data, uint8_t len);
+#include <stddef.h>
+#include <stdint.h>
 
-protected:
-    uint8_t _lut[256];
-    void init(uint8_t poly);
-};
\ No newline at end of file
+// Основная функция: slicing-by-8, восемь байт за шаг
+uint8_t crc8_calc(const uint8_t *data, size_t len);
+// Эталон: один поиск в таблице на байт (прежний Crc8::calc)
+uint8_t crc8_calc_bytewise(const uint8_t *data, size_t len);
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "crsf_channels.h"
+
+#include <cstring>
+#include <endian.h>
+
+// Таблицы перевода строятся при компиляции по прежнему правилу CrsfSerial:
+// декодирование — округление к ближайшему, кодирование — ближайший код с поправкой ±1,
+// чтобы декодирование давало ровно исходное значение
+static const int CODE_SPAN = CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000;
+static const unsigned CODE_COUNT = 2048;   // 11 бит
+static const int US_MIN = 1000;
+static const int US_MAX = 2000;
+
+struct ChannelTables
+{
+    uint16_t codeToUs[CODE_COUNT];
+    uint16_t usToCode[US_MAX - US_MIN + 1];
+};
+
+static constexpr int decodeUs(int code)
+{
+    if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
+    if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
+    return US_MIN + ((code - CRSF_CHANNEL_VALUE_1000) * 1000 + CODE_SPAN / 2) / CODE_SPAN;
+}
+
+static constexpr int encodeCode(int us)
+{
+    int code = CRSF_CHANNEL_VALUE_1000 + ((us - US_MIN) * CODE_SPAN + 500) / 1000;
+    if (code > CRSF_CHANNEL_VALUE_2000) code = CRSF_CHANNEL_VALUE_2000;
+    if (code < CRSF_CHANNEL_VALUE_1000) code = CRSF_CHANNEL_VALUE_1000;
+    const int decoded = decodeUs(code);
+    if (decoded < us && code < CRSF_CHANNEL_VALUE_2000 && decodeUs(code + 1) == us)
+        ++code;
+    else if (decoded > us && code > CRSF_CHANNEL_VALUE_1000 && decodeUs(code - 1) == us)
+        --code;
+    return code;
+}
+
+static constexpr ChannelTables makeTables()
+{
+    ChannelTables t{};
+    for (unsigned code = 0; code < CODE_COUNT; ++code)
+        t.codeToUs[code] = static_cast<uint16_t>(decodeUs(static_cast<int>(code)));
+    for (int us = US_MIN; us <= US_MAX; ++us)
+        t.usToCode[us - US_MIN] = static_cast<uint16_t>(encodeCode(us));
+    return t;
+}
+
+static constexpr ChannelTables TABLES = makeTables();
+
+static constexpr bool roundTripExact()
+{
+    for (int us = US_MIN; us <= US_MAX; ++us)
+        if (TABLES.codeToUs[TABLES.usToCode[us - US_MIN]] != us) return false;
+    return true;
+}
+static_assert(roundTripExact(), "crsf_us_to_code/crsf_code_to_us: каждое значение 1000..2000 мкс должно возвращаться без потерь");
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+static inline void store64(uint8_t *p, uint64_t v)
+{
+    v = htole64(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+// 8 каналов = 88 бит = 11 байт. Два перекрывающихся 64-битных чтения (байты 0..7 и 3..10)
+// покрывают все восемь без выхода за пределы группы
+static inline void unpack8(const uint8_t *p, uint16_t *c)
+{
+    const uint64_t lo = load64(p);
+    const uint64_t hi = load64(p + 3);   // бит 0 соответствует биту 24 группы
+    c[0] = lo & 0x7FF;
+    c[1] = (lo >> 11) & 0x7FF;
+    c[2] = (lo >> 22) & 0x7FF;
+    c[3] = (lo >> 33) & 0x7FF;
+    c[4] = (lo >> 44) & 0x7FF;
+    c[5] = (hi >> 31) & 0x7FF;
+    c[6] = (hi >> 42) & 0x7FF;
+    c[7] = (hi >> 53) & 0x7FF;
+}
+
+static inline void pack8(const uint16_t *c, uint8_t *p)
+{
+    const uint64_t lo = uint64_t(c[0] & 0x7FF) | uint64_t(c[1] & 0x7FF) << 11 | uint64_t(c[2] & 0x7FF) << 22 |
+                        uint64_t(c[3] & 0x7FF) << 33 | uint64_t(c[4] & 0x7FF) << 44 | uint64_t(c[5] & 0x7FF) << 55;
+    const uint32_t hi = uint32_t(c[5] & 0x7FF) >> 9 | uint32_t(c[6] & 0x7FF) << 2 | uint32_t(c[7] & 0x7FF) << 13;
+    store64(p, lo);
+    p[8] = hi & 0xFF;
+    p[9] = (hi >> 8) & 0xFF;
+    p[10] = (hi >> 16) & 0xFF;
+}
+
+void crsf_channels_unpack(const uint8_t *payload, uint16_t codes[CRSF_NUM_CHANNELS])
+{
+    unpack8(payload, codes);
+    unpack8(payload + 11, codes + 8);
+}
+
+void crsf_channels_pack(const uint16_t codes[CRSF_NUM_CHANNELS], uint8_t *payload)
+{
+    pack8(codes, payload);
+    pack8(codes + 8, payload + 11);
+}
+
+int crsf_code_to_us(unsigned code)
+{
+    return TABLES.codeToUs[code & (CODE_COUNT - 1)];
+}
+
+uint16_t crsf_us_to_code(int us)
+{
+    if (us < US_MIN) us = US_MIN;
+    if (us > US_MAX) us = US_MAX;
+    return TABLES.usToCode[us - US_MIN];
+}
+
+void crsf_channels_decode(const uint8_t *payload, int us[CRSF_NUM_CHANNELS])
+{
+    uint16_t codes[CRSF_NUM_CHANNELS];
+    crsf_channels_unpack(payload, codes);
+    for (unsigned i = 0; i < CRSF_NUM_CHANNELS; ++i)
+        us[i] = TABLES.codeToUs[codes[i]];
+}
+
+void crsf_channels_encode(const int us[CRSF_NUM_CHANNELS], uint8_t *payload)
+{
+    uint16_t codes[CRSF_NUM_CHANNELS];
+    for (unsigned i = 0; i < CRSF_NUM_CHANNELS; ++i)
+        codes[i] = crsf_us_to_code(us[i]);
+    crsf_channels_pack(codes, payload);
+}
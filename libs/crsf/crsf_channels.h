@@ -0,0 +1,24 @@
+#pragma once
+
+// Кодек RC-каналов CRSF: 16 каналов по 11 бит в 22 байтах нагрузки и перевод код <-> мкс.
+// Один и тот же кодек у CrsfSerial, rpi/CrsfClientLinux и rpi/CrsfSenderLinux,
+// поэтому округление везде одинаковое
+
+#include <stddef.h>
+#include <stdint.h>
+#include "crsf_protocol.h"
+
+// Распаковать 22 байта нагрузки в 16 кодов 0..2047
+void crsf_channels_unpack(const uint8_t *payload, uint16_t codes[CRSF_NUM_CHANNELS]);
+// Упаковать 16 кодов (используются младшие 11 бит) в 22 байта нагрузки
+void crsf_channels_pack(const uint16_t codes[CRSF_NUM_CHANNELS], uint8_t *payload);
+
+// Код -> мкс: коды за пределами 191..1792 ограничиваются, округление к ближайшему
+int crsf_code_to_us(unsigned code);
+// Мкс -> код: значения ограничиваются 1000..2000; crsf_code_to_us(crsf_us_to_code(us)) == us
+uint16_t crsf_us_to_code(int us);
+
+// Нагрузка RC-кадра -> 16 значений в мкс
+void crsf_channels_decode(const uint8_t *payload, int us[CRSF_NUM_CHANNELS]);
+// 16 значений в мкс -> нагрузка RC-кадра
+void crsf_channels_encode(const int us[CRSF_NUM_CHANNELS], uint8_t *payload);
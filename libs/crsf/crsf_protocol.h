@@ -76,6 +76,26 @@ typedef enum
     CRSF_ADDRESS_CRSF_TRANSMITTER = 0xEE,
 } crsf_addr_e;
 
+// Байты, с которых может начинаться кадр (все адреса crsf_addr_e): точки ресинхронизации разбора.
+// Таблица на 256 значений строится при компиляции
+struct CrsfAddressSet {
+    bool is[256];
+};
+constexpr CrsfAddressSet crsf_make_address_set()
+{
+    CrsfAddressSet s{};
+    const uint8_t addresses[] = {
+        CRSF_ADDRESS_BROADCAST, CRSF_ADDRESS_USB, CRSF_ADDRESS_TBS_CORE_PNP_PRO, CRSF_ADDRESS_RESERVED1,
+        CRSF_ADDRESS_CURRENT_SENSOR, CRSF_ADDRESS_GPS, CRSF_ADDRESS_TBS_BLACKBOX, CRSF_ADDRESS_FLIGHT_CONTROLLER,
+        CRSF_ADDRESS_RESERVED2, CRSF_ADDRESS_RACE_TAG, CRSF_ADDRESS_RADIO_TRANSMITTER, CRSF_ADDRESS_CRSF_RECEIVER,
+        CRSF_ADDRESS_CRSF_TRANSMITTER,
+    };
+    for (uint8_t a : addresses)
+        s.is[a] = true;
+    return s;
+}
+inline constexpr CrsfAddressSet CRSF_ADDRESSES = crsf_make_address_set();
+
 typedef struct crsf_header_s
 {
     uint8_t device_addr; // from crsf_addr_e
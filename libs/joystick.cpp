@@ -4,12 +4,14 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <ctime>
 #include <vector>
 
 namespace {
 int g_fd = -1;
 std::vector<int16_t> g_axes;
 std::vector<uint8_t> g_buttons;
+uint64_t g_axis_ns = 0;   // первое событие оси с прошлого js_take_axis_ns(), CLOCK_MONOTONIC
 }
 
 bool js_open(const char* path)
@@ -34,6 +36,12 @@ void js_close()
     }
     g_axes.clear();
     g_buttons.clear();
+    g_axis_ns = 0;
+}
+
+int js_fd()
+{
+    return g_fd;
 }
 
 static void ensure_axis_size(size_t idx)
@@ -59,6 +67,12 @@ bool js_poll()
         if (type == JS_EVENT_AXIS) {
             ensure_axis_size(e.number);
             g_axes[e.number] = e.value;
+            // Одна метка на пачку событий; начальные (JS_EVENT_INIT) — не ввод
+            if (!g_axis_ns && !(e.type & JS_EVENT_INIT)) {
+                timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                g_axis_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+            }
         } else if (type == JS_EVENT_BUTTON) {
             ensure_button_size(e.number);
             g_buttons[e.number] = (e.value != 0);
@@ -67,6 +81,13 @@ bool js_poll()
     return processed;
 }
 
+uint64_t js_take_axis_ns()
+{
+    const uint64_t ns = g_axis_ns;
+    g_axis_ns = 0;
+    return ns;
+}
+
 bool js_get_axis(int index, int16_t& outValue)
 {
     if (index < 0) return false;
@@ -12,9 +12,16 @@ bool js_open(const char* path = "/dev/input/js0");
 // Закрыть джойстик
 void js_close();
 
+// Дескриптор устройства (для epoll), -1 если джойстик не открыт
+int js_fd();
+
 // Прочитать доступные события (неблокирующее). Возвращает true, если что-то обработано
 bool js_poll();
 
+// Момент (CLOCK_MONOTONIC, нс) чтения первого события оси с прошлого вызова; 0 — оси не менялись.
+// Метка для гистограмм задержки от ввода до кадра каналов
+uint64_t js_take_axis_ns();
+
 // Получить текущее значение оси (диапазон примерно [-32767..32767]).
 // Возвращает true, если ось присутствует
 bool js_get_axis(int index, int16_t& outValue);
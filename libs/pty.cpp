@@ -0,0 +1,23 @@
+#include "pty.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+
+bool pty_open(int &masterFd, std::string &slavePath) {
+    // posix_openpt + grantpt/unlockpt: не требует libutil
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) return false;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        ::close(fd);
+        return false;
+    }
+    char name[64];
+    if (ptsname_r(fd, name, sizeof(name)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    masterFd = fd;
+    slavePath = name;
+    return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// Псевдотерминал (pty) вместо UART: тесты и бенчмарки без /dev/ttyAMA0.
+// Master-сторону открывает SerialPort/SerialLinux::openPty(), slave-путь (/dev/pts/N)
+// открывается второй стороной как обычное устройство UART
+
+#include <string>
+
+// Создать пару pty. masterFd — неблокирующий дескриптор master-стороны, slavePath — путь slave.
+// Возвращает true при успехе
+bool pty_open(int &masterFd, std::string &slavePath);
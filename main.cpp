@@ -4,8 +4,168 @@
 #include "crsf/crsf.h"
 #include "libs/rpi_hal.h"
 #include "libs/joystick.h"
+#include "libs/EventLoop.h"
+#include "libs/UdpSetpoints.h"
+#include "libs/CrsfShm.h"
+#include "libs/TelemetryHistory.h"
+#include "libs/crsf/CrsfSerial.h"
 #include "telemetry_server.h"
 
+#if USE_CRSF_SEND == true
+// Преобразуем оси джойстика [-32767..32767] в CRSF [1000..2000]
+static int axisToUs(int16_t v) {
+  // нормируем к [-1..1]
+  const float nf = (v >= 0) ? (static_cast<float>(v) / 32767.0f)
+                            : (static_cast<float>(v) / 32768.0f);
+  // диапазон [1000..2000]
+  float us = 1500.0f + nf * 500.0f;
+  int ius = static_cast<int>(us + 0.5f);
+  if (ius < 1000) ius = 1000;
+  if (ius > 2000) ius = 2000;
+  return ius;
+}
+
+// Обработка осей джойстика только в режиме joystick
+static void applyJoystick() {
+  // Метка забирается и вне режима joystick: иначе старые события попали бы в задержку после смены режима
+  const uint64_t inputNs = js_take_axis_ns();
+  std::string mode = getWorkMode();
+  if (mode == "joystick") {
+    crsfMarkInput(CRSF_INPUT_JOYSTICK, inputNs);
+    int16_t ax0 = 0, ax1 = 0, ax2 = 0, ax3 = 0;
+    bool axis0_ok = js_get_axis(0, ax0);
+    bool axis1_ok = js_get_axis(1, ax1);
+    bool axis2_ok = js_get_axis(2, ax2);
+    bool axis3_ok = js_get_axis(3, ax3);
+
+    if (axis0_ok) crsfSetChannel(1, axisToUs(ax2)); // Roll
+    if (axis1_ok) crsfSetChannel(2, axisToUs(-ax3)); // Pitch
+    if (axis2_ok) crsfSetChannel(3, axisToUs(-ax1)); // Throttle
+    if (axis3_ok) crsfSetChannel(4, axisToUs(ax0)); // Yaw
+  }
+}
+#endif
+
+#if USE_CRSF_SEND == true
+// Уставки внешних процессов (UDP, разделяемая память): главный поток пишет их прямо в каналы,
+// ближайший тик отправки уносит. ctx — SetpointInput: источник и момент приёма для гистограмм задержки
+struct SetpointInput {
+  unsigned source;
+  uint64_t ns;
+};
+
+static void applySetpoints(uint16_t mask, const int* values, void* ctx) {
+  const SetpointInput* input = (const SetpointInput*)ctx;
+  crsfMarkInput(input->source, input->ns);
+  for (unsigned ch = 1; ch <= 16; ++ch)
+    if (mask & (1u << (ch - 1))) crsfSetChannel(ch, values[ch - 1]);
+}
+#endif
+
+#if USE_CRSF_SEND == true && UDP_SETPOINTS_ENABLE == true
+static UdpSetpoints udpSetpoints(UDP_SETPOINTS_MAX_AGE_MS);
+
+static void onUdpReadable(void*) {
+  SetpointInput input = { CRSF_INPUT_UDP, LatencyHistogram::monotonicNs() };
+  udpSetpoints.poll(&applySetpoints, &input);
+}
+#endif
+
+#if CRSF_SHM_ENABLE == true
+static CrsfShmServer shmServer;
+#endif
+#if TELEMETRY_HISTORY_ENABLE == true
+static TelemetryHistory telemetryHistory(TELEMETRY_HISTORY_CAPACITY);
+static bool historyPending = false;
+static uint64_t historyLastNs = 0;
+#endif
+static CrsfSerial* snapshotSource = nullptr;
+static uint32_t snapshotVersion = 0;
+
+// Новый снимок CrsfSerial (или сменился активный порт) — в разделяемую память и в историю.
+// В историю не чаще TELEMETRY_HISTORY_INTERVAL_MS: снимок, пришедший раньше, ждёт ближайшего прохода цикла
+static void publishTelemetrySnapshot() {
+  CrsfSerial* crsf = (CrsfSerial*)crsfGetActive();
+  if (!crsf) return;
+  const uint32_t version = crsf->telemetryVersion();
+  const bool changed = crsf != snapshotSource || version != snapshotVersion;
+#if TELEMETRY_HISTORY_ENABLE == true
+  historyPending = historyPending || changed;
+  const uint64_t now = TelemetryHistory::monotonicNs();
+  const bool history = historyPending && now - historyLastNs >= TELEMETRY_HISTORY_INTERVAL_MS * 1000000ull;
+#else
+  const bool history = false;
+#endif
+  if (!changed && !history) return;
+  snapshotSource = crsf;
+  snapshotVersion = version;
+  const CrsfTelemetry t = crsf->telemetry();
+#if CRSF_SHM_ENABLE == true
+  if (changed && shmServer.isOpen()) {
+    CrsfShmTelemetry s;
+    crsfShmFill(s, t, crsf->channelsFrame());
+    shmServer.publish(s);
+  }
+#endif
+#if TELEMETRY_HISTORY_ENABLE == true
+  if (history) {
+    telemetryHistory.record(now, t);
+    historyPending = false;
+    historyLastNs = now;
+  }
+#endif
+}
+
+// Обработчики цикла событий
+static void onUartReadable(void*) {
+#if USE_CRSF_RECV == true
+  loop_ch();
+#endif
+}
+
+static void onJoystickReadable(void*) {
+  // Читать события джойстика (неблокирующе); оси применяются на ближайшем тике отправки
+  js_poll();
+}
+
+static void onJoystickError(void*) {
+  // Джойстик отключён: цикл уже снял fd, закрываем устройство
+  printf("Джойстик отключён\n");
+  js_close();
+}
+
+#if USE_CRSF_RECV == true
+static void onUartError(void*) {
+  // Цикл снял fd порта; он не подписывается снова, пока активный порт тот же — при потере связи
+  // переключение на резервный порт сменит дескриптор
+  printf("Ошибка UART: порт снят с опроса\n");
+}
+#endif
+
+static void onSendTick(void*) {
+#if USE_CRSF_RECV == true
+  // Таймауты пакетов и failsafe проверяются и в отсутствие входящих байт
+  loop_ch();
+#endif
+#if USE_CRSF_SEND == true
+  applyJoystick();
+#if CRSF_SHM_ENABLE == true
+  // У ящика нет метки записи клиента: отсчёт от момента, когда главный поток его увидел
+  SetpointInput shmInput = { CRSF_INPUT_SHM, LatencyHistogram::monotonicNs() };
+  shmServer.pollSetpoints(&applySetpoints, &shmInput);
+#endif
+  // Кадр не ушёл — значения понесёт следующий тик, задержку источников считаем до него
+  const bool sent = crsfSendChannels();
+  (void)sent; // без UDP_SETPOINTS_ENABLE и CRSF_SHM_ENABLE не нужен
+#if UDP_SETPOINTS_ENABLE == true
+  if (sent) udpSetpoints.channelsSent(UdpSetpoints::monotonicNs());
+#endif
+#if CRSF_SHM_ENABLE == true
+  if (sent) shmServer.channelsSent(((CrsfSerial*)crsfGetActive())->channelsFrame());
+#endif
+#endif
+}
+
 // Главная точка входа Linux-приложения для Raspberry Pi
 // Полная замена Arduino setup()/loop()
 int main() {
@@ -26,10 +186,7 @@ int main() {
   pinInit();      // Инициализация пинов реле/камеры
 #endif
 
-  // флаг доступности (не используется, можно удалить/раскомментировать при необходимости)
-  // bool isCan = true;
   const uint32_t crsfSendPeriodMs = 10; // ~100 Гц отправка каналов для реалтайма
-  uint32_t lastSendMs = 0;
   // Инициализация джойстика (не критично, если недоступен)
   if (js_open("/dev/input/js0")) {
     printf("Джойстик подключен: %d осей, %d кнопок\n", js_num_axes(), js_num_buttons());
@@ -41,61 +198,59 @@ int main() {
   std::thread webServerThread([]() {
     // Ждем инициализации CRSF (уменьшено для реалтайма)
     rpi_delay_ms(500);
-    startTelemetryServer((CrsfSerial*)crsfGetActive(), 8081, 10);
+    startTelemetryServer((CrsfSerial*)crsfGetActive(), 8081);
   });
   webServerThread.detach();
 
+  // Главный цикл: спим в epoll до данных UART, событий джойстика или тика отправки каналов
+#if MAIN_LOOP_HYBRID == true
+  EventLoop loop(EventLoop::Mode::Hybrid, MAIN_LOOP_SPIN_US);
+#else
+  EventLoop loop(EventLoop::Mode::Blocking);
+#endif
+  if (!loop.open()) {
+    printf("Ошибка: не удалось создать epoll\n");
+    return 1;
+  }
+  loop.addTimer(crsfSendPeriodMs * 1000, &onSendTick, nullptr);
+  if (js_fd() >= 0) loop.add(js_fd(), &onJoystickReadable, nullptr, &onJoystickError);
+#if USE_CRSF_SEND == true && UDP_SETPOINTS_ENABLE == true
+  if (udpSetpoints.open(UDP_SETPOINTS_PORT, UDP_SETPOINTS_BIND) && loop.add(udpSetpoints.fd(), &onUdpReadable, nullptr)) {
+    setUdpSetpointsSource(&udpSetpoints);
+    printf("Уставки по UDP: %s:%d\n", UDP_SETPOINTS_BIND, UDP_SETPOINTS_PORT);
+  } else {
+    printf("Предупреждение: порт UDP %d для уставок недоступен\n", UDP_SETPOINTS_PORT);
+  }
+#endif
+#if CRSF_SHM_ENABLE == true
+  if (shmServer.create(CRSF_SHM_NAME))
+    printf("Разделяемая память: %s\n", CRSF_SHM_NAME);
+  else
+    printf("Предупреждение: не удалось создать разделяемую память %s\n", CRSF_SHM_NAME);
+#endif
+#if TELEMETRY_HISTORY_ENABLE == true
+  setTelemetryHistorySource(&telemetryHistory);
+#endif
+#if USE_CRSF_RECV == true || USE_CRSF_SEND == true
+  // Счётчики приёма и передачи обоих портов для /metrics
+  for (unsigned i = 0; crsfGetPort(i); ++i)
+    addMetricsPort(crsfGetPortName(i), (const CrsfSerial*)crsfGetPort(i));
+  setFrameLogSource(crsfGetFrameLog());
+  setLatencySource(crsfGetLatency());
+#endif
 
-  // Главный цикл
+  int uartFd = -1;
   for (;;) {
 #if USE_CRSF_RECV == true
-    loop_ch();
-#endif
-
-#if USE_CRSF_SEND == true
-    uint32_t currentMillis = rpi_millis();
-
-    // Читать события джойстика (неблокирующе)
-    js_poll();
-
-    // Преобразуем оси джойстика [-32767..32767] в CRSF [1000..2000]
-    auto axisToUs = [](int16_t v) -> int {
-      // нормируем к [-1..1]
-      const float nf = (v >= 0) ? (static_cast<float>(v) / 32767.0f)
-                                : (static_cast<float>(v) / 32768.0f);
-      // диапазон [1000..2000]
-      float us = 1500.0f + nf * 500.0f;
-      int ius = static_cast<int>(us + 0.5f);
-      if (ius < 1000) ius = 1000;
-      if (ius > 2000) ius = 2000;
-      return ius;
-    };
-
-    // Обработка осей джойстика только в режиме joystick
-    std::string mode = getWorkMode();
-    if (mode == "joystick") {
-      int16_t ax0 = 0, ax1 = 0, ax2 = 0, ax3 = 0;
-      bool axis0_ok = js_get_axis(0, ax0);
-      bool axis1_ok = js_get_axis(1, ax1);
-      bool axis2_ok = js_get_axis(2, ax2);
-      bool axis3_ok = js_get_axis(3, ax3);
-      
-      if (axis0_ok) crsfSetChannel(1, axisToUs(ax2)); // Roll
-      if (axis1_ok) crsfSetChannel(2, axisToUs(-ax3)); // Pitch
-      if (axis2_ok) crsfSetChannel(3, axisToUs(-ax1)); // Throttle
-      if (axis3_ok) crsfSetChannel(4, axisToUs(ax0)); // Yaw
+    // Активный порт может смениться (failover) — переподписываемся на его дескриптор
+    int activeFd = crsfGetRxFd();
+    if (activeFd != uartFd) {
+      loop.remove(uartFd);
+      uartFd = loop.add(activeFd, &onUartReadable, nullptr, &onUartError) ? activeFd : -1;
     }
-
-    // Отправляем RC-каналы с частотой ~100 Гц для реалтайма
-    if (currentMillis - lastSendMs >= crsfSendPeriodMs) {
-      lastSendMs = currentMillis;
-      crsfSendChannels();
-    }
-
-
 #endif
-    // Реалтайм без задержек - максимальная скорость обработки
-    // rpi_delay_ms(0); // Полностью убираем задержку для реалтайма
+    loop.runOnce();
+    publishTelemetrySnapshot();
   }
 
   return 0;
@@ -5,13 +5,22 @@
 #include <cstdint>
 #include "../libs/crsf/crsf_protocol.h"
 #include "../libs/crsf/crc8.h"
+#include "../libs/crsf/crsf_channels.h"
+#include "../libs/crsf/CrsfParser.h"
 #include "SerialLinux.h"
 
+class CrsfClientLinux;
+// Клиенту нужны только каналы; остальные кадры проверяются по CRC и пропускаются
+typedef CrsfParser<SerialLinux, SerialLinux, CrsfClientLinux, CrsfFrameTypes<CRSF_FRAMETYPE_RC_CHANNELS_PACKED>>
+    CrsfClientParser;
+
 class CrsfClientLinux
 {
 public:
     // Инициализация с устройством UART, например "/dev/ttyAMA0"
     bool begin(const std::string& device, uint32_t baud = CRSF_BAUDRATE);
+    // Работа через псевдотерминал вместо UART; peerPath — slave-путь для второй стороны
+    bool beginPty(std::string& peerPath, uint32_t baud = CRSF_BAUDRATE);
     void end();
 
     // Вызывать часто в главном цикле
@@ -20,19 +29,22 @@ public:
     // Текущее значение канала (1..16) в мкс
     int getChannel(unsigned int ch) const;
 
+    // Разобрать байты из источника без UART (бенчмарки) так же, как прочитанные в loop()
+    void receive(const uint8_t* data, size_t len) { _parser.receive(data, len); }
+    CrsfRxStats rxStats() const { return _parser.stats(); }
+
 private:
+    friend CrsfClientParser;
+
     SerialLinux _serial;
-    Crc8 _crc{0xd5};
-    uint8_t _rxBuf[CRSF_MAX_PACKET_SIZE]{};
-    uint8_t _rxPos{0};
-    uint32_t _lastReceive{0};
+    CrsfClientParser _parser{_serial, *this};
     uint32_t _lastChannels{0};
     bool _linkUp{false};
     int _channels[CRSF_NUM_CHANNELS]{};
 
-    void handleByte(uint8_t b);
-    void processPacket(uint8_t len);
-    void shiftRx(uint8_t cnt);
+    // Обработчики CrsfParser
+    void onFrame(const uint8_t* frame, uint8_t len);
+    void onSkippedByte(uint8_t) {}
     void checkTimeouts();
 };
 
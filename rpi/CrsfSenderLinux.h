@@ -6,6 +6,7 @@
 #include <string>
 #include "../libs/crsf/crsf_protocol.h"
 #include "../libs/crsf/crc8.h"
+#include "../libs/crsf/crsf_channels.h"
 #include "SerialLinux.h"
 
 class CrsfSenderLinux
@@ -13,6 +14,8 @@ class CrsfSenderLinux
 public:
     // Открыть порт, например "/dev/ttyAMA0"; по умолчанию 420000 бод
     bool begin(const std::string& device, uint32_t baud = CRSF_BAUDRATE);
+    // Работа через псевдотерминал вместо UART; peerPath — slave-путь для второй стороны
+    bool beginPty(std::string& peerPath, uint32_t baud = CRSF_BAUDRATE);
     void end();
 
     // Установить значение канала в микросекундах (1000..2000), ch: 1..16
@@ -27,12 +30,9 @@ public:
 
 private:
     SerialLinux _serial;
-    Crc8 _crc{0xd5};
     int _channels[CRSF_NUM_CHANNELS]{}; // 1000..2000
     bool _linkUp{true}; // по умолчанию позволяем отправку
 
-    // Преобразование в протокольные значения 11 бит
-    static int usToCrsf(int us);
 };
 
 
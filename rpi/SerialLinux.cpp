@@ -3,37 +3,33 @@
 // Реализация Linux UART с поддержкой нестандартных скоростей
 // Комментарии на русском для наглядности
 
-#include <termios.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <asm/termbits.h>
+#include <cerrno>
 #include <cstring>
+#include "../libs/pty.h"
 
-// Настройка нестандартной скорости через termios2 (Linux-specific)
-#ifndef BOTHER
-#include <sys/ioctl.h>
-#include <linux/termios.h>
-#endif
-
-static bool setCustomBaud(int fd, uint32_t baud)
+// Сырой режим 8N1 без управления потоком и нестандартная скорость через termios2 (Linux-specific).
+// <termios.h> не подключаем: его struct termios конфликтует с <asm/termbits.h>
+static bool configureRaw(int fd, uint32_t baud)
 {
-#ifdef BOTHER
     struct termios2 tio2;
     if (ioctl(fd, TCGETS2, &tio2) != 0)
         return false;
-    tio2.c_cflag &= ~CBAUD;
-    tio2.c_cflag |= BOTHER;
+    tio2.c_iflag = 0;
+    tio2.c_oflag = 0;
+    tio2.c_lflag = 0;
+    tio2.c_cflag &= ~(CBAUD | CSIZE | CSTOPB | PARENB | CRTSCTS); // 1 стоп-бит, без чётности
+    tio2.c_cflag |= BOTHER | CS8 | CLOCAL | CREAD;
     tio2.c_ispeed = baud;
     tio2.c_ospeed = baud;
-    if (ioctl(fd, TCSETS2, &tio2) != 0)
-        return false;
-    return true;
-#else
-    // fallback: попробуем стандартные скорости, если нет поддержки BOTHER
-    (void)fd; (void)baud;
-    return false;
-#endif
+    tio2.c_cc[VMIN] = 0;
+    tio2.c_cc[VTIME] = 0;
+    return ioctl(fd, TCSETS2, &tio2) == 0;
 }
 
 bool SerialLinux::open(const std::string& device, uint32_t baud)
@@ -42,34 +38,27 @@ bool SerialLinux::open(const std::string& device, uint32_t baud)
     if (_fd < 0)
         return false;
 
-    struct termios tio{};
-    if (tcgetattr(_fd, &tio) != 0)
+    if (!configureRaw(_fd, baud))
+    {
+        close();
         return false;
+    }
+    return true;
+}
 
-    cfmakeraw(&tio);
-    tio.c_cflag |= (CLOCAL | CREAD);
-    tio.c_cflag &= ~CSTOPB;   // 1 стоп-бит
-    tio.c_cflag &= ~PARENB;   // без чётности
-    tio.c_cflag &= ~CRTSCTS;  // без аппаратного управления потоком
-
-    // Временные стандартные скорости, затем переопределим нестандартную
-    cfsetispeed(&tio, B115200);
-    cfsetospeed(&tio, B115200);
-
-    if (tcsetattr(_fd, TCSANOW, &tio) != 0)
+bool SerialLinux::openPty(std::string& peerPath, uint32_t baud)
+{
+    if (!pty_open(_fd, peerPath))
+    {
+        _fd = -1;
         return false;
-
-    // Устанавливаем нестандартную скорость, если требуется
-    if (baud != 115200)
+    }
+    // termios-запросы к master применяются к slave-стороне
+    if (!configureRaw(_fd, baud))
     {
-#ifdef BOTHER
-        if (!setCustomBaud(_fd, baud))
-            return false;
-#else
+        close();
         return false;
-#endif
     }
-
     return true;
 }
 
@@ -91,6 +80,19 @@ int SerialLinux::readByte()
     return -1;
 }
 
+ssize_t SerialLinux::readBulk(uint8_t* first, size_t firstLen, uint8_t* second, size_t secondLen)
+{
+    if (_fd < 0) return -1;
+    struct iovec iov[2];
+    int cnt = 0;
+    if (firstLen > 0) { iov[cnt].iov_base = first; iov[cnt].iov_len = firstLen; ++cnt; }
+    if (secondLen > 0) { iov[cnt].iov_base = second; iov[cnt].iov_len = secondLen; ++cnt; }
+    if (cnt == 0) return 0;
+    ssize_t n = ::readv(_fd, iov, cnt);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return n;
+}
+
 ssize_t SerialLinux::writeBytes(const uint8_t* data, size_t len)
 {
     if (_fd < 0) return -1;
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <cstdint>
+#include <sys/types.h>
 
 class SerialLinux
 {
@@ -12,10 +13,16 @@ public:
     // Открыть порт, например "/dev/ttyAMA0" или "/dev/ttyUSB0"
     // baud может быть 420000 для CRSF
     bool open(const std::string& device, uint32_t baud);
+    // Открыть master-сторону нового псевдотерминала вместо UART (тесты без железа).
+    // peerPath — путь slave-стороны, её открывает вторая сторона как обычный UART
+    bool openPty(std::string& peerPath, uint32_t baud);
     void close();
 
     // Неблокирующее чтение одного байта, возвращает -1 если нет данных
     int readByte();
+    // Пакетное чтение одним readv в два непрерывных участка (хвост и начало кольца).
+    // Возвращает число байт, 0 — данных нет, -1 — ошибка
+    ssize_t readBulk(uint8_t* first, size_t firstLen, uint8_t* second, size_t secondLen);
     // Запись буфера
     ssize_t writeBytes(const uint8_t* data, size_t len);
     // Запись одного байта
@@ -26,19 +26,13 @@ sleep 0.5
 echo ""
 echo "📡 Установка значений каналов..."
 
-# Канал 1: 1100 мкс
-echo "  CH1: 1100 мкс"
-curl -s "${API_URL}/api/command?cmd=setChannel&value=1=1100" > /dev/null
-
-# Каналы 2-15: 1500 мкс (центр)
-for ch in {2..15}; do
-    echo "  CH${ch}: 1500 мкс"
-    curl -s "${API_URL}/api/command?cmd=setChannel&value=${ch}=1500" > /dev/null
-done
-
-# Канал 16: 1160 мкс
-echo "  CH16: 1160 мкс"
-curl -s "${API_URL}/api/command?cmd=setChannel&value=16=1160" > /dev/null
+# Все каналы одним запросом: сервер отправит их в одном кадре CRSF
+# CH1: 1100 мкс, CH2-CH15: 1500 мкс (центр), CH16: 1160 мкс
+echo "  CH1: 1100 мкс, CH2-CH15: 1500 мкс, CH16: 1160 мкс"
+response=$(curl -s -X POST -H "Content-Type: application/json" \
+    --data '[1100,1500,1500,1500,1500,1500,1500,1500,1500,1500,1500,1500,1500,1500,1500,1160]' \
+    "${API_URL}/api/channels")
+echo "  Ответ: ${response}"
 
 echo ""
 echo "✅ Все каналы установлены!"
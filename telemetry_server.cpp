@@ -1,23 +1,30 @@
 #include <iostream>
+#include <algorithm>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <chrono>
-#include <sstream>
-#include <fstream>
-#include <iomanip>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
+#include <charconv>
+#include <string_view>
 #include <cstring>
 #include <cstdlib>
+#include <ctime>
+#include <arpa/inet.h>
+#include "config.h"
 #include "crsf/crsf.h"
+#include "libs/HttpServer.h"
+#include "libs/JsonWriter.h"
+#include "libs/TelemetryHistory.h"
+#include "libs/UdpSetpoints.h"
+#include "libs/crsf/CrsfFrameLog.h"
 #include "libs/crsf/CrsfSerial.h"
+#include "telemetry_server.h"
 
 // Глобальные переменные для телеметрии
 struct TelemetryData {
     // Статус связи
     bool linkUp = false;
-    std::string activePort = "Unknown";
+    const char* activePort = "Unknown";
     uint32_t lastReceive = 0;
     
     // RC каналы
@@ -48,188 +55,369 @@ struct TelemetryData {
     // Сырые значения attitude (raw bytes)
     int16_t rawAttitudeBytes[3] = {0};  // [0]=roll, [1]=pitch, [2]=yaw
     
-    // Режим работы
-    std::string workMode = "joystick"; // joystick, manual
-    
-    std::string timestamp;
+    char timestamp[16] = "";   // ЧЧ:ММ:СС.ммм
 };
 
+// telemetryMutex защищает только telemetryData между потоками веб-сервера;
+// поток CRSF его не берёт: данные приходят из seqlock-снимка CrsfSerial::telemetry()
 static TelemetryData telemetryData;
 static std::mutex telemetryMutex;
-static CrsfSerial* crsfInstance = nullptr;
+static std::atomic<CrsfSerial*> crsfInstance{nullptr};
+// Режим работы: joystick или manual. Читается главным циклом на каждом тике — без блокировок
+static std::atomic<bool> manualMode{false};
+
+static std::atomic<const UdpSetpoints*> udpInstance{nullptr};
+static std::atomic<const TelemetryHistory*> historyInstance{nullptr};
+
+void setUdpSetpointsSource(const UdpSetpoints* udp) {
+    udpInstance.store(udp, std::memory_order_release);
+}
+
+void setTelemetryHistorySource(const TelemetryHistory* history) {
+    historyInstance.store(history, std::memory_order_release);
+}
+
+// Порты /metrics: запись только при запуске (главный поток), число публикуется после заполнения записи
+struct MetricsPort {
+    const char* name;
+    const CrsfSerial* crsf;
+};
+static MetricsPort metricsPorts[TELEMETRY_METRICS_PORTS];
+static std::atomic<unsigned> metricsPortCount{0};
+static std::atomic<const CrsfFrameLog*> frameLogInstance{nullptr};
+static std::atomic<CrsfLatencyStats*> latencyInstance{nullptr};
+
+bool addMetricsPort(const char* name, const CrsfSerial* crsf) {
+    const unsigned n = metricsPortCount.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < n; ++i)
+        if (metricsPorts[i].crsf == crsf) return true;
+    if (n == TELEMETRY_METRICS_PORTS) return false;
+    metricsPorts[n] = MetricsPort{ name, crsf };
+    metricsPortCount.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+void setFrameLogSource(const CrsfFrameLog* log) {
+    frameLogInstance.store(log, std::memory_order_release);
+}
+
+void setLatencySource(CrsfLatencyStats* latency) {
+    latencyInstance.store(latency, std::memory_order_release);
+}
+
+void setTelemetrySource(CrsfSerial* crsf) {
+    crsfInstance.store(crsf, std::memory_order_release);
+}
 
 // Функция для получения текущего режима работы
 std::string getWorkMode() {
-    std::lock_guard<std::mutex> lock(telemetryMutex);
-    return telemetryData.workMode;
+    return manualMode.load(std::memory_order_relaxed) ? "manual" : "joystick";
 }
 
-// Функция для получения текущего времени
-std::string getCurrentTime() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
+// Время now как ЧЧ:ММ:СС.ммм в out (не меньше 13 байт)
+static void formatTime(char* out, size_t size, std::chrono::system_clock::time_point now) {
+    time_t t = std::chrono::system_clock::to_time_t(now);
+    const unsigned ms = static_cast<unsigned>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()).count() % 1000);
     
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    struct tm local;
+    localtime_r(&t, &local);
+    const size_t n = strftime(out, size, "%H:%M:%S", &local);
+    if (n == 0 || n + 5 > size) return;
+    out[n] = '.';
+    out[n + 1] = static_cast<char>('0' + ms / 100);
+    out[n + 2] = static_cast<char>('0' + ms / 10 % 10);
+    out[n + 3] = static_cast<char>('0' + ms % 10);
+    out[n + 4] = '\0';
 }
 
-// Функция для обновления телеметрии
-void updateTelemetry() {
+// Источник и версия снимка, из которых последний раз заполнялась telemetryData (под telemetryMutex)
+static CrsfSerial* telemetrySource = nullptr;
+static uint32_t telemetryVersion = 0;
+static bool telemetryValid = false;
+// Растёт при каждом изменении telemetryData: ключ кэша JSON
+static uint32_t telemetryGeneration = 0;
+// Миллисекунда, которой отформатирован telemetryData.timestamp (под telemetryMutex)
+static int64_t telemetryTimestampMs = -1;
+
+// timestamp — время запроса, а не снимка: по нему клиенты замечают устаревшие ответы и при тихой связи.
+// Форматируется не чаще раза в миллисекунду (вызывается под telemetryMutex)
+static void refreshTimestampLocked() {
+    const auto now = std::chrono::system_clock::now();
+    const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    if (ms == telemetryTimestampMs) return;
+    telemetryTimestampMs = ms;
+    formatTime(telemetryData.timestamp, sizeof(telemetryData.timestamp), now);
+}
+
+// Функция для обновления телеметрии: вызывается при запросе, а не по таймеру
+bool updateTelemetry() {
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
+    const uint32_t version = crsf ? crsf->telemetryVersion() : 0;
+
     std::lock_guard<std::mutex> lock(telemetryMutex);
+    // Новых кадров не было — копировать и форматировать время незачем
+    if (telemetryValid && crsf == telemetrySource && version == telemetryVersion)
+        return false;
+
+    // Снимок читается без блокировок; при совпадении с записью seqlock просто повторяет копию
+    CrsfTelemetry t{};
+    if (crsf)
+        t = crsf->telemetry();
+    telemetrySource = crsf;
+    // Версия до копии: если между ними была ещё запись, следующий вызов её подхватит
+    telemetryVersion = version;
+    telemetryValid = true;
+    ++telemetryGeneration;
     
-    if (crsfInstance) {
-        telemetryData.linkUp = crsfInstance->isLinkUp();
-        telemetryData.lastReceive = crsfInstance->_lastReceive;
+    if (crsf) {
+        telemetryData.linkUp = t.linkUp;
+        telemetryData.lastReceive = t.lastReceive;
         
         // Получаем каналы
         for (int i = 0; i < 16; i++) {
-            telemetryData.channels[i] = crsfInstance->getChannel(i + 1);
+            telemetryData.channels[i] = t.channels[i];
         }
         
         // Получаем статистику связи
-        const crsfLinkStatistics_t* stats = crsfInstance->getLinkStatistics();
-        if (stats) {
-            telemetryData.packetsReceived = stats->uplink_RSSI_1;
-            telemetryData.packetsSent = stats->uplink_RSSI_2;
-            telemetryData.packetsLost = 100 - stats->uplink_Link_quality; // Потерянные пакеты = 100 - качество связи
-        }
+        telemetryData.packetsReceived = t.linkStatistics.uplink_RSSI_1;
+        telemetryData.packetsSent = t.linkStatistics.uplink_RSSI_2;
+        telemetryData.packetsLost = 100 - t.linkStatistics.uplink_Link_quality; // Потерянные пакеты = 100 - качество связи
         
         // Получаем GPS данные
-        const crsf_sensor_gps_t* gps = crsfInstance->getGpsSensor();
-        if (gps) {
-            // Конвертируем из формата CRSF (degree / 10,000,000) в обычные градусы
-            telemetryData.latitude = gps->latitude / 10000000.0;
-            telemetryData.longitude = gps->longitude / 10000000.0;
-            // Высота в метрах, +1000м offset
-            telemetryData.altitude = gps->altitude - 1000;
-            // Скорость в км/ч / 10
-            telemetryData.speed = gps->groundspeed / 10.0;
-        }
+        // Конвертируем из формата CRSF (degree / 10,000,000) в обычные градусы
+        telemetryData.latitude = t.gps.latitude / 10000000.0;
+        telemetryData.longitude = t.gps.longitude / 10000000.0;
+        // Высота в метрах, +1000м offset
+        telemetryData.altitude = t.gps.altitude - 1000;
+        // Скорость в км/ч / 10
+        telemetryData.speed = t.gps.groundspeed / 10.0;
         
         // Получаем данные батареи
-        telemetryData.voltage = crsfInstance->getBatteryVoltage();
-        telemetryData.current = crsfInstance->getBatteryCurrent();
-        telemetryData.capacity = crsfInstance->getBatteryCapacity();
-        telemetryData.remaining = crsfInstance->getBatteryRemaining();
+        telemetryData.voltage = t.batteryVoltage;
+        telemetryData.current = t.batteryCurrent;
+        telemetryData.capacity = t.batteryCapacity;
+        telemetryData.remaining = t.batteryRemaining;
         
         // Получаем данные положения
-        telemetryData.roll = crsfInstance->getAttitudeRoll();
-        telemetryData.pitch = crsfInstance->getAttitudePitch();
-        telemetryData.yaw = crsfInstance->getAttitudeYaw();
+        telemetryData.roll = t.attitudeRoll;
+        telemetryData.pitch = t.attitudePitch;
+        telemetryData.yaw = t.attitudeYaw;
         
         // Получаем сырые значения attitude
-        telemetryData.rawAttitudeBytes[0] = crsfInstance->getRawAttitudeRoll();
-        telemetryData.rawAttitudeBytes[1] = crsfInstance->getRawAttitudePitch();
-        telemetryData.rawAttitudeBytes[2] = crsfInstance->getRawAttitudeYaw();
+        telemetryData.rawAttitudeBytes[0] = t.rawAttitude[0];
+        telemetryData.rawAttitudeBytes[1] = t.rawAttitude[1];
+        telemetryData.rawAttitudeBytes[2] = t.rawAttitude[2];
     }
     
-    telemetryData.timestamp = getCurrentTime();
-    
     // Определяем активный порт
-    if (crsfInstance) {
+    if (crsf) {
         telemetryData.activePort = "UART Active";
     } else {
         telemetryData.activePort = "No Connection";
     }
+    return true;
 }
 
-// Функция для отправки HTTP ответа
-void sendHttpResponse(int clientSocket, const std::string& content, const std::string& contentType = "text/html") {
-    std::stringstream response;
-    response << "HTTP/1.1 200 OK\r\n";
-    response << "Content-Type: " << contentType << "\r\n";
-    response << "Content-Length: " << content.length() << "\r\n";
-    response << "Access-Control-Allow-Origin: *\r\n";
-    response << "Connection: close\r\n\r\n";
-    response << content;
-    
-    std::string responseStr = response.str();
-    send(clientSocket, responseStr.c_str(), responseStr.length(), 0);
+uint32_t getTelemetryVersion() {
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
+    return crsf ? crsf->telemetryVersion() : 0;
 }
 
-// Функция для создания JSON телеметрии
-std::string createTelemetryJson() {
-    std::lock_guard<std::mutex> lock(telemetryMutex);
-    
-    std::stringstream json;
-    json << "{";
-    json << "\"linkUp\":" << (telemetryData.linkUp ? "true" : "false") << ",";
-    json << "\"activePort\":\"" << telemetryData.activePort << "\",";
-    json << "\"lastReceive\":" << telemetryData.lastReceive << ",";
-    json << "\"timestamp\":\"" << telemetryData.timestamp << "\",";
+bool waitTelemetry(uint32_t version, int timeoutMs) {
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
+    if (!crsf) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return false;
+    }
+    return crsf->waitTelemetry(version, static_cast<uint32_t>(timeoutMs));
+}
+
+// Имена полей в порядке битов TELEMETRY_FIELD_*
+static const char* const telemetryFieldNames[] = {
+    "linkUp", "activePort", "lastReceive", "timestamp", "channels", "packetsReceived", "packetsSent",
+    "packetsLost", "gps", "battery", "attitude", "attitudeRaw", "workMode",
+};
+static_assert(sizeof(telemetryFieldNames) / sizeof(telemetryFieldNames[0]) == 13 &&
+              TELEMETRY_FIELDS_ALL == (1u << 13) - 1, "telemetryFieldNames не совпадает с TELEMETRY_FIELD_*");
+
+uint32_t parseTelemetryFields(std::string_view list) {
+    if (list.empty()) return TELEMETRY_FIELDS_ALL;
+    uint32_t mask = 0;
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        const std::string_view name = list.substr(0, comma);
+        list = (comma == std::string_view::npos) ? std::string_view() : list.substr(comma + 1);
+        if (name.empty()) continue;
+        uint32_t bit = 0;
+        for (unsigned i = 0; i < sizeof(telemetryFieldNames) / sizeof(telemetryFieldNames[0]); ++i)
+            if (name == telemetryFieldNames[i]) bit = 1u << i;
+        if (!bit) return 0;
+        mask |= bit;
+    }
+    return mask ? mask : TELEMETRY_FIELDS_ALL;
+}
+
+// Сериализация telemetryData (вызывается под telemetryMutex)
+static size_t renderTelemetryLocked(char* buf, size_t size, uint32_t fields) {
+    JsonWriter json(buf, size);
+    json.beginObject();
+    if (fields & TELEMETRY_FIELD_LINK_UP) { json.key("linkUp"); json.value(telemetryData.linkUp); }
+    if (fields & TELEMETRY_FIELD_ACTIVE_PORT) { json.key("activePort"); json.value(telemetryData.activePort); }
+    if (fields & TELEMETRY_FIELD_LAST_RECEIVE) { json.key("lastReceive"); json.value(telemetryData.lastReceive); }
+    if (fields & TELEMETRY_FIELD_TIMESTAMP) { json.key("timestamp"); json.value(telemetryData.timestamp); }
     
     // RC каналы
-    json << "\"channels\":[";
-    for (int i = 0; i < 16; i++) {
-        if (i > 0) json << ",";
-        json << telemetryData.channels[i];
+    if (fields & TELEMETRY_FIELD_CHANNELS) {
+        json.key("channels");
+        json.beginArray();
+        for (int i = 0; i < 16; i++)
+            json.value(telemetryData.channels[i]);
+        json.endArray();
     }
-    json << "],";
     
     // Статистика
-    json << "\"packetsReceived\":" << telemetryData.packetsReceived << ",";
-    json << "\"packetsSent\":" << telemetryData.packetsSent << ",";
-    json << "\"packetsLost\":" << telemetryData.packetsLost << ",";
+    if (fields & TELEMETRY_FIELD_PACKETS_RECEIVED) { json.key("packetsReceived"); json.value(telemetryData.packetsReceived); }
+    if (fields & TELEMETRY_FIELD_PACKETS_SENT) { json.key("packetsSent"); json.value(telemetryData.packetsSent); }
+    if (fields & TELEMETRY_FIELD_PACKETS_LOST) { json.key("packetsLost"); json.value(telemetryData.packetsLost); }
     
     // GPS
-    json << "\"gps\":{";
-    json << "\"latitude\":" << telemetryData.latitude << ",";
-    json << "\"longitude\":" << telemetryData.longitude << ",";
-    json << "\"altitude\":" << telemetryData.altitude << ",";
-    json << "\"speed\":" << telemetryData.speed;
-    json << "},";
+    if (fields & TELEMETRY_FIELD_GPS) {
+        json.key("gps");
+        json.beginObject();
+        json.key("latitude"); json.value(telemetryData.latitude);
+        json.key("longitude"); json.value(telemetryData.longitude);
+        json.key("altitude"); json.value(telemetryData.altitude);
+        json.key("speed"); json.value(telemetryData.speed);
+        json.endObject();
+    }
     
     // Батарея
-    json << "\"battery\":{";
-    json << "\"voltage\":" << telemetryData.voltage << ",";
-    json << "\"current\":" << telemetryData.current << ",";
-    json << "\"capacity\":" << telemetryData.capacity << ",";
-    json << "\"remaining\":" << (int)telemetryData.remaining;
-    json << "},";
+    if (fields & TELEMETRY_FIELD_BATTERY) {
+        json.key("battery");
+        json.beginObject();
+        json.key("voltage"); json.value(telemetryData.voltage);
+        json.key("current"); json.value(telemetryData.current);
+        json.key("capacity"); json.value(telemetryData.capacity);
+        json.key("remaining"); json.value(telemetryData.remaining);
+        json.endObject();
+    }
     
     // Положение
-    json << "\"attitude\":{";
-    json << "\"roll\":" << telemetryData.roll << ",";
-    json << "\"pitch\":" << telemetryData.pitch << ",";
-    json << "\"yaw\":" << telemetryData.yaw;
-    json << "},";
+    if (fields & TELEMETRY_FIELD_ATTITUDE) {
+        json.key("attitude");
+        json.beginObject();
+        json.key("roll"); json.value(telemetryData.roll);
+        json.key("pitch"); json.value(telemetryData.pitch);
+        json.key("yaw"); json.value(telemetryData.yaw);
+        json.endObject();
+    }
     
     // Сырые значения attitude (raw CRSF bytes)
-    json << "\"attitudeRaw\":{";
-    json << "\"roll\":" << telemetryData.rawAttitudeBytes[0] << ",";
-    json << "\"pitch\":" << telemetryData.rawAttitudeBytes[1] << ",";
-    json << "\"yaw\":" << telemetryData.rawAttitudeBytes[2];
-    json << "},";
+    if (fields & TELEMETRY_FIELD_ATTITUDE_RAW) {
+        json.key("attitudeRaw");
+        json.beginObject();
+        json.key("roll"); json.value(telemetryData.rawAttitudeBytes[0]);
+        json.key("pitch"); json.value(telemetryData.rawAttitudeBytes[1]);
+        json.key("yaw"); json.value(telemetryData.rawAttitudeBytes[2]);
+        json.endObject();
+    }
     
     // Режим работы
-    json << "\"workMode\":\"" << telemetryData.workMode << "\"";
+    if (fields & TELEMETRY_FIELD_WORK_MODE) {
+        json.key("workMode");
+        json.value(manualMode.load(std::memory_order_relaxed) ? "manual" : "joystick");
+    }
     
-    json << "}";
-    return json.str();
+    json.endObject();
+    return json.overflow() ? 0 : json.size();
 }
 
-// Функция для обработки команд управления
-void handleCommand(const std::string& command, const std::string& value) {
+size_t renderTelemetryJson(char* buf, size_t size, uint32_t fields) {
     std::lock_guard<std::mutex> lock(telemetryMutex);
+    refreshTimestampLocked();
+    return renderTelemetryLocked(buf, size, fields);
+}
+
+// Кэш готовых документов (под telemetryMutex): несколько слотов, чтобы клиенты с разными fields=
+// не вытесняли друг друга. Полный документ ~600 байт
+static const size_t TELEMETRY_JSON_MAX = 1024;
+static const unsigned TELEMETRY_JSON_CACHE_SLOTS = 4;
+
+struct TelemetryJsonCache {
+    bool valid = false;
+    uint32_t generation = 0;
+    uint32_t fields = 0;
+    bool manual = false;
+    int64_t timestampMs = 0;   // только для fields с timestamp
+    size_t size = 0;
+    char doc[TELEMETRY_JSON_MAX];
+};
+
+static TelemetryJsonCache telemetryJsonCache[TELEMETRY_JSON_CACHE_SLOTS];
+static unsigned telemetryJsonCacheNext = 0;
+
+// Документ для текущей telemetryData (под telemetryMutex): из кэша или сериализованный заново
+static const TelemetryJsonCache& cachedTelemetryJson(uint32_t fields) {
+    // workMode меняется командой без нового снимка — он тоже часть ключа; timestamp — время запроса,
+    // поэтому документ с ним годится только в ту же миллисекунду
+    const bool manual = manualMode.load(std::memory_order_relaxed);
+    const int64_t timestampMs = (fields & TELEMETRY_FIELD_TIMESTAMP) ? telemetryTimestampMs : 0;
+    for (const TelemetryJsonCache& e : telemetryJsonCache)
+        if (e.valid && e.generation == telemetryGeneration && e.fields == fields && e.manual == manual &&
+            e.timestampMs == timestampMs)
+            return e;
+    
+    TelemetryJsonCache& e = telemetryJsonCache[telemetryJsonCacheNext];
+    telemetryJsonCacheNext = (telemetryJsonCacheNext + 1) % TELEMETRY_JSON_CACHE_SLOTS;
+    e.generation = telemetryGeneration;
+    e.fields = fields;
+    e.manual = manual;
+    e.timestampMs = timestampMs;
+    e.size = renderTelemetryLocked(e.doc, sizeof(e.doc), fields);
+    e.valid = true;
+    return e;
+}
+
+void writeTelemetryJson(std::string& out, uint32_t fields) {
+    // Подтянуть свежий снимок, если CRSF опубликовал новый с прошлого запроса
+    updateTelemetry();
+    std::lock_guard<std::mutex> lock(telemetryMutex);
+    refreshTimestampLocked();
+    const TelemetryJsonCache& e = cachedTelemetryJson(fields);
+    out.assign(e.doc, e.size);
+}
+
+std::string createTelemetryJson(uint32_t fields) {
+    std::string json;
+    writeTelemetryJson(json, fields);
+    return json;
+}
+
+// Функция для обработки команд управления
+static void handleCommand(std::string_view command, std::string_view value) {
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
     
     if (command == "setMode") {
         if (value == "joystick" || value == "manual") {
-            telemetryData.workMode = value;
+            manualMode.store(value == "manual", std::memory_order_relaxed);
             std::cout << "🔧 Режим изменен на: " << value << std::endl;
         }
     } else if (command == "setChannel") {
         // Формат: channel=value (например: 1=1500)
         size_t pos = value.find('=');
-        if (pos != std::string::npos) {
-            int channel = std::stoi(value.substr(0, pos));
-            int val = std::stoi(value.substr(pos + 1));
+        if (pos != std::string_view::npos) {
+            int channel = 0, val = 0;
+            const char* begin = value.data();
+            const char* end = value.data() + value.size();
+            if (std::from_chars(begin, begin + pos, channel).ec != std::errc() ||
+                std::from_chars(begin + pos + 1, end, val).ec != std::errc())
+                return;
             if (channel >= 1 && channel <= 16 && val >= 1000 && val <= 2000) {
-                if (crsfInstance) {
-                    crsfInstance->setChannel(channel, val);
+                if (crsf) {
+                    int values[CRSF_NUM_CHANNELS];
+                    values[channel - 1] = val;
+                    crsf->queueChannels(static_cast<uint16_t>(1u << (channel - 1)), values);
                     std::cout << "🎮 Канал " << channel << " установлен в " << val << " мкс" << std::endl;
                 }
             }
@@ -237,122 +425,852 @@ void handleCommand(const std::string& command, const std::string& value) {
     }
 }
 
-// Функция для обработки HTTP запросов
-void handleHttpRequest(int clientSocket, const std::string& request) {
-    std::stringstream ss(request);
-    std::string method, path, version;
-    ss >> method >> path >> version;
-    
-    if (path == "/" || path == "/index.html") {
-        // Простая информационная страница
-        std::string html = R"(<!DOCTYPE html>
+// Обработчики маршрутов: вызываются в рабочих потоках HttpServer
+static void routeIndex(const HttpRequest&, HttpResponse& resp) {
+    // Простая информационная страница
+    resp.body = R"(<!DOCTYPE html>
 <html><head><title>CRSF API</title></head>
 <body>
 <h1>CRSF Телеметрия API</h1>
 <p>Доступные endpoints:</p>
 <ul>
-<li><a href="/api/telemetry">/api/telemetry</a> - JSON данные телеметрии</li>
+<li><a href="/api/telemetry">/api/telemetry</a> - JSON данные телеметрии (?fields=channels,attitude — только выбранные поля)</li>
+<li><a href="/api/stream">/api/stream</a> - поток телеметрии (Server-Sent Events, ?maxRate=Гц)</li>
 <li><a href="/api/command">/api/command</a> - Команды управления</li>
+<li>/api/channels - POST: все или часть каналов одним запросом, применяются в одном кадре</li>
+<li><a href="/api/udp">/api/udp</a> - счётчики приёма уставок по UDP по источникам</li>
+<li>/api/ws - WebSocket: двоичные уставки каналов и телеметрия в одном подключении</li>
+<li><a href="/api/history?since=-60000&step=1000">/api/history</a> - история телеметрии за интервал (?since=&until=&step= мс, fields=)</li>
+<li><a href="/metrics">/metrics</a> - счётчики приёма и передачи по портам, HTTP, UDP, журнала (текстовый формат Prometheus)</li>
 </ul>
 </body></html>)";
-        sendHttpResponse(clientSocket, html);
-    } else if (path == "/api/telemetry") {
-        // API для получения телеметрии
-        std::string json = createTelemetryJson();
-        sendHttpResponse(clientSocket, json, "application/json");
-    } else if (path.find("/api/command") == 0) {
-        // API для команд управления
-        size_t pos = path.find("?");
-        if (pos != std::string::npos) {
-            std::string query = path.substr(pos + 1);
-            size_t cmdPos = query.find("cmd=");
-            size_t valPos = query.find("&value=");
-            
-            if (cmdPos != std::string::npos && valPos != std::string::npos) {
-                std::string command = query.substr(cmdPos + 4, valPos - cmdPos - 4);
-                std::string value = query.substr(valPos + 7);
-                handleCommand(command, value);
-            }
+}
+
+static void routeTelemetry(const HttpRequest& req, HttpResponse& resp) {
+    // API для получения телеметрии: ?fields=channels,attitude — только перечисленные поля
+    resp.contentType = "application/json";
+    const uint32_t fields = parseTelemetryFields(req.param("fields"));
+    if (!fields) {
+        resp.status = 400;
+        resp.body = "{\"error\":\"unknown field\"}";
+        return;
+    }
+    writeTelemetryJson(resp.body, fields);
+}
+
+// Темы HttpServer: /api/stream (события SSE) и /api/ws (JSON текстовыми кадрами)
+static const unsigned TELEMETRY_STREAM_TOPIC = 1;
+static const unsigned TELEMETRY_WS_TOPIC = 2;
+
+// Событие SSE: id — номер снимка, data — JSON телеметрии
+static void appendTelemetryEvent(std::string& out, uint32_t version, const std::string& json) {
+    char num[16];
+    out.append("id: ");
+    out.append(num, std::to_chars(num, num + sizeof(num), version).ptr);
+    out.append("\nevent: telemetry\ndata: ");
+    out.append(json);
+    out.append("\n\n");
+}
+
+// Сообщение /api/ws: {"id":<номер снимка>,"telemetry":{...}}
+static void appendTelemetryWsMessage(std::string& out, uint32_t version, const std::string& json) {
+    char num[16];
+    out.append("{\"id\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), version).ptr);
+    out.append(",\"telemetry\":");
+    out.append(json);
+    out.push_back('}');
+}
+
+// ?maxRate= для потоковых маршрутов; false — ответ 400 уже заполнен
+static bool parseStreamRate(const HttpRequest& req, HttpResponse& resp, unsigned& hz) {
+    hz = TELEMETRY_STREAM_MAX_HZ;
+    const std::string_view rate = req.param("maxRate");
+    if (!rate.empty() && (std::from_chars(rate.data(), rate.data() + rate.size(), hz).ec != std::errc() ||
+                          hz == 0 || hz > 1000)) {
+        resp.status = 400;
+        resp.contentType = "application/json";
+        resp.body = "{\"error\":\"maxRate must be 1..1000\"}";
+        return false;
+    }
+    return true;
+}
+
+static void routeStream(const HttpRequest& req, HttpResponse& resp) {
+    // Поток телеметрии: каждый новый снимок — событие, не чаще maxRate в секунду
+    unsigned hz;
+    if (!parseStreamRate(req, resp, hz)) return;
+    resp.contentType = "text/event-stream";
+    resp.stream = TELEMETRY_STREAM_TOPIC;
+    resp.streamIntervalMs = 1000 / hz;
+    // Первое событие — текущий снимок, чтобы клиент не ждал следующего кадра
+    std::string json;
+    const uint32_t version = getTelemetryVersion();
+    writeTelemetryJson(json);
+    resp.body.assign("retry: 1000\n");
+    appendTelemetryEvent(resp.body, version, json);
+}
+
+static uint16_t readU16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static uint32_t readU32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// Двоичные уставки (/api/ws и /api/channels): mask:u16 и по u16 (мкс) на каждый установленный бит, little-endian.
+// values — по номеру канала (values[ch - 1]). false — пустая маска, длина не совпала с ней или значение вне 1000..2000
+static bool parseSetpoints(const uint8_t* p, size_t len, uint16_t& mask, int* values) {
+    if (len < 2) return false;
+    mask = readU16(p);
+    size_t at = 2;
+    for (unsigned ch = 0; ch < CRSF_NUM_CHANNELS; ++ch) {
+        if (!(mask & (1u << ch))) continue;
+        if (at + 2 > len) return false;
+        values[ch] = readU16(p + at);
+        at += 2;
+        if (values[ch] < 1000 || values[ch] > 2000) return false;
+    }
+    return mask != 0 && at == len;
+}
+
+// JSON уставок: массив с канала 1 ([1500,1500,null,1100] — null оставляет канал как есть)
+// или объект по номерам каналов ({"1":1100,"16":1160}). false — другая форма или значение вне 1000..2000
+static bool parseChannelsJson(std::string_view s, uint16_t& mask, int* values) {
+    size_t i = 0;
+    auto skipSpace = [&]() { while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i; };
+    auto number = [&](int& v) {
+        const std::from_chars_result r = std::from_chars(s.data() + i, s.data() + s.size(), v);
+        if (r.ec != std::errc()) return false;
+        i = static_cast<size_t>(r.ptr - s.data());
+        return true;
+    };
+    mask = 0;
+    skipSpace();
+    if (i >= s.size() || (s[i] != '[' && s[i] != '{')) return false;
+    const bool array = s[i++] == '[';
+    const char close = array ? ']' : '}';
+    skipSpace();
+    if (i < s.size() && s[i] == close) return false;
+    for (int index = 1;; ++index) {
+        skipSpace();
+        int channel = index, value = 0;
+        if (!array) {
+            if (i >= s.size() || s[i++] != '"' || !number(channel) || i >= s.size() || s[i++] != '"') return false;
+            skipSpace();
+            if (i >= s.size() || s[i++] != ':') return false;
+            skipSpace();
         }
-        
-        sendHttpResponse(clientSocket, "{\"status\":\"ok\"}", "application/json");
-    } else {
-        // 404 Not Found
-        std::string response = "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\n\r\n<h1>404 Not Found</h1>";
-        send(clientSocket, response.c_str(), response.length(), 0);
+        if (channel < 1 || channel > CRSF_NUM_CHANNELS) return false;
+        if (array && s.substr(i, 4) == "null") {
+            i += 4;
+        } else {
+            if (!number(value) || value < 1000 || value > 2000) return false;
+            values[channel - 1] = value;
+            mask |= static_cast<uint16_t>(1u << (channel - 1));
+        }
+        skipSpace();
+        if (i >= s.size()) return false;
+        if (s[i] == close) break;
+        if (s[i++] != ',') return false;
     }
+    ++i;
+    skipSpace();
+    return i == s.size() && mask != 0;
 }
 
-// Функция для обработки клиентских подключений
-void handleClient(int clientSocket) {
-    char buffer[4096];
-    int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+// Входящие сообщения /api/ws: уставки каналов и режим. session — последний принятый seq
+// (бит 32 — был ли он вообще). Без вывода в консоль: путь команды должен быть коротким
+static void wsControl(HttpWsMessage& msg) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(msg.data.data());
+    const size_t len = msg.data.size();
+    if (!msg.binary || len < 5) return;
+    const uint8_t type = p[0];
+    const uint32_t seq = readU32(p + 1);
+    uint8_t status = TELEMETRY_WS_OK;
     
-    if (bytesReceived > 0) {
-        buffer[bytesReceived] = '\0';
-        std::string request(buffer);
-        handleHttpRequest(clientSocket, request);
+    const bool haveSeq = (*msg.session >> 32) != 0;
+    const uint32_t lastSeq = static_cast<uint32_t>(*msg.session);
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
+    if (haveSeq && static_cast<int32_t>(seq - lastSeq) <= 0) {
+        status = TELEMETRY_WS_STALE;
+    } else if (type == TELEMETRY_WS_SETPOINTS) {
+        // Сначала проверяем всё сообщение, потом ставим в очередь: либо все каналы, либо ни одного
+        uint16_t mask = 0;
+        int values[CRSF_NUM_CHANNELS];
+        if (!parseSetpoints(p + 5, len - 5, mask, values)) status = TELEMETRY_WS_INVALID;
+        else if (!crsf) status = TELEMETRY_WS_NO_SOURCE;
+        else crsf->queueChannels(mask, values);
+    } else if (type == TELEMETRY_WS_MODE) {
+        if (len != 6 || p[5] > 1) status = TELEMETRY_WS_INVALID;
+        else manualMode.store(p[5] == 1, std::memory_order_relaxed);
+    } else {
+        status = TELEMETRY_WS_INVALID;
     }
+    if (status == TELEMETRY_WS_OK)
+        *msg.session = (1ull << 32) | seq;
     
-    close(clientSocket);
+    char ack[6] = { static_cast<char>(TELEMETRY_WS_ACK | type), static_cast<char>(seq & 0xFF),
+                    static_cast<char>((seq >> 8) & 0xFF), static_cast<char>((seq >> 16) & 0xFF),
+                    static_cast<char>(seq >> 24), static_cast<char>(status) };
+    msg.reply->assign(ack, sizeof(ack));
 }
 
-// Основная функция веб-сервера
-void startTelemetryServer(CrsfSerial* crsf, int port = 8080, int updateIntervalMs = 10) {
-    std::cout << "🌐 Запуск веб-сервера телеметрии (реалтайм " << updateIntervalMs << "мс)..." << std::endl;
-    crsfInstance = crsf;
-    
-    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        std::cerr << "Ошибка создания сокета" << std::endl;
+static void routeWs(const HttpRequest& req, HttpResponse& resp) {
+    // Канал управления: уставки внутрь, телеметрия наружу (не чаще maxRate в секунду)
+    unsigned hz;
+    if (!parseStreamRate(req, resp, hz)) return;
+    resp.websocket = wsControl;
+    resp.stream = TELEMETRY_WS_TOPIC;
+    resp.streamIntervalMs = 1000 / hz;
+    std::string json;
+    const uint32_t version = getTelemetryVersion();
+    writeTelemetryJson(json);
+    appendTelemetryWsMessage(resp.body, version, json);
+}
+
+static void routeCommand(const HttpRequest& req, HttpResponse& resp) {
+    // API для команд управления: ?cmd=...&value=...
+    const std::string_view command = req.param("cmd");
+    const std::string_view value = req.param("value");
+    if (!command.empty() && !value.empty())
+        handleCommand(command, value);
+    resp.contentType = "application/json";
+    resp.body = "{\"status\":\"ok\"}";
+}
+
+static void routeChannels(const HttpRequest& req, HttpResponse& resp) {
+    // Набор каналов одним запросом: JSON или двоичные уставки (application/octet-stream), все — в один кадр
+    resp.contentType = "application/json";
+    if (req.method != "POST") {
+        resp.status = 405;
+        resp.body = "{\"error\":\"use POST\"}";
         return;
     }
-    
-    int opt = 1;
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    struct sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(port);
-    
-    if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        std::cerr << "❌ Ошибка привязки к порту " << port << std::endl;
-        close(serverSocket);
+    uint16_t mask = 0;
+    int values[CRSF_NUM_CHANNELS];
+    const bool binary = req.header("Content-Type").substr(0, 24) == "application/octet-stream";
+    if (!(binary ? parseSetpoints(reinterpret_cast<const uint8_t*>(req.body.data()), req.body.size(), mask, values)
+                 : parseChannelsJson(req.body, mask, values))) {
+        resp.status = 400;
+        resp.body = "{\"error\":\"invalid channels\"}";
         return;
     }
-    
-    if (listen(serverSocket, 5) < 0) {
-        std::cerr << "❌ Ошибка прослушивания порта" << std::endl;
-        close(serverSocket);
+    CrsfSerial* crsf = crsfInstance.load(std::memory_order_acquire);
+    if (!crsf) {
+        resp.status = 503;
+        resp.body = "{\"error\":\"no CRSF source\"}";
         return;
     }
-    
-    std::cout << "🌐 Веб-сервер телеметрии запущен на порту " << port << std::endl;
-    std::cout << "📱 Откройте браузер: http://localhost:" << port << std::endl;
-    
-    // Запускаем поток для обновления телеметрии (реалтайм)
-    std::thread telemetryThread([updateIntervalMs]() {
-        while (true) {
-            updateTelemetry();
-            std::this_thread::sleep_for(std::chrono::milliseconds(updateIntervalMs));
+    const uint32_t frame = crsf->queueChannels(mask, values);
+    char buf[64];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    w.key("status");
+    w.value("ok");
+    w.key("frame");
+    w.value(frame);
+    w.key("mask");
+    w.value(mask);
+    w.endObject();
+    resp.body.assign(w.data(), w.size());
+}
+
+static void routeUdp(const HttpRequest&, HttpResponse& resp) {
+    // Счётчики приёма уставок по UDP по источникам
+    resp.contentType = "application/json";
+    const UdpSetpoints* udp = udpInstance.load(std::memory_order_acquire);
+    if (!udp) {
+        resp.status = 404;
+        resp.body = "{\"error\":\"UDP setpoints disabled\"}";
+        return;
+    }
+    char buf[256 + UdpSetpoints::MAX_SOURCES * 320];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    w.key("rejected");
+    w.value(udp->rejected());
+    w.key("sources");
+    w.beginArray();
+    UdpSetpointStats s;
+    for (int i = 0; udp->stats(i, s); ++i) {
+        char address[INET_ADDRSTRLEN];
+        in_addr a;
+        a.s_addr = s.address;
+        inet_ntop(AF_INET, &a, address, sizeof(address));
+        w.beginObject();
+        w.key("address");
+        w.value(address);
+        w.key("port");
+        w.value(s.port);
+        w.key("received");
+        w.value(s.received);
+        w.key("accepted");
+        w.value(s.accepted);
+        w.key("dropped");
+        w.value(s.dropped);
+        w.key("late");
+        w.value(s.late);
+        w.key("lastSeq");
+        w.value(s.lastSeq);
+        w.key("frames");
+        w.value(s.frames);
+        w.key("latencyAvgUs");
+        w.value(s.frames ? s.latencySumUs / s.frames : 0);
+        w.key("latencyMaxUs");
+        w.value(s.latencyMaxUs);
+        w.key("latencyLastUs");
+        w.value(s.latencyLastUs);
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    resp.body.assign(w.data(), w.size());
+}
+
+static void writeLatency(JsonWriter& w, const char* name, const LatencyHistogram::Summary& s) {
+    w.key(name);
+    w.beginObject();
+    w.key("count");
+    w.value(s.count);
+    w.key("meanUs");
+    w.value(s.meanNs / 1000.0);
+    w.key("p50Us");
+    w.value(s.p50Ns / 1000.0);
+    w.key("p99Us");
+    w.value(s.p99Ns / 1000.0);
+    w.key("p999Us");
+    w.value(s.p999Ns / 1000.0);
+    w.key("maxUs");
+    w.value(s.maxNs / 1000.0);
+    w.endObject();
+}
+
+static void routeLatency(const HttpRequest& req, HttpResponse& resp) {
+    // Сквозные задержки по источникам уставок и приёма; reset=1 — отдать накопленное и начать заново
+    resp.contentType = "application/json";
+    CrsfLatencyStats* latency = latencyInstance.load(std::memory_order_acquire);
+    if (!latency) {
+        resp.status = 404;
+        resp.body = "{\"error\":\"latency stats disabled\"}";
+        return;
+    }
+    const bool reset = req.param("reset") == "1";
+    char buf[256 + (CRSF_INPUT_SOURCES + 1) * 160];
+    JsonWriter w(buf, sizeof(buf));
+    w.beginObject();
+    w.key("reset");
+    w.value(reset);
+    w.key("input");
+    w.beginObject();
+    for (unsigned i = 0; i < CRSF_INPUT_SOURCES; ++i)
+        writeLatency(w, crsf_input_name(i), reset ? latency->input[i].takeSummary() : latency->input[i].summary());
+    w.endObject();
+    writeLatency(w, "rx", reset ? latency->rx.takeSummary() : latency->rx.summary());
+    w.endObject();
+    resp.body.assign(w.data(), w.size());
+}
+
+// Число в фиксированной точке: v / 10^decimals без double и без хвостовых нулей дробной части
+static void appendFixed(std::string& out, int64_t v, unsigned decimals) {
+    char num[24];
+    if (v < 0) {
+        out.push_back('-');
+        v = -v;
+    }
+    uint64_t scale = 1;
+    for (unsigned i = 0; i < decimals; ++i) scale *= 10;
+    const uint64_t u = static_cast<uint64_t>(v);
+    out.append(num, std::to_chars(num, num + sizeof(num), u / scale).ptr);
+    uint64_t frac = u % scale;
+    if (!frac) return;
+    while (frac % 10 == 0) {
+        frac /= 10;
+        --decimals;
+    }
+    char* end = std::to_chars(num, num + sizeof(num), frac).ptr;
+    out.push_back('.');
+    out.append(decimals - static_cast<unsigned>(end - num), '0');
+    out.append(num, end);
+}
+
+// Метка истории (нс) в мс с дробной частью до мкс
+static void appendHistoryTime(std::string& out, uint64_t ns) {
+    appendFixed(out, static_cast<int64_t>(ns / 1000), 3);
+}
+
+// Курсор ответа /api/history (HttpResponse::chunkState)
+enum : unsigned {
+    HISTORY_INDEX,          // следующий отсчёт
+    HISTORY_END_INDEX,      // первый отсчёт после окна: окно — отсчёты, записанные до запроса
+    HISTORY_END_NS,         // until: отсчёты раньше этой метки
+    HISTORY_STEP_NS,        // ширина интервала свёртки; 0 — отсчёты как есть
+    HISTORY_ORIGIN_NS,      // since: от него отсчитываются интервалы
+    HISTORY_MASK,           // колонки TelemetryHistory
+    HISTORY_ROWS,
+    HISTORY_OVERWRITTEN,
+};
+// Часть ответа не больше примерно стольких байт: дальше — следующим вызовом, когда сокет её заберёт
+static const size_t HISTORY_PART_SIZE = 16384;
+
+static void appendHistoryRowStart(std::string& out, uint64_t* state) {
+    if (state[HISTORY_ROWS]++) out.push_back(',');
+    out.push_back('[');
+}
+
+// Генератор строк /api/history: rows — [t, значения...] или [t, n, min, max, min, max...] по интервалам step
+static bool historyChunk(uint64_t* state, std::string& out) {
+    const TelemetryHistory* history = historyInstance.load(std::memory_order_acquire);
+    const uint32_t mask = static_cast<uint32_t>(state[HISTORY_MASK]);
+    const uint64_t endIndex = state[HISTORY_END_INDEX];
+    const uint64_t endNs = state[HISTORY_END_NS];
+    const uint64_t stepNs = state[HISTORY_STEP_NS];
+    bool more = history != nullptr;
+    while (more && out.size() < HISTORY_PART_SIZE) {
+        uint64_t& index = state[HISTORY_INDEX];
+        if (!stepNs) {
+            TelemetryHistory::Sample samples[32];
+            const size_t n = history->read(index, endIndex, endNs, mask, samples, 32, state[HISTORY_OVERWRITTEN]);
+            more = n > 0;
+            for (size_t i = 0; i < n; ++i) {
+                appendHistoryRowStart(out, state);
+                appendHistoryTime(out, samples[i].timeNs);
+                for (unsigned c = 0; c < TelemetryHistory::COLUMNS; ++c) {
+                    if (!(mask & (1u << c))) continue;
+                    out.push_back(',');
+                    appendFixed(out, samples[i].values[c], TelemetryHistory::columns[c].decimals);
+                }
+                out.push_back(']');
+            }
+            continue;
         }
-    });
-    telemetryThread.detach();
-    
-    // Основной цикл сервера
-    while (true) {
-        struct sockaddr_in clientAddr;
-        socklen_t clientAddrLen = sizeof(clientAddr);
-        
-        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-        if (clientSocket < 0) {
+        // Пустые интервалы пропускаются: следующий — тот, куда попал ближайший отсчёт
+        const uint64_t next = std::max(index, history->oldest());
+        if (next >= endIndex) {
+            more = false;
+            break;
+        }
+        const uint64_t first = history->timeAt(next);
+        if (!first) continue;  // затёрт, пока читали: берём следующий
+        if (first >= endNs) {
+            more = false;
+            break;
+        }
+        const uint64_t origin = state[HISTORY_ORIGIN_NS];
+        const uint64_t bucketNs = origin + (first - origin) / stepNs * stepNs;
+        TelemetryHistory::Bucket b;
+        if (!history->aggregate(index, endIndex, std::min(bucketNs + stepNs, endNs), mask, b, state[HISTORY_OVERWRITTEN]))
             continue;
+        appendHistoryRowStart(out, state);
+        appendHistoryTime(out, bucketNs);
+        out.push_back(',');
+        char num[16];
+        out.append(num, std::to_chars(num, num + sizeof(num), b.count).ptr);
+        for (unsigned c = 0; c < TelemetryHistory::COLUMNS; ++c) {
+            if (!(mask & (1u << c))) continue;
+            out.push_back(',');
+            appendFixed(out, b.min[c], TelemetryHistory::columns[c].decimals);
+            out.push_back(',');
+            appendFixed(out, b.max[c], TelemetryHistory::columns[c].decimals);
         }
-        
-        std::thread clientThread(handleClient, clientSocket);
-        clientThread.detach();
+        out.push_back(']');
+    }
+    if (more) return true;
+    char num[24];
+    out.append("],\"overwritten\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), state[HISTORY_OVERWRITTEN]).ptr);
+    out.push_back('}');
+    return false;
+}
+
+// Время запроса /api/history в мс CLOCK_MONOTONIC; отрицательное — от текущего момента. false — не число
+static bool parseHistoryTime(std::string_view s, uint64_t nowNs, uint64_t& ns) {
+    // До ~30 лет в обе стороны: умножение на 10^6 не переполняется
+    int64_t ms = 0;
+    if (std::from_chars(s.data(), s.data() + s.size(), ms).ec != std::errc() || ms > 1000000000000ll ||
+        ms < -1000000000000ll)
+        return false;
+    if (ms >= 0) {
+        ns = static_cast<uint64_t>(ms) * 1000000ull;
+    } else {
+        const uint64_t back = static_cast<uint64_t>(-ms) * 1000000ull;
+        ns = back < nowNs ? nowNs - back : 0;
+    }
+    return true;
+}
+
+static void routeHistory(const HttpRequest& req, HttpResponse& resp) {
+    // История телеметрии за [since, until): строки частями, сколько бы их ни было
+    resp.contentType = "application/json";
+    const TelemetryHistory* history = historyInstance.load(std::memory_order_acquire);
+    if (!history) {
+        resp.status = 404;
+        resp.body = "{\"error\":\"history disabled\"}";
+        return;
+    }
+    const uint64_t nowNs = TelemetryHistory::monotonicNs();
+    uint64_t sinceNs = 0, untilNs = nowNs + 1, stepNs = 0;
+    const std::string_view since = req.param("since");
+    const std::string_view until = req.param("until");
+    const std::string_view step = req.param("step");
+    uint32_t stepMs = 0;
+    if ((!since.empty() && !parseHistoryTime(since, nowNs, sinceNs)) ||
+        (!until.empty() && !parseHistoryTime(until, nowNs, untilNs)) ||
+        (!step.empty() && std::from_chars(step.data(), step.data() + step.size(), stepMs).ec != std::errc())) {
+        resp.status = 400;
+        resp.body = "{\"error\":\"since, until and step are milliseconds\"}";
+        return;
+    }
+    stepNs = static_cast<uint64_t>(stepMs) * 1000000ull;
+
+    // fields= — те же имена, что у /api/telemetry; поля без истории (activePort, timestamp...) — ошибка
+    const uint32_t fields = parseTelemetryFields(req.param("fields"));
+    uint32_t mask = 0, covered = 0;
+    for (unsigned c = 0; c < TelemetryHistory::COLUMNS; ++c) {
+        const uint32_t field = parseTelemetryFields(TelemetryHistory::columns[c].field);
+        if (fields & field) mask |= 1u << c;
+        covered |= field;
     }
+    if (!fields || (!req.param("fields").empty() && (fields & ~covered))) {
+        resp.status = 400;
+        resp.body = "{\"error\":\"unknown field or field without history\"}";
+        return;
+    }
+
+    const uint64_t index = history->lowerBound(sinceNs);
+    // Интервалы свёртки — от since, а без since — от первого отсчёта
+    const uint64_t first = history->timeAt(index);
+    const uint64_t origin = since.empty() && first ? first : sinceNs;
+
+    char num[24];
+    std::string& out = resp.body;
+    out.append("{\"now\":");
+    appendHistoryTime(out, nowNs);
+    out.append(",\"since\":");
+    appendHistoryTime(out, origin);
+    out.append(",\"until\":");
+    appendHistoryTime(out, untilNs);
+    out.append(",\"step\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), stepMs).ptr);
+    out.append(",\"capacity\":");
+    out.append(num, std::to_chars(num, num + sizeof(num), history->capacity()).ptr);
+    out.append(stepNs ? ",\"columns\":[\"t\",\"n\"" : ",\"columns\":[\"t\"");
+    for (unsigned c = 0; c < TelemetryHistory::COLUMNS; ++c) {
+        if (!(mask & (1u << c))) continue;
+        const char* name = TelemetryHistory::columns[c].name;
+        if (stepNs) {
+            out.append(",\"").append(name).append(".min\",\"").append(name).append(".max\"");
+        } else {
+            out.append(",\"").append(name).push_back('"');
+        }
+    }
+    out.append("],\"rows\":[");
+
+    resp.chunked = &historyChunk;
+    memset(resp.chunkState, 0, sizeof(resp.chunkState));
+    resp.chunkState[HISTORY_INDEX] = index;
+    resp.chunkState[HISTORY_END_INDEX] = history->count();
+    resp.chunkState[HISTORY_END_NS] = untilNs;
+    resp.chunkState[HISTORY_STEP_NS] = stepNs;
+    resp.chunkState[HISTORY_ORIGIN_NS] = origin;
+    resp.chunkState[HISTORY_MASK] = mask;
+}
+
+// Определён после telemetryServer: отдаёт его счётчики
+static void routeMetrics(const HttpRequest& req, HttpResponse& resp);
+
+static const HttpRoute telemetryRoutes[] = {
+    { "/", false, routeIndex },
+    { "/index.html", false, routeIndex },
+    { "/api/telemetry", false, routeTelemetry },
+    { "/api/stream", false, routeStream },
+    { "/api/ws", false, routeWs },
+    { "/api/channels", false, routeChannels },
+    { "/api/udp", false, routeUdp },
+    { "/api/history", false, routeHistory },
+    { "/api/latency", false, routeLatency },
+    { "/metrics", false, routeMetrics },
+    { "/api/command", true, routeCommand },
+};
+
+static HttpServer telemetryServer(telemetryRoutes, sizeof(telemetryRoutes) / sizeof(telemetryRoutes[0]));
+
+// Текстовый формат Prometheus (0.0.4): на семейство — # HELP, # TYPE и строки name{labels} value.
+// Все счётчики читаются relaxed-загрузками: ни поток приёма, ни рабочие потоки не блокируются
+static void appendMetricFamily(std::string& out, const char* name, const char* type, const char* help) {
+    out.append("# HELP ").append(name).push_back(' ');
+    out.append(help).append("\n# TYPE ").append(name).push_back(' ');
+    out.append(type).push_back('\n');
+}
+
+static void appendLabelValue(std::string& out, std::string_view v) {
+    for (char c : v) {
+        if (c == '\\' || c == '"') out.push_back('\\');
+        if (c == '\n') out.append("\\n");
+        else out.push_back(c);
+    }
+}
+
+// labels — готовые пары через запятую (name="value",...) или пусто
+static void appendMetric(std::string& out, const char* name, std::string_view labels, uint64_t value) {
+    char num[24];
+    out.append(name);
+    if (!labels.empty()) out.append("{").append(labels).push_back('}');
+    out.push_back(' ');
+    out.append(num, std::to_chars(num, num + sizeof(num), value).ptr);
+    out.push_back('\n');
+}
+
+static void appendPortMetric(std::string& out, const char* name, const char* help,
+                             uint64_t (*get)(const CrsfSerial&)) {
+    appendMetricFamily(out, name, "counter", help);
+    const unsigned n = metricsPortCount.load(std::memory_order_acquire);
+    std::string labels;
+    for (unsigned i = 0; i < n; ++i) {
+        labels.assign("port=\"");
+        appendLabelValue(labels, metricsPorts[i].name);
+        labels.push_back('"');
+        appendMetric(out, name, labels, get(*metricsPorts[i].crsf));
+    }
+}
+
+static void routeMetrics(const HttpRequest&, HttpResponse& resp) {
+    resp.contentType = "text/plain; version=0.0.4; charset=utf-8";
+    std::string& out = resp.body;
+    std::string labels;
+    char num[24];
+
+    // Приём и передача по портам
+    appendPortMetric(out, "crsf_rx_bytes_total", "Bytes read from the UART",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().bytes; });
+    appendPortMetric(out, "crsf_rx_frames_total", "Frames with a valid CRC",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().frames; });
+    appendPortMetric(out, "crsf_rx_crc_errors_total", "Frames with a bad CRC",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().crcErrors; });
+    appendPortMetric(out, "crsf_rx_resyncs_total", "Resyncs to the next sync byte after a bad length or CRC",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().resyncs; });
+    appendPortMetric(out, "crsf_rx_dropped_bytes_total", "Bytes skipped by resync or packet timeout",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().droppedBytes; });
+    appendPortMetric(out, "crsf_rx_timeouts_total", "Incomplete frames dropped by the packet timeout",
+                     [](const CrsfSerial& c) -> uint64_t { return c.rxStats().timeouts; });
+    appendPortMetric(out, "crsf_tx_frames_total", "Frames written in full by queuePacket",
+                     [](const CrsfSerial& c) -> uint64_t { return c.txStats().frames; });
+    appendPortMetric(out, "crsf_tx_bytes_total", "Bytes accepted by write()",
+                     [](const CrsfSerial& c) -> uint64_t { return c.txStats().bytes; });
+    appendPortMetric(out, "crsf_tx_write_errors_total", "write() calls that failed",
+                     [](const CrsfSerial& c) -> uint64_t { return c.txStats().errors; });
+    appendPortMetric(out, "crsf_tx_short_writes_total", "write() calls that accepted only part of a frame",
+                     [](const CrsfSerial& c) -> uint64_t { return c.txStats().shortWrites; });
+
+    appendMetricFamily(out, "crsf_rx_type_frames_total", "counter", "Frames with a valid CRC by frame type");
+    const unsigned ports = metricsPortCount.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < ports; ++i) {
+        for (unsigned t = 0; t < 256; ++t) {
+            const uint32_t n = metricsPorts[i].crsf->rxTypeFrames(static_cast<uint8_t>(t));
+            if (!n) continue;
+            static const char hex[] = "0123456789ABCDEF";
+            labels.assign("port=\"");
+            appendLabelValue(labels, metricsPorts[i].name);
+            labels.append("\",type=\"0x");
+            labels.push_back(hex[t >> 4]);
+            labels.push_back(hex[t & 15]);
+            labels.push_back('"');
+            appendMetric(out, "crsf_rx_type_frames_total", labels, n);
+        }
+    }
+
+    // HTTP: по маршрутам и всего
+    appendMetricFamily(out, "crsf_http_requests_total", "counter", "HTTP requests by route");
+    HttpRouteStats rs;
+    for (size_t i = 0; telemetryServer.routeStats(i, rs); ++i) {
+        labels.assign("path=\"");
+        appendLabelValue(labels, i < telemetryServer.routeCount() ? telemetryServer.route(i).path : "other");
+        labels.push_back('"');
+        appendMetric(out, "crsf_http_requests_total", labels, rs.requests);
+    }
+    appendMetricFamily(out, "crsf_http_request_duration_seconds", "histogram",
+                       "Time spent in the route handler, without network I/O");
+    for (size_t i = 0; telemetryServer.routeStats(i, rs); ++i) {
+        std::string path("path=\"");
+        appendLabelValue(path, i < telemetryServer.routeCount() ? telemetryServer.route(i).path : "other");
+        path.push_back('"');
+        uint64_t cumulative = 0;
+        for (unsigned b = 0; b < HttpRouteStats::BUCKETS; ++b) {
+            cumulative += rs.buckets[b];
+            labels.assign(path).append(",le=\"");
+            if (b + 1 < HttpRouteStats::BUCKETS) appendFixed(labels, HttpRouteStats::BUCKET_US[b], 6);
+            else labels.append("+Inf");
+            labels.push_back('"');
+            appendMetric(out, "crsf_http_request_duration_seconds_bucket", labels, cumulative);
+        }
+        out.append("crsf_http_request_duration_seconds_sum{").append(path).append("} ");
+        appendFixed(out, static_cast<int64_t>(rs.durationUs), 6);
+        out.push_back('\n');
+        appendMetric(out, "crsf_http_request_duration_seconds_count", path, rs.requests);
+    }
+    appendMetricFamily(out, "crsf_http_responses_total", "counter", "HTTP responses by status class");
+    for (unsigned c = 1; c <= 5; ++c) {
+        labels.assign("code=\"");
+        labels.push_back(static_cast<char>('0' + c));
+        labels.append("xx\"");
+        appendMetric(out, "crsf_http_responses_total", labels, telemetryServer.responses(c));
+    }
+    appendMetricFamily(out, "crsf_http_connections_total", "counter", "Accepted HTTP connections");
+    appendMetric(out, "crsf_http_connections_total", {}, telemetryServer.connections());
+    appendMetricFamily(out, "crsf_http_rejected_total", "counter", "Connections closed because the worker pool was full");
+    appendMetric(out, "crsf_http_rejected_total", {}, telemetryServer.rejected());
+    appendMetricFamily(out, "crsf_http_stream_dropped_total", "counter", "Stream events dropped for slow clients");
+    appendMetric(out, "crsf_http_stream_dropped_total", {}, telemetryServer.streamDropped());
+    appendMetricFamily(out, "crsf_http_ws_messages_total", "counter", "WebSocket messages received");
+    appendMetric(out, "crsf_http_ws_messages_total", {}, telemetryServer.wsMessages());
+
+    // Уставки по UDP по источникам
+    if (const UdpSetpoints* udp = udpInstance.load(std::memory_order_acquire)) {
+        appendMetricFamily(out, "crsf_udp_rejected_total", "counter", "UDP datagrams rejected (no free source slot)");
+        appendMetric(out, "crsf_udp_rejected_total", {}, udp->rejected());
+        static const struct {
+            const char* name;
+            const char* help;
+            uint64_t UdpSetpointStats::*field;
+        } udpMetrics[] = {
+            { "crsf_udp_received_total", "UDP setpoint datagrams received", &UdpSetpointStats::received },
+            { "crsf_udp_accepted_total", "UDP setpoints applied", &UdpSetpointStats::accepted },
+            { "crsf_udp_dropped_total", "UDP setpoints dropped (reordered, duplicate or invalid)", &UdpSetpointStats::dropped },
+            { "crsf_udp_late_total", "UDP setpoints older than the maximum age", &UdpSetpointStats::late },
+        };
+        for (const auto& m : udpMetrics) {
+            appendMetricFamily(out, m.name, "counter", m.help);
+            UdpSetpointStats st;
+            for (int i = 0; udp->stats(i, st); ++i) {
+                char address[INET_ADDRSTRLEN];
+                in_addr a;
+                a.s_addr = st.address;
+                inet_ntop(AF_INET, &a, address, sizeof(address));
+                labels.assign("source=\"").append(address).push_back(':');
+                labels.append(num, std::to_chars(num, num + sizeof(num), st.port).ptr).push_back('"');
+                appendMetric(out, m.name, labels, st.*m.field);
+            }
+        }
+    }
+
+    if (const TelemetryHistory* history = historyInstance.load(std::memory_order_acquire)) {
+        appendMetricFamily(out, "crsf_history_samples_total", "counter", "Telemetry history samples written");
+        appendMetric(out, "crsf_history_samples_total", {}, history->count());
+        appendMetricFamily(out, "crsf_history_capacity", "gauge", "Telemetry history ring capacity");
+        appendMetric(out, "crsf_history_capacity", {}, history->capacity());
+    }
+
+    if (const CrsfFrameLog* log = frameLogInstance.load(std::memory_order_acquire)) {
+        const CrsfFrameLog::Stats st = log->stats();
+        appendMetricFamily(out, "crsf_frame_log_frames_total", "counter", "Frames queued to the flight log");
+        appendMetric(out, "crsf_frame_log_frames_total", {}, st.frames);
+        appendMetricFamily(out, "crsf_frame_log_dropped_total", "counter", "Frames dropped by the flight log");
+        appendMetric(out, "crsf_frame_log_dropped_total", {}, st.dropped);
+        appendMetricFamily(out, "crsf_frame_log_written_total", "counter", "Frames written to flight log segments");
+        appendMetric(out, "crsf_frame_log_written_total", {}, st.written);
+        appendMetricFamily(out, "crsf_frame_log_bytes_total", "counter", "Bytes written to flight log segments");
+        appendMetric(out, "crsf_frame_log_bytes_total", {}, st.bytes);
+        appendMetricFamily(out, "crsf_frame_log_segments_total", "counter", "Flight log segments opened");
+        appendMetric(out, "crsf_frame_log_segments_total", {}, st.segments);
+    }
+
+    // Сквозные задержки: квантили по гистограмме, с прошлого /api/latency?reset=1
+    if (const CrsfLatencyStats* latency = latencyInstance.load(std::memory_order_acquire)) {
+        appendMetricFamily(out, "crsf_latency_seconds", "summary",
+                           "End-to-end latency: setpoint input to channels frame write(), UART read to frame handled");
+        for (unsigned i = 0; i <= CRSF_INPUT_SOURCES; ++i) {
+            const bool rx = i == CRSF_INPUT_SOURCES;
+            const LatencyHistogram::Summary s = rx ? latency->rx.summary() : latency->input[i].summary();
+            const std::string stage = rx ? std::string("stage=\"rx\"")
+                                        : std::string("stage=\"input\",source=\"") + crsf_input_name(i) + "\"";
+            const struct {
+                const char* q;
+                uint64_t ns;
+            } quantiles[] = { { "0.5", s.p50Ns }, { "0.99", s.p99Ns }, { "0.999", s.p999Ns }, { "1", s.maxNs } };
+            for (const auto& q : quantiles) {
+                labels.assign(stage).append(",quantile=\"").append(q.q).push_back('"');
+                out.append("crsf_latency_seconds{").append(labels).append("} ");
+                appendFixed(out, static_cast<int64_t>(q.ns), 9);
+                out.push_back('\n');
+            }
+            out.append("crsf_latency_seconds_sum{").append(stage).append("} ");
+            appendFixed(out, static_cast<int64_t>(s.sumNs), 9);
+            out.push_back('\n');
+            appendMetric(out, "crsf_latency_seconds_count", stage, s.count);
+        }
+    }
+}
+
+// Издатель /api/stream: спит до нового снимка, сериализует его один раз и раздаёт всем подписчикам.
+// Без подписчиков только ждёт. При долгой тишине шлёт комментарий SSE, чтобы клиент и прокси
+// не считали подключение мёртвым, а сервер заметил отвалившихся клиентов по ошибке отправки
+static std::thread streamThread;
+static std::atomic<bool> streamStop{false};
+
+static void streamPublisher() {
+    std::string json;
+    std::string event;
+    uint32_t version = getTelemetryVersion();
+    auto lastEvent = std::chrono::steady_clock::now();
+    while (!streamStop.load(std::memory_order_relaxed)) {
+        const bool changed = waitTelemetry(version, 1000);
+        const auto now = std::chrono::steady_clock::now();
+        const bool sse = telemetryServer.subscribers(TELEMETRY_STREAM_TOPIC) > 0;
+        const bool ws = telemetryServer.subscribers(TELEMETRY_WS_TOPIC) > 0;
+        if (!sse && !ws) {
+            version = getTelemetryVersion();
+            lastEvent = now;
+            continue;
+        }
+        if (changed) {
+            // Один JSON на снимок для обоих видов подписчиков
+            version = getTelemetryVersion();
+            writeTelemetryJson(json);
+            if (sse) {
+                event.clear();
+                appendTelemetryEvent(event, version, json);
+                telemetryServer.publish(TELEMETRY_STREAM_TOPIC, event.data(), event.size());
+            }
+            if (ws) {
+                event.clear();
+                appendTelemetryWsMessage(event, version, json);
+                telemetryServer.publish(TELEMETRY_WS_TOPIC, event.data(), event.size());
+            }
+            lastEvent = now;
+        } else if (sse && now - lastEvent >= std::chrono::seconds(5)) {
+            // WebSocket проверяет живость сам (ping/pong в HttpServer)
+            event.assign(": ping\n\n");
+            telemetryServer.publish(TELEMETRY_STREAM_TOPIC, event.data(), event.size());
+            lastEvent = now;
+        }
+    }
+}
+
+void stopTelemetryServer() {
+    streamStop.store(true, std::memory_order_relaxed);
+    if (streamThread.joinable())
+        streamThread.join();
+    telemetryServer.stop();
+}
+
+// Останавливает издателя раньше, чем разрушится telemetryServer (объявлен после него)
+static struct TelemetryServerGuard {
+    ~TelemetryServerGuard() { stopTelemetryServer(); }
+} telemetryServerGuard;
+
+// Основная функция веб-сервера: запускает рабочие потоки и возвращается
+void startTelemetryServer(CrsfSerial* crsf, int port) {
+    std::cout << "🌐 Запуск веб-сервера телеметрии (обновление по новым кадрам CRSF)..." << std::endl;
+    // Повторный запуск: прежний сервер и издатель останавливаются
+    stopTelemetryServer();
+    setTelemetrySource(crsf);
     
-    close(serverSocket);
+    if (!telemetryServer.start(port, TELEMETRY_HTTP_WORKERS, TELEMETRY_HTTP_MAX_CONNECTIONS, 10000,
+                               TELEMETRY_STREAM_QUEUE)) {
+        std::cerr << "❌ Ошибка привязки к порту " << port << std::endl;
+        return;
+    }
+    streamStop.store(false, std::memory_order_relaxed);
+    streamThread = std::thread(streamPublisher);
+    
+    std::cout << "🌐 Веб-сервер телеметрии запущен на порту " << port << std::endl;
+    std::cout << "📱 Откройте браузер: http://localhost:" << port << std::endl;
 }
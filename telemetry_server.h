@@ -3,9 +3,83 @@
 
 #include "libs/crsf/CrsfSerial.h"
 #include <string>
+#include <string_view>
 
 // Запуск веб-сервера телеметрии
-void startTelemetryServer(CrsfSerial* crsf, int port = 8080, int updateIntervalMs = 50);
+void startTelemetryServer(CrsfSerial* crsf, int port = 8080);
+// Остановить веб-сервер и издателя /api/stream (вызывается и при выходе из программы)
+void stopTelemetryServer();
+
+// Источник данных телеметрии (задаётся и в startTelemetryServer)
+void setTelemetrySource(CrsfSerial* crsf);
+class UdpSetpoints;
+// Приёмник уставок по UDP: его счётчики отдаёт /api/udp (nullptr — не подключён)
+void setUdpSetpointsSource(const UdpSetpoints* udp);
+class TelemetryHistory;
+// История снимков для /api/history (nullptr — не ведётся)
+void setTelemetryHistorySource(const TelemetryHistory* history);
+// CRSF-порт для /metrics: счётчики приёма и передачи с меткой port="name" (до TELEMETRY_METRICS_PORTS портов).
+// Повторная регистрация того же объекта не добавляет порт; false — мест нет
+static const unsigned TELEMETRY_METRICS_PORTS = 4;
+bool addMetricsPort(const char* name, const CrsfSerial* crsf);
+class CrsfFrameLog;
+// Бортовой журнал кадров для /metrics (nullptr — не ведётся)
+void setFrameLogSource(const CrsfFrameLog* log);
+// Гистограммы сквозных задержек для /api/latency и /metrics (nullptr — не ведутся); /api/latency?reset=1 их обнуляет
+void setLatencySource(CrsfLatencyStats* latency);
+// Снять данные CrsfSerial в телеметрию, если с прошлого раза опубликован новый снимок.
+// false — нового снимка не было, ничего не копировалось
+bool updateTelemetry();
+// Номер последнего снимка CrsfSerial (0 — источника нет)
+uint32_t getTelemetryVersion();
+// Спать до снимка новее version, не дольше timeoutMs; true — есть новый снимок.
+// Для потоковых клиентов: будятся только новыми данными, а не таймером
+bool waitTelemetry(uint32_t version, int timeoutMs);
+// Поля верхнего уровня JSON телеметрии (битовая маска для fields=)
+enum : uint32_t {
+    TELEMETRY_FIELD_LINK_UP          = 1u << 0,
+    TELEMETRY_FIELD_ACTIVE_PORT      = 1u << 1,
+    TELEMETRY_FIELD_LAST_RECEIVE     = 1u << 2,
+    TELEMETRY_FIELD_TIMESTAMP        = 1u << 3,
+    TELEMETRY_FIELD_CHANNELS         = 1u << 4,
+    TELEMETRY_FIELD_PACKETS_RECEIVED = 1u << 5,
+    TELEMETRY_FIELD_PACKETS_SENT     = 1u << 6,
+    TELEMETRY_FIELD_PACKETS_LOST     = 1u << 7,
+    TELEMETRY_FIELD_GPS              = 1u << 8,
+    TELEMETRY_FIELD_BATTERY          = 1u << 9,
+    TELEMETRY_FIELD_ATTITUDE         = 1u << 10,
+    TELEMETRY_FIELD_ATTITUDE_RAW     = 1u << 11,
+    TELEMETRY_FIELD_WORK_MODE        = 1u << 12,
+    TELEMETRY_FIELDS_ALL             = (1u << 13) - 1,
+};
+// Маска по списку имён через запятую ("channels,attitude"); пустой список — все поля, 0 — неизвестное имя
+uint32_t parseTelemetryFields(std::string_view list);
+
+// JSON для /api/telemetry из последнего снимка. Документ кэшируется по номеру снимка, режиму и полям:
+// сколько бы клиентов ни опрашивали один снимок, он сериализуется один раз
+std::string createTelemetryJson(uint32_t fields = TELEMETRY_FIELDS_ALL);
+// То же в буфер вызывающего: ёмкость out сохраняется, при повторных вызовах память не выделяется
+void writeTelemetryJson(std::string& out, uint32_t fields = TELEMETRY_FIELDS_ALL);
+// Сериализовать текущие данные в buf без кэша и без подтягивания снимка; длина или 0, если не уместилось
+size_t renderTelemetryJson(char* buf, size_t size, uint32_t fields = TELEMETRY_FIELDS_ALL);
+
+// Двоичные сообщения /api/ws (все числа little-endian):
+//   клиент → сервер, уставки каналов: [0x01][seq u32][mask u16][значение u16 (мкс) на каждый бит mask, по возрастанию]
+//                    режим:           [0x02][seq u32][0 — joystick, 1 — manual]
+//   сервер → клиент, подтверждение:   [0x80 | тип][seq u32][статус]
+// seq растёт у клиента с каждым сообщением; сообщение с seq не новее последнего принятого
+// на этом подключении устарело и отбрасывается (статус STALE) — значения не применяются
+enum : uint8_t {
+    TELEMETRY_WS_SETPOINTS = 0x01,
+    TELEMETRY_WS_MODE      = 0x02,
+    TELEMETRY_WS_ACK       = 0x80,
+};
+enum : uint8_t {
+    TELEMETRY_WS_OK        = 0,
+    TELEMETRY_WS_STALE     = 1,
+    TELEMETRY_WS_INVALID   = 2,   // неверный формат или значение вне 1000..2000: ничего не применено
+    TELEMETRY_WS_NO_SOURCE = 3,   // нет CrsfSerial
+};
 
 // Получить текущий режим работы
 std::string getWorkMode();